@@ -10,7 +10,11 @@ StructuredBuffer<HalfEdge>	inputCage	: register(t0);
 StructuredBuffer<Vertex>	inputPoints : register(t1);
 StructuredBuffer<HE_Face>	inputFaces	: register(t2);
 StructuredBuffer<uint>		faceLookup	: register(t3);
-RWStructuredBuffer<HE_Face>	outFaces	: register(u0, space0);
+StructuredBuffer<NormalCone>	faceCones	: register(t4); // faces, then one per 32 face cluster
+StructuredBuffer<uint2>			faceList	: register(t5); // faces to refine this frame, y is the face's level, the highest any view asks for
+StructuredBuffer<float4>		facePoints	: register(t6); // per control face, from BuildFacePoints in HE_FacePoints.hlsl
+StructuredBuffer<AABB>			faceBounds	: register(t7); // per control face, HE_PatchBounds, the hull of its one-ring
+RWStructuredBuffer<HE_Face>	outFaces	: register(u0, space0); // visible faces, level set from faceList
 
 RWStructuredBuffer<TwinEdge>	cages[]		: register(u0, space1);
 RWStructuredBuffer<Vertex>		points[]	: register(u0, space2);
@@ -22,11 +26,22 @@ cbuffer ViewConstants : register(b0)
 	float4x4	view;
 	uint		heCount;
 	uint		patchCount;
+	uint		faceListCount;
 };
 
-cbuffer ViewConstants : register(b1)
+#define HE_MAX_VIEWS 8
+
+struct CullView
+{
+	float4x4	view;
+	Frustum		frustum;
+};
+
+// Every view shares one refinement, a face is kept when any of them can see it
+cbuffer CullViews : register(b1)
 {
-	Frustum frustum;
+	CullView	cullViews[HE_MAX_VIEWS];
+	uint		viewCount;
 };
 
 
@@ -157,6 +172,7 @@ struct BuildEdgesArgs
 
 groupshared uint			localPatchCount;
 groupshared uint			localEdgeCount;
+groupshared uint			localVisibleEdges[32];	// Edge count of each thread's face, 0 when culled
 
 [Shader("node")]
 [NodeLaunch("broadcasting")]
@@ -171,8 +187,9 @@ void SubdivideHalfEdgeMesh(
 					const uint										dispatchThreadID	: SV_DispatchThreadID, 
 					const uint										groupDispatchID		: SV_GroupIndex)
 {
-	if(dispatchThreadID >= patchCount)
-		return;
+	// Threads past faceListCount stay alive to the end, the group barriers and the group output
+	// records need every thread of the group. They count as culled faces and skip their writes.
+	const bool live = dispatchThreadID < faceListCount;
 
 	if(groupDispatchID == 0)	
 	{
@@ -182,45 +199,67 @@ void SubdivideHalfEdgeMesh(
 
 	GroupMemoryBarrierWithGroupSync();
 	
-	const HE_Face face = inputFaces[dispatchThreadID];
+	const uint2		entry	= live ? faceList[dispatchThreadID] : uint2(0, 0);
+	const uint		faceIdx	= entry.x;
+	HE_Face			face	= inputFaces[faceIdx];
 
-	AABB aabb;
-	aabb.mMin = float3( 100000,  100000,  100000);
-	aabb.mMax = float3(-100000, -100000, -100000);
-	
-	float3 f = float3(0, 0, 0);
-	for(int i = 0; i < face.edgeCount; i++)
-	{	
-		HalfEdge he = inputCage[face.begin + i];
-		
-		const float3 xyz = inputPoints[he.vert].xyz;
-		f += xyz;
-		aabb.Add(mul(view, float4(xyz, 1)));
+	face.level = (uint16_t)entry.y;
+
+	bool intersects = false;
+	if(live)
+	{
+		const NormalCone clusterCone	= faceCones[patchCount + faceIdx / 32];
+		const NormalCone faceCone		= faceCones[faceIdx];
+
+		for(uint viewIdx = 0; viewIdx < viewCount && !intersects; viewIdx++)
+		{
+			const float4x4 cullView = cullViews[viewIdx].view;
+
+			if(IsBackFacing(clusterCone, cullView) || IsBackFacing(faceCone, cullView))
+				continue;
+
+			// The limit patch depends on the one-ring, not just the face's corners. Its world space hull
+			// holds the patch at every level, so faces near silhouettes are not culled early.
+			intersects = Intersects(cullViews[viewIdx].frustum, TransformAABB(faceBounds[faceIdx], cullView));
+		}
 	}
-	
-	const bool intersects = Intersects(frustum, aabb);
-	uint patchIdx;
-	uint edgeIdx;
-	
+	localVisibleEdges[groupDispatchID] = intersects ? face.edgeCount : 0;
+
+	GroupMemoryBarrierWithGroupSync();
+
+	// Exclusive prefix sum over the threads before this one, visible faces keep their face list order
+	// in the record instead of the order their atomics landed in
+	uint patchIdx = 0;
+
+	for (uint threadIdx = 0; threadIdx < groupDispatchID; threadIdx++)
+		patchIdx += localVisibleEdges[threadIdx] != 0 ? 1 : 0;
+
 	if(intersects)
 	{
-		InterlockedAdd(args.Get().patchCount, 1), 
+		uint drawIdx;
+		InterlockedAdd(args.Get().patchCount, 1, drawIdx);
 		InterlockedAdd(args.Get().halfEdgeCount, face.edgeCount);
-		InterlockedAdd(localPatchCount, 1, patchIdx);
-		InterlockedAdd(localEdgeCount,	face.edgeCount, edgeIdx);
+
+		outFaces[drawIdx] = face;
+
+		InterlockedAdd(localPatchCount, 1);
+		InterlockedAdd(localEdgeCount,	face.edgeCount);
 
 		const uint	vertexCount	= face.GetVertexCount();
-		points[0][face.vertexRange + vertexCount - 1].xyz	= f / face.edgeCount;
+		points[0][face.vertexRange + vertexCount - 1].xyz	= facePoints[faceIdx].xyz;
 		points[0][face.vertexRange + vertexCount - 1].color	= 6;
 	}
 
 	GroupMemoryBarrierWithGroupSync();
-	GroupNodeOutputRecords<BuildFace2Args> dispatchEdges = BuildEdges2.GetGroupNodeOutputRecords(intersects);
+
+	// The record count has to be uniform across the group, groups with nothing visible emit none
+	const uint recordCount = localPatchCount != 0 ? 1 : 0;
+	GroupNodeOutputRecords<BuildFace2Args> dispatchEdges = BuildEdges2.GetGroupNodeOutputRecords(recordCount);
 	
 	if(intersects)
 		dispatchEdges[0].faces[patchIdx] = face;
 	
-	if(groupDispatchID == 0)
+	if(groupDispatchID == 0 && recordCount != 0)
 	{
 		dispatchEdges[0].edgeCount		= localEdgeCount;
 		dispatchEdges[0].patchCount		= localPatchCount;
@@ -255,24 +294,11 @@ void SubdivideHalfEdgeMesh(
 /************************************************************************************************/
 
 
+// Face points are evaluated once per control face by BuildFacePoints, the edge and vertex
+// rules read them instead of walking the face of every half-edge around them
 float3 GetFacePoint(uint halfEdgeID)
 {
-	HalfEdge he = inputCage[halfEdgeID];
-	float3	f = inputPoints[he.vert].xyz;
-	float	n = 1.0f;
-	
-	while (he.next != halfEdgeID)
-	{
-		he					= inputCage[he.next];
-		const float3 xyz	= inputPoints[he.vert].xyz;
-		f += xyz;
-		n += 1.0f;
-		
-		if(n > 16)
-			return float3(100000000, 100000000, 100000000);
-	}
-	
-	return f / n;
+	return facePoints[faceLookup[halfEdgeID]].xyz;
 }
 
 
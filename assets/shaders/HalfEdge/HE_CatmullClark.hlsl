@@ -126,24 +126,24 @@ void SubdivideTwinEdges(
 	const TwinEdge te		= inputCage[edgeItr];
 	const TwinEdge prevEdge	= inputCage[Prev(edgeItr)];
 		
-	TwinEdge edge0;
+	TwinEdge edge0 = (TwinEdge)0;
 	edge0.twin = te.Border() ? BORDERVALUE : (Next(te.Twin()) * 4 + 3);
 	edge0.vert = vertexBlock + 2 * i + 0;
 	edge0.MarkCorner(te.IsCorner());
 	edge0.MarkT(te.IsT());
 	outputCage[outputIdx + 0] = edge0;
 
-	TwinEdge edge1;
+	TwinEdge edge1 = (TwinEdge)0;
 	edge1.twin = Next(edgeItr) * 4 + 2;
 	edge1.vert = vertexBlock + 2 * i + 1;
 	outputCage[outputIdx + 1] = edge1;
 		
-	TwinEdge edge2;
+	TwinEdge edge2 = (TwinEdge)0;
 	edge2.twin = Prev(edgeItr) * 4 + 1;
 	edge2.vert = vertexBlock + 8;
 	outputCage[outputIdx + 2] = edge2;
 		
-	TwinEdge edge3;
+	TwinEdge edge3 = (TwinEdge)0;
 	edge3.twin = prevEdge.Border() ? BORDERVALUE : (prevEdge.Twin() * 4);
 	edge3.vert = vertexBlock + (9 - 2 + 2 * i) % 8;
 	edge3.MarkT(prevEdge.Border());
@@ -1,46 +1,49 @@
 /************************************************************************************************/
 
-#define BORDERVALUE (0xffffffff >> 2)
-#define TWINMASK (0xffffffff >> 2)
+// Twins use all 32 bits, the corner and T flags have their own word. Mirrored in HalfEdgeCPU.hpp
+#define BORDERVALUE (0xffffffff)
+#define CORNERFLAG (1 << 0)
+#define TFLAG (1 << 1)
 
 /************************************************************************************************/
 
 
 struct HalfEdge
 {
-	int32_t twin;
+	uint32_t twin;
 	uint32_t next;
 	uint32_t prev;
 	uint32_t vert;
+	uint32_t flags;
 	
 	uint32_t Twin()
 	{
-		return twin & TWINMASK;
+		return twin;
 	}
 	
 	bool Border()
 	{
-		return Twin() == BORDERVALUE;
+		return twin == BORDERVALUE;
 	}
 	
 	bool IsCorner()
 	{
-		return (twin & (1 << 31)) != 0;
+		return (flags & CORNERFLAG) != 0;
 	}
 	
 	bool IsT()
 	{
-		return (twin & (1 << 30)) != 0;
+		return (flags & TFLAG) != 0;
 	}
 	
 	void MarkCorner(bool f)
 	{
-		twin = Twin() | (f << 31);
+		flags = (flags & ~CORNERFLAG) | (f ? CORNERFLAG : 0);
 	}
 	
 	void MarkT(bool f)
 	{
-		twin = Twin() | (f << 30);
+		flags = (flags & ~TFLAG) | (f ? TFLAG : 0);
 	}
 };
 
@@ -71,39 +74,42 @@ HE_Face MakeFace(uint32_t begin, uint32_t vertexRange, uint16_t edgeCount = 4, u
 /************************************************************************************************/
 
 
+// 16 byte stride, HalfEdgeMesh::TwinEdgeStride
 struct TwinEdge
 {
-	int32_t twin;
+	uint32_t twin;
 	uint32_t vert;
+	uint32_t flags;
+	uint32_t padding;
 	
 	uint32_t Twin()
 	{
-		return twin & TWINMASK;
+		return twin;
 	}
 	
 	bool Border()
 	{
-		return Twin() == BORDERVALUE;
+		return twin == BORDERVALUE;
 	}
 	
 	bool IsCorner()
 	{
-		return (twin & (1 << 31)) != 0;
+		return (flags & CORNERFLAG) != 0;
 	}
 	
 	void MarkCorner(bool f)
 	{
-		twin = Twin() | (f << 31);
+		flags = (flags & ~CORNERFLAG) | (f ? CORNERFLAG : 0);
 	}
 	
 	bool IsT()
 	{
-		return (twin & (1 << 30)) != 0;
+		return (flags & TFLAG) != 0;
 	}
 	
 	void MarkT(bool f)
 	{
-		twin = Twin() | (f << 30);
+		flags = (flags & ~TFLAG) | (f ? TFLAG : 0);
 	}
 };
 
@@ -235,24 +241,24 @@ void SubdividePatch(
 		HalfEdge he			= inputCage[edgeItr];
 		HalfEdge prevEdge	= inputCage[he.prev];
 		
-		TwinEdge edge0;
+		TwinEdge edge0 = (TwinEdge)0;
 		edge0.twin = he.Border() ? BORDERVALUE : (Next(inputCage, he.Twin()) * 4 + 3);
 		edge0.vert = idx + 2 * i + 0;
 		edge0.MarkCorner(he.IsCorner());
 		edge0.MarkT(he.IsT());
 		outputCage[outputIdx + 0] = edge0;
 
-		TwinEdge edge1;
+		TwinEdge edge1 = (TwinEdge)0;
 		edge1.twin = (beginCount.x + (beginCount.y + i + 1) % beginCount.y) * 4 + 2;
 		edge1.vert = idx + 2 * i + 1;
 		outputCage[outputIdx + 1] = edge1;
 		
-		TwinEdge edge2;
+		TwinEdge edge2 = (TwinEdge)0;
 		edge2.twin = (beginCount.x + (beginCount.y + i - 1) % beginCount.y) * 4 + 1;
 		edge2.vert = idx + vertexCount - 1;
 		outputCage[outputIdx + 2] = edge2;
 		
-		TwinEdge edge3;
+		TwinEdge edge3 = (TwinEdge)0;
 		edge3.twin = prevEdge.Border() ? BORDERVALUE : (prevEdge.Twin() * 4);
 		edge3.vert = idx + (vertexCount - 2 + 2 * i) % (vertexCount - 1);
 		outputCage[outputIdx + 3] = edge3;
@@ -284,25 +290,25 @@ void GetSubTwinEdges(uint i, inout TwinEdge edges[4])
 	TwinEdge hePrev			= edges[Next(i % 4)];
 	const uint vertexCount	= 9;
 	
-	TwinEdge edge0;
+	TwinEdge edge0 = (TwinEdge)0;
 	edge0.twin	= he.Border() ? BORDERVALUE : (Next(he.Twin()) * 4 + 3);
 	edge0.vert	= i * 9 + 2 * i + 0;
 	edge0.MarkCorner(he.IsCorner());
 	edge0.MarkT(he.IsT());
 	edges[0]	= edge0;
 	
-	TwinEdge edge1;
+	TwinEdge edge1 = (TwinEdge)0;
 	edge1.twin	= (i * 9 + (4 + i + 1) % 4) * 4 + 2;
 	edge1.vert	= i * 9 + 2 * i + 1;
 	edge1.MarkT(edge0.Border());
 	edges[1]	= edge1;
 	
-	TwinEdge edge2;
+	TwinEdge edge2 = (TwinEdge)0;
 	edge2.twin	= (i * 9 + (4 + i - 1) % 4) * 4 + 1;
 	edge2.vert	= i * 9 + vertexCount - 1;
 	edges[2]	= edge2;
 	
-	TwinEdge edge3;
+	TwinEdge edge3 = (TwinEdge)0;
 	edge3.twin	= hePrev.Border() ? BORDERVALUE : (hePrev.Twin() * 4);
 	edge3.vert	= i * 9 + (vertexCount - 2 + 2 * i) % (vertexCount - 1);
 	edges[3]	= edge3;
@@ -318,25 +324,57 @@ void GetTwinEdges(HE_Face face, uint i, out TwinEdge edges[4], StructuredBuffer<
 	HalfEdge hePrev			= inputCage[he.prev];
 	const uint vertexCount	= face.GetVertexCount();
 	
-	TwinEdge edge0;
+	TwinEdge edge0 = (TwinEdge)0;
 	edge0.twin	= he.Border() ? BORDERVALUE : (Next(inputCage, he.Twin()) * 4 + 3);
 	edge0.vert	= face.vertexRange + 2 * i + 0;
 	edge0.MarkCorner(he.IsCorner());
 	edge0.MarkT(he.IsT());
 	edges[0]	= edge0;
 	
-	TwinEdge edge1;
+	TwinEdge edge1 = (TwinEdge)0;
 	edge1.twin	= (face.begin + (face.edgeCount + i + 1) % face.edgeCount) * 4 + 2;
 	edge1.vert	= face.vertexRange + 2 * i + 1;
 	edge1.MarkT(edge0.Border());
 	edges[1]	= edge1;
 	
-	TwinEdge edge2;
+	TwinEdge edge2 = (TwinEdge)0;
 	edge2.twin	= (face.begin + (face.edgeCount + i - 1) % face.edgeCount) * 4 + 1;
 	edge2.vert	= face.vertexRange + vertexCount - 1;
 	edges[2]	= edge2;
 	
-	TwinEdge edge3;
+	TwinEdge edge3 = (TwinEdge)0;
+	edge3.twin	= hePrev.Border() ? BORDERVALUE : (hePrev.Twin() * 4);
+	edge3.vert	= face.vertexRange + (vertexCount - 2 + 2 * i) % (vertexCount - 1);
+	edges[3]	= edge3;
+}
+
+
+// Patches of a level, every face a quad whose next and prev follow from the index
+void GetTwinEdges(HE_Face face, uint i, out TwinEdge edges[4], StructuredBuffer<TwinEdge> inputLevel)
+{
+	TwinEdge he				= inputLevel[face.begin + i];
+	TwinEdge hePrev			= inputLevel[Prev(face.begin + i)];
+	const uint vertexCount	= face.GetVertexCount();
+	
+	TwinEdge edge0 = (TwinEdge)0;
+	edge0.twin	= he.Border() ? BORDERVALUE : (Next(he.Twin()) * 4 + 3);
+	edge0.vert	= face.vertexRange + 2 * i + 0;
+	edge0.MarkCorner(he.IsCorner());
+	edge0.MarkT(he.IsT());
+	edges[0]	= edge0;
+	
+	TwinEdge edge1 = (TwinEdge)0;
+	edge1.twin	= (face.begin + (face.edgeCount + i + 1) % face.edgeCount) * 4 + 2;
+	edge1.vert	= face.vertexRange + 2 * i + 1;
+	edge1.MarkT(edge0.Border());
+	edges[1]	= edge1;
+	
+	TwinEdge edge2 = (TwinEdge)0;
+	edge2.twin	= (face.begin + (face.edgeCount + i - 1) % face.edgeCount) * 4 + 1;
+	edge2.vert	= face.vertexRange + vertexCount - 1;
+	edges[2]	= edge2;
+	
+	TwinEdge edge3 = (TwinEdge)0;
 	edge3.twin	= hePrev.Border() ? BORDERVALUE : (hePrev.Twin() * 4);
 	edge3.vert	= face.vertexRange + (vertexCount - 2 + 2 * i) % (vertexCount - 1);
 	edges[3]	= edge3;
@@ -1,3 +1,5 @@
+#include "HE_Common.hlsl"
+
 #define BuildLevelRS "UAV(u0)," \
 					 "UAV(u1)," \
 					 "UAV(u2)," \
@@ -8,21 +10,16 @@
 cbuffer constants : register(b0)
 {
 	uint count;
+	uint deterministic;	// Place output by face index instead of by counter
 };
 
-struct HalfEdge
-{
-	 int32_t twin;
-	uint32_t next;
-	uint32_t prev;
-	uint32_t vert;
-};
-
-StructuredBuffer<HalfEdge>	halfEdge	: register(t0);
-StructuredBuffer<float3>	inputVerts	: register(t1);
+// Input and output levels hold TwinEdge records, HalfEdgeMesh::TwinEdgeStride, as the work graph
+// writes them. Every face of a level is a quad patch, next and prev follow from the index.
+StructuredBuffer<TwinEdge>	inputLevel	: register(t0);
+StructuredBuffer<Vertex>	inputVerts	: register(t1);
 
-RWStructuredBuffer<HalfEdge>	outputStructure		: register(u0);
-RWStructuredBuffer<float3>		vertexPoints		: register(u1);
+RWStructuredBuffer<TwinEdge>	outputStructure		: register(u0);
+RWStructuredBuffer<Vertex>		vertexPoints		: register(u1);
 RWStructuredBuffer<uint>		counters			: register(u2);
 
 [RootSignature(BuildLevelRS)]
@@ -32,55 +29,38 @@ void BuildLevel(const uint threadID : SV_DispatchThreadID)
 	if (threadID >= count)
 		return;
 	
-	float3 facePoint = float3(0, 0, 0);
+	const uint vertexCount = 9;
 	
 	uint idx;
-	uint vertexCount = 9;
 	InterlockedAdd(counters[0], vertexCount, idx);
+
+	const HE_Face face = MakeFace(4 * threadID, deterministic ? vertexCount * threadID : idx);
 	
-	uint32_t edgeItr = threadID * 16;
+	float3 facePoint = float3(0, 0, 0);
 
-	for (int32_t i = 0; i < 4; i++)
+	for (uint i = 0; i < 4; i++)
 	{
-		const uint outputIdx = edgeItr * 4;
-		HalfEdge he = halfEdge[threadID * 4 + i];
-		
-		HalfEdge edge0;
-		edge0.twin = (he.twin != -1) ? (halfEdge[he.twin].next * 4 + 3) : -1;
-		edge0.next = outputIdx + 1;
-		edge0.prev = outputIdx + 3;
-		edge0.vert = idx + 2 * i + 0;
-		outputStructure[4 * i + threadID * 16] = edge0;
-
-		HalfEdge edge1;
-		edge1.twin = ((outputIdx * 4 + 4 + i + 1) % 4) * 4 + 2;
-		edge1.next = outputIdx + 2;
-		edge1.prev = outputIdx + 0;
-		edge1.vert = idx + 2 * i + 1;
-		outputStructure[1 + 4 * i + threadID * 16] = edge1;
-		
-		HalfEdge edge2;
-		edge2.twin = ((outputIdx * 4 + 4 + i - 1) % 4) * 4 + 1;
-		edge2.next = outputIdx + 3;
-		edge2.prev = outputIdx + 1;
-		edge2.vert = idx + vertexCount - 1;
-		outputStructure[2 + 4 * i + threadID * 16] = edge2;
-		
-		HalfEdge edge3;
-		edge3.twin = (he.twin != -1) ? (halfEdge[he.prev].twin * 4 + 3) : -1;
-		edge3.next = outputIdx + 0;
-		edge3.prev = outputIdx + 2;
-		edge3.vert = idx + (vertexCount - 2 + 2 * i) % (vertexCount - 1);
-		outputStructure[3 + 4 * i + threadID * 16] = edge3;
-
-		facePoint += inputVerts[he.vert];
-		edgeItr = he.next;
+		const uint		edgeID	= face.begin + i;
+		const TwinEdge	he		= inputLevel[edgeID];
+
+		TwinEdge edges[4];
+		GetTwinEdges(face, i, edges, inputLevel);
+
+		outputStructure[4 * edgeID + 0] = edges[0];
+		outputStructure[4 * edgeID + 1] = edges[1];
+		outputStructure[4 * edgeID + 2] = edges[2];
+		outputStructure[4 * edgeID + 3] = edges[3];
+
+		const float3 p0 = inputVerts[he.vert].xyz;
+		const float3 p1 = inputVerts[inputLevel[Next(edgeID)].vert].xyz;
+
+		facePoint += p0;
 		
-		vertexPoints[idx + 2 * i + 0] = inputVerts[he.vert];
-		vertexPoints[idx + 2 * i + 1] = (inputVerts[he.vert] + inputVerts[halfEdge[he.next].vert]) / 2;
+		vertexPoints[face.vertexRange + 2 * i + 0] = MakeVertex(p0);
+		vertexPoints[face.vertexRange + 2 * i + 1] = MakeVertex((p0 + p1) / 2);
 	}
 	
-	vertexPoints[idx + vertexCount - 1] = facePoint / 4;
+	vertexPoints[face.vertexRange + vertexCount - 1] = MakeVertex(facePoint / 4);
 }
 
 
@@ -0,0 +1,76 @@
+#include "HE_Common.hlsl"
+
+#define BuildFacePointsRS	"SRV(t0)," \
+							"SRV(t1)," \
+							"SRV(t2)," \
+							"UAV(u0)," \
+							"RootConstants(num32BitConstants = 1, b0)"
+
+cbuffer constants : register(b0)
+{
+	uint faceCount;
+};
+
+StructuredBuffer<HalfEdge>	inputCage	: register(t0);
+StructuredBuffer<Vertex>	inputPoints	: register(t1);
+StructuredBuffer<HE_Face>	inputFaces	: register(t2);
+
+RWStructuredBuffer<float4>	facePoints	: register(u0);
+
+
+/************************************************************************************************/
+
+
+// First phase of a subdivision pass: every control face point is evaluated once, the edge and
+// vertex rules in HE_AdaptiveCC.hlsl read them through faceLookup instead of walking each face
+// around every edge and vertex again. Rerun only when the control points change.
+[RootSignature(BuildFacePointsRS)]
+[numthreads(64, 1, 1)]
+void BuildFacePoints(const uint threadID : SV_DispatchThreadID)
+{
+	if (threadID >= faceCount)
+		return;
+
+	const HE_Face face = inputFaces[threadID];
+
+	// Same pairwise tree as HE_FacePoint in HalfEdgeCPU.hpp, the sum does not depend on the order
+	// faces are scheduled in and matches the CPU reference term for term
+	const uint n = clamp(face.edgeCount, 1, 16);
+
+	float3 terms[16];
+	for (uint i = 0; i < n; i++)
+		terms[i] = inputPoints[inputCage[face.begin + i].vert].xyz;
+
+	for (uint stride = 1; stride < n; stride *= 2)
+	{
+		for (uint j = 0; j + stride < n; j += 2 * stride)
+			terms[j] += terms[j + stride];
+	}
+
+	facePoints[threadID] = float4(terms[0] / n, 1.0f);
+}
+
+
+/**********************************************************************
+
+Copyright (c) 2024 Robert May
+
+Permission is hereby granted, free of charge, to any person obtaining a
+copy of this software and associated documentation files (the "Software"),
+to deal in the Software without restriction, including without limitation
+the rights to use, copy, modify, merge, publish, distribute, sublicense,
+and/or sell copies of the Software, and to permit persons to whom the
+Software is furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included
+in all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+**********************************************************************/
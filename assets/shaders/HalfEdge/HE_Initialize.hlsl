@@ -1,3 +1,5 @@
+#include "HE_Common.hlsl"
+
 #define BuildBisectorsRS	"UAV(u0)," \
 							"UAV(u1)," \
 							"UAV(u2)," \
@@ -9,22 +11,16 @@
 cbuffer constants : register(b0)
 {
 	uint count;
-};
-
-struct HalfEdge
-{
-	 int32_t twin;
-	uint32_t next;
-	uint32_t prev;
-	uint32_t vert;
+	uint deterministic;	// Place output by face index instead of by counter
 };
 
 StructuredBuffer<HalfEdge>	halfEdge	: register(t0);
-StructuredBuffer<float3>	inputVerts	: register(t1);
-StructuredBuffer<uint2>		inputFaces	: register(t2);
+StructuredBuffer<Vertex>	inputVerts	: register(t1);
+StructuredBuffer<HE_Face>	inputFaces	: register(t2);
 
-RWStructuredBuffer<HalfEdge>	outputStructure		: register(u0);
-RWStructuredBuffer<float3>		vertexPoints		: register(u1);
+// Level buffers hold TwinEdge records, HalfEdgeMesh::TwinEdgeStride, as the work graph writes them
+RWStructuredBuffer<TwinEdge>	outputStructure		: register(u0);
+RWStructuredBuffer<Vertex>		vertexPoints		: register(u1);
 RWStructuredBuffer<uint>		counters			: register(u2);
 
 [RootSignature(BuildBisectorsRS)]
@@ -34,63 +30,42 @@ void BuildBisectors(const uint threadID : SV_DispatchThreadID)
 	if (threadID >= count)
 		return;
 	
-	const uint2 beginCount = inputFaces[threadID];
-	float3 facePoint = float3(0, 0, 0);
+	HE_Face		face		= inputFaces[threadID];
+	const uint	vertexCount	= face.GetVertexCount();
 	
 	uint idx;
-	uint vertexCount = 1 + 2 * beginCount.y;
 	InterlockedAdd(counters[0], vertexCount, idx);
+
+	// The face's vertexRange is the prefix sum of 1 + 2 * edgeCount over the faces before it and does
+	// not depend on which thread got there first
+	if (!deterministic)
+		face.vertexRange = idx;
 	
-	 int32_t i			= 0;
-	uint32_t edgeItr	= beginCount.x;
-	
-	while (edgeItr != beginCount.x || i == 0)
+	float3 facePoint = float3(0, 0, 0);
+
+	for (uint i = 0; i < face.edgeCount; i++)
 	{
-		const uint outputIdx = edgeItr * 4;
-		
-		HalfEdge he = halfEdge[edgeItr];
-		
-		HalfEdge edge0;
-		edge0.twin = (he.twin != -1) ? (halfEdge[he.twin].next * 4 + 3) : -1;
-		edge0.next = outputIdx + 1;
-		edge0.prev = outputIdx + 3;
-		edge0.vert = idx + 2 * i + 0;
-		outputStructure[outputIdx + 0] = edge0;
-
-		HalfEdge edge1;
-		edge1.twin = ((beginCount.x + beginCount.y + i + 1) % beginCount.y) * 4 + 2;
-		edge1.next = outputIdx + 2;
-		edge1.prev = outputIdx + 0;
-		edge1.vert = idx + 2 * i + 1;
-		outputStructure[outputIdx + 1] = edge1;
-		
-		HalfEdge edge2;
-		edge2.twin = ((beginCount.x + beginCount.y + i - 1) % beginCount.y) * 4 + 1;
-		edge2.next = outputIdx + 3;
-		edge2.prev = outputIdx + 1;
-		edge2.vert = idx + vertexCount - 1;
-		outputStructure[outputIdx + 2] = edge2;
-		
-		HalfEdge edge3;
-		edge3.twin = (he.twin != -1) ? (halfEdge[he.prev].twin * 4 + 3) : -1;
-		edge3.next = outputIdx + 0;
-		edge3.prev = outputIdx + 2;
-		edge3.vert = idx + (vertexCount - 2 + 2 * i) % (vertexCount - 1);
-		outputStructure[outputIdx + 3] = edge3;
-
-		facePoint  += inputVerts[he.vert];
-		edgeItr		= he.next;
-		
-		vertexPoints[idx + 2 * i + 0] = inputVerts[he.vert];
-		vertexPoints[idx + 2 * i + 1] = (inputVerts[he.vert] + inputVerts[halfEdge[he.next].vert]) / 2;
-		
-		i++;
+		const uint		edgeID	= face.begin + i;
+		const HalfEdge	he		= halfEdge[edgeID];
+
+		TwinEdge edges[4];
+		GetTwinEdges(face, i, edges, halfEdge);
+
+		outputStructure[4 * edgeID + 0] = edges[0];
+		outputStructure[4 * edgeID + 1] = edges[1];
+		outputStructure[4 * edgeID + 2] = edges[2];
+		outputStructure[4 * edgeID + 3] = edges[3];
+
+		const float3 p0 = inputVerts[he.vert].xyz;
+		const float3 p1 = inputVerts[halfEdge[he.next].vert].xyz;
+
+		facePoint += p0;
 		
-		if(i > 32)
-			return;
+		vertexPoints[face.vertexRange + 2 * i + 0] = MakeVertex(p0);
+		vertexPoints[face.vertexRange + 2 * i + 1] = MakeVertex((p0 + p1) / 2);
 	}
 
-	vertexPoints[idx + vertexCount - 1] = facePoint / beginCount.y;
+	vertexPoints[face.vertexRange + vertexCount - 1] = MakeVertex(facePoint / face.edgeCount);
 }
 
 
@@ -43,4 +43,39 @@ bool Intersects(const in Frustum frustum, const in AABB aabb)
 	}
 
 	return true;
-}
\ No newline at end of file
+}
+
+
+// Bounds of a transformed box, the extent goes through the absolute value of the rotation
+AABB TransformAABB(const in AABB aabb, const in float4x4 m)
+{
+	const float3 center	= mul(m, float4((aabb.mMin + aabb.mMax) * 0.5f, 1)).xyz;
+	const float3 extent	= mul(abs((float3x3)m), (aabb.mMax - aabb.mMin) * 0.5f);
+
+	AABB result;
+	result.mMin = center - extent;
+	result.mMax = center + extent;
+
+	return result;
+}
+
+
+struct NormalCone
+{
+	float3	axis;
+	float	cutoff;
+	float3	center;
+	float	radius;
+};
+
+// Cone and bounds are in world space, camera sits at the view space origin
+bool IsBackFacing(const in NormalCone cone, const in float4x4 view)
+{
+	if (cone.cutoff > 1.0f)
+		return false;
+
+	const float3 center	= mul(view, float4(cone.center, 1)).xyz;
+	const float3 axis	= mul(view, float4(cone.axis, 0)).xyz;
+
+	return dot(center, axis) >= cone.cutoff * length(center) + cone.radius;
+}
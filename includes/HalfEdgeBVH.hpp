@@ -0,0 +1,151 @@
+#pragma once
+#include "HalfEdgeCPU.hpp"
+
+#include <limits>
+#include <span>
+
+
+namespace FlexKit
+{	/************************************************************************************************/
+
+
+	constexpr uint32_t HE_InvalidPatch = 0xffffffff;
+
+
+	struct HE_Ray
+	{
+		float3	origin;
+		float3	direction;
+		float	tMin = 0.0f;
+		float	tMax = std::numeric_limits<float>::max();
+	};
+
+
+	// uv is the bilinear parameter within the patch, (0, 0) at the vertex of half-edge 4p
+	// and (1, 0) at the vertex of half-edge 4p + 1
+	struct HE_RayHit
+	{
+		uint32_t	patchIdx	= HE_InvalidPatch;
+		float		u			= 0.0f;
+		float		v			= 0.0f;
+		float		distance	= std::numeric_limits<float>::max();
+
+		bool Hit() const noexcept { return patchIdx != HE_InvalidPatch; }
+	};
+
+
+	// Interior nodes have count == 0 and their children at leftOrFirst and leftOrFirst + 1,
+	// leaves cover patchIndices[leftOrFirst, leftOrFirst + count)
+	struct HE_BVHNode
+	{
+		float3		min;
+		uint32_t	leftOrFirst;
+		float3		max;
+		uint32_t	count;
+
+		bool IsLeaf() const noexcept { return count != 0; }
+	};
+
+
+	struct HE_BVHOptions
+	{
+		uint32_t	binCount			= 16;
+		uint32_t	maxLeafSize			= 4;
+		float		traversalCost		= 1.0f;
+		float		intersectionCost	= 1.0f;		// Per patch, two triangles
+		uint32_t	threadCount			= 0;
+	};
+
+
+	struct HE_BVHStats
+	{
+		uint32_t	nodeCount		= 0;
+		uint32_t	leafCount		= 0;
+		uint32_t	maxDepth		= 0;
+		double		buildDuration	= 0.0; // ms
+		double		refitDuration	= 0.0; // ms
+	};
+
+
+	// Bounding volume hierarchy over the patches of one subdivided level. Each patch is
+	// intersected as the two triangles (0, 1, 2) and (0, 2, 3) of its corner points.
+	class HE_BVH
+	{
+	public:
+		HE_BVH(iAllocator& allocator) :
+			nodes			{ allocator },
+			patchIndices	{ allocator },
+			patchMin		{ allocator },
+			patchMax		{ allocator } {}
+
+		// Binned SAH build, nodes at the same depth are split in parallel
+		void		Build(const HE_Level& level, const HE_BVHOptions& options = {});
+
+		// Recomputes the bounds after the points moved, the topology and tree stay as built
+		void		Refit(const HE_Level& level, const uint32_t threadCount = 0);
+
+		HE_RayHit	Intersect(const HE_Level& level, const HE_Ray& ray) const noexcept;
+		void		Intersect(const HE_Level& level, std::span<const HE_Ray> rays, std::span<HE_RayHit> outHits, const uint32_t threadCount = 0) const;
+
+		Vector<HE_BVHNode>	nodes;
+		Vector<uint32_t>	patchIndices;
+		HE_BVHStats			stats;
+
+	private:
+		void UpdatePatchBounds(const HE_Level& level, const uint32_t threadCount);
+
+		Vector<float3>		patchMin;
+		Vector<float3>		patchMax;
+	};
+
+
+	/************************************************************************************************/
+
+
+	struct HE_RayBenchmark
+	{
+		uint32_t	rayCount	= 0;
+		uint32_t	hitCount	= 0;
+		uint32_t	threadCount	= 0;
+		double		duration	= 0.0; // ms
+
+		double RaysPerSecondPerCore() const noexcept
+		{
+			return duration > 0.0 ? double(rayCount) / (duration / 1000.0) / double(Max(threadCount, 1u)) : 0.0;
+		}
+	};
+
+
+	HE_RayBenchmark BenchmarkRays(
+		const HE_BVH&				bvh,
+		const HE_Level&				level,
+		std::span<const HE_Ray>		rays,
+		std::span<HE_RayHit>		outHits,
+		const uint32_t				threadCount = 1);
+
+
+}	/************************************************************************************************/
+
+/**********************************************************************
+
+Copyright (c) 2024 Robert May
+
+Permission is hereby granted, free of charge, to any person obtaining a
+copy of this software and associated documentation files (the "Software"),
+to deal in the Software without restriction, including without limitation
+the rights to use, copy, modify, merge, publish, distribute, sublicense,
+and/or sell copies of the Software, and to permit persons to whom the
+Software is furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included
+in all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+**********************************************************************/
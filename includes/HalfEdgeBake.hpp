@@ -0,0 +1,101 @@
+#pragma once
+#include "HalfEdgeCPU.hpp"
+
+#include <filesystem>
+#include <string>
+
+
+namespace FlexKit
+{	/************************************************************************************************/
+
+
+	enum class HE_BakeFormat : uint32_t
+	{
+		OBJ,
+		PLY,	// Binary little endian
+		Raw,			// HE_RawLevelHeader followed by the level's HE_TwinEdge, patch flag and float3 buffers
+		Progressive,	// Cage and every level up to the written one as residuals, see HalfEdgeProgressive.hpp
+	};
+
+
+	struct HE_RawLevelHeader
+	{
+		char		magic[4]		= { 'H', 'E', 'L', 'V' };
+		uint32_t	version			= 2;	// 2: patch flags follow the half-edges
+		uint32_t	level			= 0;
+		uint32_t	halfEdgeCount	= 0;
+		uint32_t	pointCount		= 0;
+		uint32_t	pointStride		= sizeof(float3);
+	};
+
+
+	struct HE_BakeOptions
+	{
+		uint32_t		level		= 1;	// Level written, 0 is the first subdivision
+		HE_BakeFormat	format		= HE_BakeFormat::OBJ;
+		uint32_t		threadCount	= 1;	// Threads per file for the level builds
+		HE_IndexMode	indexMode	= HE_IndexMode::PerFace;	// Shared writes welded meshes
+	};
+
+
+	struct HE_BakeResult
+	{
+		std::filesystem::path	input;
+		std::filesystem::path	output;
+		std::string				error;
+		uint32_t				faceCount			= 0;
+		uint32_t				level				= 0;
+		uint32_t				patchCount			= 0;
+		uint64_t				bytesWritten		= 0;
+		double					loadTime			= 0.0; // ms
+		double					subdivideTime		= 0.0; // ms
+		double					writeTime			= 0.0; // ms
+		double					compressionRatio	= 0.0; // Progressive only
+		double					decodeRate			= 0.0; // Progressive only, points per second of a read back
+
+		bool Succeeded() const noexcept { return error.empty(); }
+	};
+
+
+	// Positions and faces of an OBJ, read line by line so files can be loaded from several threads
+	bool LoadObjShape(const std::filesystem::path& path, ModifiableShape& out, std::string& outError);
+
+	// Written through a fixed-size buffer, the text of a level is never held in memory as a whole.
+	// Return the byte count, 0 if the file could not be written.
+	uint64_t WriteLevelOBJ(const HE_Level& level, const std::filesystem::path& path);
+	uint64_t WriteLevelPLY(const HE_Level& level, const std::filesystem::path& path);
+	uint64_t WriteLevelRaw(const HE_Level& level, const std::filesystem::path& path);
+
+	// Loads an OBJ, builds the control cage the same way HalfEdgeMesh does, subdivides to
+	// options.level and writes <stem>_L<level>.<ext> to outputDir. Progressive files are read back
+	// to report the decode rate.
+	HE_BakeResult BakeFile(const std::filesystem::path& input, const std::filesystem::path& outputDir, const HE_BakeOptions& options, iAllocator& allocator);
+
+	uint64_t HE_PeakRSS() noexcept; // bytes, 0 where unsupported
+
+
+}	/************************************************************************************************/
+
+/**********************************************************************
+
+Copyright (c) 2024 Robert May
+
+Permission is hereby granted, free of charge, to any person obtaining a
+copy of this software and associated documentation files (the "Software"),
+to deal in the Software without restriction, including without limitation
+the rights to use, copy, modify, merge, publish, distribute, sublicense,
+and/or sell copies of the Software, and to permit persons to whom the
+Software is furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included
+in all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+**********************************************************************/
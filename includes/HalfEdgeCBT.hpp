@@ -0,0 +1,169 @@
+#pragma once
+#include "HalfEdgeCPU.hpp"
+
+#include <bit>
+#include <span>
+
+
+namespace FlexKit
+{	/************************************************************************************************/
+
+
+	// Heap indexed node, id is in [2^depth, 2^(depth + 1))
+	struct HE_CBTNode
+	{
+		uint32_t id		= 1;
+		uint32_t depth	= 0;
+
+		HE_CBTNode	LeftChild()		const noexcept { return { id << 1, depth + 1 }; }
+		HE_CBTNode	RightChild()	const noexcept { return { (id << 1) | 1, depth + 1 }; }
+		HE_CBTNode	Sibling()		const noexcept { return { id ^ 1, depth }; }
+		HE_CBTNode	Parent()		const noexcept { return { id >> 1, depth - 1 }; }
+
+		bool operator == (const HE_CBTNode& rhs) const noexcept = default;
+	};
+
+
+	// CPU reference of a concurrent binary tree. Leaves are stored as one bit at the leftmost position
+	// they cover at maxDepth, and a sum reduction tree above the bitfield counts the leaves in each
+	// subtree. Split and merge are single bit operations and can run from several threads between
+	// reductions; a leaf keeps its bit, and with it its slot, until it is merged away.
+	class HE_CBT
+	{
+	public:
+		static constexpr uint32_t MinDepth = 6;		// One bitfield word
+		static constexpr uint32_t MaxDepth = 30;
+
+		HE_CBT(iAllocator& allocator, const uint32_t maxDepth = 14, const uint32_t initDepth = 0);
+
+		void Reset(const uint32_t initDepth);
+
+		uint32_t	GetMaxDepth()	const noexcept { return maxDepth; }
+		uint32_t	NodeCount()		const noexcept { return heap[1]; }
+		uint32_t	Value(const HE_CBTNode node) const noexcept;
+		bool		IsLeaf(const HE_CBTNode node) const noexcept;
+
+		// Leaf bit position of a node, stable for as long as the node is a leaf
+		uint32_t	Slot(const HE_CBTNode node) const noexcept { return (node.id << (maxDepth - node.depth)) - (1u << maxDepth); }
+
+		HE_CBTNode	DecodeNode(uint32_t leafIndex) const noexcept;	// O(depth)
+		uint32_t	EncodeNode(const HE_CBTNode node) const noexcept;	// O(depth)
+
+		// Safe to call concurrently, the tree is updated by the next SumReduction
+		void		SplitNode(const HE_CBTNode node) noexcept;
+		void		MergeNode(const HE_CBTNode node) noexcept;
+
+		// Bulk forms of SplitNode and MergeNode, mask holds the slots in one bitfield word to set or clear
+		void		SetSlots(const uint32_t word, const uint64_t mask) noexcept;
+		void		ClearSlots(const uint32_t word, const uint64_t mask) noexcept;
+
+		void		SumReduction(const uint32_t threadCount = 0);
+
+		// Calls fn(node) for every leaf in slot order
+		template<typename TY_FN>
+		void ForEachLeaf(TY_FN&& fn, const uint32_t beginWord = 0, uint32_t endWord = -1) const
+		{
+			endWord = Min(endWord, (uint32_t)bits.size());
+
+			for (uint32_t word = beginWord; word < endWord; word++)
+			{
+				for (uint64_t remaining = bits[word]; remaining; remaining &= remaining - 1)
+				{
+					const uint32_t slot = word * 64 + std::countr_zero(remaining);
+					fn(LeafFromSlot(slot));
+				}
+			}
+		}
+
+		uint32_t					WordCount()	const noexcept { return (uint32_t)bits.size(); }
+		std::span<const uint64_t>	Words()		const noexcept { return { bits.data(), bits.size() }; }
+
+		// Checks the reduction against the bitfield and that every leaf decodes and encodes to itself
+		bool		Validate() const;
+
+	private:
+		HE_CBTNode	LeafFromSlot(const uint32_t slot) const noexcept;
+		uint32_t	NextSlot(const uint32_t slot) const noexcept;
+
+		uint32_t			maxDepth;
+		uint32_t			wordDepth;	// Depth at which one node covers one bitfield word
+		Vector<uint32_t>	heap;		// Leaf counts for depths [0, wordDepth], indexed by node id
+		Vector<uint64_t>	bits;
+	};
+
+
+	/************************************************************************************************/
+
+
+	// Adaptive patch allocation on top of a CBT. Every control face owns one node at rootDepth, one
+	// subdivision level is two binary splits below it. Patches are addressed by CBT slot, which stays
+	// the same across frames for as long as the patch is not merged.
+	struct HE_Patch
+	{
+		uint32_t faceIdx;	// Control face
+		uint32_t level;		// Subdivision level within the face, two CBT depths per level
+		uint32_t path;		// Child path below the face root, 2 bits per level
+		uint32_t slot;
+	};
+
+
+	struct HE_PatchUpdateStats
+	{
+		uint32_t splits		= 0;
+		uint32_t merges		= 0;
+		uint32_t patchCount	= 0;
+	};
+
+
+	class HE_PatchAllocator
+	{
+	public:
+		HE_PatchAllocator(iAllocator& allocator, const uint32_t faceCount, const uint32_t maxLevel);
+
+		// One split or merge step towards targetLevels, one entry per control face
+		HE_PatchUpdateStats Update(std::span<const uint8_t> targetLevels, const uint32_t threadCount = 0);
+
+		uint32_t	PatchCount() const noexcept { return cbt.NodeCount(); }
+		HE_Patch	GetPatch(const uint32_t patchIdx) const noexcept;
+		HE_Patch	GetPatch(const HE_CBTNode node) const noexcept;
+
+		// Bitfield words the last Update split or merged in, the only ones a copy of the bitfield needs resent
+		std::span<const uint32_t> ChangedWords() const noexcept { return { changedWords.data(), changedWords.size() }; }
+
+		HE_CBT				cbt;
+		uint32_t			faceCount;
+		uint32_t			rootDepth;
+		uint32_t			maxLevel;
+
+	private:
+		Vector<uint64_t>	splitBits;
+		Vector<uint64_t>	mergeBits;
+		Vector<uint32_t>	changedWords;
+	};
+
+
+}	/************************************************************************************************/
+
+/**********************************************************************
+
+Copyright (c) 2024 Robert May
+
+Permission is hereby granted, free of charge, to any person obtaining a
+copy of this software and associated documentation files (the "Software"),
+to deal in the Software without restriction, including without limitation
+the rights to use, copy, modify, merge, publish, distribute, sublicense,
+and/or sell copies of the Software, and to permit persons to whom the
+Software is furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included
+in all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+**********************************************************************/
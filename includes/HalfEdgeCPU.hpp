@@ -0,0 +1,826 @@
+#pragma once
+#include <Containers.hpp>
+#include <MathUtilities.hpp>
+#include <ModifiableShape.hpp>
+
+#include <span>
+#include <thread>
+#include <type_traits>
+#include <vector>
+
+namespace FlexKit
+{	/************************************************************************************************/
+
+
+	// Mirrors HE_Common.hlsl. Twins use all 32 bits, the corner and T flags are stored apart from them
+	constexpr uint32_t HE_BorderValue	= 0xffffffff;
+	constexpr uint8_t  HE_CornerFlag	= 1u << 0;
+	constexpr uint8_t  HE_TFlag			= 1u << 1;
+	constexpr uint32_t HE_MaxValence	= 16;
+	constexpr uint32_t HE_MaxLevels		= 8;
+	constexpr uint16_t HE_FreeFace		= 0xffff;	// HE_Face::level of a slot left by a deleted face, see HE_CageEditor
+
+
+	// Half-edges of subdivision level L, every level splits each half-edge into four
+	constexpr uint64_t HE_LevelHalfEdgeCount(const uint64_t cageHalfEdgeCount, const uint32_t level) noexcept
+	{
+		return cageHalfEdgeCount << (2 * (level + 1));
+	}
+
+
+	// Per-face points written at a level: the cage's face ranges at level 0, then nine per patch of
+	// the level before, which has one patch per cage half-edge at level 0
+	constexpr uint64_t HE_LevelPointCount(const uint64_t cageHalfEdgeCount, const uint64_t cagePointCount, const uint32_t level) noexcept
+	{
+		return level == 0 ? cagePointCount : 9 * (cageHalfEdgeCount << (2 * (level - 1)));
+	}
+
+
+	// Levels whose half-edge indices fit below HE_BorderValue. Per-face point indices stay below
+	// three quarters of the half-edge count, so they fit whenever the twins do.
+	constexpr uint32_t HE_MaxLevelCount(const uint64_t cageHalfEdgeCount) noexcept
+	{
+		uint32_t levelCount = 0;
+
+		while (levelCount < HE_MaxLevels && HE_LevelHalfEdgeCount(cageHalfEdgeCount, levelCount) < HE_BorderValue)
+			levelCount++;
+
+		return levelCount;
+	}
+
+	static_assert(HE_MaxLevelCount(1u << 24) == 3, "a 16M half-edge cage keeps its third level, 2^30 half-edges");
+
+
+	struct HE_LevelBufferPlan
+	{
+		uint32_t	levelCount					= 0;
+		uint64_t	halfEdgeBytes[HE_MaxLevels]	= {};
+		uint64_t	pointBytes[HE_MaxLevels]	= {};
+		uint64_t	totalBytes					= 0;
+	};
+
+
+	// Byte sizes of the dense level buffers, all in 64 bits. Every level is four times the last, levels
+	// stop at the 32-bit twin range or at the first level past level 0 that would exceed the budget.
+	constexpr HE_LevelBufferPlan HE_PlanLevelBuffers(
+		const uint64_t cageHalfEdgeCount,
+		const uint64_t cagePointCount,
+		const uint32_t levelCount,
+		const uint64_t budgetBytes,
+		const uint64_t halfEdgeStride,
+		const uint64_t pointStride) noexcept
+	{
+		HE_LevelBufferPlan plan;
+
+		const uint32_t maxLevelCount = levelCount < HE_MaxLevelCount(cageHalfEdgeCount) ? levelCount : HE_MaxLevelCount(cageHalfEdgeCount);
+
+		for (; plan.levelCount < maxLevelCount; plan.levelCount++)
+		{
+			const uint64_t halfEdgeBytes	= HE_LevelHalfEdgeCount(cageHalfEdgeCount, plan.levelCount) * halfEdgeStride;
+			const uint64_t pointBytes		= HE_LevelPointCount(cageHalfEdgeCount, cagePointCount, plan.levelCount) * pointStride;
+
+			if (plan.levelCount > 0 && plan.totalBytes + halfEdgeBytes + pointBytes > budgetBytes)
+				break;
+
+			plan.halfEdgeBytes[plan.levelCount]	= halfEdgeBytes;
+			plan.pointBytes[plan.levelCount]	= pointBytes;
+			plan.totalBytes						+= halfEdgeBytes + pointBytes;
+		}
+
+		return plan;
+	}
+
+
+	struct HEEdge
+	{
+		uint32_t twin;
+		uint32_t next;
+		uint32_t prev;
+		uint32_t vert;
+		uint32_t flags;	// HE_CornerFlag | HE_TFlag
+
+		uint32_t	Twin()		const noexcept { return twin; }
+		bool		Border()	const noexcept { return twin == HE_BorderValue; }
+		bool		IsCorner()	const noexcept { return (flags & HE_CornerFlag) != 0; }
+		bool		IsT()		const noexcept { return (flags & HE_TFlag) != 0; }
+	};
+
+	struct HE_Face
+	{
+		uint32_t begin;
+		uint32_t vertexRange;
+		uint16_t edgeCount;
+		uint16_t level;
+
+		uint32_t GetVertexCount() const
+		{
+			return 1 + 2 * edgeCount;
+		}
+
+		bool IsFree() const noexcept { return level == HE_FreeFace; }
+	};
+
+	struct HEVertex
+	{
+		float3 point;
+		float2 UV;
+	};
+
+	// Level half-edge, the flags of a level are kept in a separate array, see HE_Level::flags
+	struct HE_TwinEdge
+	{
+		uint32_t twin;
+		uint32_t vert;
+
+		uint32_t	Twin()		const noexcept { return twin; }
+		bool		Border()	const noexcept { return twin == HE_BorderValue; }
+	};
+
+
+	// Patch flags hold two bits per half-edge, half-edge e of a patch at bits [2 * (e & 3), 2 * (e & 3) + 2)
+	constexpr uint8_t HE_PatchEdgeFlags(const uint8_t patchFlags, const uint32_t e) noexcept
+	{
+		return (patchFlags >> (2 * (e & 3))) & (HE_CornerFlag | HE_TFlag);
+	}
+
+
+	/************************************************************************************************/
+
+
+	template<typename TY_FN>
+	void HE_ParallelFor(const uint32_t count, TY_FN&& fn, uint32_t threadCount = 0, const uint32_t grainSize = 1024)
+	{
+		auto Invoke = [&](uint32_t begin, uint32_t end, uint32_t chunk)
+		{
+			if constexpr (std::is_invocable_v<TY_FN, uint32_t, uint32_t, uint32_t>)
+				fn(begin, end, chunk);
+			else
+				fn(begin, end);
+		};
+
+		if (threadCount == 0)
+			threadCount = Max(std::thread::hardware_concurrency(), 1u);
+
+		threadCount = Min(threadCount, Max(count / Max(grainSize, 1u), 1u));
+
+		if (threadCount <= 1)
+		{
+			Invoke(0, count, 0);
+			return;
+		}
+
+		const uint32_t chunkSize = count / threadCount + (count % threadCount == 0 ? 0 : 1);
+
+		std::vector<std::jthread> workers;
+		workers.reserve(threadCount - 1);
+
+		for (uint32_t chunk = 1; chunk < threadCount; chunk++)
+		{
+			const uint32_t begin	= Min(chunk * chunkSize, count);
+			const uint32_t end		= Min(begin + chunkSize, count);
+			workers.emplace_back([&Invoke, begin, end, chunk] { Invoke(begin, end, chunk); });
+		}
+
+		Invoke(0, Min(chunkSize, count), 0);
+	}
+
+
+	/************************************************************************************************/
+
+
+	struct HE_ControlCage
+	{
+		HE_ControlCage(iAllocator& allocator) :
+			halfEdges	{ allocator },
+			faces		{ allocator },
+			faceLookup	{ allocator },
+			points		{ allocator } {}
+
+		Vector<HEEdge>		halfEdges;
+		Vector<HE_Face>		faces;
+		Vector<uint32_t>	faceLookup;
+		Vector<float3>		points;
+		uint32_t			vertexCount = 0; // Level 0 point count, sum of 1 + 2 * edgeCount over all faces
+	};
+
+
+	HE_ControlCage BuildControlCage(const ModifiableShape& shape, iAllocator& allocator);
+
+
+	/************************************************************************************************/
+
+
+	enum class HE_IndexMode : uint32_t
+	{
+		PerFace,	// Every input face owns 1 + 2 * edgeCount points, matching the GPU layout
+		Shared,		// Vertex, edge and face points are stored once, see HE_SubdivideFacesShared
+	};
+
+
+	// CPU mirror of a subdivided level. Patch p owns half-edges [4p, 4p + 4) and
+	// half-edge e of the level below is split into children [4e, 4e + 4).
+	struct HE_Level
+	{
+		HE_Level(iAllocator& allocator) :
+			cage	{ allocator },
+			flags	{ allocator },
+			points	{ allocator } {}
+
+		uint32_t	PatchCount()				const noexcept { return (uint32_t)cage.size() / 4; }
+		uint8_t		EdgeFlags(const uint32_t e)	const noexcept { return HE_PatchEdgeFlags(flags[e >> 2], e); }
+
+		Vector<HE_TwinEdge>	cage;
+		Vector<uint8_t>		flags;	// One byte per patch, so patches written by different threads never share one
+		Vector<float3>		points;
+		uint32_t			level		= 0;
+		HE_IndexMode		indexMode	= HE_IndexMode::PerFace;
+	};
+
+
+	/************************************************************************************************/
+
+
+	struct HE_ControlCageView
+	{
+		const HE_ControlCage& cage;
+
+		uint32_t	Next(uint32_t e)		const noexcept { return cage.halfEdges[e].next; }
+		uint32_t	Prev(uint32_t e)		const noexcept { return cage.halfEdges[e].prev; }
+		uint32_t	Twin(uint32_t e)		const noexcept { return cage.halfEdges[e].Twin(); }
+		uint32_t	Vert(uint32_t e)		const noexcept { return cage.halfEdges[e].vert; }
+		uint32_t	Face(uint32_t e)		const noexcept { return cage.faceLookup[e]; }
+		bool		IsCorner(uint32_t e)	const noexcept { return cage.halfEdges[e].IsCorner(); }
+		bool		IsT(uint32_t e)			const noexcept { return cage.halfEdges[e].IsT(); }
+		float3		Point(uint32_t e)		const noexcept { return cage.points[Vert(e)]; }
+
+		uint32_t	FaceCount()				const noexcept { return (uint32_t)cage.faces.size(); }
+		uint32_t	HalfEdgeCount()			const noexcept { return (uint32_t)cage.halfEdges.size(); }
+		uint32_t	PointCount()			const noexcept { return cage.vertexCount; }
+		HE_Face		GetFace(uint32_t f)		const noexcept { return cage.faces[f]; }
+	};
+
+
+	struct HE_LevelView
+	{
+		const HE_Level& level;
+
+		uint32_t	Next(uint32_t e)		const noexcept { return (e & ~0x3u) | ((e + 1) & 3); }
+		uint32_t	Prev(uint32_t e)		const noexcept { return (e & ~0x3u) | ((e - 1) & 3); }
+		uint32_t	Twin(uint32_t e)		const noexcept { return level.cage[e].Twin(); }
+		uint32_t	Vert(uint32_t e)		const noexcept { return level.cage[e].vert; }
+		uint32_t	Face(uint32_t e)		const noexcept { return e >> 2; }
+		bool		IsCorner(uint32_t e)	const noexcept { return (level.EdgeFlags(e) & HE_CornerFlag) != 0; }
+		bool		IsT(uint32_t e)			const noexcept { return (level.EdgeFlags(e) & HE_TFlag) != 0; }
+		float3		Point(uint32_t e)		const noexcept { return level.points[Vert(e)]; }
+
+		uint32_t	FaceCount()				const noexcept { return level.PatchCount(); }
+		uint32_t	HalfEdgeCount()			const noexcept { return (uint32_t)level.cage.size(); }
+		uint32_t	PointCount()			const noexcept { return 9 * level.PatchCount(); }
+		HE_Face		GetFace(uint32_t p)		const noexcept { return { 4 * p, 9 * p, 4, (uint16_t)level.level }; }
+	};
+
+
+	/************************************************************************************************/
+
+
+	template<typename TY_View>
+	uint32_t RotateSelectionCCW(const TY_View& view, uint32_t halfEdge)
+	{
+		const uint32_t twin = view.Twin(halfEdge);
+		return (twin == HE_BorderValue) ? HE_BorderValue : view.Next(twin);
+	}
+
+
+	template<typename TY_View>
+	uint32_t RotateSelectionCW(const TY_View& view, uint32_t halfEdge)
+	{
+		return (halfEdge != HE_BorderValue) ? view.Twin(view.Prev(halfEdge)) : HE_BorderValue;
+	}
+
+
+	// Summed from the face's first half-edge in a fixed pairwise tree, so a face point is bitwise the
+	// same whichever half-edge asks for it and however the faces are split between threads
+	template<typename TY_View>
+	float3 HE_FacePoint(const TY_View& view, const uint32_t halfEdge)
+	{
+		const uint32_t begin = view.GetFace(view.Face(halfEdge)).begin;
+
+		float3		terms[HE_MaxValence];
+		uint32_t	n	= 0;
+		uint32_t	itr	= begin;
+
+		do
+		{
+			terms[n++]	= view.Point(itr);
+			itr			= view.Next(itr);
+		} while (itr != begin && n < HE_MaxValence);
+
+		for (uint32_t stride = 1; stride < n; stride *= 2)
+		{
+			for (uint32_t i = 0; i + stride < n; i += 2 * stride)
+				terms[i] += terms[i + stride];
+		}
+
+		return terms[0] / float(n);
+	}
+
+
+	// facePoint(e) returns the face point of the face holding half-edge e, either evaluated in place
+	// or read from a face point pass
+	template<typename TY_View, typename TY_FacePoint>
+	float3 HE_EdgePoint(const TY_View& view, const uint32_t halfEdge, TY_FacePoint&& facePoint)
+	{
+		const float3 midPoint = (view.Point(halfEdge) + view.Point(view.Next(halfEdge))) / 2.0f;
+
+		const uint32_t twin = view.Twin(halfEdge);
+		if (twin == HE_BorderValue)
+			return midPoint;
+
+		return (facePoint(halfEdge) + facePoint(twin)) / 4.0f + midPoint / 2.0f;
+	}
+
+
+	template<typename TY_View>
+	float3 HE_EdgePoint(const TY_View& view, const uint32_t halfEdge)
+	{
+		return HE_EdgePoint(view, halfEdge, [&](const uint32_t e) { return HE_FacePoint(view, e); });
+	}
+
+
+	template<typename TY_View, typename TY_FacePoint>
+	float3 HE_VertexPoint(const TY_View& view, const uint32_t halfEdge, TY_FacePoint&& facePoint)
+	{
+		const float3 p = view.Point(halfEdge);
+
+		if (view.IsCorner(halfEdge))
+			return p;
+
+		if (view.IsT(halfEdge))
+		{
+			uint32_t n				= 0;
+			uint32_t prevSelection	= halfEdge;
+			uint32_t selection		= RotateSelectionCCW(view, halfEdge);
+
+			while (selection != HE_BorderValue)
+			{
+				if (++n > HE_MaxValence || selection == halfEdge)
+					return p;
+
+				prevSelection	= selection;
+				selection		= RotateSelectionCCW(view, selection);
+			}
+
+			const uint32_t selection0 = prevSelection;
+
+			prevSelection	= halfEdge;
+			selection		= RotateSelectionCW(view, halfEdge);
+
+			while (selection != HE_BorderValue)
+			{
+				if (++n > HE_MaxValence)
+					return p;
+
+				prevSelection	= selection;
+				selection		= RotateSelectionCW(view, selection);
+			}
+
+			const uint32_t selection1 = prevSelection;
+
+			const float3 p0 = view.Point(view.Next(selection0));
+			const float3 p2 = view.Point(view.Prev(selection1));
+
+			return (p0 + p * 6.0f + p2) / 8.0f;
+		}
+
+		float3	Q	= facePoint(halfEdge);
+		float3	R	= (p + view.Point(view.Next(halfEdge))) / 2.0f;
+		float	n	= 1.0f;
+
+		uint32_t selection = RotateSelectionCCW(view, halfEdge);
+		while (selection != halfEdge)
+		{
+			if (selection == HE_BorderValue || n >= HE_MaxValence)
+				return p;
+
+			n += 1.0f;
+			Q += facePoint(selection);
+			R += (p + view.Point(view.Next(selection))) / 2.0f;
+			selection = RotateSelectionCCW(view, selection);
+		}
+
+		Q /= n;
+		R /= n;
+
+		return (Q + R * 2.0f + p * (n - 3.0f)) / n;
+	}
+
+
+	template<typename TY_View>
+	float3 HE_VertexPoint(const TY_View& view, const uint32_t halfEdge)
+	{
+		return HE_VertexPoint(view, halfEdge, [&](const uint32_t e) { return HE_FacePoint(view, e); });
+	}
+
+
+	/************************************************************************************************/
+
+
+	// Twins of the patch split from half-edge i of face, vert is left to the indexing mode. Returns
+	// the patch flags, see HE_PatchEdgeFlags.
+	template<typename TY_View>
+	uint8_t HE_PatchTwins(const TY_View& view, const HE_Face& face, const uint32_t i, HE_TwinEdge (&edges)[4])
+	{
+		const uint32_t edgeID	= face.begin + i;
+		const uint32_t twin		= view.Twin(edgeID);
+		const uint32_t prevTwin	= view.Twin(view.Prev(edgeID));
+
+		edges[0].twin = twin == HE_BorderValue ? HE_BorderValue : (view.Next(twin) * 4 + 3);
+		edges[1].twin = (face.begin + (i + 1) % face.edgeCount) * 4 + 2;
+		edges[2].twin = (face.begin + (face.edgeCount + i - 1) % face.edgeCount) * 4 + 1;
+		edges[3].twin = prevTwin == HE_BorderValue ? HE_BorderValue : (prevTwin * 4);
+
+		return uint8_t(
+			(view.IsCorner(edgeID)			? HE_CornerFlag << 0 : 0) |
+			(view.IsT(edgeID)				? HE_TFlag << 0 : 0) |
+			(twin == HE_BorderValue			? HE_TFlag << 2 : 0) |
+			(prevTwin == HE_BorderValue		? HE_TFlag << 6 : 0));
+	}
+
+
+	// Splits one face of the input into one quad patch per half-edge, matching the output layout of
+	// GetTwinEdges in HE_Common.hlsl. edgeOut, flagOut and pointOut map output half-edge, patch and
+	// point indices to storage, facePoint is the face point source of the edge and vertex rules.
+	template<typename TY_View, typename TY_EdgeOut, typename TY_FlagOut, typename TY_PointOut, typename TY_FacePoint>
+	void HE_SubdivideFace(const TY_View& view, const uint32_t faceIdx, TY_EdgeOut&& edgeOut, TY_FlagOut&& flagOut, TY_PointOut&& pointOut, TY_FacePoint&& facePoint)
+	{
+		const HE_Face	face		= view.GetFace(faceIdx);
+		const uint32_t	vertexCount	= face.GetVertexCount();
+
+		for (uint32_t i = 0; i < face.edgeCount; i++)
+		{
+			const uint32_t edgeID		= face.begin + i;
+			const uint32_t outputIdx	= 4 * edgeID;
+
+			HE_TwinEdge edges[4];
+			flagOut(edgeID) = HE_PatchTwins(view, face, i, edges);
+
+			edges[0].vert = face.vertexRange + 2 * i + 0;
+			edges[1].vert = face.vertexRange + 2 * i + 1;
+			edges[2].vert = face.vertexRange + vertexCount - 1;
+			edges[3].vert = face.vertexRange + (vertexCount - 2 + 2 * i) % (vertexCount - 1);
+
+			edgeOut(outputIdx + 0) = edges[0];
+			edgeOut(outputIdx + 1) = edges[1];
+			edgeOut(outputIdx + 2) = edges[2];
+			edgeOut(outputIdx + 3) = edges[3];
+
+			pointOut(face.vertexRange + 2 * i + 0) = HE_VertexPoint(view, edgeID, facePoint);
+			pointOut(face.vertexRange + 2 * i + 1) = HE_EdgePoint(view, edgeID, facePoint);
+		}
+
+		pointOut(face.vertexRange + vertexCount - 1) = facePoint(face.begin);
+	}
+
+
+	// Evaluates every face point where it is used, for callers that subdivide faces one at a time
+	template<typename TY_View, typename TY_EdgeOut, typename TY_FlagOut, typename TY_PointOut>
+	void HE_SubdivideFace(const TY_View& view, const uint32_t faceIdx, TY_EdgeOut&& edgeOut, TY_FlagOut&& flagOut, TY_PointOut&& pointOut)
+	{
+		HE_SubdivideFace(view, faceIdx, edgeOut, flagOut, pointOut, [&](const uint32_t e) { return HE_FacePoint(view, e); });
+	}
+
+
+	// Slot of the face point in the per-face layout, the last point of the face's range
+	inline uint32_t HE_FacePointIndex(const HE_Face& face) noexcept
+	{
+		return face.vertexRange + face.GetVertexCount() - 1;
+	}
+
+
+	// Splits every face of the input into one quad patch per half-edge. Face points are evaluated once
+	// into their output slots first, the edge and vertex rules then read them back instead of walking
+	// every face around each edge and vertex again.
+	template<typename TY_View>
+	void HE_SubdivideFaces(const TY_View& view, HE_Level& out, const uint32_t threadCount = 0)
+	{
+		out.cage.resize(4 * size_t(view.HalfEdgeCount()));
+		out.flags.resize(view.HalfEdgeCount());
+		out.points.resize(view.PointCount());
+
+		HE_ParallelFor(view.FaceCount(),
+			[&](const uint32_t begin, const uint32_t end)
+			{
+				for (uint32_t faceIdx = begin; faceIdx < end; faceIdx++)
+				{
+					const HE_Face face = view.GetFace(faceIdx);
+					out.points[HE_FacePointIndex(face)] = HE_FacePoint(view, face.begin);
+				}
+			}, threadCount, 1024);
+
+		auto CachedFacePoint = [&](const uint32_t e) -> float3
+		{
+			return out.points[HE_FacePointIndex(view.GetFace(view.Face(e)))];
+		};
+
+		HE_ParallelFor(view.FaceCount(),
+			[&](const uint32_t begin, const uint32_t end)
+			{
+				for (uint32_t faceIdx = begin; faceIdx < end; faceIdx++)
+				{
+					HE_SubdivideFace(view, faceIdx,
+						[&](const uint32_t idx) -> HE_TwinEdge&	{ return out.cage[idx]; },
+						[&](const uint32_t idx) -> uint8_t&		{ return out.flags[idx]; },
+						[&](const uint32_t idx) -> float3&		{ return out.points[idx]; },
+						CachedFacePoint);
+				}
+			}, threadCount, 256);
+
+		out.indexMode = HE_IndexMode::PerFace;
+	}
+
+
+	// Splits every face of the input with each output point stored once. Points are laid out as
+	// [vertex points | edge points | face points]: vertex point v keeps the index of input vertex v,
+	// edge points are numbered by the lower half-edge of each twin pair and face points by face.
+	// The vertex rule runs once per vertex instead of once per incident face. The input must be the
+	// cage or a level built with shared indexing, inputPointCount is its point count.
+	template<typename TY_View>
+	void HE_SubdivideFacesShared(const TY_View& view, const uint32_t inputPointCount, HE_Level& out, iAllocator& allocator, const uint32_t threadCount = 0)
+	{
+		const uint32_t halfEdgeCount = view.HalfEdgeCount();
+
+		Vector<uint32_t> edgeSlot	{ allocator };
+		Vector<uint32_t> vertexEdge	{ allocator };
+
+		edgeSlot.resize(halfEdgeCount);
+		vertexEdge.resize(inputPointCount);
+		std::fill(vertexEdge.begin(), vertexEdge.end(), HE_BorderValue);
+
+		uint32_t edgePointCount = 0;
+		for (uint32_t e = 0; e < halfEdgeCount; e++)
+		{
+			const uint32_t twin = view.Twin(e);
+
+			if (twin == HE_BorderValue)
+				edgeSlot[e] = edgePointCount++;
+			else if (e < twin)
+				edgeSlot[e] = edgeSlot[twin] = edgePointCount++;
+
+			vertexEdge[view.Vert(e)] = e;
+		}
+
+		const uint32_t edgePointBegin = inputPointCount;
+		const uint32_t facePointBegin = inputPointCount + edgePointCount;
+
+		out.cage.resize(4 * size_t(halfEdgeCount));
+		out.flags.resize(halfEdgeCount);
+		out.points.resize(facePointBegin + view.FaceCount());
+
+		HE_ParallelFor(view.FaceCount(),
+			[&](const uint32_t begin, const uint32_t end)
+			{
+				for (uint32_t faceIdx = begin; faceIdx < end; faceIdx++)
+					out.points[facePointBegin + faceIdx] = HE_FacePoint(view, view.GetFace(faceIdx).begin);
+			}, threadCount, 1024);
+
+		auto CachedFacePoint = [&](const uint32_t e) -> float3
+		{
+			return out.points[facePointBegin + view.Face(e)];
+		};
+
+		HE_ParallelFor(inputPointCount,
+			[&](const uint32_t begin, const uint32_t end)
+			{
+				for (uint32_t vertex = begin; vertex < end; vertex++)
+				{
+					const uint32_t edgeID = vertexEdge[vertex];
+					out.points[vertex] = edgeID != HE_BorderValue ? HE_VertexPoint(view, edgeID, CachedFacePoint) : float3{ 0.0f, 0.0f, 0.0f };
+				}
+			}, threadCount, 1024);
+
+		HE_ParallelFor(view.FaceCount(),
+			[&](const uint32_t begin, const uint32_t end)
+			{
+				for (uint32_t faceIdx = begin; faceIdx < end; faceIdx++)
+				{
+					const HE_Face face = view.GetFace(faceIdx);
+
+					for (uint32_t i = 0; i < face.edgeCount; i++)
+					{
+						const uint32_t edgeID = face.begin + i;
+
+						HE_TwinEdge edges[4];
+						out.flags[edgeID] = HE_PatchTwins(view, face, i, edges);
+
+						edges[0].vert = view.Vert(edgeID);
+						edges[1].vert = edgePointBegin + edgeSlot[edgeID];
+						edges[2].vert = facePointBegin + faceIdx;
+						edges[3].vert = edgePointBegin + edgeSlot[view.Prev(edgeID)];
+
+						for (uint32_t j = 0; j < 4; j++)
+							out.cage[4 * edgeID + j] = edges[j];
+
+						const uint32_t twin = view.Twin(edgeID);
+						if (twin == HE_BorderValue || edgeID < twin)
+							out.points[edges[1].vert] = HE_EdgePoint(view, edgeID, CachedFacePoint);
+					}
+				}
+			}, threadCount, 256);
+
+		out.indexMode = HE_IndexMode::Shared;
+	}
+
+
+	// Points of a level whose topology was built before, from an input that differs from the one it
+	// was built from only in its points. Output slots are read from the half-edges of topology, and
+	// every point is evaluated as HE_SubdivideFaces or HE_SubdivideFacesShared writes it.
+	// inputPointCount is only read for shared indexing, as in HE_SubdivideFacesShared.
+	template<typename TY_View>
+	void HE_SubdividePoints(const TY_View& view, const uint32_t inputPointCount, const HE_Level& topology, Vector<float3>& outPoints, iAllocator& allocator, const uint32_t threadCount = 0)
+	{
+		const bool		shared			= topology.indexMode == HE_IndexMode::Shared;
+		const uint32_t	halfEdgeCount	= view.HalfEdgeCount();
+
+		outPoints.resize(topology.points.size());
+
+		// Shared vertex points are written once, from the last half-edge leaving each vertex
+		Vector<uint32_t> vertexEdge{ allocator };
+
+		if (shared)
+		{
+			vertexEdge.resize(inputPointCount);
+			std::fill(vertexEdge.begin(), vertexEdge.end(), HE_BorderValue);
+
+			for (uint32_t e = 0; e < halfEdgeCount; e++)
+			{
+				if (view.Vert(e) < vertexEdge.size())
+					vertexEdge[view.Vert(e)] = e;
+			}
+		}
+
+		HE_ParallelFor(view.FaceCount(),
+			[&](const uint32_t begin, const uint32_t end)
+			{
+				for (uint32_t faceIdx = begin; faceIdx < end; faceIdx++)
+				{
+					const HE_Face face = view.GetFace(faceIdx);
+					outPoints[topology.cage[4 * face.begin + 2].vert] = HE_FacePoint(view, face.begin);
+				}
+			}, threadCount, 1024);
+
+		auto CachedFacePoint = [&](const uint32_t e) -> float3
+		{
+			return outPoints[topology.cage[4 * e + 2].vert];
+		};
+
+		if (shared)
+		{
+			HE_ParallelFor((uint32_t)vertexEdge.size(),
+				[&](const uint32_t begin, const uint32_t end)
+				{
+					for (uint32_t vertex = begin; vertex < end; vertex++)
+					{
+						const uint32_t edgeID = vertexEdge[vertex];
+						outPoints[vertex] = edgeID != HE_BorderValue ? HE_VertexPoint(view, edgeID, CachedFacePoint) : float3{ 0.0f, 0.0f, 0.0f };
+					}
+				}, threadCount, 1024);
+		}
+
+		HE_ParallelFor(view.FaceCount(),
+			[&](const uint32_t begin, const uint32_t end)
+			{
+				for (uint32_t faceIdx = begin; faceIdx < end; faceIdx++)
+				{
+					const HE_Face face = view.GetFace(faceIdx);
+
+					for (uint32_t i = 0; i < face.edgeCount; i++)
+					{
+						const uint32_t edgeID	= face.begin + i;
+						const uint32_t twin		= view.Twin(edgeID);
+
+						if (!shared)
+							outPoints[topology.cage[4 * edgeID].vert] = HE_VertexPoint(view, edgeID, CachedFacePoint);
+
+						if (!shared || twin == HE_BorderValue || edgeID < twin)
+							outPoints[topology.cage[4 * edgeID + 1].vert] = HE_EdgePoint(view, edgeID, CachedFacePoint);
+					}
+				}
+			}, threadCount, 256);
+	}
+
+
+	/************************************************************************************************/
+
+
+	// Forwards to a view and counts input point loads, not thread safe
+	template<typename TY_View>
+	struct HE_LoadCountingView
+	{
+		const TY_View&		view;
+		mutable uint64_t	pointLoads = 0;
+
+		uint32_t	Next(uint32_t e)		const noexcept { return view.Next(e); }
+		uint32_t	Prev(uint32_t e)		const noexcept { return view.Prev(e); }
+		uint32_t	Twin(uint32_t e)		const noexcept { return view.Twin(e); }
+		uint32_t	Vert(uint32_t e)		const noexcept { return view.Vert(e); }
+		uint32_t	Face(uint32_t e)		const noexcept { return view.Face(e); }
+		bool		IsCorner(uint32_t e)	const noexcept { return view.IsCorner(e); }
+		bool		IsT(uint32_t e)			const noexcept { return view.IsT(e); }
+		float3		Point(uint32_t e)		const noexcept { pointLoads++; return view.Point(e); }
+
+		uint32_t	FaceCount()				const noexcept { return view.FaceCount(); }
+		uint32_t	HalfEdgeCount()			const noexcept { return view.HalfEdgeCount(); }
+		uint32_t	PointCount()			const noexcept { return view.PointCount(); }
+		HE_Face		GetFace(uint32_t f)		const noexcept { return view.GetFace(f); }
+	};
+
+
+	struct HE_SubdivisionBenchmark
+	{
+		uint32_t	levelCount			= 0;
+		uint64_t	uncachedPointLoads	= 0;	// Face points evaluated by every rule that reads them
+		uint64_t	cachedPointLoads	= 0;	// Face point pass first, as HE_SubdivideFaces does
+		double		uncachedDuration	= 0.0; // ms
+		double		cachedDuration		= 0.0; // ms
+
+		double LoadReduction() const noexcept { return cachedPointLoads ? double(uncachedPointLoads) / double(cachedPointLoads) : 0.0; }
+	};
+
+
+	// Builds levelCount per-face levels on one thread with and without the face point pass
+	HE_SubdivisionBenchmark BenchmarkSubdivision(const HE_ControlCage& cage, iAllocator& allocator, const uint32_t levelCount = 3);
+
+
+	/************************************************************************************************/
+
+
+	// FNV-1a over the bytes of a level's half-edges, flags and points, for content-hash caches
+	uint64_t HE_HashLevel(const HE_Level& level) noexcept;
+
+
+	struct HE_DeterminismReport
+	{
+		uint32_t	levelCount		= 0;
+		uint32_t	firstMismatch	= ~0u;	// Level that first differed from the single thread build
+		uint32_t	threadCount		= 0;	// Thread count of that build
+		uint64_t	levelHashes[HE_MaxLevels] = {};
+
+		bool IsDeterministic() const noexcept { return firstMismatch == ~0u; }
+	};
+
+
+	// Builds levelCount levels on one thread, then once per entry of threadCounts, and compares every
+	// level's hash against the single thread build
+	HE_DeterminismReport CheckDeterminism(const HE_ControlCage& cage, iAllocator& allocator, std::span<const uint32_t> threadCounts, const uint32_t levelCount = 3, const HE_IndexMode indexMode = HE_IndexMode::PerFace);
+
+
+	/************************************************************************************************/
+
+
+	// CPU reference of the subdivision graph in HE_AdaptiveCC.hlsl, usable without a device.
+	struct HalfEdgeCPUMesh
+	{
+		HalfEdgeCPUMesh(HE_ControlCage&& IN_cage, iAllocator& IN_allocator, const HE_IndexMode IN_indexMode = HE_IndexMode::PerFace) :
+			cage		{ std::move(IN_cage) },
+			levels		{ IN_allocator },
+			allocator	{ &IN_allocator },
+			indexMode	{ IN_indexMode } {}
+
+		// Stops at HE_MaxLevelCount, past it twin indices no longer fit in 32 bits and the deepest level is returned
+		const HE_Level& BuildNextLevel(const uint32_t threadCount = 0);
+		const HE_Level& GetLevel(const uint32_t level) const { return levels[level]; }
+		uint32_t		LevelCount() const noexcept { return (uint32_t)levels.size(); }
+
+		HE_ControlCage		cage;
+		Vector<HE_Level>	levels;
+		iAllocator*			allocator;
+		HE_IndexMode		indexMode;
+	};
+
+
+}	/************************************************************************************************/
+
+
+/**********************************************************************
+
+Copyright (c) 2024 Robert May
+
+Permission is hereby granted, free of charge, to any person obtaining a
+copy of this software and associated documentation files (the "Software"),
+to deal in the Software without restriction, including without limitation
+the rights to use, copy, modify, merge, publish, distribute, sublicense,
+and/or sell copies of the Software, and to permit persons to whom the
+Software is furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included
+in all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+**********************************************************************/
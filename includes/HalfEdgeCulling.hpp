@@ -0,0 +1,273 @@
+#pragma once
+#include "HalfEdgeCPU.hpp"
+
+#include <span>
+
+
+namespace FlexKit
+{	/************************************************************************************************/
+
+
+	// Matches NormalCone in Intersection.hlsl
+	struct HE_NormalCone
+	{
+		float3	axis;
+		float	cutoff;	// sin of the cone half angle, > 1 never culls
+		float3	center;
+		float	radius;
+	};
+
+
+	struct HE_ConeOptions
+	{
+		float		padding			= 0.1f;	// Extra half angle in radians for the limit surface bulging past the cage
+		uint32_t	clusterSize		= 32;	// Faces per cluster, matches the SubdivideHalfEdgeMesh group size
+		bool		oneRing			= true;	// Include the faces around each corner, the limit patch depends on them
+		bool		clockwise		= false;
+	};
+
+
+	struct HE_PatchBounds
+	{
+		float3 min;
+		float3 max;
+	};
+
+
+	// Face cones in [0, faceCount), cluster cones in [faceCount, faceCount + clusterCount)
+	struct HE_NormalCones
+	{
+		HE_NormalCones(iAllocator& allocator) :
+			cones	{ allocator },
+			bounds	{ allocator } {}
+
+		const HE_NormalCone&	Face(const uint32_t faceIdx)		const noexcept { return cones[faceIdx]; }
+		const HE_NormalCone&	Cluster(const uint32_t faceIdx)		const noexcept { return cones[faceCount + faceIdx / clusterSize]; }
+		const HE_PatchBounds&	Bounds(const uint32_t faceIdx)		const noexcept { return bounds[faceIdx]; }
+
+		Vector<HE_NormalCone>	cones;
+		Vector<HE_PatchBounds>	bounds;	// Per face, the axis-aligned hull of the faces gathered for its cone
+		uint32_t				faceCount		= 0;
+		uint32_t				clusterCount	= 0;
+		uint32_t				clusterSize		= 32;
+	};
+
+
+	struct HE_CullStats
+	{
+		uint32_t	faceCount			= 0;
+		uint32_t	frustumCulled		= 0;
+		uint32_t	clusterConeCulled	= 0;
+		uint32_t	faceConeCulled		= 0;
+		uint32_t	visible				= 0;
+
+		float		ConeCullRate() const noexcept
+		{
+			const uint32_t inFrustum = faceCount - frustumCulled;
+			return inFrustum ? float(clusterConeCulled + faceConeCulled) / float(inFrustum) : 0.0f;
+		}
+	};
+
+
+	HE_NormalCones	BuildNormalCones(const HE_ControlCage& cage, iAllocator& allocator, const HE_ConeOptions& options = {});
+
+	// A half-edge leaving each cage point, HE_BorderValue for points no face uses
+	void			BuildVertexEdges(const HE_ControlCage& cage, Vector<uint32_t>& out);
+
+	// Refits only what the moved points reach: the faces with a face around one of them in their
+	// one-ring, and the clusters holding those faces. Options must match the build. Appends the
+	// refit cone indices, faces and clusters alike, to outDirtyCones.
+	void			RefitNormalCones(
+						const HE_ControlCage&		cage,
+						std::span<const uint32_t>	vertexEdges,
+						std::span<const uint32_t>	movedVertices,
+						HE_NormalCones&				cones,
+						Vector<uint32_t>&			outDirtyCones,
+						const HE_ConeOptions&		options = {});
+
+
+	inline bool IsBackFacing(const HE_NormalCone& cone, const float3 cameraPosition) noexcept
+	{
+		const float3	d		= cone.center - cameraPosition;
+		const float		length	= std::sqrt(d.x * d.x + d.y * d.y + d.z * d.z);
+
+		return d.x * cone.axis.x + d.y * cone.axis.y + d.z * cone.axis.z >= cone.cutoff * length + cone.radius;
+	}
+
+
+	// Mirrors Intersects in Intersection.hlsl
+	inline bool HE_Intersects(const Frustum& frustum, const float3 min, const float3 max) noexcept
+	{
+		for (int I = 0; I < 6; ++I)
+		{
+			const auto& plane = frustum.Planes[I];
+
+			const float px = (plane.n.x >= 0.0f) ? min.x : max.x;
+			const float py = (plane.n.y >= 0.0f) ? min.y : max.y;
+			const float pz = (plane.n.z >= 0.0f) ? min.z : max.z;
+
+			const float dP =	plane.n.x * (px - plane.o.x) +
+								plane.n.y * (py - plane.o.y) +
+								plane.n.z * (pz - plane.o.z);
+
+			if (dP >= 0)
+				return false;
+		}
+
+		return true;
+	}
+
+
+	// Axis-aligned hull of the corners of every face sharing a vertex with the face. Every refinement
+	// step writes convex combinations of the one-ring, so the limit patch and the one-ring of each of
+	// its children, at any level, stay inside.
+	template<typename TY_View>
+	HE_PatchBounds HE_OneRingBounds(const TY_View& view, const uint32_t faceIdx)
+	{
+		const HE_Face	face		= view.GetFace(faceIdx);
+		const uint32_t	maxSteps	= view.HalfEdgeCount();	// Only bounds the walk on broken topology, valence isn't capped
+		HE_PatchBounds	bounds		= { view.Point(face.begin), view.Point(face.begin) };
+
+		auto AddFace = [&](const uint32_t ringFace)
+		{
+			const HE_Face f = view.GetFace(ringFace);
+
+			for (uint32_t i = 0; i < f.edgeCount; i++)
+			{
+				const float3 p = view.Point(f.begin + i);
+				bounds.min = float3{ Min(bounds.min.x, p.x), Min(bounds.min.y, p.y), Min(bounds.min.z, p.z) };
+				bounds.max = float3{ Max(bounds.max.x, p.x), Max(bounds.max.y, p.y), Max(bounds.max.z, p.z) };
+			}
+		};
+
+		AddFace(faceIdx);
+
+		for (uint32_t i = 0; i < face.edgeCount; i++)
+		{
+			const uint32_t	edgeID		= face.begin + i;
+			uint32_t		selection	= RotateSelectionCCW(view, edgeID);
+			uint32_t		steps		= 0;
+
+			while (selection != edgeID && selection != HE_BorderValue && steps++ < maxSteps)
+			{
+				AddFace(view.Face(selection));
+				selection = RotateSelectionCCW(view, selection);
+			}
+
+			if (selection == HE_BorderValue)
+			{
+				selection = RotateSelectionCW(view, edgeID);
+
+				while (selection != HE_BorderValue && steps++ < maxSteps)
+				{
+					AddFace(view.Face(selection));
+					selection = RotateSelectionCW(view, selection);
+				}
+			}
+		}
+
+		return bounds;
+	}
+
+
+	// CPU reference of the cull in SubdivideHalfEdgeMesh, in world space. Faces are tested with their
+	// one-ring bounds, the shader tests the same bounds moved into view space and keeps a superset.
+	HE_CullStats CullControlFaces(
+		const HE_ControlCage&	cage,
+		const HE_NormalCones&	cones,
+		const Frustum&			frustum,
+		const float3			cameraPosition,
+		Vector<uint32_t>&		outVisibleFaces,
+		const bool				coneCulling = true);
+
+
+	/************************************************************************************************/
+
+
+	struct HE_HierarchyCullStats
+	{
+		uint32_t	levelCount				= 0;
+		uint32_t	tested[HE_MaxLevels]	= {};
+		uint32_t	visible[HE_MaxLevels]	= {};
+		uint64_t	denseTests				= 0;	// Patches a cull of every level in full would test
+	};
+
+
+	struct HE_BoundsReport
+	{
+		uint64_t	pointsChecked	= 0;
+		uint64_t	outside			= 0;
+		float		maxExcess		= 0.0f;	// Furthest a point was found past a bound
+
+		bool IsConservative() const noexcept { return outside == 0; }
+	};
+
+
+	// One-ring bounds of every patch of the levels of a HalfEdgeCPUMesh. Level L stores one bound per
+	// patch, patch p of level L refines patches [4p, 4p + 4) of level L + 1, and patch p of level 0
+	// belongs to control face faceLookup[p]. Bounds tighten with every level as the rings shrink.
+	// CPU only: the GPU graph refines a single level from the control faces it kept, and the uniform
+	// level passes build every patch, so neither has children to cull.
+	class HE_PatchHierarchy
+	{
+	public:
+		HE_PatchHierarchy(iAllocator& allocator) :
+			bounds	{ allocator },
+			visible	{ allocator } {}
+
+		void					Build(const HalfEdgeCPUMesh& mesh, const uint32_t threadCount = 0);
+
+		// Culls level by level, starting from the control faces that passed. Only the children of
+		// patches that passed level L - 1 are tested at level L, so refinement stops where a patch
+		// leaves the view. Visible patches of each level are in ascending order.
+		HE_HierarchyCullStats	Cull(const HE_ControlCage& cage, std::span<const uint32_t> visibleFaces, const Frustum& frustum);
+
+		std::span<const HE_PatchBounds>	LevelBounds(const uint32_t level)	const noexcept { return { bounds.data() + boundsOffset[level], boundsOffset[level + 1] - boundsOffset[level] }; }
+		std::span<const uint32_t>		Visible(const uint32_t level)		const noexcept { return { visible.data() + visibleOffset[level], visibleOffset[level + 1] - visibleOffset[level] }; }
+		uint32_t						LevelCount()						const noexcept { return levelCount; }
+
+	private:
+		Vector<HE_PatchBounds>	bounds;
+		Vector<uint32_t>		visible;
+		uint64_t				boundsOffset[HE_MaxLevels + 1]	= {};
+		uint64_t				visibleOffset[HE_MaxLevels + 1]	= {};
+		uint32_t				levelCount						= 0;
+	};
+
+
+	// Checks the corners of every patch of every level against the bounds of its control face and of
+	// each ancestor patch. Corners converge to the limit surface, so a bound that holds them all at
+	// the deepest level holds the surface to within that level's error. tolerance is relative to the
+	// bound's extent.
+	HE_BoundsReport CheckPatchBounds(
+		const HalfEdgeCPUMesh&		mesh,
+		const HE_NormalCones&		cones,
+		const HE_PatchHierarchy&	hierarchy,
+		const float					tolerance = 1.0e-5f);
+
+
+}	/************************************************************************************************/
+
+/**********************************************************************
+
+Copyright (c) 2024 Robert May
+
+Permission is hereby granted, free of charge, to any person obtaining a
+copy of this software and associated documentation files (the "Software"),
+to deal in the Software without restriction, including without limitation
+the rights to use, copy, modify, merge, publish, distribute, sublicense,
+and/or sell copies of the Software, and to permit persons to whom the
+Software is furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included
+in all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+**********************************************************************/
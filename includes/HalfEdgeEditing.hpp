@@ -0,0 +1,134 @@
+#pragma once
+#include "HalfEdgeCPU.hpp"
+#include "HalfEdgeUpload.hpp"
+
+#include <span>
+#include <unordered_map>
+#include <vector>
+
+
+namespace FlexKit
+{	/************************************************************************************************/
+
+
+	constexpr uint32_t HE_InvalidFace	= 0xffffffff;
+	constexpr uint32_t HE_InvalidVertex	= 0xffffffff;
+
+
+	struct HE_EditStats
+	{
+		uint32_t facesAdded		= 0;	// Faces written, including those split and collapsed edges rewrite
+		uint32_t facesDeleted	= 0;
+		uint32_t slotsReused	= 0;	// Added faces that took a free slot instead of growing the arrays
+		uint32_t rejected		= 0;	// Edits refused and rolled back
+	};
+
+
+	// Edits a control cage in place. Deleted faces leave free slots: the face keeps its half-edge block
+	// and point range, marked HE_FreeFace, and its half-edges become a loop of border edges on a single
+	// vertex, so the slot subdivides to nothing visible and every reader of the cage stays valid. A
+	// later face with the same edge count takes the slot back, other faces are appended.
+	//
+	// Every edit touches only the faces around it and marks the elements it wrote in the dirty ranges,
+	// ready for HE_BufferUploader. Arrays that grew show up as dirty ranges past their old size.
+	// Edits that would leave an edge with more than two faces, or a vertex with more than one fan or
+	// over HE_MaxValence edges, are rolled back and refused.
+	class HE_CageEditor
+	{
+	public:
+		HE_CageEditor(HE_ControlCage& cage, iAllocator& allocator);	// Indexes the cage once, linear in its size
+
+		uint32_t	AddVertex(const float3 point);
+		void		MoveVertex(const uint32_t vertex, const float3 point);
+
+		// Counter-clockwise vertex loop, as passed to ModifiableShape::AddPolygon. HE_InvalidFace when a
+		// directed edge of the loop already exists, a vertex repeats or the edge count is unsupported.
+		uint32_t	AddFace(std::span<const uint32_t> vertices);
+		bool		DeleteFace(const uint32_t face);
+
+		// Inserts a vertex on the half-edge's edge, each face on it gains one edge. Returns the new vertex.
+		uint32_t	SplitEdge(const uint32_t halfEdge, const float3 point);
+
+		// Merges the far vertex of the half-edge into its origin, moved to the midpoint. Faces left with
+		// fewer than three edges are deleted. Returns the kept vertex, HE_InvalidVertex if refused.
+		uint32_t	CollapseEdge(const uint32_t halfEdge);
+
+		uint32_t	LiveFaceCount()		const noexcept { return liveFaces; }
+		void		ClearDirty() noexcept;
+
+		HE_DirtyRanges	dirtyHalfEdges;
+		HE_DirtyRanges	dirtyFaces;
+		HE_DirtyRanges	dirtyFaceLookup;
+		HE_DirtyRanges	dirtyPoints;
+		HE_EditStats	stats;
+
+	private:
+		using Loop = std::vector<uint32_t>;
+
+		// Removes the faces and inserts the loops, undone as a whole if any loop cannot be inserted
+		bool		ReplaceFaces(std::span<const uint32_t> removed, std::span<const Loop> loops, uint32_t* firstAdded = nullptr);
+
+		uint32_t	InsertFace(std::span<const uint32_t> vertices);
+		void		RemoveFace(const uint32_t face);
+		bool		CanInsert(std::span<const uint32_t> vertices) const;
+		bool		IsManifold(const uint32_t vertex) const;
+
+		uint32_t	FindEdge(const uint32_t from, const uint32_t to) const noexcept;
+		void		FaceVertices(const uint32_t face, Loop& out) const;
+		void		RefreshFlags(const uint32_t vertex);
+
+		static uint64_t	EdgeKey(const uint32_t from, const uint32_t to) noexcept { return uint64_t(from) << 32 | to; }
+
+		HE_ControlCage*							cage;
+		std::unordered_map<uint64_t, uint32_t>	edges;		// Live half-edge by its directed vertex pair
+		std::vector<std::vector<uint32_t>>		outgoing;	// Live half-edges leaving each vertex
+		std::vector<uint32_t>					freeSlots[HE_MaxValence + 1];	// Free faces by edge count
+		uint32_t								liveFaces = 0;
+	};
+
+
+	/************************************************************************************************/
+
+
+	struct HE_RebuildReport
+	{
+		uint32_t	faceCount		= 0;	// Live faces compared
+		uint32_t	mismatches		= 0;	// Faces whose half-edges, flags, twins or first level differ
+		uint32_t	firstMismatch	= HE_InvalidFace;	// Slot in the edited cage
+
+		bool IsEqual() const noexcept { return mismatches == 0; }
+	};
+
+
+	// Rebuilds the live faces of an edited cage from scratch through ModifiableShape and
+	// BuildControlCage and compares the two. Faces are matched in slot order, twins by the face and
+	// corner they lead to, so the check ignores where free slots left the edited layout. Both cages are
+	// subdivided once and each face's points and patch flags compared bitwise.
+	HE_RebuildReport CompareWithRebuild(const HE_ControlCage& edited, iAllocator& allocator);
+
+
+}	/************************************************************************************************/
+
+/**********************************************************************
+
+Copyright (c) 2024 Robert May
+
+Permission is hereby granted, free of charge, to any person obtaining a
+copy of this software and associated documentation files (the "Software"),
+to deal in the Software without restriction, including without limitation
+the rights to use, copy, modify, merge, publish, distribute, sublicense,
+and/or sell copies of the Software, and to permit persons to whom the
+Software is furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included
+in all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+**********************************************************************/
@@ -0,0 +1,120 @@
+#pragma once
+#include "HalfEdgeCPU.hpp"
+
+#include <atomic>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <unordered_map>
+
+
+namespace FlexKit
+{	/************************************************************************************************/
+
+
+	struct HE_FaceCacheOptions
+	{
+		uint64_t budgetBytes	= 16 * MEGABYTE;
+		uint32_t shardCount		= 16;	// Each shard has its own lock and LRU list, keys are spread by face
+	};
+
+
+	struct HE_FaceCacheStats
+	{
+		uint64_t	hits			= 0;
+		uint64_t	misses			= 0;
+		uint64_t	evictions		= 0;
+		uint64_t	bytes			= 0;
+		uint32_t	entries			= 0;
+		double		evaluateTime	= 0.0;	// Summed over misses, ms
+
+		float		HitRate()			const noexcept { return hits + misses ? float(hits) / float(hits + misses) : 0.0f; }
+		double		MissMicroseconds()	const noexcept { return misses ? 1000.0 * evaluateTime / double(misses) : 0.0; }
+	};
+
+
+	// Subdivides single control faces on demand. A face's patches at level L depend only on the faces
+	// sharing a vertex with it, so a miss copies that one-ring into a small cage, subdivides it to
+	// L - 1 and runs the last level on the face's own patches only.
+	//
+	// The result holds the face's contiguous range of the per-face level: patches
+	// [begin * 4^L, (begin + n) * 4^L) with n the face's edge count, renumbered from 0. Twins and
+	// points are relative to that range, twins leaving it are HE_BorderValue, and everything else is
+	// bitwise what HalfEdgeCPUMesh builds for the whole cage.
+	//
+	// Results are kept in a sharded LRU cache keyed by face, level and point version. EvaluateFace is
+	// thread safe, a result stays valid for as long as its pointer is held, even once evicted.
+	class HE_FaceEvaluator
+	{
+	public:
+		HE_FaceEvaluator(const HE_ControlCage& cage, iAllocator& allocator, const HE_FaceCacheOptions& options = {});
+
+		// Levels are clamped to HE_MaxLevelCount of the cage, as HalfEdgeCPUMesh::BuildNextLevel does
+		std::shared_ptr<const HE_Level>	EvaluateFace(const uint32_t face, const uint32_t level);
+
+		// Call after the cage points change. Entries of older versions are never returned again and
+		// age out of the LRU lists.
+		void				PointsChanged() noexcept	{ version++; }
+		uint32_t			PointVersion() const noexcept	{ return version; }
+
+		void				Clear();
+		HE_FaceCacheStats	GetStats() const;
+
+	private:
+		struct Entry
+		{
+			uint64_t						key;
+			std::shared_ptr<const HE_Level>	level;
+			uint64_t						bytes;
+		};
+
+		struct Shard
+		{
+			std::mutex														lock;
+			std::list<Entry>												lru;	// Most recently used first
+			std::unordered_map<uint64_t, typename std::list<Entry>::iterator>	lookup;
+			uint64_t														bytes			= 0;
+			uint64_t														evictions		= 0;
+			double															evaluateTime	= 0.0;
+		};
+
+		std::shared_ptr<const HE_Level>	Evaluate(const uint32_t face, const uint32_t level) const;
+
+		const HE_ControlCage*		cage;
+		iAllocator*					allocator;
+		uint64_t					shardBudget;
+		uint32_t					maxLevel;
+		std::unique_ptr<Shard[]>	shards;
+		uint32_t					shardCount;
+
+		std::atomic_uint32_t		version	= 0;
+		std::atomic_uint64_t		hits	= 0;
+		std::atomic_uint64_t		misses	= 0;
+	};
+
+
+}	/************************************************************************************************/
+
+/**********************************************************************
+
+Copyright (c) 2024 Robert May
+
+Permission is hereby granted, free of charge, to any person obtaining a
+copy of this software and associated documentation files (the "Software"),
+to deal in the Software without restriction, including without limitation
+the rights to use, copy, modify, merge, publish, distribute, sublicense,
+and/or sell copies of the Software, and to permit persons to whom the
+Software is furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included
+in all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+**********************************************************************/
@@ -0,0 +1,151 @@
+#pragma once
+#include "HalfEdgeCPU.hpp"
+#include "HalfEdgeCulling.hpp"
+#include "SubdivisionSurfaceComponent.hpp"
+
+#include <span>
+
+
+namespace FlexKit
+{	/************************************************************************************************/
+
+
+	// Topology, cones and subdivided levels shared by every instance of one shape. Levels are built on
+	// first use from the base points, building is not thread safe.
+	class HE_SharedTopology
+	{
+	public:
+		HE_SharedTopology(HE_ControlCage&& cage, iAllocator& allocator, const HE_IndexMode indexMode = HE_IndexMode::PerFace);
+
+		const HE_Level&			Level(const uint32_t level, const uint32_t threadCount = 0);
+		const HE_ControlCage&	Cage()		const noexcept { return mesh.cage; }
+		const HE_NormalCones&	Cones()		const noexcept { return cones; }
+		const HE_SurfaceBounds&	Bounds()	const noexcept { return bounds; }	// Object space, base points
+		uint32_t				MaxLevel()	const noexcept { return HE_MaxLevelCount(mesh.cage.halfEdges.size()) - 1; }
+
+		uint64_t				ByteSize()	const noexcept;
+
+		HalfEdgeCPUMesh		mesh;
+		HE_NormalCones		cones;
+		HE_SurfaceBounds	bounds;
+	};
+
+
+	/************************************************************************************************/
+
+
+	// Affine object to world transform, three rows of a 4x4 matrix as uploaded per instance
+	struct HE_InstanceTransform
+	{
+		float4 rows[3] = {
+			float4{ 1.0f, 0.0f, 0.0f, 0.0f },
+			float4{ 0.0f, 1.0f, 0.0f, 0.0f },
+			float4{ 0.0f, 0.0f, 1.0f, 0.0f } };
+
+		float3 Apply(const float3 p) const noexcept
+		{
+			return float3{
+				rows[0].x * p.x + rows[0].y * p.y + rows[0].z * p.z + rows[0].w,
+				rows[1].x * p.x + rows[1].y * p.y + rows[1].z * p.z + rows[1].w,
+				rows[2].x * p.x + rows[2].y * p.y + rows[2].z * p.z + rows[2].w };
+		}
+	};
+
+
+	struct HE_PointOverride
+	{
+		uint32_t	vertex;
+		float3		position;	// Object space
+	};
+
+
+	struct HE_OverrideRange
+	{
+		uint32_t begin	= 0;
+		uint32_t count	= 0;
+	};
+
+
+	struct HE_InstanceStats
+	{
+		uint32_t	instanceCount	= 0;
+		uint32_t	overridden		= 0;	// Instances with control point overrides
+		uint64_t	instanceBytes	= 0;	// Per instance arrays and the override pool
+		uint64_t	sharedBytes		= 0;	// HE_SharedTopology, paid once
+	};
+
+
+	// Instances of one HE_SharedTopology. An instance is a transform, an optional range of control
+	// point overrides and the LOD fields of SubdivisionSurfaceComponent, in arrays indexed by instance,
+	// so the per-instance cost is tens of bytes and the cage, cones and levels exist once.
+	class HE_InstanceSet
+	{
+	public:
+		HE_InstanceSet(HE_SharedTopology& topology, iAllocator& allocator);
+
+		uint32_t			AddInstance(const HE_InstanceTransform& transform, const HE_SurfaceLOD& lod = {});
+		void				SetTransform(const uint32_t instance, const HE_InstanceTransform& transform);
+
+		// Replaces the instance's overrides, an empty span returns it to the shared points. Ranges that
+		// grow are appended to the pool, CompactOverrides reclaims the old ones.
+		void				SetOverrides(const uint32_t instance, std::span<const HE_PointOverride> overrides);
+		void				CompactOverrides();
+
+		// Culls and selects a level for every instance in parallel chunks, see UpdateSubdivisionSurfaces.
+		// Visible instances whose level changed or whose overrides changed are appended to outDirty.
+		HE_SurfaceUpdateStats	Update(std::span<const HE_ViewState> views, Vector<uint32_t>& outDirty, const HE_SurfaceUpdateOptions& options = {});
+
+		// Object space points of one instance at a level, in the layout of the shared level's points,
+		// whose half-edges and flags it shares. Instances without overrides return the shared points,
+		// others evaluate only their points over the shared levels, into scratch storage that stays
+		// valid until the next call.
+		std::span<const float3>	EvaluateInstance(const uint32_t instance, const uint32_t level, const uint32_t threadCount = 0);
+
+		uint32_t			InstanceCount()							const noexcept { return (uint32_t)transforms.size(); }
+		bool				IsVisible(const uint32_t instance)		const noexcept { return (states[instance].flags & HE_SurfaceVisible) != 0; }
+		uint32_t			InstanceLevel(const uint32_t instance)	const noexcept { return lods[instance].level; }
+		HE_InstanceStats	GetStats()								const noexcept;
+
+	private:
+		void				UpdateBounds(const uint32_t instance) noexcept;
+
+		HE_SharedTopology*				topology;
+		iAllocator*						allocator;
+
+		Vector<HE_InstanceTransform>	transforms;
+		Vector<HE_OverrideRange>		overrideRanges;
+		Vector<HE_SurfaceLOD>			lods;
+		Vector<HE_SurfaceBounds>		bounds;
+		Vector<HE_SurfaceState>			states;
+		Vector<HE_PointOverride>		overridePool;
+
+		Vector<float3>					scratchPoints;
+		Vector<float3>					scratchLevels[2];	// Points of each level are the input of the next
+	};
+
+
+}	/************************************************************************************************/
+
+/**********************************************************************
+
+Copyright (c) 2024 Robert May
+
+Permission is hereby granted, free of charge, to any person obtaining a
+copy of this software and associated documentation files (the "Software"),
+to deal in the Software without restriction, including without limitation
+the rights to use, copy, modify, merge, publish, distribute, sublicense,
+and/or sell copies of the Software, and to permit persons to whom the
+Software is furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included
+in all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+**********************************************************************/
@@ -1,5 +1,8 @@
 #pragma once
-#include "CBT.hpp"
+#include "HalfEdgeCBT.hpp"
+#include "HalfEdgeCPU.hpp"
+#include "HalfEdgeTemporal.hpp"
+#include "HalfEdgeUpload.hpp"
 #include <FrameGraph.hpp>
 #include <Graphics.hpp>
 #include <ModifiableShape.hpp>
@@ -7,34 +10,6 @@
 
 namespace FlexKit
 {
-	struct HEEdge
-	{
-		uint32_t twin;
-		uint32_t next;
-		uint32_t prev;
-		uint32_t vert;
-	};
-
-	struct HE_Face
-	{
-		uint32_t begin;
-		uint32_t vertexRange;
-		uint16_t edgeCount;
-		uint16_t level;
-
-		uint32_t GetVertexCount()
-		{
-			return 1 + 2 * edgeCount;
-		}
-	};
-
-	struct HEVertex
-	{
-		float3 point;
-		float2 UV;
-	};
-
-
 	struct HalfEdgeMesh
 	{
 		struct HalfEdgeVertex
@@ -44,11 +19,21 @@ namespace FlexKit
 			float2	UV;
 		};
 
+		static constexpr uint32_t TwinEdgeStride = 16;	// TwinEdge in HE_Common.hlsl, twin, vert and flags
+
+		struct LevelOptions
+		{
+			uint32_t	levelCount		= 3;				// Clamped to HE_MaxLevelCount
+			uint64_t	budgetBytes		= 512 * MEGABYTE;	// Level buffers, levels past it are not allocated
+			bool		deterministic	= false;			// Level builds place output by face index, bitwise stable between runs
+		};
+
 		HalfEdgeMesh(
 			const	ModifiableShape&	shape,
 					RenderSystem&		IN_renderSystem, 
 					iAllocator&			IN_allocator, 
-					iAllocator&			IN_temp);
+					iAllocator&			IN_temp,
+			const	LevelOptions&		levelOptions = {});
 
 
 		~HalfEdgeMesh();
@@ -56,7 +41,28 @@ namespace FlexKit
 
 		void InitializeMesh(FlexKit::FrameGraph& frameGraph);
 		void BuildSubDivLevel(FlexKit::FrameGraph& frameGraph);
-		void AdaptiveSubdivUpdate(FlexKit::FrameGraph& frameGraph, FlexKit::CameraHandle camera);
+		void UpdateFacePoints(FlexKit::FrameGraph& frameGraph); // Reevaluates the control face points after the cage moved
+
+		// A camera the refinement serves, lodScale comes from its viewport, see HE_LODScale. Without one
+		// every face stays at level 0.
+		struct RefineView
+		{
+			FlexKit::CameraHandle	camera;
+			float					lodScale	= 0.0f;
+		};
+
+		void AdaptiveSubdivUpdate(FlexKit::FrameGraph& frameGraph, const RefineView& view) { AdaptiveSubdivUpdate(frameGraph, { &view, 1 }); }
+		void AdaptiveSubdivUpdate(FlexKit::FrameGraph& frameGraph, std::span<const RefineView> views, UpdateTask* prep = nullptr);
+
+		// Culling and LOD selection of the adaptive update as a dispatcher task, run once cameraUpdate
+		// is done. Pass the task as prep to AdaptiveSubdivUpdate and as update to DrawSubDivLevel_DEBUG,
+		// the refinement is then prepared alongside other frame work instead of while recording.
+		UpdateTask& QueueSubdivisionPrep(UpdateDispatcher& dispatcher, UpdateTask& cameraUpdate, std::span<const RefineView> views);
+		HE_RefineAction PrepareRefinement(std::span<const RefineView> views); // The task's work, sets refineAction
+
+		// Moves control vertices, the changed ranges are sent by the next UploadControlPoints
+		void SetControlPoints(std::span<const uint32_t> vertices, std::span<const float3> positions);
+		void UploadControlPoints(FlexKit::FrameGraph& frameGraph);
 
 		
 		/************************************************************************************************/
@@ -84,12 +90,43 @@ namespace FlexKit
 		ResourceHandle		controlCage			= InvalidHandle;
 		ResourceHandle		controlPoints		= InvalidHandle;
 		ResourceHandle		faceLookup			= InvalidHandle;
-		ResourceHandle		levels[3]			= { InvalidHandle, InvalidHandle, InvalidHandle };
-		ResourceHandle		points[3]			= { InvalidHandle, InvalidHandle, InvalidHandle };
-		uint32_t			edgeCount[3]		= { 0, 0, 0 };
-		uint32_t			patchCount[3]		= { 0, 0, 0 };
+		ResourceHandle		normalCones			= InvalidHandle;
+		ResourceHandle		faceBounds			= InvalidHandle;	// HE_NormalCones::bounds, the one-ring hull of each control face
+		ResourceHandle		facePoints			= InvalidHandle;
+		ResourceHandle		patchBits			= InvalidHandle;	// Device copy of the patch CBT's bitfield
+		ResourceHandle		levels[HE_MaxLevels];
+		ResourceHandle		points[HE_MaxLevels];
+		uint32_t			edgeCount[HE_MaxLevels]		= {};
+		uint32_t			patchCount[HE_MaxLevels]	= {};
+		uint32_t			levelCount			= 0;
 		uint8_t				levelsBuilt			= 0;
-		CBTBuffer			cbt;
+		bool				deterministic		= false;
+
+		HE_ControlCage			cpuCage;
+		HE_NormalCones			cpuCones;
+		HE_VisibilityTracker	visibility;
+		uint64_t				cageVersion			= 0;
+		uint64_t				facePointVersion	= ~0ull;
+		HE_RefineAction			refineAction		= HE_RefineAction::Skip;	// Written by the prep task
+
+		// Adaptive patches, every visible control face is split to its level and the rest merged back.
+		// Slots stay put across frames, so only the bitfield words a step changed are sent to patchBits.
+		// SubdivideHalfEdgeMesh still reads its faces from the refine list, decoding patches from
+		// patchBits through the sum reduction on the device is left for when the level passes take
+		// patches below the control faces.
+		HE_PatchAllocator		patches;
+		Vector<uint8_t>			patchTargets;	// Per control face
+		HE_BufferUploader		patchUploader;
+		bool					inView				= true;	// Cleared by the owner's surface cull, before the prep task runs
+
+		Vector<HalfEdgeVertex>	controlPointData;
+		HE_BufferUploader		pointUploader;
+		HE_BufferUploader		coneUploader;
+		HE_BufferUploader		boundsUploader;
+		Vector<uint32_t>		vertexEdges;	// A half-edge leaving each control point, for refitting cones around moved ones
+		Vector<uint32_t>		movedVertices;	// Since the last UploadControlPoints
+		Vector<uint32_t>		dirtyCones;
+		iAllocator*				allocator			= nullptr;
 	};
 
 }
@@ -0,0 +1,107 @@
+#pragma once
+#include "HalfEdgeCPU.hpp"
+
+
+namespace FlexKit
+{	/************************************************************************************************/
+
+
+	constexpr uint32_t HE_MeshletMaxVertices	= 128;
+	constexpr uint32_t HE_MeshletMaxPrimitives	= 64;
+
+
+	// Layout intended for a mesh shader with one group per meshlet
+	struct HE_Meshlet
+	{
+		uint32_t vertexOffset;
+		uint32_t vertexCount;
+		uint32_t primitiveOffset;
+		uint32_t primitiveCount;
+	};
+
+	struct HE_MeshletBounds
+	{
+		float3	center;
+		float	radius;
+		float3	min;
+		float3	max;
+	};
+
+
+	// Three 8-bit meshlet local indices in the low 24 bits
+	inline uint32_t HE_PackTriangle(uint32_t i0, uint32_t i1, uint32_t i2) noexcept
+	{
+		return (i0 & 0xff) | ((i1 & 0xff) << 8) | ((i2 & 0xff) << 16);
+	}
+
+
+	struct HE_MeshletList
+	{
+		HE_MeshletList(iAllocator& allocator) :
+			meshlets		{ allocator },
+			bounds			{ allocator },
+			vertexIndices	{ allocator },
+			primitives		{ allocator } {}
+
+		Vector<HE_Meshlet>			meshlets;
+		Vector<HE_MeshletBounds>	bounds;
+		Vector<uint32_t>			vertexIndices;	// Indices into HE_Level::points, one run per meshlet
+		Vector<uint32_t>			primitives;		// HE_PackTriangle, one run per meshlet
+	};
+
+
+	struct HE_MeshletStats
+	{
+		uint32_t	meshletCount			= 0;
+		uint32_t	patchCount				= 0;
+		uint32_t	triangleCount			= 0;
+		uint32_t	emittedVertexCount		= 0;	// Sum of per meshlet vertex counts
+		uint32_t	uniqueVertexCount		= 0;	// Welded vertices across the whole level
+
+		float		verticesPerTriangle		= 0.0f;
+		float		perPatchVertsPerTri		= 2.0f;	// MeshMain emits 4 vertices per 2 triangles
+		float		primitiveFillRate		= 0.0f;	// Average primitiveCount / maxPrimitives
+		float		vertexFillRate			= 0.0f;	// Average vertexCount / maxVertices
+	};
+
+
+	struct HE_MeshletOptions
+	{
+		uint32_t maxVertices	= HE_MeshletMaxVertices;
+		uint32_t maxPrimitives	= HE_MeshletMaxPrimitives;
+	};
+
+
+	// Greedily grows clusters of level patches across twin edges, picking the neighbour
+	// that adds the fewest new vertices. Level vertices are welded through the twin
+	// links first, since every face stores its own copy of its corners and edge points.
+	HE_MeshletList	BuildMeshlets(const HE_Level& level, iAllocator& allocator, const HE_MeshletOptions& options = {});
+	HE_MeshletStats	GetMeshletStats(const HE_MeshletList& meshlets, const HE_Level& level, const HE_MeshletOptions& options = {});
+	uint32_t		WeldLevelVertices(const HE_Level& level, Vector<uint32_t>& outRemap);
+
+
+}	/************************************************************************************************/
+
+/**********************************************************************
+
+Copyright (c) 2024 Robert May
+
+Permission is hereby granted, free of charge, to any person obtaining a
+copy of this software and associated documentation files (the "Software"),
+to deal in the Software without restriction, including without limitation
+the rights to use, copy, modify, merge, publish, distribute, sublicense,
+and/or sell copies of the Software, and to permit persons to whom the
+Software is furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included
+in all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+**********************************************************************/
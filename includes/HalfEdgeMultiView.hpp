@@ -0,0 +1,119 @@
+#pragma once
+#include "HalfEdgeCulling.hpp"
+
+#include <cmath>
+#include <span>
+
+
+namespace FlexKit
+{	/************************************************************************************************/
+
+
+	constexpr uint32_t HE_MaxViews = 8; // Matches HE_MAX_VIEWS in HE_AdaptiveCC.hlsl
+
+
+	struct HE_ViewState
+	{
+		float3	position;			// World space
+		Frustum	frustum;			// World space
+		float	lodScale	= 0.0f;	// Pixels covered by one world unit at distance one, 0 keeps level zero
+	};
+
+
+	// lodScale of a perspective view from its viewport height in pixels and vertical fov in radians
+	inline float HE_LODScale(const float viewportHeight, const float fovY) noexcept
+	{
+		return viewportHeight / (2.0f * std::tan(fovY * 0.5f));
+	}
+
+
+	struct HE_LODOptions
+	{
+		float		targetPixels	= 16.0f;	// Projected face size a single level should cover
+		uint32_t	maxLevel		= 3;
+	};
+
+
+	// Screen space driven level for one face as seen from one view, from the face bounding sphere
+	inline uint32_t HE_FaceLOD(const HE_ViewState& view, const HE_NormalCone& bounds, const HE_LODOptions& options = {}) noexcept
+	{
+		if (view.lodScale <= 0.0f)
+			return 0;
+
+		const float3	d			= bounds.center - view.position;
+		const float		distance	= std::sqrt(d.x * d.x + d.y * d.y + d.z * d.z) - bounds.radius;
+
+		if (distance <= 1.0e-4f)
+			return options.maxLevel;
+
+		const float projected = 2.0f * bounds.radius * view.lodScale / distance;
+
+		if (projected <= options.targetPixels)
+			return 0;
+
+		const uint32_t level = (uint32_t)std::ceil(std::log2(projected / options.targetPixels));
+
+		return level < options.maxLevel ? level : options.maxLevel;
+	}
+
+
+	struct HE_MultiViewStats
+	{
+		uint32_t	viewCount			= 0;
+		uint32_t	faceCount			= 0;
+		uint32_t	clustersRejected	= 0;	// Clusters no view can see, their faces are never visited
+		uint64_t	viewTests			= 0;	// Face and cluster tests against a single view
+		uint32_t	visible				= 0;	// Faces visible to at least one view
+		uint64_t	visiblePerView		= 0;	// Sum of each view's own visible set
+		uint64_t	sharedWork			= 0;	// Sum of edgeCount * 4^level over the union at the max level
+		uint64_t	independentWork		= 0;	// The same, summed over every view refined on its own
+	};
+
+
+	// One refinement for several views. A face is kept when any view sees it and its level is the
+	// highest any of those views asks for, so the output serves every view at once.
+	// outFaces is in ascending face order, outLevels holds the level of each entry in outFaces.
+	HE_MultiViewStats RefineMultiView(
+		const HE_ControlCage&			cage,
+		const HE_NormalCones&			cones,
+		std::span<const HE_ViewState>	views,
+		Vector<uint32_t>&				outFaces,
+		Vector<uint8_t>&				outLevels,
+		const HE_LODOptions&			options = {});
+
+
+	// Runs RefineMultiView on the first 1..N views and returns one entry per prefix, to show how the
+	// shared cost grows as views are added compared to refining each view separately.
+	Vector<HE_MultiViewStats> MeasureMultiViewScaling(
+		const HE_ControlCage&			cage,
+		const HE_NormalCones&			cones,
+		std::span<const HE_ViewState>	views,
+		iAllocator&						allocator,
+		const HE_LODOptions&			options = {});
+
+
+}	/************************************************************************************************/
+
+/**********************************************************************
+
+Copyright (c) 2024 Robert May
+
+Permission is hereby granted, free of charge, to any person obtaining a
+copy of this software and associated documentation files (the "Software"),
+to deal in the Software without restriction, including without limitation
+the rights to use, copy, modify, merge, publish, distribute, sublicense,
+and/or sell copies of the Software, and to permit persons to whom the
+Software is furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included
+in all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+**********************************************************************/
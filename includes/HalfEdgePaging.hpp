@@ -0,0 +1,229 @@
+#pragma once
+#include "HalfEdgeCPU.hpp"
+
+#include <span>
+
+
+namespace FlexKit
+{	/************************************************************************************************/
+
+
+	constexpr uint32_t HE_InvalidPage = 0xffffffff;
+
+
+	struct HE_PageMove
+	{
+		uint32_t from;
+		uint32_t to;
+		uint32_t owner;
+	};
+
+
+	struct HE_PageStats
+	{
+		uint32_t	pageCount		= 0;	// Pages backed by storage, resident or on the free list
+		uint32_t	residentPages	= 0;
+		uint32_t	highWater		= 0;	// One past the highest resident page
+
+		// Share of the pages below the high water mark that are holes
+		float		Fragmentation() const noexcept { return highWater ? 1.0f - float(residentPages) / float(highWater) : 0.0f; }
+	};
+
+
+	// Pool of fixed-size pages with a free list. Every page records the page table entry that owns it,
+	// so compaction can move pages and hand back the entries to patch.
+	class HE_PageAllocator
+	{
+	public:
+		HE_PageAllocator(iAllocator& allocator, const uint32_t maxPages);
+
+		uint32_t		Allocate(const uint32_t owner) noexcept;	// HE_InvalidPage once maxPages are resident
+		void			Free(const uint32_t page) noexcept;
+
+		// Moves the resident pages above the resident count into the holes below it, then trims the pool
+		void			Compact(Vector<HE_PageMove>& outMoves);
+
+		HE_PageStats	GetStats()		const noexcept;
+		uint32_t		PageCount()		const noexcept { return (uint32_t)owners.size(); }
+		uint32_t		ResidentCount()	const noexcept { return residentCount; }
+		uint32_t		Owner(const uint32_t page) const noexcept { return owners[page]; }
+
+		uint32_t maxPages;
+
+	private:
+		Vector<uint32_t>	owners;		// HE_InvalidPage for free pages
+		Vector<uint32_t>	freeList;
+		uint32_t			residentCount = 0;
+	};
+
+
+	/************************************************************************************************/
+
+
+	struct HE_PagedLevelOptions
+	{
+		uint32_t levelCount		= 2;			// Paged levels, built on top of the dense first level, clamped to HE_MaxLevelCount
+		uint32_t parentsPerPage	= 16;
+		uint32_t maxPages		= 1u << 16;
+	};
+
+
+	struct HE_ResidencyStats
+	{
+		uint32_t mapped			= 0;
+		uint32_t unmapped		= 0;
+		uint32_t residentPages	= 0;
+		uint32_t levelLimit		= 0;	// Highest level that fit in maxPages, faces above it were clamped
+	};
+
+
+	// Sparse storage for the levels below the first. Level L >= 1 is split by parent patch, the patches
+	// of level L - 1: parent p owns half-edges [16p, 16p + 16), patch flags [4p, 4p + 4) and points
+	// [9p, 9p + 9) of level L. A page
+	// holds parentsPerPage consecutive parents, and a page table per level maps parent groups to pages.
+	// Only the parents of faces refined to a level are resident, so memory follows visible detail.
+	class HE_PagedLevels
+	{
+	public:
+		static constexpr uint32_t EdgesPerParent	= 16;
+		static constexpr uint32_t PatchesPerParent	= 4;
+		static constexpr uint32_t PointsPerParent	= 9;
+		static constexpr uint32_t MaxLevels			= HE_MaxLevels;
+		static constexpr uint32_t BytesPerParent	= EdgesPerParent * sizeof(HE_TwinEdge) + PatchesPerParent + PointsPerParent * sizeof(float3);
+
+		HE_PagedLevels(iAllocator& allocator, const HE_ControlCage& cage, const HE_PagedLevelOptions& options = {});
+
+		// faceLevels holds the levels wanted per control face, as returned by HE_FaceLOD. Levels are
+		// widened so every neighbour of a face at level n holds at least n - 1, enough to subdivide it.
+		HE_ResidencyStats	UpdateResidency(std::span<const uint8_t> faceLevels);
+
+		// Subdivides the resident parents of every paged level, level0 is the dense first level
+		void				Build(const HE_Level& level0, const uint32_t threadCount = 0);
+
+		// Closes the holes left by coarsening and trims the pool to the resident pages
+		void				Compact();
+
+		uint32_t			Translate(const uint32_t level, const uint32_t parent)	const noexcept;	// Page slot of a parent, HE_InvalidPage if not resident
+		bool				IsResident(const uint32_t level, const uint32_t parent)	const noexcept { return Translate(level, parent) != HE_InvalidPage; }
+		HE_TwinEdge			Edge(const uint32_t level, const uint32_t halfEdge)		const noexcept;
+		uint8_t				EdgeFlags(const uint32_t level, const uint32_t halfEdge)	const noexcept;	// HE_CornerFlag | HE_TFlag
+		float3				Point(const uint32_t level, const uint32_t vertex)		const noexcept;
+
+		uint32_t			LevelCount()						const noexcept { return levelCount; }
+		uint32_t			ParentCount(const uint32_t level)	const noexcept { return parentCount[level - 1]; }
+		uint8_t				RequiredLevel(const uint32_t face)	const noexcept { return required[face]; }
+		HE_PageStats		PageStats()							const noexcept { return pages.GetStats(); }
+
+		uint64_t			PageBytes()		const noexcept { return uint64_t(parentsPerPage) * BytesPerParent; }
+		uint64_t			ResidentBytes()	const noexcept { return PageBytes() * pages.ResidentCount(); }
+		uint64_t			PoolBytes()		const noexcept { return PageBytes() * pages.PageCount(); }
+		uint64_t			DenseBytes()	const noexcept;	// Same levels stored for the whole mesh
+
+	private:
+		uint32_t			FaceOfParent(const uint32_t level, const uint32_t parent) const noexcept;
+
+		const HE_ControlCage*	cage;
+		uint32_t				levelCount;
+		uint32_t				parentsPerPage;
+		uint32_t				parentCount[MaxLevels];
+		uint32_t				tableOffset[MaxLevels + 1];
+
+		HE_PageAllocator		pages;
+		Vector<uint32_t>		pageTable;
+		Vector<uint8_t>			needed;
+		Vector<uint8_t>			required;
+		Vector<uint32_t>		neighbourOffsets;	// Faces sharing a vertex, CSR
+		Vector<uint32_t>		neighbours;
+		Vector<HE_PageMove>		moves;
+
+		Vector<HE_TwinEdge>		edges;
+		Vector<uint8_t>			flags;
+		Vector<float3>			points;
+	};
+
+
+	/************************************************************************************************/
+
+
+	struct HE_LevelPlanOptions
+	{
+		uint64_t	budgetBytes	= 64 * MEGABYTE;
+		uint32_t	regionSize	= 32;	// Consecutive faces planned together, matches the normal cone clusters
+		uint32_t	maxLevel	= 5;
+	};
+
+
+	struct HE_LevelPlanStats
+	{
+		uint64_t	plannedBytes	= 0;
+		uint64_t	wantedBytes		= 0;
+		uint32_t	regionCount		= 0;
+		uint32_t	clampedRegions	= 0;	// Regions left below their wanted level
+		uint32_t	deepestLevel	= 0;
+	};
+
+
+	// Bytes of subdivision level L of one control face, the half-edges, flags and points HE_SubdivideFace writes
+	uint64_t HE_FaceLevelBytes(const uint32_t edgeCount, const uint32_t level) noexcept;
+
+	// Picks the deepest level per region that fits budgetBytes. A face at level n holds levels [0, n),
+	// the same convention as HE_PagedLevels::UpdateResidency. Regions are raised one level at a time,
+	// furthest below their wanted level first, so detail spreads before it deepens. The neighbour
+	// widening done by UpdateResidency is not counted.
+	HE_LevelPlanStats PlanLevels(
+		const HE_ControlCage&		cage,
+		std::span<const uint8_t>	wantedLevels,
+		std::span<uint8_t>			outLevels,
+		const HE_LevelPlanOptions&	options = {});
+
+
+	/************************************************************************************************/
+
+
+	// HE_LevelView over a paged level, reads of parents that are not resident return a border edge
+	struct HE_PagedLevelView
+	{
+		const HE_PagedLevels&	levels;
+		uint32_t				level;
+
+		uint32_t	Next(uint32_t e)		const noexcept { return (e & ~0x3u) | ((e + 1) & 3); }
+		uint32_t	Prev(uint32_t e)		const noexcept { return (e & ~0x3u) | ((e - 1) & 3); }
+		uint32_t	Twin(uint32_t e)		const noexcept { return levels.Edge(level, e).Twin(); }
+		uint32_t	Vert(uint32_t e)		const noexcept { return levels.Edge(level, e).vert; }
+		uint32_t	Face(uint32_t e)		const noexcept { return e >> 2; }
+		bool		IsCorner(uint32_t e)	const noexcept { return (levels.EdgeFlags(level, e) & HE_CornerFlag) != 0; }
+		bool		IsT(uint32_t e)			const noexcept { return (levels.EdgeFlags(level, e) & HE_TFlag) != 0; }
+		float3		Point(uint32_t e)		const noexcept { return levels.Point(level, Vert(e)); }
+
+		uint32_t	FaceCount()				const noexcept { return 4 * levels.ParentCount(level); }
+		uint32_t	HalfEdgeCount()			const noexcept { return 16 * levels.ParentCount(level); }
+		uint32_t	PointCount()			const noexcept { return 9 * levels.ParentCount(level); }
+		HE_Face		GetFace(uint32_t p)		const noexcept { return { 4 * p, 9 * p, 4, (uint16_t)level }; }
+	};
+
+
+}	/************************************************************************************************/
+
+/**********************************************************************
+
+Copyright (c) 2024 Robert May
+
+Permission is hereby granted, free of charge, to any person obtaining a
+copy of this software and associated documentation files (the "Software"),
+to deal in the Software without restriction, including without limitation
+the rights to use, copy, modify, merge, publish, distribute, sublicense,
+and/or sell copies of the Software, and to permit persons to whom the
+Software is furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included
+in all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+**********************************************************************/
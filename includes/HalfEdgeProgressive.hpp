@@ -0,0 +1,158 @@
+#pragma once
+#include "HalfEdgeCPU.hpp"
+
+#include <istream>
+#include <memory>
+#include <ostream>
+#include <string>
+
+
+namespace FlexKit
+{	/************************************************************************************************/
+
+
+	// File layout:
+	//	HE_ProgressiveHeader
+	//	cage chunk, zlib: topology encoded by EncodeTopology, then the points
+	//	per level: HE_ProgressiveLevelHeader, blockCount HE_ProgressiveBlock, then the blocks
+	//
+	// A level is stored as the quantized difference between the baked points and the Catmull-Clark
+	// prediction from the decoded level below, so a level that only follows the subdivision rules
+	// costs little more than its zeros. Blocks are compressed independently to decode in parallel.
+
+	struct HE_ProgressiveHeader
+	{
+		char			magic[4]		= { 'H', 'E', 'P', 'R' };
+		uint32_t		version			= 2;	// 2: cage topology stored with EncodeTopology
+		uint32_t		levelCount		= 0;
+		HE_IndexMode	indexMode		= HE_IndexMode::PerFace;
+		float			step			= 0.0f;	// Quantization step of the residuals
+		uint32_t		halfEdgeCount	= 0;
+		uint32_t		faceCount		= 0;
+		uint32_t		pointCount		= 0;
+		uint32_t		vertexCount		= 0;
+		uint32_t		cageRawBytes	= 0;
+		uint32_t		cageBytes		= 0;	// Compressed
+	};
+
+
+	struct HE_ProgressiveLevelHeader
+	{
+		uint32_t level			= 0;
+		uint32_t pointCount		= 0;
+		uint32_t blockCount		= 0;
+		uint32_t blockPoints	= 0;
+	};
+
+
+	struct HE_ProgressiveBlock
+	{
+		uint32_t compressedBytes	= 0;
+		uint32_t rawBytes			= 0;
+	};
+
+
+	/************************************************************************************************/
+
+
+	struct HE_ProgressiveOptions
+	{
+		float		step				= 0.0f;		// 0 picks 2^-precisionBits of the cage bounds diagonal
+		uint32_t	precisionBits		= 16;
+		uint32_t	blockPoints			= 1u << 16;
+		int			compressionLevel	= 6;
+		uint32_t	threadCount			= 0;
+	};
+
+
+	struct HE_ProgressiveEncodeStats
+	{
+		std::string	error;
+		uint64_t	rawBytes		= 0;	// Cage plus float3 points of every level
+		uint64_t	fileBytes		= 0;
+		uint32_t	levelCount		= 0;
+		float		step			= 0.0f;
+		float		maxError		= 0.0f;	// Largest component difference between baked and decoded points
+		double		duration		= 0.0;	// ms
+
+		bool	Succeeded()			const noexcept { return error.empty(); }
+		double	CompressionRatio()	const noexcept { return fileBytes ? double(rawBytes) / double(fileBytes) : 0.0; }
+	};
+
+
+	// Writes the cage and levels of baked. Levels must have been built from baked.cage, any point
+	// positions are allowed: displaced or sculpted detail is what the residuals carry.
+	HE_ProgressiveEncodeStats WriteProgressive(std::ostream& stream, const HalfEdgeCPUMesh& baked, iAllocator& allocator, const HE_ProgressiveOptions& options = {});
+
+
+	/************************************************************************************************/
+
+
+	struct HE_ProgressiveDecodeStats
+	{
+		uint64_t	bytesRead		= 0;
+		uint64_t	pointsDecoded	= 0;
+		double		duration		= 0.0;	// ms, decompression, prediction and residuals
+
+		double PointsPerSecond()	const noexcept { return duration > 0.0 ? double(pointsDecoded) / (duration / 1000.0) : 0.0; }
+		double MegabytesPerSecond()	const noexcept { return duration > 0.0 ? double(bytesRead) / double(MEGABYTE) / (duration / 1000.0) : 0.0; }
+	};
+
+
+	// Reads the cage on construction, so it can be drawn before any level arrives. Each
+	// DecodeNextLevel reads one more level from the stream, which only has to hold that far.
+	class HE_ProgressiveReader
+	{
+	public:
+		HE_ProgressiveReader(std::istream& stream, iAllocator& allocator);
+
+		bool						IsValid()			const noexcept { return error.empty(); }
+		const std::string&			Error()				const noexcept { return error; }
+		const HE_ProgressiveHeader&	Header()			const noexcept { return header; }
+
+		const HE_ControlCage&		Cage()				const noexcept { return mesh->cage; }
+		const HalfEdgeCPUMesh&		Mesh()				const noexcept { return *mesh; }
+		uint32_t					LevelCount()		const noexcept { return header.levelCount; }
+		uint32_t					LevelsDecoded()		const noexcept { return mesh ? mesh->LevelCount() : 0; }
+		const HE_Level&				GetLevel(const uint32_t level) const { return mesh->GetLevel(level); }
+
+		// nullptr once every level is decoded or the stream fails
+		const HE_Level*				DecodeNextLevel(const uint32_t threadCount = 0);
+
+		HE_ProgressiveDecodeStats	Stats()				const noexcept { return stats; }
+
+	private:
+		std::istream&						stream;
+		iAllocator*							allocator;
+		HE_ProgressiveHeader				header;
+		std::unique_ptr<HalfEdgeCPUMesh>	mesh;
+		HE_ProgressiveDecodeStats			stats;
+		std::string							error;
+	};
+
+
+}	/************************************************************************************************/
+
+/**********************************************************************
+
+Copyright (c) 2024 Robert May
+
+Permission is hereby granted, free of charge, to any person obtaining a
+copy of this software and associated documentation files (the "Software"),
+to deal in the Software without restriction, including without limitation
+the rights to use, copy, modify, merge, publish, distribute, sublicense,
+and/or sell copies of the Software, and to permit persons to whom the
+Software is furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included
+in all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+**********************************************************************/
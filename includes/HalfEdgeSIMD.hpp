@@ -0,0 +1,98 @@
+#pragma once
+#include <cstdint>
+
+
+namespace FlexKit
+{	/************************************************************************************************/
+
+
+	// The AVX2 and AVX-512 kernels live in HalfEdgeAVX2.cpp and HalfEdgeAVX512.cpp, the only sources
+	// built with arch flags (see CMakeLists.txt). Everything else stays at the baseline ISA, and the
+	// kernels run only once HE_SIMDSupport has checked the CPU. They take raw arrays and include no
+	// FlexKit headers, so no shared inline function is ever emitted with the wider instructions.
+
+	enum class HE_SIMDLevel : uint32_t
+	{
+		Scalar,
+		AVX2,	// 8 lanes
+		AVX512,	// 16 lanes
+	};
+
+
+	// Widest level that was built and that the CPU and OS support, detected on first use
+	HE_SIMDLevel HE_SIMDSupport() noexcept;
+
+	// Whether the kernel sources were compiled with their arch flags, false on other targets
+	bool HE_AVX2Built() noexcept;
+	bool HE_AVX512Built() noexcept;
+
+
+	constexpr uint32_t HE_SIMDMaxValence = 16;	// HE_MaxValence, the kernels' per-lane term count
+
+
+	// Raw view of an HE_SoAMesh
+	struct HE_SoAArrays
+	{
+		const uint32_t*	twin;
+		const uint32_t*	next;
+		const uint32_t*	vert;
+		const uint32_t*	face;
+		const uint32_t*	faceBegin;
+		const uint32_t*	edgeCount;
+		const float*	x;
+		const float*	y;
+		const float*	z;
+	};
+
+
+	struct HE_SoAPointArrays
+	{
+		const float* x;
+		const float* y;
+		const float* z;
+	};
+
+
+	struct HE_SoAOutput
+	{
+		float* x;
+		float* y;
+		float* z;
+	};
+
+
+	// Each advances itr past the last full group of lanes before end, the scalar loop takes the rest
+	void HE_FacePointsAVX2(const HE_SoAArrays& mesh, const HE_SoAOutput& out, uint32_t& itr, const uint32_t end) noexcept;
+	void HE_EdgePointsAVX2(const HE_SoAArrays& mesh, const HE_SoAPointArrays& facePoints, const HE_SoAOutput& out, uint32_t& itr, const uint32_t end) noexcept;
+	void HE_FacePointsAVX512(const HE_SoAArrays& mesh, const HE_SoAOutput& out, uint32_t& itr, const uint32_t end) noexcept;
+	void HE_EdgePointsAVX512(const HE_SoAArrays& mesh, const HE_SoAPointArrays& facePoints, const HE_SoAOutput& out, uint32_t& itr, const uint32_t end) noexcept;
+
+	// out[i] = in[2i] + in[2i + 1], same contract as above
+	void HE_PairwiseSumAVX2(const uint32_t* in, uint32_t* out, uint32_t& itr, const uint32_t end) noexcept;
+
+
+}	/************************************************************************************************/
+
+/**********************************************************************
+
+Copyright (c) 2024 Robert May
+
+Permission is hereby granted, free of charge, to any person obtaining a
+copy of this software and associated documentation files (the "Software"),
+to deal in the Software without restriction, including without limitation
+the rights to use, copy, modify, merge, publish, distribute, sublicense,
+and/or sell copies of the Software, and to permit persons to whom the
+Software is furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included
+in all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+**********************************************************************/
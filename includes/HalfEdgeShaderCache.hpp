@@ -0,0 +1,150 @@
+#pragma once
+#include "HalfEdgeCPU.hpp"
+
+#include <cstddef>
+#include <filesystem>
+#include <span>
+#include <string>
+#include <vector>
+
+
+namespace FlexKit
+{	/************************************************************************************************/
+
+
+	struct HE_ShaderJob
+	{
+		std::string							path;
+		std::string							entryPoint;		// Empty for libraries
+		std::string							target;
+		std::vector<std::string>			arguments;
+		std::vector<std::filesystem::path>	includeDirs;
+
+		// Same options LibraryBuilder::LoadShaderLibrary passes to the engine compiler
+		static HE_ShaderJob Library(std::string path)
+		{
+			return { std::move(path), {}, "lib_6_8", { "-enable-16bit-types", "-HV", "2021" } };
+		}
+
+		// One entry point, with the options PipelineBuilder passes for { .enable16BitTypes, .hlsl2021 = true }
+		static HE_ShaderJob EntryPoint(std::string path, std::string entryPoint, std::string target, const bool enable16BitTypes = false)
+		{
+			HE_ShaderJob job{ std::move(path), std::move(entryPoint), std::move(target), { "-HV", "2021" } };
+
+			if (enable16BitTypes)
+				job.arguments.push_back("-enable-16bit-types");
+
+			return job;
+		}
+	};
+
+
+	// Cache key from the compile options and the contents of the source and every file it includes,
+	// directly or not. Quoted includes resolve against the including file first, then the job's
+	// includeDirs. Missing includes are hashed by name, so the key changes once they show up.
+	uint64_t HE_ShaderCacheKey(
+		const HE_ShaderJob&						job,
+		std::string_view						compilerVersion	= {},
+		std::vector<std::filesystem::path>*		outDependencies	= nullptr);
+
+
+	class HE_ShaderCache
+	{
+	public:
+		HE_ShaderCache(std::filesystem::path directory);
+
+		bool Load(const uint64_t key, std::vector<std::byte>& out) const;
+		bool Store(const uint64_t key, std::span<const std::byte> dxil) const;	// Written to a temporary and renamed, safe across threads and processes
+
+		std::filesystem::path directory;
+	};
+
+
+	/************************************************************************************************/
+
+
+	class HE_ShaderCompiler
+	{
+	public:
+		virtual ~HE_ShaderCompiler() = default;
+
+		virtual bool				Compile(const HE_ShaderJob& job, std::vector<std::byte>& outDXIL, std::string& outErrors) = 0;
+		virtual std::string_view	Version() const = 0;
+	};
+
+
+	// Runs the dxc executable, available on both Windows and Linux
+	class HE_DXCCompiler final : public HE_ShaderCompiler
+	{
+	public:
+		HE_DXCCompiler(std::string executable = "dxc", std::string version = "dxc");
+
+		bool				Compile(const HE_ShaderJob& job, std::vector<std::byte>& outDXIL, std::string& outErrors) override;
+		std::string_view	Version() const override { return version; }
+
+		std::string executable;
+		std::string version;
+	};
+
+
+	/************************************************************************************************/
+
+
+	struct HE_CompiledShader
+	{
+		std::vector<std::byte>	dxil;
+		std::string				errors;
+		uint64_t				key			= 0;
+		bool					cacheHit	= false;
+		double					duration	= 0.0; // ms
+
+		bool Succeeded() const noexcept { return !dxil.empty(); }
+	};
+
+
+	struct HE_ShaderBuildStats
+	{
+		uint32_t	jobs			= 0;
+		uint32_t	cacheHits		= 0;
+		uint32_t	failures		= 0;
+		double		compileTime		= 0.0;	// Sum over jobs, ms
+		double		wallTime		= 0.0;	// ms
+
+		float		HitRate() const noexcept { return jobs ? float(cacheHits) / float(jobs) : 0.0f; }
+	};
+
+
+	// Compiles the jobs in parallel, one job per worker, reading and filling the cache
+	std::vector<HE_CompiledShader> CompileShaders(
+		std::span<const HE_ShaderJob>	jobs,
+		HE_ShaderCache&					cache,
+		HE_ShaderCompiler&				compiler,
+		HE_ShaderBuildStats*			outStats	= nullptr,
+		const uint32_t					threadCount	= 0);
+
+
+}	/************************************************************************************************/
+
+/**********************************************************************
+
+Copyright (c) 2024 Robert May
+
+Permission is hereby granted, free of charge, to any person obtaining a
+copy of this software and associated documentation files (the "Software"),
+to deal in the Software without restriction, including without limitation
+the rights to use, copy, modify, merge, publish, distribute, sublicense,
+and/or sell copies of the Software, and to permit persons to whom the
+Software is furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included
+in all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+**********************************************************************/
@@ -0,0 +1,132 @@
+#pragma once
+#include "HalfEdgeCPU.hpp"
+
+
+namespace FlexKit
+{	/************************************************************************************************/
+
+
+	enum class HE_SoAKernel : uint32_t
+	{
+		Scalar,
+		AVX2,	// 8 lanes
+		AVX512,	// 16 lanes
+	};
+
+
+	// Widest kernel this CPU runs, see HE_SIMDSupport. Requests for wider ones fall back to it.
+	HE_SoAKernel	HE_BestSoAKernel() noexcept;
+	const char*		HE_SoAKernelString(const HE_SoAKernel kernel) noexcept;
+
+
+	// Structure of arrays mirror of a control cage or a level, so the point rules load eight or sixteen
+	// consecutive half-edges per instruction instead of gathering across HEEdge strides. Faces own
+	// consecutive half-edge ranges, as in both sources. Indices are gathered as signed 32 bit lanes,
+	// mirrors are limited to 2^31 half-edges and points.
+	struct HE_SoAMesh
+	{
+		HE_SoAMesh(iAllocator& allocator) :
+			twin		{ allocator },
+			next		{ allocator },
+			vert		{ allocator },
+			face		{ allocator },
+			faceBegin	{ allocator },
+			edgeCount	{ allocator },
+			x			{ allocator },
+			y			{ allocator },
+			z			{ allocator } {}
+
+		uint32_t	HalfEdgeCount()	const noexcept { return (uint32_t)vert.size(); }
+		uint32_t	FaceCount()		const noexcept { return (uint32_t)faceBegin.size(); }
+
+		// Per half-edge
+		Vector<uint32_t>	twin;
+		Vector<uint32_t>	next;
+		Vector<uint32_t>	vert;
+		Vector<uint32_t>	face;
+
+		// Per face
+		Vector<uint32_t>	faceBegin;
+		Vector<uint32_t>	edgeCount;
+
+		// Per point
+		Vector<float>		x;
+		Vector<float>		y;
+		Vector<float>		z;
+	};
+
+
+	struct HE_SoAPoints
+	{
+		HE_SoAPoints(iAllocator& allocator) :
+			x{ allocator },
+			y{ allocator },
+			z{ allocator } {}
+
+		void	Resize(const uint32_t count)	{ x.resize(count); y.resize(count); z.resize(count); }
+		float3	operator [](const uint32_t idx) const noexcept { return float3{ x[idx], y[idx], z[idx] }; }
+
+		Vector<float> x;
+		Vector<float> y;
+		Vector<float> z;
+	};
+
+
+	void HE_BuildSoAMesh(const HE_ControlCage& cage, HE_SoAMesh& out);
+	void HE_BuildSoAMesh(const HE_Level& level, HE_SoAMesh& out);
+
+
+	// Face points by face and edge points by half-edge, with the arithmetic of HE_FacePoint and
+	// HE_EdgePoint evaluated lane by lane in the same order. Edge points read the face points.
+	void HE_SoAFacePoints(const HE_SoAMesh& mesh, HE_SoAPoints& out, const HE_SoAKernel kernel = HE_BestSoAKernel(), const uint32_t threadCount = 1);
+	void HE_SoAEdgePoints(const HE_SoAMesh& mesh, const HE_SoAPoints& facePoints, HE_SoAPoints& out, const HE_SoAKernel kernel = HE_BestSoAKernel(), const uint32_t threadCount = 1);
+
+
+	/************************************************************************************************/
+
+
+	struct HE_SoABenchmark
+	{
+		HE_SoAKernel	kernel			= HE_SoAKernel::Scalar;	// Kernel the SIMD timings used
+		uint32_t		levelCount		= 0;
+		uint64_t		halfEdgeCount	= 0;	// Summed over the cage and the levels measured
+		double			aosDuration		= 0.0;	// ms, HE_FacePoint and HE_EdgePoint over the cage or level view
+		double			scalarDuration	= 0.0;	// ms, SoA mirror without SIMD
+		double			simdDuration	= 0.0;	// ms
+		double			mirrorDuration	= 0.0;	// ms, building the SoA mirrors, not part of the above
+		float			maxError		= 0.0f;	// Largest component difference of the SIMD points to the AoS ones
+
+		double Speedup() const noexcept { return simdDuration > 0.0 ? aosDuration / simdDuration : 0.0; }
+	};
+
+
+	// Face and edge points of the cage and the levels built from it, levelCount inputs in all, on one
+	// thread through the AoS scalar rules, the SoA scalar loop and the widest SIMD kernel built
+	HE_SoABenchmark BenchmarkSoAKernels(const HE_ControlCage& cage, iAllocator& allocator, const uint32_t levelCount = 3);
+
+
+}	/************************************************************************************************/
+
+/**********************************************************************
+
+Copyright (c) 2024 Robert May
+
+Permission is hereby granted, free of charge, to any person obtaining a
+copy of this software and associated documentation files (the "Software"),
+to deal in the Software without restriction, including without limitation
+the rights to use, copy, modify, merge, publish, distribute, sublicense,
+and/or sell copies of the Software, and to permit persons to whom the
+Software is furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included
+in all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+**********************************************************************/
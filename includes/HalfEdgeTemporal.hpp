@@ -0,0 +1,157 @@
+#pragma once
+#include "HalfEdgeMultiView.hpp"
+
+#include <span>
+
+
+namespace FlexKit
+{	/************************************************************************************************/
+
+
+	enum class HE_RefineAction : uint32_t
+	{
+		Skip,			// View and cage unchanged since the last rebuild
+		Incremental,	// Refine only the faces that entered visibility
+		Full,			// Refine every visible face
+	};
+
+
+	struct HE_TemporalOptions
+	{
+		float skipThreshold			= 1.0e-4f;	// Max view delta that still reuses the last rebuild
+		float incrementalThreshold	= 0.5f;		// Max view delta refined incrementally
+		float maxIncrementalRatio	= 0.5f;		// Past this fraction of entered faces a full rebuild is cheaper
+	};
+
+
+	// Largest component change of the camera position and frustum plane normals. The normals are
+	// unit length, so rotation and fov contribute roughly in radians and translation in world units.
+	float HE_ViewDelta(const HE_ViewState& lhs, const HE_ViewState& rhs) noexcept;
+
+
+	class HE_ChangeDetector
+	{
+	public:
+		HE_RefineAction Update(std::span<const HE_ViewState> views, const uint64_t cageVersion) noexcept;
+		HE_RefineAction Update(const HE_ViewState& view, const uint64_t cageVersion) noexcept { return Update({ &view, 1 }, cageVersion); }
+
+		void			Invalidate() noexcept { valid = false; }
+
+		HE_TemporalOptions	options;
+
+	private:
+		HE_ViewState		lastBuild[HE_MaxViews];
+		uint32_t			lastViewCount	= 0;
+		uint64_t			lastCageVersion	= 0;
+		bool				valid			= false;
+	};
+
+
+	/************************************************************************************************/
+
+
+	class HE_VisibilityTracker
+	{
+	public:
+		HE_VisibilityTracker(iAllocator& allocator) :
+			visible			{ allocator },
+			nextVisible		{ allocator },
+			current			{ allocator },
+			entered			{ allocator },
+			left			{ allocator },
+			refineList		{ allocator },
+			levels			{ allocator },
+			currentLevels	{ allocator } {}
+
+		// Classifies the frame, then fills entered/left and the list of faces to refine. Visibility is
+		// the union over all views, a face already visible is refined again only if its level changed.
+		HE_RefineAction Update(
+			const HE_ControlCage&			cage,
+			const HE_NormalCones&			cones,
+			std::span<const HE_ViewState>	views,
+			const uint64_t					cageVersion,
+			const HE_LODOptions&			lodOptions = {});
+
+		HE_RefineAction Update(
+			const HE_ControlCage&	cage,
+			const HE_NormalCones&	cones,
+			const HE_ViewState&		view,
+			const uint64_t			cageVersion,
+			const HE_LODOptions&	lodOptions = {})
+		{
+			return Update(cage, cones, { &view, 1 }, cageVersion, lodOptions);
+		}
+
+		void Invalidate() noexcept { detector.Invalidate(); }
+
+		HE_ChangeDetector	detector;
+		HE_MultiViewStats	lastRefine;
+
+		Vector<uint64_t>	visible;		// One bit per control face, as of the last rebuild
+		Vector<uint64_t>	nextVisible;
+		Vector<uint32_t>	current;
+		Vector<uint32_t>	entered;
+		Vector<uint32_t>	left;
+		Vector<uint32_t>	refineList;
+		Vector<uint8_t>		levels;			// Per control face, as of the last rebuild
+		Vector<uint8_t>		currentLevels;	// Per entry in current
+	};
+
+
+	/************************************************************************************************/
+
+
+	struct HE_ReplayFrame
+	{
+		HE_ViewState	view;
+		uint64_t		cageVersion = 0;
+	};
+
+
+	struct HE_ReplayStats
+	{
+		uint32_t	frames				= 0;
+		uint32_t	skipped				= 0;
+		uint32_t	incremental			= 0;
+		uint32_t	full				= 0;
+		uint64_t	facesRefined		= 0;	// With temporal reuse
+		uint64_t	facesRefinedAlways	= 0;	// Rebuilding every visible face every frame
+		uint32_t	mismatches			= 0;	// Frames whose tracked set differs from a from-scratch cull
+	};
+
+
+	// Runs a recorded camera path through a tracker and checks after every non skipped frame that
+	// the tracked visible set equals a from-scratch cull, so a captured path can be replayed as a test.
+	HE_ReplayStats ReplayVisibility(
+		const HE_ControlCage&				cage,
+		const HE_NormalCones&				cones,
+		std::span<const HE_ReplayFrame>		frames,
+		iAllocator&							allocator,
+		const HE_TemporalOptions&			options = {});
+
+
+}	/************************************************************************************************/
+
+/**********************************************************************
+
+Copyright (c) 2024 Robert May
+
+Permission is hereby granted, free of charge, to any person obtaining a
+copy of this software and associated documentation files (the "Software"),
+to deal in the Software without restriction, including without limitation
+the rights to use, copy, modify, merge, publish, distribute, sublicense,
+and/or sell copies of the Software, and to permit persons to whom the
+Software is furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included
+in all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+**********************************************************************/
@@ -0,0 +1,120 @@
+#pragma once
+#include "HalfEdgeCPU.hpp"
+
+#include <span>
+#include <string>
+#include <vector>
+
+
+namespace FlexKit
+{	/************************************************************************************************/
+
+
+	// Layout:
+	//	HE_TopologyHeader
+	//	blockCount HE_TopologyBlock
+	//	blocks: per face the edge count, then its vertex indices as zig-zag varint deltas. The first
+	//	vertex is relative to the first vertex of the previous face, the others to the vertex before.
+	//	exceptions: half-edge delta, twin and flags, for half-edges the rebuild gets wrong
+	//
+	// Only the face vertex lists are stored, next, prev, twin, flags, face ranges and faceLookup are
+	// rebuilt. Faces must own consecutive half-edge ranges in face order, as BuildControlCage emits.
+
+	struct HE_TopologyHeader
+	{
+		char		magic[4]		= { 'H', 'E', 'T', 'C' };
+		uint32_t	version			= 2;	// 2: flags stored apart from the twin
+		uint32_t	faceCount		= 0;
+		uint32_t	halfEdgeCount	= 0;
+		uint32_t	vertexCount		= 0;	// Control points
+		uint32_t	blockCount		= 0;
+		uint32_t	exceptionCount	= 0;
+		uint32_t	exceptionBytes	= 0;
+	};
+
+
+	struct HE_TopologyBlock
+	{
+		uint32_t firstFace		= 0;
+		uint32_t firstHalfEdge	= 0;
+		uint32_t byteOffset		= 0;	// From the end of the block table
+		uint32_t byteCount		= 0;
+	};
+
+
+	struct HE_TopologyOptions
+	{
+		uint32_t blockFaces		= 1u << 14;	// Faces per independently decoded block
+		uint32_t threadCount	= 0;
+	};
+
+
+	struct HE_TopologyStats
+	{
+		std::string	error;
+		uint64_t	rawBytes		= 0;	// HEEdge, HE_Face and faceLookup arrays
+		uint64_t	encodedBytes	= 0;
+		uint32_t	exceptionCount	= 0;
+		double		duration		= 0.0;	// ms
+
+		bool	Succeeded()			const noexcept { return error.empty(); }
+		double	CompressionRatio()	const noexcept { return encodedBytes ? double(rawBytes) / double(encodedBytes) : 0.0; }
+		double	GigabytesPerSecond() const noexcept { return duration > 0.0 ? double(rawBytes) / (double(MEGABYTE) * 1024.0) / (duration / 1000.0) : 0.0; }
+	};
+
+
+	// Appends the encoded topology of cage to out, points are not included
+	HE_TopologyStats EncodeTopology(const HE_ControlCage& cage, std::vector<uint8_t>& out, iAllocator& allocator, const HE_TopologyOptions& options = {});
+
+	// Rebuilds halfEdges, faces, faceLookup and vertexCount of out, points are left to the caller.
+	// outBytesRead receives the size of the encoded topology when it is followed by other data.
+	HE_TopologyStats DecodeTopology(std::span<const uint8_t> data, HE_ControlCage& out, iAllocator& allocator, const uint32_t threadCount = 0, size_t* outBytesRead = nullptr);
+
+	// Twins by matching each half-edge a->b with b->a, lowest index first, and corner and T flags
+	// classified the same way ValidateControlCage checks them
+	void HE_RebuildTwins(Vector<HEEdge>& halfEdges, const uint32_t vertexCount, iAllocator& allocator, const uint32_t threadCount = 0);
+
+
+	/************************************************************************************************/
+
+
+	struct HE_TopologyBenchmark
+	{
+		HE_TopologyStats	encode;
+		HE_TopologyStats	decode;
+		double				rawCopyDuration	= 0.0;	// ms, copying the raw arrays of the same cage
+		bool				matches			= false;
+
+		double RawCopyGigabytesPerSecond() const noexcept { return rawCopyDuration > 0.0 ? double(encode.rawBytes) / (double(MEGABYTE) * 1024.0) / (rawCopyDuration / 1000.0) : 0.0; }
+	};
+
+
+	// Encodes and decodes cage, compares the result and times a copy of the raw layout for reference
+	HE_TopologyBenchmark BenchmarkTopology(const HE_ControlCage& cage, iAllocator& allocator, const uint32_t threadCount = 0);
+
+
+}	/************************************************************************************************/
+
+/**********************************************************************
+
+Copyright (c) 2024 Robert May
+
+Permission is hereby granted, free of charge, to any person obtaining a
+copy of this software and associated documentation files (the "Software"),
+to deal in the Software without restriction, including without limitation
+the rights to use, copy, modify, merge, publish, distribute, sublicense,
+and/or sell copies of the Software, and to permit persons to whom the
+Software is furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included
+in all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+**********************************************************************/
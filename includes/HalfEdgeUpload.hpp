@@ -0,0 +1,183 @@
+#pragma once
+#include "HalfEdgeCPU.hpp"
+
+#include <cstddef>
+#include <span>
+
+
+namespace FlexKit
+{	/************************************************************************************************/
+
+
+	struct HE_DirtyRange
+	{
+		uint32_t begin;
+		uint32_t end;		// Exclusive, in elements
+	};
+
+
+	class HE_DirtyRanges
+	{
+	public:
+		HE_DirtyRanges(iAllocator& allocator) :
+			ranges{ allocator } {}
+
+		void Mark(const uint32_t begin, const uint32_t count = 1);
+		void Clear() noexcept	{ ranges.clear(); }
+		bool Empty() const		{ return ranges.size() == 0; }
+
+		// Sorted and merged ranges. Gaps of up to maxGap elements are uploaded rather than split, and the
+		// smallest gaps are closed until at most maxRegions ranges remain.
+		void Coalesce(Vector<HE_DirtyRange>& out, const uint32_t maxGap, const uint32_t maxRegions) const;
+
+	private:
+		Vector<HE_DirtyRange> ranges;
+	};
+
+
+	/************************************************************************************************/
+
+
+	struct HE_CopyRegion
+	{
+		uint64_t stagingOffset;		// From the start of the ring
+		uint64_t destOffset;
+		uint64_t size;
+	};
+
+
+	// Staging memory split into segmentCount segments, one per frame in flight. A segment is
+	// reused segmentCount frames after it was written, once the copies reading it have retired.
+	class HE_StagingRing
+	{
+	public:
+		HE_StagingRing(iAllocator& allocator, const size_t segmentSize, const uint32_t segmentCount = 2);
+
+		void		BeginFrame() noexcept;
+		std::byte*	Allocate(const size_t size, uint64_t& outOffset) noexcept; // nullptr when the segment is full
+
+		const std::byte*	Data()				const noexcept { return memory.data(); }
+		std::byte*			SegmentData()		noexcept { return memory.data() + size_t(segment) * segmentSize; }
+		size_t				SegmentSize()		const noexcept { return segmentSize; }
+		uint32_t			CurrentSegment()	const noexcept { return segment; }
+		size_t				Used()				const noexcept { return used; }
+		size_t				Available()			const noexcept;	// Largest allocation that still fits this frame
+
+	private:
+		Vector<std::byte>	memory;
+		size_t				segmentSize;
+		uint32_t			segmentCount;
+		uint32_t			segment	= 0;
+		size_t				used	= 0;
+	};
+
+
+	class HE_CopyQueue
+	{
+	public:
+		virtual ~HE_CopyQueue() = default;
+
+		// Where a flush writes its size staged bytes, the start of the ring's current segment. Queues
+		// with upload memory of their own return it instead and the bytes are written there once.
+		// nullptr when size doesn't fit, the flush then defers its regions to the next frame.
+		virtual std::byte*	Stage(HE_StagingRing& ring, const size_t size) { return size <= ring.SegmentSize() ? ring.SegmentData() : nullptr; }
+		virtual void		Copy(const HE_StagingRing& ring, std::span<const HE_CopyRegion> regions) = 0;
+	};
+
+
+	// Applies the copies to a CPU buffer, so the upload path can be checked without a device
+	class HE_MockCopyQueue final : public HE_CopyQueue
+	{
+	public:
+		HE_MockCopyQueue(iAllocator& allocator, const size_t destinationSize);
+
+		void Copy(const HE_StagingRing& ring, std::span<const HE_CopyRegion> regions) override;
+
+		Vector<std::byte>		destination;
+		Vector<HE_CopyRegion>	history;
+		uint32_t				submissions = 0;
+	};
+
+
+	/************************************************************************************************/
+
+
+	struct HE_UploadOptions
+	{
+		uint32_t	maxGap			= 16;		// Elements
+		uint32_t	maxRegions		= 256;
+		float		fullUploadRatio	= 0.75f;	// Past this dirty fraction the whole dirty span is sent as one region
+	};
+
+
+	struct HE_UploadStats
+	{
+		uint32_t	frames			= 0;
+		uint32_t	regions			= 0;
+		uint32_t	fullUploads		= 0;
+		uint32_t	overflows		= 0;	// Frames that ran out of staging and deferred part of the upload
+		uint64_t	dirtyBytes		= 0;
+		uint64_t	uploadedBytes	= 0;	// Dirty bytes plus the gaps merged into regions
+		uint64_t	fullBytes		= 0;	// What re-uploading the whole buffer every frame would cost
+
+		double		BytesPerFrame() const noexcept { return frames ? double(uploadedBytes) / double(frames) : 0.0; }
+	};
+
+
+	// Tracks dirty elements of a GPU buffer and sends them through a staging ring as a few coalesced copies
+	class HE_BufferUploader
+	{
+	public:
+		HE_BufferUploader(
+			iAllocator&				allocator,
+			const uint32_t			elementCount,
+			const uint32_t			elementSize,
+			const size_t			stagingSize,	// Per segment
+			const HE_UploadOptions&	options = {});
+
+		void MarkDirty(const uint32_t begin, const uint32_t count = 1)	{ dirty.Mark(begin, count); }
+		void MarkAllDirty()												{ dirty.Mark(0, elementCount); }
+		bool IsDirty() const											{ return !dirty.Empty(); }
+
+		// Stages and copies the dirty ranges of source, elementCount * elementSize bytes. Returns the
+		// stats for this frame, totals accumulates over every flush.
+		HE_UploadStats Flush(const void* source, HE_CopyQueue& queue);
+
+		HE_UploadOptions	options;
+		HE_UploadStats		totals;
+
+	private:
+		uint32_t				elementCount;
+		uint32_t				elementSize;
+		HE_DirtyRanges			dirty;
+		HE_StagingRing			ring;
+		Vector<HE_DirtyRange>	coalesced;
+		Vector<HE_CopyRegion>	regions;
+	};
+
+
+}	/************************************************************************************************/
+
+/**********************************************************************
+
+Copyright (c) 2024 Robert May
+
+Permission is hereby granted, free of charge, to any person obtaining a
+copy of this software and associated documentation files (the "Software"),
+to deal in the Software without restriction, including without limitation
+the rights to use, copy, modify, merge, publish, distribute, sublicense,
+and/or sell copies of the Software, and to permit persons to whom the
+Software is furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included
+in all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+**********************************************************************/
@@ -0,0 +1,94 @@
+#pragma once
+#include "HalfEdgeCPU.hpp"
+
+
+namespace FlexKit
+{	/************************************************************************************************/
+
+
+	enum class HE_ValidationErrorCode : uint32_t
+	{
+		VertexOutOfRange,		// element: half-edge
+		NextOutOfRange,			// element: half-edge
+		TwinOutOfRange,			// element: half-edge
+		TwinSelf,				// element: half-edge
+		TwinAsymmetric,			// element: half-edge, other: twin
+		InconsistentWinding,	// element: half-edge, other: twin
+		NextPrevMismatch,		// element: half-edge
+		FaceOutOfRange,			// element: face
+		FaceEdgeCount,			// element: face, other: edge count
+		FaceOpenLoop,			// element: face, other: half-edge that leaves the face
+		FaceLookupMismatch,		// element: half-edge, other: face
+		VertexRangeMismatch,	// element: face, other: expected vertexRange
+		ValenceExceeded,		// element: vertex, other: valence
+		NonManifoldVertex,		// element: vertex, other: outgoing half-edges not reachable from the fan
+		CornerFlagMismatch,		// element: half-edge
+		TFlagMismatch,			// element: half-edge
+		LevelIndexOverflow,		// element: first level past the 32-bit twin range, other: requested level count
+	};
+
+
+	struct HE_ValidationError
+	{
+		HE_ValidationErrorCode	code;
+		uint32_t				element;
+		uint32_t				other = 0;
+	};
+
+
+	struct HE_ValidationReport
+	{
+		HE_ValidationReport(iAllocator& allocator) :
+			errors{ allocator } {}
+
+		bool IsValid() const noexcept { return errors.size() == 0 && !truncated; }
+
+		Vector<HE_ValidationError>	errors;
+		bool						truncated		= false;
+		uint32_t					halfEdgeCount	= 0;
+		uint32_t					faceCount		= 0;
+		uint32_t					vertexCount		= 0;
+		double						duration		= 0.0; // ms
+	};
+
+
+	struct HE_ValidationOptions
+	{
+		uint32_t	threadCount		= 0;
+		uint32_t	maxValence		= HE_MaxValence;
+		uint32_t	maxErrors		= 1024;
+		uint32_t	levelCount		= 0;	// Subdivision levels the cage will be refined to, checked against the twin index range
+	};
+
+
+	const char*			HE_ValidationErrorString(const HE_ValidationErrorCode code);
+
+	// Linear in the half-edge count; every check runs in parallel over half-edges, faces or vertices.
+	HE_ValidationReport	ValidateControlCage(const HE_ControlCage& cage, iAllocator& allocator, const HE_ValidationOptions& options = {});
+
+
+}	/************************************************************************************************/
+
+/**********************************************************************
+
+Copyright (c) 2024 Robert May
+
+Permission is hereby granted, free of charge, to any person obtaining a
+copy of this software and associated documentation files (the "Software"),
+to deal in the Software without restriction, including without limitation
+the rights to use, copy, modify, merge, publish, distribute, sublicense,
+and/or sell copies of the Software, and to permit persons to whom the
+Software is furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included
+in all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+**********************************************************************/
@@ -1,6 +1,7 @@
 #pragma once
 #include <Graphics.hpp>
 #include <Containers.hpp>
+#include <span>
 #include <string_view>
 
 namespace FlexKit
@@ -137,6 +138,25 @@ namespace FlexKit
 		}
 
 
+		// Precompiled DXIL, the caller keeps the bytes alive until BuildStateObject returns
+		LibraryBuilder& LoadShaderLibrary(std::span<const std::byte> dxil)
+		{
+			D3D12_DXIL_LIBRARY_DESC* dxil_desc = &allocator->allocate<D3D12_DXIL_LIBRARY_DESC>();
+			dxil_desc->DXILLibrary.pShaderBytecode	= dxil.data();
+			dxil_desc->DXILLibrary.BytecodeLength	= dxil.size();
+			dxil_desc->NumExports					= 0;
+			dxil_desc->pExports						= nullptr;
+
+			subObjects.push_back(
+				D3D12_STATE_SUBOBJECT{
+					.Type	= D3D12_STATE_SUBOBJECT_TYPE_DXIL_LIBRARY,
+					.pDesc	= dxil_desc,
+				});
+
+			return *this;
+		}
+
+
 		struct EntryPoints
 		{
 			std::string_view	entryPointName;
@@ -0,0 +1,179 @@
+#pragma once
+#include "HalfEdgeMultiView.hpp"
+
+#include <Components.hpp>
+#include <Handle.hpp>
+#include <MultiFieldComponent.hpp>
+#include <Type.hpp>
+
+#include <span>
+
+
+namespace FlexKit
+{	/************************************************************************************************/
+
+
+	struct HalfEdgeMesh;
+
+	using HalfEdgeMeshHandle = Handle_t<32, GetTypeGUID(HalfEdgeMesh)>;	// Resolved by whoever owns the meshes
+
+
+	// Fields of SubdivisionSurfaceComponent, each is stored as its own array so a sweep over one
+	// concern, bounds for culling or flags for gathering, only touches that array
+
+	struct HE_SurfaceLOD
+	{
+		float	targetPixels	= 16.0f;	// Projected size a single level should cover
+		uint8_t	minLevel		= 0;
+		uint8_t	maxLevel		= 3;
+		uint8_t	level			= 0;		// Selected by the last UpdateSubdivisionSurfaces
+		uint8_t	padding			= 0;
+	};
+
+
+	struct HE_SurfaceBounds
+	{
+		float3 min;	// World space
+		float3 max;
+	};
+
+
+	enum HE_SurfaceFlags : uint32_t
+	{
+		HE_SurfaceVisible		= 1 << 0,	// Inside at least one view
+		HE_SurfaceLevelChanged	= 1 << 1,	// Level differs from the previous update
+		HE_SurfacePointsDirty	= 1 << 2,	// Control points moved, set by the owner and cleared once gathered
+	};
+
+
+	struct HE_SurfaceState
+	{
+		uint32_t flags = 0;
+	};
+
+
+	struct HE_SurfaceMesh
+	{
+		HalfEdgeMeshHandle mesh = InvalidHandle;
+	};
+
+
+	/************************************************************************************************/
+
+
+	// The field arrays the sweep reads, index i of every span is the same instance. The mesh field is
+	// not needed, so instance sets without one (HE_InstanceSet) share the sweep.
+	struct HE_SurfaceFields
+	{
+		std::span<HE_SurfaceLOD>			lods;
+		std::span<const HE_SurfaceBounds>	bounds;
+		std::span<HE_SurfaceState>			states;
+
+		uint32_t Count() const noexcept { return (uint32_t)Min(lods.size(), Min(bounds.size(), states.size())); }
+	};
+
+
+	struct HE_SurfaceUpdateOptions
+	{
+		uint32_t threadCount	= 0;
+		uint32_t chunkSize		= 1024;	// Instances per parallel chunk
+	};
+
+
+	struct HE_SurfaceUpdateStats
+	{
+		uint32_t	instanceCount	= 0;
+		uint32_t	visible			= 0;
+		uint32_t	levelChanged	= 0;
+		uint32_t	dirty			= 0;	// Instances written to outDirty
+		double		duration		= 0.0;	// ms
+	};
+
+
+	// Culls every instance's bounds against the views, selects its level from the closest view the
+	// same way HE_FaceLOD does for faces and sets the visible and level changed flags. Visible
+	// instances whose level changed or whose points are dirty are appended to outDirty in index
+	// order, their points dirty flag is cleared.
+	HE_SurfaceUpdateStats UpdateSubdivisionSurfaces(
+		const HE_SurfaceFields&			fields,
+		std::span<const HE_ViewState>	views,
+		Vector<uint32_t>&				outDirty,
+		const HE_SurfaceUpdateOptions&	options = {});
+
+
+	/************************************************************************************************/
+
+
+	constexpr ComponentID SubdivisionSurfaceComponentID = GetTypeGUID(SubdivisionSurfaceComponent);
+
+	using SubdivisionSurfaceHandle		= Handle_t<32, SubdivisionSurfaceComponentID>;
+	using SubdivisionSurfaceComponent	= MultiFieldComponent_t<
+											SubdivisionSurfaceHandle,
+											SubdivisionSurfaceComponentID,
+											MultiFieldComponentEventHandler,
+											HE_SurfaceLOD,
+											HE_SurfaceBounds,
+											HE_SurfaceState,
+											HE_SurfaceMesh>;
+
+
+	// The component's field arrays as the sweep reads them, row i of each is the same surface
+	inline HE_SurfaceFields HE_GetSurfaceFields(SubdivisionSurfaceComponent& surfaces) noexcept
+	{
+		return {
+			surfaces.GetFieldArray<HE_SurfaceLOD>(),
+			surfaces.GetFieldArray<HE_SurfaceBounds>(),
+			surfaces.GetFieldArray<HE_SurfaceState>() };
+	}
+
+
+	// New surfaces start with their points dirty so the first sweep that sees them refines them
+	inline SubdivisionSurfaceHandle CreateSubdivisionSurface(SubdivisionSurfaceComponent& surfaces, const HalfEdgeMeshHandle mesh, const HE_SurfaceBounds& bounds, const HE_SurfaceLOD& lod = {})
+	{
+		return surfaces.Create(lod, bounds, HE_SurfaceState{ HE_SurfacePointsDirty }, HE_SurfaceMesh{ mesh });
+	}
+
+
+	// The per-frame sweep over every surface of the component, outDirty holds rows of its field arrays
+	inline HE_SurfaceUpdateStats UpdateSubdivisionSurfaces(
+		SubdivisionSurfaceComponent&	surfaces,
+		std::span<const HE_ViewState>	views,
+		Vector<uint32_t>&				outDirty,
+		const HE_SurfaceUpdateOptions&	options = {})
+	{
+		return UpdateSubdivisionSurfaces(HE_GetSurfaceFields(surfaces), views, outDirty, options);
+	}
+
+
+	/************************************************************************************************/
+
+
+	// World bounds of a control cage's points, for the bounds field
+	HE_SurfaceBounds HE_CageBounds(const HE_ControlCage& cage) noexcept;
+
+
+}	/************************************************************************************************/
+
+/**********************************************************************
+
+Copyright (c) 2024 Robert May
+
+Permission is hereby granted, free of charge, to any person obtaining a
+copy of this software and associated documentation files (the "Software"),
+to deal in the Software without restriction, including without limitation
+the rights to use, copy, modify, merge, publish, distribute, sublicense,
+and/or sell copies of the Software, and to permit persons to whom the
+Software is furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included
+in all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+**********************************************************************/
@@ -0,0 +1,162 @@
+#include "HalfEdgeSIMD.hpp"
+
+#if defined(__AVX2__)
+#include <immintrin.h>
+#endif
+
+
+// Built with /arch:AVX2 or -mavx2, see HalfEdgeSIMD.hpp. Only the kernels belong here.
+
+
+namespace FlexKit
+{	/************************************************************************************************/
+
+
+	bool HE_AVX2Built() noexcept
+	{
+#if defined(__AVX2__)
+		return true;
+#else
+		return false;
+#endif
+	}
+
+
+	/************************************************************************************************/
+
+
+#if defined(__AVX2__)
+	// Each lane runs the scalar tree, faces with fewer edges keep their partial sums through the blends
+	void HE_FacePointsAVX2(const HE_SoAArrays& mesh, const HE_SoAOutput& out, uint32_t& itr, const uint32_t end) noexcept
+	{
+		const int*		vert		= (const int*)mesh.vert;
+		const __m256i	maxValence	= _mm256_set1_epi32(HE_SIMDMaxValence);
+
+		for (; itr + 8 <= end; itr += 8)
+		{
+			const __m256i	first	= _mm256_loadu_si256((const __m256i*)(mesh.faceBegin + itr));
+			const __m256i	count	= _mm256_min_epu32(_mm256_loadu_si256((const __m256i*)(mesh.edgeCount + itr)), maxValence);
+
+			// Deepest lane, the loops below run to it
+			__m256i widest	= _mm256_max_epu32(count, _mm256_permute2x128_si256(count, count, 1));
+			widest			= _mm256_max_epu32(widest, _mm256_shuffle_epi32(widest, _MM_SHUFFLE(1, 0, 3, 2)));
+			widest			= _mm256_max_epu32(widest, _mm256_shuffle_epi32(widest, _MM_SHUFFLE(2, 3, 0, 1)));
+
+			const uint32_t n = (uint32_t)_mm256_cvtsi256_si32(widest);
+
+			__m256 terms[3][HE_SIMDMaxValence];
+
+			for (uint32_t i = 0; i < n; i++)
+			{
+				const __m256i lane		= _mm256_set1_epi32(i);
+				const __m256i valid		= _mm256_cmpgt_epi32(count, lane);
+				const __m256i vertex	= _mm256_mask_i32gather_epi32(_mm256_setzero_si256(), vert, _mm256_add_epi32(first, lane), valid, 4);
+
+				terms[0][i] = _mm256_mask_i32gather_ps(_mm256_setzero_ps(), mesh.x, vertex, _mm256_castsi256_ps(valid), 4);
+				terms[1][i] = _mm256_mask_i32gather_ps(_mm256_setzero_ps(), mesh.y, vertex, _mm256_castsi256_ps(valid), 4);
+				terms[2][i] = _mm256_mask_i32gather_ps(_mm256_setzero_ps(), mesh.z, vertex, _mm256_castsi256_ps(valid), 4);
+			}
+
+			for (uint32_t stride = 1; stride < n; stride *= 2)
+			{
+				for (uint32_t i = 0; i + stride < n; i += 2 * stride)
+				{
+					const __m256 summed = _mm256_castsi256_ps(_mm256_cmpgt_epi32(count, _mm256_set1_epi32(i + stride)));
+
+					for (auto& component : terms)
+						component[i] = _mm256_blendv_ps(component[i], _mm256_add_ps(component[i], component[i + stride]), summed);
+				}
+			}
+
+			const __m256 divisor = _mm256_cvtepi32_ps(count);
+			_mm256_storeu_ps(out.x + itr, _mm256_div_ps(terms[0][0], divisor));
+			_mm256_storeu_ps(out.y + itr, _mm256_div_ps(terms[1][0], divisor));
+			_mm256_storeu_ps(out.z + itr, _mm256_div_ps(terms[2][0], divisor));
+		}
+	}
+
+
+	/************************************************************************************************/
+
+
+	void HE_EdgePointsAVX2(const HE_SoAArrays& mesh, const HE_SoAPointArrays& facePoints, const HE_SoAOutput& out, uint32_t& itr, const uint32_t end) noexcept
+	{
+		// Powers of two, the products round exactly as the scalar rules' divisions
+		const __m256 half		= _mm256_set1_ps(0.5f);
+		const __m256 quarter	= _mm256_set1_ps(0.25f);
+
+		for (; itr + 8 <= end; itr += 8)
+		{
+			const __m256i v0		= _mm256_loadu_si256((const __m256i*)(mesh.vert + itr));
+			const __m256i v1		= _mm256_i32gather_epi32((const int*)mesh.vert, _mm256_loadu_si256((const __m256i*)(mesh.next + itr)), 4);
+			const __m256i twin		= _mm256_loadu_si256((const __m256i*)(mesh.twin + itr));
+			const __m256i border	= _mm256_cmpeq_epi32(twin, _mm256_set1_epi32(-1));
+			const __m256i inner		= _mm256_xor_si256(border, _mm256_set1_epi32(-1));
+			const __m256i f0		= _mm256_loadu_si256((const __m256i*)(mesh.face + itr));
+			const __m256i f1		= _mm256_mask_i32gather_epi32(_mm256_setzero_si256(), (const int*)mesh.face, twin, inner, 4);
+
+			auto Rule = [&](const float* points, const float* faces, float* dst)
+			{
+				const __m256 midPoint	= _mm256_mul_ps(_mm256_add_ps(_mm256_i32gather_ps(points, v0, 4), _mm256_i32gather_ps(points, v1, 4)), half);
+				const __m256 faceSum	= _mm256_add_ps(
+					_mm256_i32gather_ps(faces, f0, 4),
+					_mm256_mask_i32gather_ps(_mm256_setzero_ps(), faces, f1, _mm256_castsi256_ps(inner), 4));
+
+				const __m256 point		= _mm256_add_ps(_mm256_mul_ps(faceSum, quarter), _mm256_mul_ps(midPoint, half));
+				_mm256_storeu_ps(dst + itr, _mm256_blendv_ps(point, midPoint, _mm256_castsi256_ps(border)));
+			};
+
+			Rule(mesh.x, facePoints.x, out.x);
+			Rule(mesh.y, facePoints.y, out.y);
+			Rule(mesh.z, facePoints.z, out.z);
+		}
+	}
+
+
+	/************************************************************************************************/
+
+
+	void HE_PairwiseSumAVX2(const uint32_t* in, uint32_t* out, uint32_t& itr, const uint32_t end) noexcept
+	{
+		for (; itr + 8 <= end; itr += 8)
+		{
+			const __m256i lo	= _mm256_loadu_si256((const __m256i*)(in + 2 * itr));
+			const __m256i hi	= _mm256_loadu_si256((const __m256i*)(in + 2 * itr + 8));
+
+			// hadd interleaves the 128 bit lanes, the permute puts them back in order
+			const __m256i sums	= _mm256_permute4x64_epi64(_mm256_hadd_epi32(lo, hi), _MM_SHUFFLE(3, 1, 2, 0));
+			_mm256_storeu_si256((__m256i*)(out + itr), sums);
+		}
+	}
+#else
+	void HE_FacePointsAVX2(const HE_SoAArrays&, const HE_SoAOutput&, uint32_t&, const uint32_t) noexcept {}
+	void HE_EdgePointsAVX2(const HE_SoAArrays&, const HE_SoAPointArrays&, const HE_SoAOutput&, uint32_t&, const uint32_t) noexcept {}
+	void HE_PairwiseSumAVX2(const uint32_t*, uint32_t*, uint32_t&, const uint32_t) noexcept {}
+#endif
+
+
+}	/************************************************************************************************/
+
+/**********************************************************************
+
+Copyright (c) 2024 Robert May
+
+Permission is hereby granted, free of charge, to any person obtaining a
+copy of this software and associated documentation files (the "Software"),
+to deal in the Software without restriction, including without limitation
+the rights to use, copy, modify, merge, publish, distribute, sublicense,
+and/or sell copies of the Software, and to permit persons to whom the
+Software is furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included
+in all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+**********************************************************************/
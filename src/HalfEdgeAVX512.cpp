@@ -0,0 +1,134 @@
+#include "HalfEdgeSIMD.hpp"
+
+#if defined(__AVX512F__)
+#include <immintrin.h>
+#endif
+
+
+// Built with /arch:AVX512 or -mavx512f, see HalfEdgeSIMD.hpp. Only the kernels belong here.
+
+
+namespace FlexKit
+{	/************************************************************************************************/
+
+
+	bool HE_AVX512Built() noexcept
+	{
+#if defined(__AVX512F__)
+		return true;
+#else
+		return false;
+#endif
+	}
+
+
+	/************************************************************************************************/
+
+
+#if defined(__AVX512F__)
+	void HE_FacePointsAVX512(const HE_SoAArrays& mesh, const HE_SoAOutput& out, uint32_t& itr, const uint32_t end) noexcept
+	{
+		for (; itr + 16 <= end; itr += 16)
+		{
+			const __m512i	first	= _mm512_loadu_si512(mesh.faceBegin + itr);
+			const __m512i	count	= _mm512_min_epu32(_mm512_loadu_si512(mesh.edgeCount + itr), _mm512_set1_epi32(HE_SIMDMaxValence));
+			const uint32_t	n		= (uint32_t)_mm512_reduce_max_epu32(count);
+
+			__m512 terms[3][HE_SIMDMaxValence];
+
+			for (uint32_t i = 0; i < n; i++)
+			{
+				const __m512i	lane	= _mm512_set1_epi32(i);
+				const __mmask16	valid	= _mm512_cmpgt_epu32_mask(count, lane);
+				const __m512i	vertex	= _mm512_mask_i32gather_epi32(_mm512_setzero_si512(), valid, _mm512_add_epi32(first, lane), mesh.vert, 4);
+
+				terms[0][i] = _mm512_mask_i32gather_ps(_mm512_setzero_ps(), valid, vertex, mesh.x, 4);
+				terms[1][i] = _mm512_mask_i32gather_ps(_mm512_setzero_ps(), valid, vertex, mesh.y, 4);
+				terms[2][i] = _mm512_mask_i32gather_ps(_mm512_setzero_ps(), valid, vertex, mesh.z, 4);
+			}
+
+			for (uint32_t stride = 1; stride < n; stride *= 2)
+			{
+				for (uint32_t i = 0; i + stride < n; i += 2 * stride)
+				{
+					const __mmask16 summed = _mm512_cmpgt_epu32_mask(count, _mm512_set1_epi32(i + stride));
+
+					for (auto& component : terms)
+						component[i] = _mm512_mask_add_ps(component[i], summed, component[i], component[i + stride]);
+				}
+			}
+
+			const __m512 divisor = _mm512_cvtepu32_ps(count);
+			_mm512_storeu_ps(out.x + itr, _mm512_div_ps(terms[0][0], divisor));
+			_mm512_storeu_ps(out.y + itr, _mm512_div_ps(terms[1][0], divisor));
+			_mm512_storeu_ps(out.z + itr, _mm512_div_ps(terms[2][0], divisor));
+		}
+	}
+
+
+	/************************************************************************************************/
+
+
+	void HE_EdgePointsAVX512(const HE_SoAArrays& mesh, const HE_SoAPointArrays& facePoints, const HE_SoAOutput& out, uint32_t& itr, const uint32_t end) noexcept
+	{
+		// Powers of two, the products round exactly as the scalar rules' divisions
+		const __m512 half		= _mm512_set1_ps(0.5f);
+		const __m512 quarter	= _mm512_set1_ps(0.25f);
+
+		for (; itr + 16 <= end; itr += 16)
+		{
+			const __m512i	v0		= _mm512_loadu_si512(mesh.vert + itr);
+			const __m512i	v1		= _mm512_i32gather_epi32(_mm512_loadu_si512(mesh.next + itr), mesh.vert, 4);
+			const __m512i	twin	= _mm512_loadu_si512(mesh.twin + itr);
+			const __mmask16	border	= _mm512_cmpeq_epi32_mask(twin, _mm512_set1_epi32(-1));
+			const __mmask16	inner	= _knot_mask16(border);
+			const __m512i	f0		= _mm512_loadu_si512(mesh.face + itr);
+			const __m512i	f1		= _mm512_mask_i32gather_epi32(_mm512_setzero_si512(), inner, twin, mesh.face, 4);
+
+			auto Rule = [&](const float* points, const float* faces, float* dst)
+			{
+				const __m512 midPoint	= _mm512_mul_ps(_mm512_add_ps(_mm512_i32gather_ps(v0, points, 4), _mm512_i32gather_ps(v1, points, 4)), half);
+				const __m512 faceSum	= _mm512_add_ps(
+					_mm512_i32gather_ps(f0, faces, 4),
+					_mm512_mask_i32gather_ps(_mm512_setzero_ps(), inner, f1, faces, 4));
+
+				const __m512 point		= _mm512_add_ps(_mm512_mul_ps(faceSum, quarter), _mm512_mul_ps(midPoint, half));
+				_mm512_storeu_ps(dst + itr, _mm512_mask_blend_ps(border, point, midPoint));
+			};
+
+			Rule(mesh.x, facePoints.x, out.x);
+			Rule(mesh.y, facePoints.y, out.y);
+			Rule(mesh.z, facePoints.z, out.z);
+		}
+	}
+#else
+	void HE_FacePointsAVX512(const HE_SoAArrays&, const HE_SoAOutput&, uint32_t&, const uint32_t) noexcept {}
+	void HE_EdgePointsAVX512(const HE_SoAArrays&, const HE_SoAPointArrays&, const HE_SoAOutput&, uint32_t&, const uint32_t) noexcept {}
+#endif
+
+
+}	/************************************************************************************************/
+
+/**********************************************************************
+
+Copyright (c) 2024 Robert May
+
+Permission is hereby granted, free of charge, to any person obtaining a
+copy of this software and associated documentation files (the "Software"),
+to deal in the Software without restriction, including without limitation
+the rights to use, copy, modify, merge, publish, distribute, sublicense,
+and/or sell copies of the Software, and to permit persons to whom the
+Software is furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included
+in all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+**********************************************************************/
@@ -0,0 +1,564 @@
+#include "HalfEdgeBVH.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <numeric>
+
+
+namespace FlexKit
+{	/************************************************************************************************/
+
+
+	namespace
+	{
+		float Dot(const float3 a, const float3 b) noexcept
+		{
+			return a.x * b.x + a.y * b.y + a.z * b.z;
+		}
+
+
+		float3 Cross(const float3 a, const float3 b) noexcept
+		{
+			return { a.y * b.z - a.z * b.y, a.z * b.x - a.x * b.z, a.x * b.y - a.y * b.x };
+		}
+
+
+		float3 Min3(const float3 a, const float3 b) noexcept
+		{
+			return { Min(a.x, b.x), Min(a.y, b.y), Min(a.z, b.z) };
+		}
+
+
+		float3 Max3(const float3 a, const float3 b) noexcept
+		{
+			return { Max(a.x, b.x), Max(a.y, b.y), Max(a.z, b.z) };
+		}
+
+
+		float SurfaceArea(const float3 min, const float3 max) noexcept
+		{
+			const float3 d = max - min;
+			return (d.x < 0.0f) ? 0.0f : 2.0f * (d.x * d.y + d.y * d.z + d.z * d.x);
+		}
+
+
+		struct Bounds
+		{
+			float3 min = float3{  std::numeric_limits<float>::max() };
+			float3 max = float3{ -std::numeric_limits<float>::max() };
+
+			void Add(const float3 lo, const float3 hi) noexcept
+			{
+				min = Min3(min, lo);
+				max = Max3(max, hi);
+			}
+
+			void Add(const Bounds& rhs) noexcept { Add(rhs.min, rhs.max); }
+		};
+
+
+		struct Bin
+		{
+			Bounds		bounds;
+			uint32_t	count = 0;
+		};
+
+
+		// Entry distance of the ray into the box, or tMax when it misses
+		float RayBox(const float3 min, const float3 max, const float3 origin, const float3 invDir, const float tMin, const float tMax) noexcept
+		{
+			const float tx0 = (min.x - origin.x) * invDir.x;
+			const float tx1 = (max.x - origin.x) * invDir.x;
+			const float ty0 = (min.y - origin.y) * invDir.y;
+			const float ty1 = (max.y - origin.y) * invDir.y;
+			const float tz0 = (min.z - origin.z) * invDir.z;
+			const float tz1 = (max.z - origin.z) * invDir.z;
+
+			const float tNear	= Max(Max(Min(tx0, tx1), Min(ty0, ty1)), Max(Min(tz0, tz1), tMin));
+			const float tFar	= Min(Min(Max(tx0, tx1), Max(ty0, ty1)), Min(Max(tz0, tz1), tMax));
+
+			return tNear <= tFar ? tNear : tMax;
+		}
+
+
+		// Möller-Trumbore, two sided
+		bool RayTriangle(const HE_Ray& ray, const float3 p0, const float3 p1, const float3 p2, const float tMax, float& t, float& b1, float& b2) noexcept
+		{
+			const float3	e1	= p1 - p0;
+			const float3	e2	= p2 - p0;
+			const float3	p	= Cross(ray.direction, e2);
+			const float		det	= Dot(e1, p);
+
+			if (std::abs(det) < 1.0e-12f)
+				return false;
+
+			const float		invDet	= 1.0f / det;
+			const float3	s		= ray.origin - p0;
+
+			b1 = Dot(s, p) * invDet;
+			if (b1 < 0.0f || b1 > 1.0f)
+				return false;
+
+			const float3 q = Cross(s, e1);
+
+			b2 = Dot(ray.direction, q) * invDet;
+			if (b2 < 0.0f || b1 + b2 > 1.0f)
+				return false;
+
+			t = Dot(e2, q) * invDet;
+			return t >= ray.tMin && t < tMax;
+		}
+
+
+		void IntersectPatch(const HE_Level& level, const uint32_t patchIdx, const HE_Ray& ray, HE_RayHit& hit) noexcept
+		{
+			const float3 p0 = level.points[level.cage[4 * patchIdx + 0].vert];
+			const float3 p1 = level.points[level.cage[4 * patchIdx + 1].vert];
+			const float3 p2 = level.points[level.cage[4 * patchIdx + 2].vert];
+			const float3 p3 = level.points[level.cage[4 * patchIdx + 3].vert];
+
+			float t, b1, b2;
+
+			if (RayTriangle(ray, p0, p1, p2, hit.distance, t, b1, b2))
+				hit = { .patchIdx = patchIdx, .u = b1 + b2, .v = b2, .distance = t };
+
+			if (RayTriangle(ray, p0, p2, p3, hit.distance, t, b1, b2))
+				hit = { .patchIdx = patchIdx, .u = b1, .v = b1 + b2, .distance = t };
+		}
+
+
+		constexpr uint32_t HE_BVHMaxDepth = 96;
+	}
+
+
+	/************************************************************************************************/
+
+
+	void HE_BVH::UpdatePatchBounds(const HE_Level& level, const uint32_t threadCount)
+	{
+		const uint32_t patchCount = level.PatchCount();
+
+		patchMin.resize(patchCount);
+		patchMax.resize(patchCount);
+
+		HE_ParallelFor(patchCount,
+			[&](const uint32_t begin, const uint32_t end)
+			{
+				for (uint32_t patchIdx = begin; patchIdx < end; patchIdx++)
+				{
+					float3 min = level.points[level.cage[4 * patchIdx].vert];
+					float3 max = min;
+
+					for (uint32_t i = 1; i < 4; i++)
+					{
+						const float3 p = level.points[level.cage[4 * patchIdx + i].vert];
+						min = Min3(min, p);
+						max = Max3(max, p);
+					}
+
+					patchMin[patchIdx] = min;
+					patchMax[patchIdx] = max;
+				}
+			}, threadCount);
+	}
+
+
+	/************************************************************************************************/
+
+
+	void HE_BVH::Build(const HE_Level& level, const HE_BVHOptions& options)
+	{
+		const auto		begin		= std::chrono::high_resolution_clock::now();
+		const uint32_t	patchCount	= level.PatchCount();
+		const uint32_t	binCount	= Min(Max(options.binCount, 2u), 64u);
+		const uint32_t	threadCount	= options.threadCount ? options.threadCount : Max(std::thread::hardware_concurrency(), 1u);
+
+		UpdatePatchBounds(level, threadCount);
+
+		patchIndices.resize(patchCount);
+		std::iota(patchIndices.begin(), patchIndices.end(), 0u);
+
+		nodes.clear();
+		stats = {};
+
+		// No root without patches, a root of count 0 would read as an interior node
+		if (patchCount == 0)
+			return;
+
+		nodes.reserve(2 * patchCount);
+		nodes.push_back({ .leftOrFirst = 0, .count = patchCount });
+
+		auto Centroid = [&](const uint32_t patchIdx) { return (patchMin[patchIdx] + patchMax[patchIdx]) * 0.5f; };
+
+		struct Split
+		{
+			uint32_t	mid		= 0;	// 0 keeps the node as a leaf
+		};
+
+		std::vector<uint32_t>	frontier{ 0 };
+		std::vector<uint32_t>	nextFrontier;
+		std::vector<Split>		splits;
+		uint32_t				depth = 0;
+
+		// Nodes at the same depth cover disjoint patch ranges, so they are binned and partitioned in parallel
+		while (!frontier.empty())
+		{
+			splits.assign(frontier.size(), Split{});
+
+			const uint32_t innerThreads = Max(threadCount / (uint32_t)frontier.size(), 1u);
+
+			HE_ParallelFor((uint32_t)frontier.size(),
+				[&](const uint32_t frontierBegin, const uint32_t frontierEnd)
+				{
+					for (uint32_t frontierIdx = frontierBegin; frontierIdx < frontierEnd; frontierIdx++)
+					{
+						HE_BVHNode&		node	= nodes[frontier[frontierIdx]];
+						const uint32_t	first	= node.leftOrFirst;
+						const uint32_t	count	= node.count;
+
+						// Bounds and centroid bounds, split over threads for the large nodes near the root
+						const uint32_t	chunkCount = count >= (1u << 16) ? innerThreads : 1u;
+						std::vector<Bounds> chunkBounds(chunkCount);
+						std::vector<Bounds> chunkCentroids(chunkCount);
+
+						HE_ParallelFor(count,
+							[&](const uint32_t itrBegin, const uint32_t itrEnd, const uint32_t chunk)
+							{
+								for (uint32_t itr = itrBegin; itr < itrEnd; itr++)
+								{
+									const uint32_t	patchIdx	= patchIndices[first + itr];
+									const float3	c			= Centroid(patchIdx);
+
+									chunkBounds[chunk].Add(patchMin[patchIdx], patchMax[patchIdx]);
+									chunkCentroids[chunk].Add(c, c);
+								}
+							}, chunkCount, 1u << 14);
+
+						Bounds bounds;
+						Bounds centroids;
+						for (uint32_t chunk = 0; chunk < chunkCount; chunk++)
+						{
+							bounds.Add(chunkBounds[chunk]);
+							centroids.Add(chunkCentroids[chunk]);
+						}
+
+						node.min = bounds.min;
+						node.max = bounds.max;
+
+						if (count <= options.maxLeafSize || depth >= HE_BVHMaxDepth)
+							continue;
+
+						const float3	extent		= centroids.max - centroids.min;
+						float			bestCost	= std::numeric_limits<float>::max();
+						uint32_t		bestAxis	= 0;
+						uint32_t		bestBin		= 0;
+
+						// All three axes are binned in one pass over the patches
+						float3 scale;
+						for (uint32_t axis = 0; axis < 3; axis++)
+							scale[axis] = extent[axis] > 0.0f ? float(binCount) / extent[axis] : 0.0f;
+
+						std::vector<Bin> chunkBins(chunkCount * 3 * binCount);
+
+						HE_ParallelFor(count,
+							[&](const uint32_t itrBegin, const uint32_t itrEnd, const uint32_t chunk)
+							{
+								Bin* bins = chunkBins.data() + chunk * 3 * binCount;
+
+								for (uint32_t itr = itrBegin; itr < itrEnd; itr++)
+								{
+									const uint32_t	patchIdx	= patchIndices[first + itr];
+									const float3	c			= Centroid(patchIdx);
+
+									for (uint32_t axis = 0; axis < 3; axis++)
+									{
+										const uint32_t binIdx = Min(uint32_t((c[axis] - centroids.min[axis]) * scale[axis]), binCount - 1);
+
+										bins[axis * binCount + binIdx].bounds.Add(patchMin[patchIdx], patchMax[patchIdx]);
+										bins[axis * binCount + binIdx].count++;
+									}
+								}
+							}, chunkCount, 1u << 14);
+
+						for (uint32_t chunk = 1; chunk < chunkCount; chunk++)
+						{
+							for (uint32_t binIdx = 0; binIdx < 3 * binCount; binIdx++)
+							{
+								chunkBins[binIdx].bounds.Add(chunkBins[chunk * 3 * binCount + binIdx].bounds);
+								chunkBins[binIdx].count += chunkBins[chunk * 3 * binCount + binIdx].count;
+							}
+						}
+
+						for (uint32_t axis = 0; axis < 3; axis++)
+						{
+							if (extent[axis] <= 0.0f)
+								continue;
+
+							const Bin* bins = chunkBins.data() + axis * binCount;
+
+							// Sweep from the right to get the area and count of every right side
+							float		rightArea[64];
+							uint32_t	rightCount[64];
+							Bounds		right;
+							uint32_t	rightSum = 0;
+
+							for (uint32_t binIdx = binCount - 1; binIdx > 0; binIdx--)
+							{
+								right.Add(bins[binIdx].bounds);
+								rightSum += bins[binIdx].count;
+
+								rightArea[binIdx]	= SurfaceArea(right.min, right.max);
+								rightCount[binIdx]	= rightSum;
+							}
+
+							Bounds		left;
+							uint32_t	leftSum = 0;
+
+							for (uint32_t binIdx = 1; binIdx < binCount; binIdx++)
+							{
+								left.Add(bins[binIdx - 1].bounds);
+								leftSum += bins[binIdx - 1].count;
+
+								if (leftSum == 0 || rightCount[binIdx] == 0)
+									continue;
+
+								const float cost = SurfaceArea(left.min, left.max) * leftSum + rightArea[binIdx] * rightCount[binIdx];
+
+								if (cost < bestCost)
+								{
+									bestCost	= cost;
+									bestAxis	= axis;
+									bestBin		= binIdx;
+								}
+							}
+						}
+
+						const float nodeArea	= SurfaceArea(bounds.min, bounds.max);
+						const float splitCost	= options.traversalCost + options.intersectionCost * bestCost / Max(nodeArea, 1.0e-20f);
+						const float leafCost	= options.intersectionCost * count;
+
+						if (bestCost == std::numeric_limits<float>::max())
+						{
+							// Every centroid is in the same place, split in the middle to keep the leaves small
+							splits[frontierIdx].mid = first + count / 2;
+							continue;
+						}
+
+						if (splitCost >= leafCost && count <= 4 * options.maxLeafSize)
+							continue;
+
+						const auto itr = std::partition(
+							patchIndices.begin() + first,
+							patchIndices.begin() + first + count,
+							[&](const uint32_t patchIdx)
+							{
+								return Min(uint32_t((Centroid(patchIdx)[bestAxis] - centroids.min[bestAxis]) * scale[bestAxis]), binCount - 1) < bestBin;
+							});
+
+						splits[frontierIdx].mid = uint32_t(itr - patchIndices.begin());
+					}
+				}, threadCount, 1);
+
+			nextFrontier.clear();
+
+			for (uint32_t frontierIdx = 0; frontierIdx < frontier.size(); frontierIdx++)
+			{
+				const uint32_t nodeIdx	= frontier[frontierIdx];
+				const uint32_t mid		= splits[frontierIdx].mid;
+
+				if (!mid)
+				{
+					stats.leafCount++;
+					continue;
+				}
+
+				const uint32_t first	= nodes[nodeIdx].leftOrFirst;
+				const uint32_t count	= nodes[nodeIdx].count;
+				const uint32_t left		= (uint32_t)nodes.size();
+
+				nodes.push_back({ .leftOrFirst = first, .count = mid - first });
+				nodes.push_back({ .leftOrFirst = mid,	.count = first + count - mid });
+
+				nodes[nodeIdx].leftOrFirst	= left;
+				nodes[nodeIdx].count		= 0;
+
+				nextFrontier.push_back(left);
+				nextFrontier.push_back(left + 1);
+			}
+
+			std::swap(frontier, nextFrontier);
+			depth++;
+		}
+
+		stats.nodeCount		= (uint32_t)nodes.size();
+		stats.maxDepth		= depth;
+		stats.buildDuration	= std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - begin).count();
+	}
+
+
+	/************************************************************************************************/
+
+
+	void HE_BVH::Refit(const HE_Level& level, const uint32_t threadCount)
+	{
+		// Nothing was built over an empty level, and interior nodes below would read children past the end
+		if (nodes.empty() || patchIndices.empty() || level.PatchCount() == 0)
+			return;
+
+		const auto begin = std::chrono::high_resolution_clock::now();
+
+		UpdatePatchBounds(level, threadCount);
+
+		HE_ParallelFor((uint32_t)nodes.size(),
+			[&](const uint32_t nodeBegin, const uint32_t nodeEnd)
+			{
+				for (uint32_t nodeIdx = nodeBegin; nodeIdx < nodeEnd; nodeIdx++)
+				{
+					HE_BVHNode& node = nodes[nodeIdx];
+					if (!node.IsLeaf())
+						continue;
+
+					Bounds bounds;
+					for (uint32_t itr = node.leftOrFirst; itr < node.leftOrFirst + node.count; itr++)
+						bounds.Add(patchMin[patchIndices[itr]], patchMax[patchIndices[itr]]);
+
+					node.min = bounds.min;
+					node.max = bounds.max;
+				}
+			}, threadCount);
+
+		// Children are always stored after their parent
+		for (uint32_t nodeIdx = (uint32_t)nodes.size(); nodeIdx-- > 0;)
+		{
+			HE_BVHNode& node = nodes[nodeIdx];
+			if (node.IsLeaf())
+				continue;
+
+			const HE_BVHNode& left	= nodes[node.leftOrFirst];
+			const HE_BVHNode& right	= nodes[node.leftOrFirst + 1];
+
+			node.min = Min3(left.min, right.min);
+			node.max = Max3(left.max, right.max);
+		}
+
+		stats.refitDuration = std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - begin).count();
+	}
+
+
+	/************************************************************************************************/
+
+
+	HE_RayHit HE_BVH::Intersect(const HE_Level& level, const HE_Ray& ray) const noexcept
+	{
+		HE_RayHit hit;
+		hit.distance = ray.tMax;
+
+		if (nodes.empty())
+			return hit;
+
+		const float3 invDir = { 1.0f / ray.direction.x, 1.0f / ray.direction.y, 1.0f / ray.direction.z };
+
+		uint32_t stack[HE_BVHMaxDepth + 2];
+		uint32_t stackSize = 0;
+
+		if (RayBox(nodes[0].min, nodes[0].max, ray.origin, invDir, ray.tMin, hit.distance) < hit.distance)
+			stack[stackSize++] = 0;
+
+		while (stackSize)
+		{
+			const HE_BVHNode& node = nodes[stack[--stackSize]];
+
+			if (node.IsLeaf())
+			{
+				for (uint32_t itr = node.leftOrFirst; itr < node.leftOrFirst + node.count; itr++)
+					IntersectPatch(level, patchIndices[itr], ray, hit);
+
+				continue;
+			}
+
+			const uint32_t	left	= node.leftOrFirst;
+			const uint32_t	right	= node.leftOrFirst + 1;
+			const float		tLeft	= RayBox(nodes[left].min, nodes[left].max, ray.origin, invDir, ray.tMin, hit.distance);
+			const float		tRight	= RayBox(nodes[right].min, nodes[right].max, ray.origin, invDir, ray.tMin, hit.distance);
+
+			// Push the far child first so the near one is visited next and shrinks the ray early
+			const bool leftFirst = tLeft <= tRight;
+
+			if ((leftFirst ? tRight : tLeft) < hit.distance)
+				stack[stackSize++] = leftFirst ? right : left;
+
+			if ((leftFirst ? tLeft : tRight) < hit.distance)
+				stack[stackSize++] = leftFirst ? left : right;
+		}
+
+		if (!hit.Hit())
+			hit.distance = std::numeric_limits<float>::max();
+
+		return hit;
+	}
+
+
+	void HE_BVH::Intersect(const HE_Level& level, std::span<const HE_Ray> rays, std::span<HE_RayHit> outHits, const uint32_t threadCount) const
+	{
+		HE_ParallelFor((uint32_t)Min(rays.size(), outHits.size()),
+			[&](const uint32_t begin, const uint32_t end)
+			{
+				for (uint32_t rayIdx = begin; rayIdx < end; rayIdx++)
+					outHits[rayIdx] = Intersect(level, rays[rayIdx]);
+			}, threadCount, 256);
+	}
+
+
+	/************************************************************************************************/
+
+
+	HE_RayBenchmark BenchmarkRays(
+		const HE_BVH&				bvh,
+		const HE_Level&				level,
+		std::span<const HE_Ray>		rays,
+		std::span<HE_RayHit>		outHits,
+		const uint32_t				threadCount)
+	{
+		HE_RayBenchmark results;
+		results.rayCount	= (uint32_t)Min(rays.size(), outHits.size());
+		results.threadCount	= threadCount ? threadCount : Max(std::thread::hardware_concurrency(), 1u);
+
+		const auto begin = std::chrono::high_resolution_clock::now();
+
+		bvh.Intersect(level, rays, outHits, results.threadCount);
+
+		results.duration = std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - begin).count();
+
+		for (uint32_t rayIdx = 0; rayIdx < results.rayCount; rayIdx++)
+			results.hitCount += outHits[rayIdx].Hit() ? 1 : 0;
+
+		return results;
+	}
+
+
+}	/************************************************************************************************/
+
+/**********************************************************************
+
+Copyright (c) 2024 Robert May
+
+Permission is hereby granted, free of charge, to any person obtaining a
+copy of this software and associated documentation files (the "Software"),
+to deal in the Software without restriction, including without limitation
+the rights to use, copy, modify, merge, publish, distribute, sublicense,
+and/or sell copies of the Software, and to permit persons to whom the
+Software is furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included
+in all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+**********************************************************************/
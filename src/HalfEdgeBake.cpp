@@ -0,0 +1,406 @@
+#include "HalfEdgeBake.hpp"
+#include "HalfEdgeProgressive.hpp"
+#include "HalfEdgeValidation.hpp"
+
+#include <charconv>
+#include <chrono>
+#include <cstring>
+#include <fstream>
+#include <memory>
+#include <string_view>
+#include <vector>
+
+#if defined(_WIN32)
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#include <windows.h>
+#include <psapi.h>
+#else
+#include <sys/resource.h>
+#endif
+
+
+namespace FlexKit
+{	/************************************************************************************************/
+
+
+	namespace
+	{
+		class StreamWriter
+		{
+		public:
+			static constexpr size_t BufferSize = 1 * MEGABYTE;
+
+			StreamWriter(const std::filesystem::path& path) :
+				file	{ path, std::ios::binary | std::ios::trunc },
+				buffer	{ std::make_unique<char[]>(BufferSize) } {}
+
+			void Write(const void* data, size_t size)
+			{
+				const char* bytes = static_cast<const char*>(data);
+
+				while (size)
+				{
+					if (used == BufferSize)
+						Flush();
+
+					const size_t chunk = Min(size, BufferSize - used);
+					memcpy(buffer.get() + used, bytes, chunk);
+
+					used	+= chunk;
+					bytes	+= chunk;
+					size	-= chunk;
+				}
+			}
+
+			void Text(std::string_view text) { Write(text.data(), text.size()); }
+
+			template<typename TY>
+			void Number(const TY value)
+			{
+				char digits[32];
+				const auto result = std::to_chars(digits, digits + sizeof(digits), value);
+				Write(digits, result.ptr - digits);
+			}
+
+			void Flush()
+			{
+				file.write(buffer.get(), used);
+				written	+= used;
+				used	 = 0;
+			}
+
+			uint64_t Close()
+			{
+				Flush();
+				file.close();
+
+				return file.fail() ? 0 : written;
+			}
+
+			bool IsOpen() const { return file.is_open(); }
+
+		private:
+			std::ofstream			file;
+			std::unique_ptr<char[]>	buffer;
+			size_t					used	= 0;
+			uint64_t				written	= 0;
+		};
+
+
+		std::string_view NextToken(std::string_view& line)
+		{
+			const size_t begin = line.find_first_not_of(" \t\r");
+			if (begin == std::string_view::npos)
+			{
+				line = {};
+				return {};
+			}
+
+			const size_t end = Min(line.find_first_of(" \t\r", begin), line.size());
+
+			const std::string_view token = line.substr(begin, end - begin);
+			line.remove_prefix(end);
+
+			return token;
+		}
+
+
+		double Milliseconds(const std::chrono::high_resolution_clock::time_point begin)
+		{
+			return std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - begin).count();
+		}
+	}
+
+
+	/************************************************************************************************/
+
+
+	bool LoadObjShape(const std::filesystem::path& path, ModifiableShape& out, std::string& outError)
+	{
+		std::ifstream file{ path };
+		if (!file)
+		{
+			outError = "failed to open " + path.string();
+			return false;
+		}
+
+		std::string				line;
+		std::vector<uint32_t>	indexes;
+		uint32_t				vertexCount	= 0;
+		uint32_t				lineNumber	= 0;
+
+		while (std::getline(file, line))
+		{
+			lineNumber++;
+
+			std::string_view		remaining	= line;
+			const std::string_view	keyword		= NextToken(remaining);
+
+			if (keyword == "v")
+			{
+				float xyz[3] = { 0.0f, 0.0f, 0.0f };
+
+				for (auto& component : xyz)
+				{
+					const auto token = NextToken(remaining);
+					std::from_chars(token.data(), token.data() + token.size(), component);
+				}
+
+				out.AddVertex(float3{ xyz[0], xyz[1], xyz[2] });
+				vertexCount++;
+			}
+			else if (keyword == "f")
+			{
+				indexes.clear();
+
+				// v, v/vt, v//vn or v/vt/vn, indices are one based and negative ones count back from the last vertex
+				for (auto token = NextToken(remaining); !token.empty(); token = NextToken(remaining))
+				{
+					int64_t idx = 0;
+					std::from_chars(token.data(), token.data() + token.size(), idx);
+
+					const int64_t resolved = idx < 0 ? int64_t(vertexCount) + idx : idx - 1;
+
+					if (idx == 0 || resolved < 0 || resolved >= int64_t(vertexCount))
+					{
+						outError = path.string() + ":" + std::to_string(lineNumber) + ": face index out of range";
+						return false;
+					}
+
+					indexes.push_back((uint32_t)resolved);
+				}
+
+				if (indexes.size() >= 3)
+					out.AddPolygon(indexes.data(), indexes.data() + indexes.size());
+			}
+		}
+
+		return true;
+	}
+
+
+	/************************************************************************************************/
+
+
+	uint64_t WriteLevelOBJ(const HE_Level& level, const std::filesystem::path& path)
+	{
+		StreamWriter writer{ path };
+		if (!writer.IsOpen())
+			return 0;
+
+		writer.Text("# hebake level ");
+		writer.Number(level.level);
+		writer.Text("\n");
+
+		for (const float3& point : level.points)
+		{
+			writer.Text("v ");
+			writer.Number(point.x);
+			writer.Text(" ");
+			writer.Number(point.y);
+			writer.Text(" ");
+			writer.Number(point.z);
+			writer.Text("\n");
+		}
+
+		for (uint32_t patchIdx = 0; patchIdx < level.PatchCount(); patchIdx++)
+		{
+			writer.Text("f");
+
+			for (uint32_t i = 0; i < 4; i++)
+			{
+				writer.Text(" ");
+				writer.Number(level.cage[4 * patchIdx + i].vert + 1);
+			}
+
+			writer.Text("\n");
+		}
+
+		return writer.Close();
+	}
+
+
+	uint64_t WriteLevelPLY(const HE_Level& level, const std::filesystem::path& path)
+	{
+		StreamWriter writer{ path };
+		if (!writer.IsOpen())
+			return 0;
+
+		writer.Text("ply\nformat binary_little_endian 1.0\nelement vertex ");
+		writer.Number(level.points.size());
+		writer.Text("\nproperty float x\nproperty float y\nproperty float z\nelement face ");
+		writer.Number(level.PatchCount());
+		writer.Text("\nproperty list uchar uint vertex_indices\nend_header\n");
+
+		for (const float3& point : level.points)
+		{
+			const float xyz[] = { point.x, point.y, point.z };
+			writer.Write(xyz, sizeof(xyz));
+		}
+
+		for (uint32_t patchIdx = 0; patchIdx < level.PatchCount(); patchIdx++)
+		{
+			const uint8_t	count		= 4;
+			const uint32_t	indices[]	= {
+				level.cage[4 * patchIdx + 0].vert,
+				level.cage[4 * patchIdx + 1].vert,
+				level.cage[4 * patchIdx + 2].vert,
+				level.cage[4 * patchIdx + 3].vert };
+
+			writer.Write(&count, sizeof(count));
+			writer.Write(indices, sizeof(indices));
+		}
+
+		return writer.Close();
+	}
+
+
+	uint64_t WriteLevelRaw(const HE_Level& level, const std::filesystem::path& path)
+	{
+		StreamWriter writer{ path };
+		if (!writer.IsOpen())
+			return 0;
+
+		HE_RawLevelHeader header;
+		header.level			= level.level;
+		header.halfEdgeCount	= (uint32_t)level.cage.size();
+		header.pointCount		= (uint32_t)level.points.size();
+
+		writer.Write(&header, sizeof(header));
+		writer.Write(level.cage.data(), level.cage.size() * sizeof(HE_TwinEdge));
+		writer.Write(level.flags.data(), level.flags.size());
+		writer.Write(level.points.data(), level.points.size() * sizeof(float3));
+
+		return writer.Close();
+	}
+
+
+	/************************************************************************************************/
+
+
+	HE_BakeResult BakeFile(const std::filesystem::path& input, const std::filesystem::path& outputDir, const HE_BakeOptions& options, iAllocator& allocator)
+	{
+		static const char* extensions[] = { ".obj", ".ply", ".helv", ".hep" };
+
+		HE_BakeResult result;
+		result.input = input;
+
+		auto begin = std::chrono::high_resolution_clock::now();
+
+		ModifiableShape shape;
+		if (!LoadObjShape(input, shape, result.error))
+			return result;
+
+		HE_ControlCage cage = BuildControlCage(shape, allocator);
+		result.faceCount	= (uint32_t)cage.faces.size();
+		result.level		= Min(options.level, Max(HE_MaxLevelCount(cage.halfEdges.size()), 1u) - 1);
+
+		if (const auto report = ValidateControlCage(cage, allocator, { .threadCount = options.threadCount, .levelCount = result.level + 1 }); !report.IsValid())
+		{
+			result.error = std::to_string(report.errors.size()) + (report.truncated ? "+" : "") + " validation errors, first: ";
+			result.error += report.errors.size() ? HE_ValidationErrorString(report.errors[0].code) : "truncated";
+			return result;
+		}
+
+		result.loadTime = Milliseconds(begin);
+		begin			= std::chrono::high_resolution_clock::now();
+
+		HalfEdgeCPUMesh mesh{ std::move(cage), allocator, options.indexMode };
+
+		while (mesh.LevelCount() <= result.level)
+			mesh.BuildNextLevel(options.threadCount);
+
+		const HE_Level& level = mesh.GetLevel(result.level);
+		result.patchCount		= level.PatchCount();
+		result.subdivideTime	= Milliseconds(begin);
+		begin					= std::chrono::high_resolution_clock::now();
+
+		result.output = outputDir / (input.stem().string() + "_L" + std::to_string(result.level) + extensions[(uint32_t)options.format]);
+
+		switch (options.format)
+		{
+		case HE_BakeFormat::OBJ:	result.bytesWritten = WriteLevelOBJ(level, result.output); break;
+		case HE_BakeFormat::PLY:	result.bytesWritten = WriteLevelPLY(level, result.output); break;
+		case HE_BakeFormat::Raw:	result.bytesWritten = WriteLevelRaw(level, result.output); break;
+		case HE_BakeFormat::Progressive:
+		{
+			std::ofstream file{ result.output, std::ios::binary | std::ios::trunc };
+
+			const auto stats = WriteProgressive(file, mesh, allocator, { .threadCount = options.threadCount });
+			file.close();
+
+			result.bytesWritten		= stats.Succeeded() && file ? stats.fileBytes : 0;
+			result.compressionRatio	= stats.CompressionRatio();
+		}	break;
+		}
+
+		result.writeTime = Milliseconds(begin);
+
+		if (options.format == HE_BakeFormat::Progressive && result.bytesWritten)
+		{
+			std::ifstream			file{ result.output, std::ios::binary };
+			HE_ProgressiveReader	reader{ file, allocator };
+
+			while (reader.DecodeNextLevel(options.threadCount));
+
+			if (!reader.IsValid() || reader.LevelsDecoded() != result.level + 1)
+				result.error = "failed to read back " + result.output.string() + ": " + reader.Error();
+
+			result.decodeRate = reader.Stats().PointsPerSecond();
+		}
+
+		if (result.bytesWritten == 0)
+			result.error = "failed to write " + result.output.string();
+
+		return result;
+	}
+
+
+	/************************************************************************************************/
+
+
+	uint64_t HE_PeakRSS() noexcept
+	{
+#if defined(_WIN32)
+		PROCESS_MEMORY_COUNTERS counters{};
+		if (GetProcessMemoryInfo(GetCurrentProcess(), &counters, sizeof(counters)))
+			return counters.PeakWorkingSetSize;
+
+		return 0;
+#elif defined(__APPLE__)
+		rusage usage{};
+		return getrusage(RUSAGE_SELF, &usage) == 0 ? uint64_t(usage.ru_maxrss) : 0;			// bytes
+#else
+		rusage usage{};
+		return getrusage(RUSAGE_SELF, &usage) == 0 ? uint64_t(usage.ru_maxrss) * 1024 : 0;	// kilobytes
+#endif
+	}
+
+
+}	/************************************************************************************************/
+
+/**********************************************************************
+
+Copyright (c) 2024 Robert May
+
+Permission is hereby granted, free of charge, to any person obtaining a
+copy of this software and associated documentation files (the "Software"),
+to deal in the Software without restriction, including without limitation
+the rights to use, copy, modify, merge, publish, distribute, sublicense,
+and/or sell copies of the Software, and to permit persons to whom the
+Software is furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included
+in all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+**********************************************************************/
@@ -0,0 +1,414 @@
+#include "HalfEdgeCBT.hpp"
+#include "HalfEdgeSIMD.hpp"
+
+#include <algorithm>
+#include <atomic>
+
+
+namespace FlexKit
+{	/************************************************************************************************/
+
+
+	namespace
+	{
+		// out[i] = in[2i] + in[2i + 1]
+		void HE_PairwiseSum(const uint32_t* __restrict in, uint32_t* __restrict out, const uint32_t count) noexcept
+		{
+			uint32_t i = 0;
+
+			if (HE_SIMDSupport() >= HE_SIMDLevel::AVX2)
+				HE_PairwiseSumAVX2(in, out, i, count);
+
+			for (; i < count; i++)
+				out[i] = in[2 * i] + in[2 * i + 1];
+		}
+
+
+		uint64_t HE_RangeMask(const uint32_t offset, const uint32_t width) noexcept
+		{
+			return (width >= 64 ? ~0ull : ((1ull << width) - 1)) << offset;
+		}
+	}
+
+
+	/************************************************************************************************/
+
+
+	HE_CBT::HE_CBT(iAllocator& allocator, const uint32_t IN_maxDepth, const uint32_t initDepth) :
+		maxDepth	{ Min(Max(IN_maxDepth, MinDepth), MaxDepth) },
+		wordDepth	{ maxDepth - MinDepth },
+		heap		{ allocator },
+		bits		{ allocator }
+	{
+		heap.resize(2u << wordDepth);
+		bits.resize(1u << wordDepth);
+
+		Reset(initDepth);
+	}
+
+
+	/************************************************************************************************/
+
+
+	void HE_CBT::Reset(const uint32_t initDepth)
+	{
+		const uint32_t depth	= Min(initDepth, maxDepth);
+		const uint32_t stride	= 1u << (maxDepth - depth);
+
+		std::fill(bits.begin(), bits.end(), 0ull);
+
+		for (uint32_t slot = 0; slot < (1u << maxDepth); slot += stride)
+			bits[slot / 64] |= 1ull << (slot % 64);
+
+		SumReduction(1);
+	}
+
+
+	/************************************************************************************************/
+
+
+	uint32_t HE_CBT::Value(const HE_CBTNode node) const noexcept
+	{
+		if (node.depth <= wordDepth)
+			return heap[node.id];
+
+		const uint32_t slot = Slot(node);
+		return std::popcount(bits[slot / 64] & HE_RangeMask(slot % 64, 1u << (maxDepth - node.depth)));
+	}
+
+
+	bool HE_CBT::IsLeaf(const HE_CBTNode node) const noexcept
+	{
+		const uint32_t slot = Slot(node);
+		return (bits[slot / 64] >> (slot % 64) & 1) && Value(node) == 1;
+	}
+
+
+	/************************************************************************************************/
+
+
+	HE_CBTNode HE_CBT::DecodeNode(uint32_t leafIndex) const noexcept
+	{
+		HE_CBTNode node;
+
+		while (Value(node) > 1)
+		{
+			const HE_CBTNode	left		= node.LeftChild();
+			const uint32_t		leftCount	= Value(left);
+
+			if (leafIndex < leftCount)
+				node = left;
+			else
+			{
+				leafIndex	-= leftCount;
+				node		= node.RightChild();
+			}
+		}
+
+		return node;
+	}
+
+
+	uint32_t HE_CBT::EncodeNode(const HE_CBTNode node) const noexcept
+	{
+		uint32_t leafIndex = 0;
+
+		for (uint32_t depth = 1; depth <= node.depth; depth++)
+		{
+			const HE_CBTNode ancestor = { node.id >> (node.depth - depth), depth };
+
+			if (ancestor.id & 1)
+				leafIndex += Value(ancestor.Sibling());
+		}
+
+		return leafIndex;
+	}
+
+
+	/************************************************************************************************/
+
+
+	void HE_CBT::SplitNode(const HE_CBTNode node) noexcept
+	{
+		if (node.depth >= maxDepth)
+			return;
+
+		const uint32_t slot = Slot(node.RightChild());
+		SetSlots(slot / 64, 1ull << (slot % 64));
+	}
+
+
+	void HE_CBT::MergeNode(const HE_CBTNode node) noexcept
+	{
+		if (node.depth == 0)
+			return;
+
+		const uint32_t slot = Slot({ node.id | 1, node.depth });
+		ClearSlots(slot / 64, 1ull << (slot % 64));
+	}
+
+
+	void HE_CBT::SetSlots(const uint32_t word, const uint64_t mask) noexcept
+	{
+		std::atomic_ref{ bits[word] }.fetch_or(mask, std::memory_order_relaxed);
+	}
+
+
+	void HE_CBT::ClearSlots(const uint32_t word, const uint64_t mask) noexcept
+	{
+		std::atomic_ref{ bits[word] }.fetch_and(~mask, std::memory_order_relaxed);
+	}
+
+
+	/************************************************************************************************/
+
+
+	void HE_CBT::SumReduction(const uint32_t threadCount)
+	{
+		const uint32_t wordCount	= (uint32_t)bits.size();
+		uint32_t* const wordCounts	= heap.data() + wordCount;
+
+		HE_ParallelFor(wordCount,
+			[&](const uint32_t begin, const uint32_t end)
+			{
+				for (uint32_t word = begin; word < end; word++)
+					wordCounts[word] = std::popcount(bits[word]);
+			}, threadCount, 1u << 14);
+
+		for (uint32_t depth = wordDepth; depth > 0; depth--)
+		{
+			const uint32_t	count	= 1u << (depth - 1);
+			const uint32_t*	in		= heap.data() + (1u << depth);
+			uint32_t*		out		= heap.data() + count;
+
+			HE_ParallelFor(count,
+				[&](const uint32_t begin, const uint32_t end)
+				{
+					HE_PairwiseSum(in + 2 * begin, out + begin, end - begin);
+				}, threadCount, 1u << 16);
+		}
+	}
+
+
+	/************************************************************************************************/
+
+
+	uint32_t HE_CBT::NextSlot(const uint32_t slot) const noexcept
+	{
+		uint32_t word = slot / 64;
+		uint64_t remaining = (slot % 64 == 63) ? 0 : bits[word] & (~0ull << (slot % 64 + 1));
+
+		while (!remaining && ++word < bits.size())
+			remaining = bits[word];
+
+		return remaining ? word * 64 + std::countr_zero(remaining) : 1u << maxDepth;
+	}
+
+
+	HE_CBTNode HE_CBT::LeafFromSlot(const uint32_t slot) const noexcept
+	{
+		// Largest aligned range starting at this slot that holds no other leaf
+		const uint32_t aligned	= slot ? (slot & (~slot + 1)) : (1u << maxDepth);
+		const uint32_t width	= Min(aligned, std::bit_floor(NextSlot(slot) - slot));
+		const uint32_t depth	= maxDepth - std::countr_zero(width);
+
+		return { (slot + (1u << maxDepth)) >> (maxDepth - depth), depth };
+	}
+
+
+	/************************************************************************************************/
+
+
+	bool HE_CBT::Validate() const
+	{
+		const uint32_t wordCount = (uint32_t)bits.size();
+
+		if (!(bits[0] & 1))
+			return false;
+
+		for (uint32_t word = 0; word < wordCount; word++)
+		{
+			if (heap[wordCount + word] != (uint32_t)std::popcount(bits[word]))
+				return false;
+		}
+
+		for (uint32_t id = 1; id < wordCount; id++)
+		{
+			if (heap[id] != heap[2 * id] + heap[2 * id + 1])
+				return false;
+		}
+
+		uint32_t leafIndex	= 0;
+		bool	 valid		= true;
+
+		ForEachLeaf(
+			[&](const HE_CBTNode node)
+			{
+				valid = valid &&
+						DecodeNode(leafIndex) == node &&
+						EncodeNode(node) == leafIndex;
+
+				leafIndex++;
+			});
+
+		return valid && leafIndex == NodeCount();
+	}
+
+
+	/************************************************************************************************/
+
+
+	HE_PatchAllocator::HE_PatchAllocator(iAllocator& allocator, const uint32_t IN_faceCount, const uint32_t IN_maxLevel) :
+		cbt				{ allocator,
+						  std::bit_width(Max(IN_faceCount, 1u) - 1) + 2 * IN_maxLevel,
+						  0 },
+		faceCount		{ IN_faceCount },
+		rootDepth		{ (uint32_t)std::bit_width(Max(IN_faceCount, 1u) - 1) },
+		maxLevel		{ (cbt.GetMaxDepth() - rootDepth) / 2 },
+		splitBits		{ allocator },
+		mergeBits		{ allocator },
+		changedWords	{ allocator }
+	{
+		splitBits.resize(cbt.WordCount());
+		mergeBits.resize(cbt.WordCount());
+
+		// Split down to one node per control face, the range past faceCount stays in as few nodes as possible
+		for (uint32_t depth = 0; depth < rootDepth; depth++)
+		{
+			cbt.ForEachLeaf(
+				[&](const HE_CBTNode node)
+				{
+					const uint32_t firstFace = (node.id << (rootDepth - node.depth)) - (1u << rootDepth);
+					if (node.depth == depth && firstFace < faceCount)
+						cbt.SplitNode(node);
+				});
+
+			cbt.SumReduction(1);
+		}
+	}
+
+
+	/************************************************************************************************/
+
+
+	HE_Patch HE_PatchAllocator::GetPatch(const HE_CBTNode node) const noexcept
+	{
+		if (node.depth < rootDepth)
+			return { .faceIdx = (node.id << (rootDepth - node.depth)) - (1u << rootDepth), .level = 0, .path = 0, .slot = cbt.Slot(node) };
+
+		const uint32_t relativeDepth = node.depth - rootDepth;
+
+		return {
+			.faceIdx	= (node.id >> relativeDepth) - (1u << rootDepth),
+			.level		= relativeDepth / 2,
+			.path		= node.id & ((1u << relativeDepth) - 1),
+			.slot		= cbt.Slot(node),
+		};
+	}
+
+
+	HE_Patch HE_PatchAllocator::GetPatch(const uint32_t patchIdx) const noexcept
+	{
+		return GetPatch(cbt.DecodeNode(patchIdx));
+	}
+
+
+	/************************************************************************************************/
+
+
+	HE_PatchUpdateStats HE_PatchAllocator::Update(std::span<const uint8_t> targetLevels, const uint32_t threadCount)
+	{
+		std::atomic_uint32_t splits	= 0;
+		std::atomic_uint32_t merges	= 0;
+
+		std::fill(splitBits.begin(), splitBits.end(), 0ull);
+		std::fill(mergeBits.begin(), mergeBits.end(), 0ull);
+
+		// Decisions are made against the tree as of the last reduction and applied afterwards,
+		// so every leaf sees the same state no matter how the words are split between threads
+		HE_ParallelFor(cbt.WordCount(),
+			[&](const uint32_t begin, const uint32_t end)
+			{
+				uint32_t localSplits = 0;
+				uint32_t localMerges = 0;
+
+				cbt.ForEachLeaf(
+					[&](const HE_CBTNode node)
+					{
+						const HE_Patch patch = GetPatch(node);
+						if (patch.faceIdx >= faceCount || node.depth < rootDepth)
+							return;
+
+						const uint32_t relativeDepth	= node.depth - rootDepth;
+						const uint32_t target			= 2 * Min(patch.faceIdx < targetLevels.size() ? uint32_t(targetLevels[patch.faceIdx]) : 0u, maxLevel);
+
+						if (relativeDepth < target)
+						{
+							const uint32_t slot = cbt.Slot(node.RightChild());
+							std::atomic_ref{ splitBits[slot / 64] }.fetch_or(1ull << (slot % 64), std::memory_order_relaxed);
+							localSplits++;
+						}
+						else if (relativeDepth > target && !(node.id & 1) && cbt.IsLeaf(node.Sibling()))
+						{
+							const uint32_t slot = cbt.Slot(node.Sibling());
+							std::atomic_ref{ mergeBits[slot / 64] }.fetch_or(1ull << (slot % 64), std::memory_order_relaxed);
+							localMerges++;
+						}
+					}, begin, end);
+
+				splits += localSplits;
+				merges += localMerges;
+			}, threadCount, 256);
+
+		HE_ParallelFor(cbt.WordCount(),
+			[&](const uint32_t begin, const uint32_t end)
+			{
+				for (uint32_t word = begin; word < end; word++)
+				{
+					if (splitBits[word])
+						cbt.SetSlots(word, splitBits[word]);
+
+					if (mergeBits[word])
+						cbt.ClearSlots(word, mergeBits[word]);
+				}
+			}, threadCount, 1u << 14);
+
+		cbt.SumReduction(threadCount);
+
+		changedWords.clear();
+
+		for (uint32_t word = 0; word < cbt.WordCount(); word++)
+		{
+			if (splitBits[word] | mergeBits[word])
+				changedWords.push_back(word);
+		}
+
+		return { .splits = splits, .merges = merges, .patchCount = cbt.NodeCount() };
+	}
+
+
+}	/************************************************************************************************/
+
+/**********************************************************************
+
+Copyright (c) 2024 Robert May
+
+Permission is hereby granted, free of charge, to any person obtaining a
+copy of this software and associated documentation files (the "Software"),
+to deal in the Software without restriction, including without limitation
+the rights to use, copy, modify, merge, publish, distribute, sublicense,
+and/or sell copies of the Software, and to permit persons to whom the
+Software is furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included
+in all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+**********************************************************************/
@@ -0,0 +1,246 @@
+#include "HalfEdgeCPU.hpp"
+
+#include <chrono>
+
+
+namespace FlexKit
+{	/************************************************************************************************/
+
+
+	HE_ControlCage BuildControlCage(const ModifiableShape& shape, iAllocator& allocator)
+	{
+		HE_ControlCage cage{ allocator };
+
+		cage.halfEdges.reserve(shape.wEdges.size());
+		for (const auto& edge : shape.wEdges)
+		{
+			const bool isOnEdge = shape.IsEdgeVertex(edge.vertices[0]);
+
+			auto CalculateFlags = [&]() -> uint32_t
+			{
+				return	(shape.GetVertexValence(edge.vertices[0]) == 2 ? HE_CornerFlag : 0) |
+						(isOnEdge ? HE_TFlag : 0);
+			};
+
+			cage.halfEdges.push_back(
+				HEEdge{
+					.twin	= edge.twin < shape.wEdges.size() ? edge.twin : HE_BorderValue,
+					.next	= edge.next,
+					.prev	= edge.prev,
+					.vert	= edge.vertices[0],
+					.flags	= CalculateFlags(),
+				});
+		}
+
+		cage.faces.reserve(shape.wFaces.size());
+		for (uint32_t idx = 0; idx < shape.wFaces.size(); idx++)
+		{
+			const auto& face			= shape.wFaces[idx];
+			const auto	faceEdgeCount	= (uint16_t)face.GetEdgeCount(shape);
+
+			cage.faces.push_back(HE_Face{ face.edgeStart, cage.vertexCount, faceEdgeCount, (uint16_t)0 });
+			cage.vertexCount += 1 + 2 * faceEdgeCount;
+
+			for (uint32_t i = 0; i < faceEdgeCount; i++)
+				cage.faceLookup.push_back(idx);
+		}
+
+		cage.points.reserve(shape.wVertices.size());
+		for (const auto& point : shape.wVertices)
+		{
+			float xyz[3];
+			memcpy(xyz, &point, sizeof(xyz));
+			cage.points.push_back(float3{ xyz[0], xyz[1], xyz[2] });
+		}
+
+		return cage;
+	}
+
+
+	/************************************************************************************************/
+
+
+	const HE_Level& HalfEdgeCPUMesh::BuildNextLevel(const uint32_t threadCount)
+	{
+		if (levels.size() && levels.size() >= HE_MaxLevelCount(cage.halfEdges.size()))
+			return levels.back();
+
+		levels.emplace_back(*allocator);
+
+		const uint32_t	levelIdx	= (uint32_t)levels.size() - 1;
+		HE_Level&		out			= levels[levelIdx];
+		out.level					= levelIdx;
+
+		if (indexMode == HE_IndexMode::Shared)
+		{
+			if (levelIdx == 0)
+				HE_SubdivideFacesShared(HE_ControlCageView{ cage }, (uint32_t)cage.points.size(), out, *allocator, threadCount);
+			else
+				HE_SubdivideFacesShared(HE_LevelView{ levels[levelIdx - 1] }, (uint32_t)levels[levelIdx - 1].points.size(), out, *allocator, threadCount);
+		}
+		else if (levelIdx == 0)
+			HE_SubdivideFaces(HE_ControlCageView{ cage }, out, threadCount);
+		else
+			HE_SubdivideFaces(HE_LevelView{ levels[levelIdx - 1] }, out, threadCount);
+
+		return out;
+	}
+
+
+	/************************************************************************************************/
+
+
+	HE_SubdivisionBenchmark BenchmarkSubdivision(const HE_ControlCage& cage, iAllocator& allocator, const uint32_t levelCount)
+	{
+		HE_SubdivisionBenchmark results;
+		results.levelCount = Min(levelCount, HE_MaxLevelCount(cage.halfEdges.size()));
+
+		HE_Level uncached	{ allocator };
+		HE_Level cached[]	= { HE_Level{ allocator }, HE_Level{ allocator } }; // Output of each level is the input of the next
+
+		auto Measure = [&](const auto& view, HE_Level& out)
+		{
+			HE_LoadCountingView uncachedView{ view };
+			HE_LoadCountingView cachedView{ view };
+
+			uncached.cage.resize(4 * size_t(view.HalfEdgeCount()));
+			uncached.flags.resize(view.HalfEdgeCount());
+			uncached.points.resize(view.PointCount());
+
+			auto begin = std::chrono::high_resolution_clock::now();
+
+			for (uint32_t faceIdx = 0; faceIdx < view.FaceCount(); faceIdx++)
+			{
+				HE_SubdivideFace(uncachedView, faceIdx,
+					[&](const uint32_t idx) -> HE_TwinEdge&	{ return uncached.cage[idx]; },
+					[&](const uint32_t idx) -> uint8_t&		{ return uncached.flags[idx]; },
+					[&](const uint32_t idx) -> float3&		{ return uncached.points[idx]; });
+			}
+
+			results.uncachedDuration += std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - begin).count();
+			begin = std::chrono::high_resolution_clock::now();
+
+			HE_SubdivideFaces(cachedView, out, 1);
+
+			results.cachedDuration += std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - begin).count();
+
+			results.uncachedPointLoads	+= uncachedView.pointLoads;
+			results.cachedPointLoads	+= cachedView.pointLoads;
+		};
+
+		for (uint32_t levelIdx = 0; levelIdx < results.levelCount; levelIdx++)
+		{
+			HE_Level& out	= cached[levelIdx & 1];
+			out.level		= levelIdx;
+
+			if (levelIdx == 0)
+				Measure(HE_ControlCageView{ cage }, out);
+			else
+				Measure(HE_LevelView{ cached[(levelIdx - 1) & 1] }, out);
+		}
+
+		return results;
+	}
+
+
+	/************************************************************************************************/
+
+
+	uint64_t HE_HashLevel(const HE_Level& level) noexcept
+	{
+		uint64_t hash = 0xcbf29ce484222325ull;
+
+		auto Append = [&](const void* data, const size_t size)
+		{
+			const uint8_t* bytes = static_cast<const uint8_t*>(data);
+
+			for (size_t i = 0; i < size; i++)
+				hash = (hash ^ bytes[i]) * 0x100000001b3ull;
+		};
+
+		Append(level.cage.data(), level.cage.size() * sizeof(HE_TwinEdge));
+		Append(level.flags.data(), level.flags.size());
+
+		// Component by component, float3 may be padded
+		for (const float3& point : level.points)
+		{
+			const float xyz[] = { point.x, point.y, point.z };
+			Append(xyz, sizeof(xyz));
+		}
+
+		return hash;
+	}
+
+
+	/************************************************************************************************/
+
+
+	HE_DeterminismReport CheckDeterminism(const HE_ControlCage& cage, iAllocator& allocator, std::span<const uint32_t> threadCounts, const uint32_t levelCount, const HE_IndexMode indexMode)
+	{
+		HE_DeterminismReport report;
+		report.levelCount = Min(levelCount, HE_MaxLevelCount(cage.halfEdges.size()));
+
+		auto Build = [&](const uint32_t threadCount, auto&& fn)
+		{
+			HE_ControlCage copy{ allocator };
+			copy.halfEdges.resize(cage.halfEdges.size());
+			copy.faces.resize(cage.faces.size());
+			copy.faceLookup.resize(cage.faceLookup.size());
+			copy.points.resize(cage.points.size());
+			copy.vertexCount = cage.vertexCount;
+
+			std::copy(cage.halfEdges.begin(), cage.halfEdges.end(), copy.halfEdges.begin());
+			std::copy(cage.faces.begin(), cage.faces.end(), copy.faces.begin());
+			std::copy(cage.faceLookup.begin(), cage.faceLookup.end(), copy.faceLookup.begin());
+			std::copy(cage.points.begin(), cage.points.end(), copy.points.begin());
+
+			HalfEdgeCPUMesh mesh{ std::move(copy), allocator, indexMode };
+
+			for (uint32_t levelIdx = 0; levelIdx < report.levelCount; levelIdx++)
+				fn(levelIdx, HE_HashLevel(mesh.BuildNextLevel(threadCount)));
+		};
+
+		Build(1, [&](const uint32_t levelIdx, const uint64_t hash) { report.levelHashes[levelIdx] = hash; });
+
+		for (const uint32_t threadCount : threadCounts)
+		{
+			Build(threadCount,
+				[&](const uint32_t levelIdx, const uint64_t hash)
+				{
+					if (hash != report.levelHashes[levelIdx] && levelIdx < report.firstMismatch)
+					{
+						report.firstMismatch	= levelIdx;
+						report.threadCount		= threadCount;
+					}
+				});
+		}
+
+		return report;
+	}
+
+
+}	/************************************************************************************************/
+
+/**********************************************************************
+
+Copyright (c) 2024 Robert May
+
+Permission is hereby granted, free of charge, to any person obtaining a
+copy of this software and associated documentation files (the "Software"),
+to deal in the Software without restriction, including without limitation
+the rights to use, copy, modify, merge, publish, distribute, sublicense,
+and/or sell copies of the Software, and to permit persons to whom the
+Software is furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included
+in all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+**********************************************************************/
@@ -0,0 +1,583 @@
+#include "HalfEdgeCulling.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <numbers>
+#include <vector>
+
+
+namespace FlexKit
+{	/************************************************************************************************/
+
+
+	namespace
+	{
+		float Dot(const float3 a, const float3 b) noexcept
+		{
+			return a.x * b.x + a.y * b.y + a.z * b.z;
+		}
+
+
+		float Length(const float3 v) noexcept
+		{
+			return std::sqrt(Dot(v, v));
+		}
+
+
+		float3 Normalize(const float3 v) noexcept
+		{
+			const float l = Length(v);
+			return l > 0.0f ? v / l : float3{ 0, 0, 0 };
+		}
+
+
+		float AngleBetween(const float3 a, const float3 b) noexcept
+		{
+			return std::acos(std::clamp(Dot(a, b), -1.0f, 1.0f));
+		}
+
+
+		float CutoffFromAngle(const float halfAngle) noexcept
+		{
+			// Past ~85 degrees the sphere test can no longer reject anything useful
+			return halfAngle < std::numbers::pi_v<float> / 2.0f - 0.09f ? std::sin(halfAngle) : 2.0f;
+		}
+
+
+		struct FaceNormal
+		{
+			float3	normal;		// Newell normal, length is twice the area
+			float	spread;		// Max angle between the unit normal and a corner normal
+		};
+
+
+		FaceNormal ComputeFaceNormal(const HE_ControlCageView& view, const uint32_t faceIdx, const float sign)
+		{
+			const HE_Face face = view.GetFace(faceIdx);
+
+			float3 n{ 0, 0, 0 };
+			for (uint32_t i = 0; i < face.edgeCount; i++)
+			{
+				const float3 p0 = view.Point(face.begin + i);
+				const float3 p1 = view.Point(view.Next(face.begin + i));
+
+				n.x += (p0.y - p1.y) * (p0.z + p1.z);
+				n.y += (p0.z - p1.z) * (p0.x + p1.x);
+				n.z += (p0.x - p1.x) * (p0.y + p1.y);
+			}
+
+			n = n * sign;
+
+			const float3	axis	= Normalize(n);
+			float			spread	= 0.0f;
+
+			for (uint32_t i = 0; i < face.edgeCount; i++)
+			{
+				const uint32_t e	= face.begin + i;
+				const float3 p		= view.Point(e);
+				const float3 a		= view.Point(view.Next(e)) - p;
+				const float3 b		= view.Point(view.Prev(e)) - p;
+				const float3 c		= float3{ a.y * b.z - a.z * b.y, a.z * b.x - a.x * b.z, a.x * b.y - a.y * b.x } * sign;
+
+				if (Length(c) > 0.0f)
+					spread = Max(spread, AngleBetween(axis, Normalize(c)));
+			}
+
+			return { n, spread };
+		}
+
+
+		// Faces sharing a vertex with the face, the face itself first, or only the face without oneRing.
+		// Grows with the valence, which is not capped here. False when a rotation runs past every
+		// half-edge of the cage, on broken topology.
+		bool GatherOneRing(const HE_ControlCageView& view, const uint32_t faceIdx, const bool oneRing, std::vector<uint32_t>& out)
+		{
+			const HE_Face	face		= view.GetFace(faceIdx);
+			const uint32_t	maxSteps	= view.HalfEdgeCount();
+			bool			complete	= true;
+
+			out.clear();
+			out.push_back(faceIdx);
+
+			for (uint32_t i = 0; i < face.edgeCount && oneRing; i++)
+			{
+				const uint32_t	edgeID		= face.begin + i;
+				uint32_t		selection	= RotateSelectionCCW(view, edgeID);
+				uint32_t		steps		= 0;
+
+				while (selection != edgeID && selection != HE_BorderValue && steps++ < maxSteps)
+				{
+					out.push_back(view.Face(selection));
+					selection = RotateSelectionCCW(view, selection);
+				}
+
+				if (selection == HE_BorderValue)
+				{
+					selection = RotateSelectionCW(view, edgeID);
+					while (selection != HE_BorderValue && steps++ < maxSteps)
+					{
+						out.push_back(view.Face(selection));
+						selection = RotateSelectionCW(view, selection);
+					}
+				}
+
+				complete &= steps <= maxSteps;
+			}
+
+			return complete;
+		}
+
+
+		// Bounds and cone of the face from its one-ring, normalOf returns the FaceNormal of a ring face
+		template<typename TY_NormalFn>
+		void FitFaceCone(const HE_ControlCage& cage, const HE_ControlCageView& view, const uint32_t faceIdx, const HE_ConeOptions& options, std::vector<uint32_t>& ringFaces, TY_NormalFn&& normalOf, HE_NormalCones& out)
+		{
+			if (!GatherOneRing(view, faceIdx, options.oneRing, ringFaces))
+			{
+				// The one-ring can't be walked, bounds cover the cage and the cone never culls
+				float3 min = cage.points.size() ? cage.points[0] : float3{ 0, 0, 0 };
+				float3 max = min;
+
+				for (const float3& p : cage.points)
+				{
+					min = float3{ Min(min.x, p.x), Min(min.y, p.y), Min(min.z, p.z) };
+					max = float3{ Max(max.x, p.x), Max(max.y, p.y), Max(max.z, p.z) };
+				}
+
+				const float3 center = (min + max) / 2.0f;
+
+				out.bounds[faceIdx]	= HE_PatchBounds{ min, max };
+				out.cones[faceIdx]	= HE_NormalCone{
+					.axis	= float3{ 0, 0, 0 },
+					.cutoff	= 2.0f,
+					.center	= center,
+					.radius	= Length(max - center),
+				};
+
+				return;
+			}
+
+			const HE_Face face = view.GetFace(faceIdx);
+
+			float3 n{ 0, 0, 0 };
+			float3 min = view.Point(face.begin);
+			float3 max = min;
+
+			for (const uint32_t ringFaceIdx : ringFaces)
+			{
+				const HE_Face ringFace = view.GetFace(ringFaceIdx);
+				n += normalOf(ringFaceIdx).normal;
+
+				for (uint32_t i = 0; i < ringFace.edgeCount; i++)
+				{
+					const float3 p = view.Point(ringFace.begin + i);
+					min = float3{ Min(min.x, p.x), Min(min.y, p.y), Min(min.z, p.z) };
+					max = float3{ Max(max.x, p.x), Max(max.y, p.y), Max(max.z, p.z) };
+				}
+			}
+
+			const float3	axis	= Normalize(n);
+			float			spread	= 0.0f;
+
+			for (const uint32_t ringFaceIdx : ringFaces)
+			{
+				const FaceNormal fn = normalOf(ringFaceIdx);
+				spread = Max(spread, AngleBetween(axis, Normalize(fn.normal)) + fn.spread);
+			}
+
+			// The limit patch stays inside the convex hull of its one-ring
+			const float3	center = (min + max) / 2.0f;
+			float			radius = 0.0f;
+
+			for (const uint32_t ringFaceIdx : ringFaces)
+			{
+				const HE_Face ringFace = view.GetFace(ringFaceIdx);
+				for (uint32_t i = 0; i < ringFace.edgeCount; i++)
+					radius = Max(radius, Length(view.Point(ringFace.begin + i) - center));
+			}
+
+			out.bounds[faceIdx]	= HE_PatchBounds{ min, max };
+			out.cones[faceIdx]	= HE_NormalCone{
+				.axis	= axis,
+				.cutoff	= Length(axis) > 0.0f ? CutoffFromAngle(spread + options.padding) : 2.0f,
+				.center	= center,
+				.radius	= radius,
+			};
+		}
+
+
+		void FitClusterCone(HE_NormalCones& out, const uint32_t clusterIdx)
+		{
+			const uint32_t begin	= clusterIdx * out.clusterSize;
+			const uint32_t end		= Min(begin + out.clusterSize, out.faceCount);
+
+			float3 n{ 0, 0, 0 };
+			float3 min = out.cones[begin].center;
+			float3 max = min;
+			bool   open = false;
+
+			for (uint32_t f = begin; f < end; f++)
+			{
+				const HE_NormalCone& cone = out.cones[f];
+				n	+= cone.axis;
+				open = open || cone.cutoff > 1.0f;
+				min	 = float3{ Min(min.x, cone.center.x - cone.radius), Min(min.y, cone.center.y - cone.radius), Min(min.z, cone.center.z - cone.radius) };
+				max	 = float3{ Max(max.x, cone.center.x + cone.radius), Max(max.y, cone.center.y + cone.radius), Max(max.z, cone.center.z + cone.radius) };
+			}
+
+			const float3	axis	= Normalize(n);
+			const float3	center	= (min + max) / 2.0f;
+			float			spread	= 0.0f;
+			float			radius	= 0.0f;
+
+			for (uint32_t f = begin; f < end; f++)
+			{
+				const HE_NormalCone& cone = out.cones[f];
+				spread = Max(spread, AngleBetween(axis, cone.axis) + std::asin(Min(cone.cutoff, 1.0f)));
+				radius = Max(radius, Length(cone.center - center) + cone.radius);
+			}
+
+			out.cones[out.faceCount + clusterIdx] = HE_NormalCone{
+				.axis	= axis,
+				.cutoff	= (open || Length(axis) == 0.0f) ? 2.0f : CutoffFromAngle(spread),
+				.center	= center,
+				.radius	= radius,
+			};
+		}
+	}
+
+
+	/************************************************************************************************/
+
+
+	HE_NormalCones BuildNormalCones(const HE_ControlCage& cage, iAllocator& allocator, const HE_ConeOptions& options)
+	{
+		const HE_ControlCageView view{ cage };
+
+		const uint32_t faceCount	= view.FaceCount();
+		const uint32_t clusterSize	= Max(options.clusterSize, 1u);
+		const float    sign			= options.clockwise ? -1.0f : 1.0f;
+
+		HE_NormalCones out{ allocator };
+		out.faceCount		= faceCount;
+		out.clusterSize		= clusterSize;
+		out.clusterCount	= faceCount / clusterSize + (faceCount % clusterSize == 0 ? 0 : 1);
+		out.cones.resize(faceCount + out.clusterCount);
+		out.bounds.resize(faceCount);
+
+		Vector<FaceNormal> faceNormals{ allocator };
+		faceNormals.resize(faceCount);
+
+		HE_ParallelFor(faceCount,
+			[&](const uint32_t begin, const uint32_t end)
+			{
+				for (uint32_t faceIdx = begin; faceIdx < end; faceIdx++)
+					faceNormals[faceIdx] = ComputeFaceNormal(view, faceIdx, sign);
+			}, 0, 256);
+
+		HE_ParallelFor(faceCount,
+			[&](const uint32_t begin, const uint32_t end)
+			{
+				std::vector<uint32_t> ringFaces;
+				ringFaces.reserve(HE_MaxValence * HE_MaxValence);
+
+				for (uint32_t faceIdx = begin; faceIdx < end; faceIdx++)
+					FitFaceCone(cage, view, faceIdx, options, ringFaces, [&](const uint32_t f) { return faceNormals[f]; }, out);
+			}, 0, 256);
+
+		for (uint32_t clusterIdx = 0; clusterIdx < out.clusterCount; clusterIdx++)
+			FitClusterCone(out, clusterIdx);
+
+		return out;
+	}
+
+
+	/************************************************************************************************/
+
+
+	void BuildVertexEdges(const HE_ControlCage& cage, Vector<uint32_t>& out)
+	{
+		out.resize(cage.points.size());
+		std::fill(out.begin(), out.end(), HE_BorderValue);
+
+		for (uint32_t e = 0; e < cage.halfEdges.size(); e++)
+		{
+			if (cage.halfEdges[e].vert < out.size())
+				out[cage.halfEdges[e].vert] = e;
+		}
+	}
+
+
+	void RefitNormalCones(
+		const HE_ControlCage&		cage,
+		std::span<const uint32_t>	vertexEdges,
+		std::span<const uint32_t>	movedVertices,
+		HE_NormalCones&				cones,
+		Vector<uint32_t>&			outDirtyCones,
+		const HE_ConeOptions&		options)
+	{
+		const HE_ControlCageView	view{ cage };
+		const float					sign		= options.clockwise ? -1.0f : 1.0f;
+		const uint32_t				maxSteps	= view.HalfEdgeCount();
+
+		// Faces around the moved vertices, their normals changed
+		std::vector<uint32_t> around;
+
+		for (const uint32_t vertex : movedVertices)
+		{
+			const uint32_t edgeID = vertex < vertexEdges.size() ? vertexEdges[vertex] : HE_BorderValue;
+			if (edgeID == HE_BorderValue)
+				continue;
+
+			around.push_back(view.Face(edgeID));
+
+			uint32_t selection	= RotateSelectionCCW(view, edgeID);
+			uint32_t steps		= 0;
+
+			while (selection != edgeID && selection != HE_BorderValue && steps++ < maxSteps)
+			{
+				around.push_back(view.Face(selection));
+				selection = RotateSelectionCCW(view, selection);
+			}
+
+			if (selection == HE_BorderValue)
+			{
+				selection = RotateSelectionCW(view, edgeID);
+				while (selection != HE_BorderValue && steps++ < maxSteps)
+				{
+					around.push_back(view.Face(selection));
+					selection = RotateSelectionCW(view, selection);
+				}
+			}
+		}
+
+		std::sort(around.begin(), around.end());
+		around.erase(std::unique(around.begin(), around.end()), around.end());
+
+		// Every face with one of those in its one-ring, the one-ring relation is symmetric
+		std::vector<uint32_t> faces;
+		std::vector<uint32_t> ringFaces;
+
+		for (const uint32_t faceIdx : around)
+		{
+			GatherOneRing(view, faceIdx, options.oneRing, ringFaces);
+			faces.insert(faces.end(), ringFaces.begin(), ringFaces.end());
+		}
+
+		std::sort(faces.begin(), faces.end());
+		faces.erase(std::unique(faces.begin(), faces.end()), faces.end());
+
+		for (const uint32_t faceIdx : faces)
+		{
+			FitFaceCone(cage, view, faceIdx, options, ringFaces, [&](const uint32_t f) { return ComputeFaceNormal(view, f, sign); }, cones);
+			outDirtyCones.push_back(faceIdx);
+		}
+
+		// Faces are sorted, each cluster comes up in one run
+		for (size_t I = 0; I < faces.size(); I++)
+		{
+			const uint32_t clusterIdx = faces[I] / cones.clusterSize;
+			if (I && faces[I - 1] / cones.clusterSize == clusterIdx)
+				continue;
+
+			FitClusterCone(cones, clusterIdx);
+			outDirtyCones.push_back(cones.faceCount + clusterIdx);
+		}
+	}
+
+
+	/************************************************************************************************/
+
+
+	HE_CullStats CullControlFaces(
+		const HE_ControlCage&	cage,
+		const HE_NormalCones&	cones,
+		const Frustum&			frustum,
+		const float3			cameraPosition,
+		Vector<uint32_t>&		outVisibleFaces,
+		const bool				coneCulling)
+	{
+		const HE_ControlCageView view{ cage };
+
+		HE_CullStats stats;
+		stats.faceCount = view.FaceCount();
+
+		for (uint32_t faceIdx = 0; faceIdx < stats.faceCount; faceIdx++)
+		{
+			const HE_PatchBounds& bounds = cones.Bounds(faceIdx);
+
+			if (!HE_Intersects(frustum, bounds.min, bounds.max))
+				stats.frustumCulled++;
+			else if (coneCulling && IsBackFacing(cones.Cluster(faceIdx), cameraPosition))
+				stats.clusterConeCulled++;
+			else if (coneCulling && IsBackFacing(cones.Face(faceIdx), cameraPosition))
+				stats.faceConeCulled++;
+			else
+			{
+				stats.visible++;
+				outVisibleFaces.push_back(faceIdx);
+			}
+		}
+
+		return stats;
+	}
+
+
+	/************************************************************************************************/
+
+
+	void HE_PatchHierarchy::Build(const HalfEdgeCPUMesh& mesh, const uint32_t threadCount)
+	{
+		levelCount = Min(mesh.LevelCount(), HE_MaxLevels);
+
+		for (uint32_t levelIdx = 0; levelIdx < levelCount; levelIdx++)
+			boundsOffset[levelIdx + 1] = boundsOffset[levelIdx] + mesh.GetLevel(levelIdx).PatchCount();
+
+		bounds.resize(boundsOffset[levelCount]);
+
+		for (uint32_t levelIdx = 0; levelIdx < levelCount; levelIdx++)
+		{
+			const HE_LevelView		view{ mesh.GetLevel(levelIdx) };
+			HE_PatchBounds* const	out = bounds.data() + boundsOffset[levelIdx];
+
+			HE_ParallelFor(view.FaceCount(),
+				[&](const uint32_t begin, const uint32_t end)
+				{
+					for (uint32_t patchIdx = begin; patchIdx < end; patchIdx++)
+						out[patchIdx] = HE_OneRingBounds(view, patchIdx);
+				}, threadCount, 1024);
+		}
+	}
+
+
+	HE_HierarchyCullStats HE_PatchHierarchy::Cull(const HE_ControlCage& cage, std::span<const uint32_t> visibleFaces, const Frustum& frustum)
+	{
+		HE_HierarchyCullStats stats;
+		stats.levelCount = levelCount;
+
+		visible.clear();
+
+		for (uint32_t levelIdx = 0; levelIdx < levelCount; levelIdx++)
+		{
+			const std::span<const HE_PatchBounds> levelBounds = LevelBounds(levelIdx);
+
+			auto Test = [&](const uint32_t patchIdx)
+			{
+				stats.tested[levelIdx]++;
+
+				if (HE_Intersects(frustum, levelBounds[patchIdx].min, levelBounds[patchIdx].max))
+				{
+					stats.visible[levelIdx]++;
+					visible.push_back(patchIdx);
+				}
+			};
+
+			if (levelIdx == 0)
+			{
+				for (const uint32_t faceIdx : visibleFaces)
+				{
+					const HE_Face face = cage.faces[faceIdx];
+
+					for (uint32_t i = 0; i < face.edgeCount; i++)
+						Test(face.begin + i);
+				}
+			}
+			else
+			{
+				// Indexed, visible grows while the parents are read
+				for (uint64_t itr = visibleOffset[levelIdx - 1]; itr < visibleOffset[levelIdx]; itr++)
+				{
+					const uint32_t parent = visible[itr];
+
+					for (uint32_t child = 0; child < 4; child++)
+						Test(4 * parent + child);
+				}
+			}
+
+			visibleOffset[levelIdx + 1]	= visible.size();
+			stats.denseTests			+= levelBounds.size();
+		}
+
+		return stats;
+	}
+
+
+	/************************************************************************************************/
+
+
+	HE_BoundsReport CheckPatchBounds(
+		const HalfEdgeCPUMesh&		mesh,
+		const HE_NormalCones&		cones,
+		const HE_PatchHierarchy&	hierarchy,
+		const float					tolerance)
+	{
+		HE_BoundsReport report;
+
+		auto Check = [&](const HE_PatchBounds& bounds, const float3 p)
+		{
+			const float3	extent	= bounds.max - bounds.min;
+			const float		allowed	= tolerance * Max(extent.x, Max(extent.y, extent.z));
+			const float		excess	= Max(
+				Max(Max(bounds.min.x - p.x, p.x - bounds.max.x), Max(bounds.min.y - p.y, p.y - bounds.max.y)),
+				Max(bounds.min.z - p.z, p.z - bounds.max.z));
+
+			if (excess > allowed)
+			{
+				report.outside++;
+				report.maxExcess = Max(report.maxExcess, excess);
+			}
+		};
+
+		for (uint32_t levelIdx = 0; levelIdx < hierarchy.LevelCount(); levelIdx++)
+		{
+			const HE_Level& level = mesh.GetLevel(levelIdx);
+
+			for (uint32_t patchIdx = 0; patchIdx < level.PatchCount(); patchIdx++)
+			{
+				for (uint32_t i = 0; i < 4; i++)
+				{
+					const float3	p			= level.points[level.cage[4 * patchIdx + i].vert];
+					uint32_t		ancestor	= patchIdx;
+
+					report.pointsChecked++;
+
+					for (uint32_t ancestorLevel = levelIdx; ancestorLevel-- > 0;)
+					{
+						ancestor >>= 2;
+						Check(hierarchy.LevelBounds(ancestorLevel)[ancestor], p);
+					}
+
+					Check(cones.Bounds(mesh.cage.faceLookup[ancestor]), p);
+				}
+			}
+		}
+
+		return report;
+	}
+
+
+}	/************************************************************************************************/
+
+/**********************************************************************
+
+Copyright (c) 2024 Robert May
+
+Permission is hereby granted, free of charge, to any person obtaining a
+copy of this software and associated documentation files (the "Software"),
+to deal in the Software without restriction, including without limitation
+the rights to use, copy, modify, merge, publish, distribute, sublicense,
+and/or sell copies of the Software, and to permit persons to whom the
+Software is furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included
+in all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+**********************************************************************/
@@ -0,0 +1,580 @@
+#include "HalfEdgeEditing.hpp"
+
+#include <algorithm>
+#include <cstring>
+
+
+namespace FlexKit
+{	/************************************************************************************************/
+
+
+	HE_CageEditor::HE_CageEditor(HE_ControlCage& IN_cage, iAllocator& allocator) :
+		dirtyHalfEdges	{ allocator },
+		dirtyFaces		{ allocator },
+		dirtyFaceLookup	{ allocator },
+		dirtyPoints		{ allocator },
+		cage			{ &IN_cage }
+	{
+		outgoing.resize(cage->points.size());
+
+		for (uint32_t faceIdx = 0; faceIdx < cage->faces.size(); faceIdx++)
+		{
+			const HE_Face& face = cage->faces[faceIdx];
+
+			if (face.IsFree())
+			{
+				freeSlots[face.edgeCount].push_back(faceIdx);
+				continue;
+			}
+
+			for (uint32_t i = 0; i < face.edgeCount; i++)
+			{
+				const uint32_t	e		= face.begin + i;
+				const HEEdge&	edge	= cage->halfEdges[e];
+
+				edges[EdgeKey(edge.vert, cage->halfEdges[edge.next].vert)] = e;
+				outgoing[edge.vert].push_back(e);
+			}
+
+			liveFaces++;
+		}
+	}
+
+
+	/************************************************************************************************/
+
+
+	uint32_t HE_CageEditor::AddVertex(const float3 point)
+	{
+		const uint32_t vertex = (uint32_t)cage->points.size();
+
+		cage->points.push_back(point);
+		outgoing.emplace_back();
+		dirtyPoints.Mark(vertex, 1);
+
+		return vertex;
+	}
+
+
+	void HE_CageEditor::MoveVertex(const uint32_t vertex, const float3 point)
+	{
+		cage->points[vertex] = point;
+		dirtyPoints.Mark(vertex, 1);
+	}
+
+
+	/************************************************************************************************/
+
+
+	uint32_t HE_CageEditor::AddFace(std::span<const uint32_t> vertices)
+	{
+		const Loop	loop{ vertices.begin(), vertices.end() };
+		uint32_t	face = HE_InvalidFace;
+
+		ReplaceFaces({}, { &loop, 1 }, &face);
+
+		return face;
+	}
+
+
+	bool HE_CageEditor::DeleteFace(const uint32_t face)
+	{
+		if (face >= cage->faces.size() || cage->faces[face].IsFree())
+			return false;
+
+		return ReplaceFaces({ &face, 1 }, {});
+	}
+
+
+	/************************************************************************************************/
+
+
+	uint32_t HE_CageEditor::SplitEdge(const uint32_t halfEdge, const float3 point)
+	{
+		if (halfEdge >= cage->halfEdges.size() || cage->faces[cage->faceLookup[halfEdge]].IsFree())
+			return HE_InvalidVertex;
+
+		const HEEdge&	edge		= cage->halfEdges[halfEdge];
+		const uint32_t	twin		= edge.Twin();
+		const uint32_t	removed[]	= { cage->faceLookup[halfEdge], twin != HE_BorderValue ? cage->faceLookup[twin] : HE_InvalidFace };
+		const uint32_t	faceCount	= twin != HE_BorderValue ? 2 : 1;
+
+		for (uint32_t i = 0; i < faceCount; i++)
+		{
+			if (cage->faces[removed[i]].edgeCount >= HE_MaxValence)
+			{
+				stats.rejected++;
+				return HE_InvalidVertex;
+			}
+		}
+
+		// The new vertex goes after the half-edge's origin in its face and after the far end in the twin's
+		const uint32_t	inserted[]	= { halfEdge, twin };
+		const uint32_t	vertex		= AddVertex(point);
+		Loop			loops[2];
+
+		for (uint32_t i = 0; i < faceCount; i++)
+		{
+			const HE_Face& face = cage->faces[removed[i]];
+
+			FaceVertices(removed[i], loops[i]);
+			loops[i].insert(loops[i].begin() + (inserted[i] - face.begin) + 1, vertex);
+		}
+
+		if (!ReplaceFaces({ removed, faceCount }, { loops, faceCount }))
+			return HE_InvalidVertex;
+
+		return vertex;
+	}
+
+
+	/************************************************************************************************/
+
+
+	uint32_t HE_CageEditor::CollapseEdge(const uint32_t halfEdge)
+	{
+		if (halfEdge >= cage->halfEdges.size() || cage->faces[cage->faceLookup[halfEdge]].IsFree())
+			return HE_InvalidVertex;
+
+		const uint32_t kept		= cage->halfEdges[halfEdge].vert;
+		const uint32_t merged	= cage->halfEdges[cage->halfEdges[halfEdge].next].vert;
+
+		// Every face around the merged vertex is rewritten, faces on the edge lose a side
+		std::vector<uint32_t>	removed;
+		std::vector<Loop>		loops;
+		Loop					vertices;
+
+		for (const uint32_t e : outgoing[merged])
+		{
+			const uint32_t face = cage->faceLookup[e];
+			if (std::find(removed.begin(), removed.end(), face) == removed.end())
+				removed.push_back(face);
+		}
+
+		for (const uint32_t face : removed)
+		{
+			FaceVertices(face, vertices);
+
+			Loop loop;
+			for (const uint32_t vertex : vertices)
+			{
+				const uint32_t remapped = vertex == merged ? kept : vertex;
+				if (loop.empty() || loop.back() != remapped)
+					loop.push_back(remapped);
+			}
+
+			if (loop.size() > 1 && loop.front() == loop.back())
+				loop.pop_back();
+
+			if (loop.size() >= 3)
+				loops.push_back(std::move(loop));
+		}
+
+		if (!ReplaceFaces(removed, loops))
+			return HE_InvalidVertex;
+
+		MoveVertex(kept, (cage->points[kept] + cage->points[merged]) * 0.5f);
+
+		return kept;
+	}
+
+
+	/************************************************************************************************/
+
+
+	void HE_CageEditor::ClearDirty() noexcept
+	{
+		dirtyHalfEdges.Clear();
+		dirtyFaces.Clear();
+		dirtyFaceLookup.Clear();
+		dirtyPoints.Clear();
+	}
+
+
+	/************************************************************************************************/
+
+
+	bool HE_CageEditor::ReplaceFaces(std::span<const uint32_t> removed, std::span<const Loop> loops, uint32_t* firstAdded)
+	{
+		std::vector<Loop>		previous(removed.size());
+		std::vector<uint32_t>	added;
+
+		for (size_t i = 0; i < removed.size(); i++)
+		{
+			FaceVertices(removed[i], previous[i]);
+			RemoveFace(removed[i]);
+		}
+
+		bool valid = true;
+
+		for (const Loop& loop : loops)
+		{
+			if (!CanInsert(loop))
+			{
+				valid = false;
+				break;
+			}
+
+			added.push_back(InsertFace(loop));
+		}
+
+		// Fans can only change around the vertices of the faces written
+		for (size_t i = 0; valid && i < loops.size(); i++)
+			valid = std::all_of(loops[i].begin(), loops[i].end(), [&](const uint32_t v) { return IsManifold(v); });
+
+		for (size_t i = 0; valid && i < previous.size(); i++)
+			valid = std::all_of(previous[i].begin(), previous[i].end(), [&](const uint32_t v) { return IsManifold(v); });
+
+		if (!valid)
+		{
+			// Restores the topology, the faces may come back in other slots
+			for (auto itr = added.rbegin(); itr != added.rend(); itr++)
+				RemoveFace(*itr);
+
+			for (auto itr = previous.rbegin(); itr != previous.rend(); itr++)
+				InsertFace(*itr);
+
+			stats.rejected++;
+
+			return false;
+		}
+
+		if (firstAdded && added.size())
+			*firstAdded = added.front();
+
+		return true;
+	}
+
+
+	/************************************************************************************************/
+
+
+	uint32_t HE_CageEditor::InsertFace(std::span<const uint32_t> vertices)
+	{
+		const uint32_t edgeCount = (uint32_t)vertices.size();
+
+		uint32_t faceIdx;
+		if (freeSlots[edgeCount].size())
+		{
+			faceIdx = freeSlots[edgeCount].back();
+			freeSlots[edgeCount].pop_back();
+
+			cage->faces[faceIdx].level = 0;
+			stats.slotsReused++;
+		}
+		else
+		{
+			faceIdx = (uint32_t)cage->faces.size();
+
+			const HE_Face face{ (uint32_t)cage->halfEdges.size(), cage->vertexCount, (uint16_t)edgeCount, 0 };
+			cage->faces.push_back(face);
+			cage->vertexCount += face.GetVertexCount();
+			cage->halfEdges.resize(face.begin + edgeCount);
+
+			for (uint32_t i = 0; i < edgeCount; i++)
+				cage->faceLookup.push_back(faceIdx);
+
+			dirtyFaceLookup.Mark(face.begin, edgeCount);
+		}
+
+		const uint32_t begin = cage->faces[faceIdx].begin;
+
+		for (uint32_t i = 0; i < edgeCount; i++)
+		{
+			const uint32_t e	= begin + i;
+			const uint32_t from	= vertices[i];
+			const uint32_t to	= vertices[(i + 1) % edgeCount];
+			const uint32_t twin	= FindEdge(to, from);
+
+			cage->halfEdges[e] = HEEdge{
+				.twin	= twin,
+				.next	= begin + (i + 1) % edgeCount,
+				.prev	= begin + (i + edgeCount - 1) % edgeCount,
+				.vert	= from,
+				.flags	= 0,
+			};
+
+			if (twin != HE_BorderValue)
+			{
+				cage->halfEdges[twin].twin = e;
+				dirtyHalfEdges.Mark(twin, 1);
+			}
+
+			edges[EdgeKey(from, to)] = e;
+			outgoing[from].push_back(e);
+		}
+
+		dirtyHalfEdges.Mark(begin, edgeCount);
+		dirtyFaces.Mark(faceIdx, 1);
+
+		for (const uint32_t vertex : vertices)
+			RefreshFlags(vertex);
+
+		liveFaces++;
+		stats.facesAdded++;
+
+		return faceIdx;
+	}
+
+
+	/************************************************************************************************/
+
+
+	void HE_CageEditor::RemoveFace(const uint32_t faceIdx)
+	{
+		HE_Face&	face = cage->faces[faceIdx];
+		Loop		vertices;
+
+		FaceVertices(faceIdx, vertices);
+
+		for (uint32_t i = 0; i < face.edgeCount; i++)
+		{
+			const uint32_t	e		= face.begin + i;
+			const uint32_t	twin	= cage->halfEdges[e].Twin();
+			auto&			fan		= outgoing[vertices[i]];
+
+			edges.erase(EdgeKey(vertices[i], vertices[(i + 1) % face.edgeCount]));
+			fan.erase(std::find(fan.begin(), fan.end(), e));
+
+			if (twin != HE_BorderValue)
+			{
+				cage->halfEdges[twin].twin = HE_BorderValue;
+				dirtyHalfEdges.Mark(twin, 1);
+			}
+		}
+
+		// Left as a closed loop of border edges on one vertex, the slot's patches collapse to a point
+		for (uint32_t i = 0; i < face.edgeCount; i++)
+		{
+			cage->halfEdges[face.begin + i] = HEEdge{
+				.twin	= HE_BorderValue,
+				.next	= face.begin + (i + 1) % face.edgeCount,
+				.prev	= face.begin + (i + face.edgeCount - 1) % face.edgeCount,
+				.vert	= vertices[0],
+				.flags	= 0,
+			};
+		}
+
+		face.level = HE_FreeFace;
+		freeSlots[face.edgeCount].push_back(faceIdx);
+
+		dirtyHalfEdges.Mark(face.begin, face.edgeCount);
+		dirtyFaces.Mark(faceIdx, 1);
+
+		for (const uint32_t vertex : vertices)
+			RefreshFlags(vertex);
+
+		liveFaces--;
+		stats.facesDeleted++;
+	}
+
+
+	/************************************************************************************************/
+
+
+	bool HE_CageEditor::CanInsert(std::span<const uint32_t> vertices) const
+	{
+		const uint32_t edgeCount = (uint32_t)vertices.size();
+
+		if (edgeCount < 3 || edgeCount > HE_MaxValence)
+			return false;
+
+		for (uint32_t i = 0; i < edgeCount; i++)
+		{
+			if (vertices[i] >= outgoing.size() || std::find(vertices.begin(), vertices.begin() + i, vertices[i]) != vertices.begin() + i)
+				return false;
+
+			if (FindEdge(vertices[i], vertices[(i + 1) % edgeCount]) != HE_BorderValue)
+				return false;
+		}
+
+		return true;
+	}
+
+
+	// Walks the fan the way ValidateControlCage does, every outgoing half-edge must be reached
+	bool HE_CageEditor::IsManifold(const uint32_t vertex) const
+	{
+		const auto&		fan		= outgoing[vertex];
+		const uint32_t	count	= (uint32_t)fan.size();
+
+		if (count == 0)
+			return true;
+
+		if (count > HE_MaxValence)
+			return false;
+
+		const auto& halfEdges = cage->halfEdges;
+
+		auto CCW = [&](const uint32_t e) { return halfEdges[e].Border() ? HE_BorderValue : halfEdges[halfEdges[e].twin].next; };
+		auto CW  = [&](const uint32_t e) { return halfEdges[halfEdges[e].prev].Twin(); };
+
+		uint32_t	reached		= 1;
+		uint32_t	selection	= CCW(fan[0]);
+
+		while (selection != fan[0] && selection != HE_BorderValue && reached <= count)
+		{
+			reached++;
+			selection = CCW(selection);
+		}
+
+		if (selection == HE_BorderValue)
+		{
+			selection = CW(fan[0]);
+			while (selection != HE_BorderValue && selection != fan[0] && reached <= count)
+			{
+				reached++;
+				selection = CW(selection);
+			}
+		}
+
+		return reached == count;
+	}
+
+
+	/************************************************************************************************/
+
+
+	uint32_t HE_CageEditor::FindEdge(const uint32_t from, const uint32_t to) const noexcept
+	{
+		const auto itr = edges.find(EdgeKey(from, to));
+		return itr != edges.end() ? itr->second : HE_BorderValue;
+	}
+
+
+	void HE_CageEditor::FaceVertices(const uint32_t faceIdx, Loop& out) const
+	{
+		const HE_Face& face = cage->faces[faceIdx];
+
+		out.clear();
+		for (uint32_t i = 0; i < face.edgeCount; i++)
+			out.push_back(cage->halfEdges[face.begin + i].vert);
+	}
+
+
+	// Flags follow ValidateControlCage: T on border vertices, corner where a border vertex has one face
+	void HE_CageEditor::RefreshFlags(const uint32_t vertex)
+	{
+		const auto& halfEdges	= cage->halfEdges;
+		const auto& fan			= outgoing[vertex];
+
+		const bool border = std::any_of(fan.begin(), fan.end(),
+			[&](const uint32_t e) { return halfEdges[e].Border() || halfEdges[halfEdges[e].prev].Border(); });
+
+		const uint32_t flags =
+			(fan.size() + (border ? 1 : 0) == 2 ? HE_CornerFlag : 0) |
+			(border ? HE_TFlag : 0);
+
+		for (const uint32_t e : fan)
+		{
+			if (cage->halfEdges[e].flags != flags)
+			{
+				cage->halfEdges[e].flags = flags;
+				dirtyHalfEdges.Mark(e, 1);
+			}
+		}
+	}
+
+
+	/************************************************************************************************/
+
+
+	HE_RebuildReport CompareWithRebuild(const HE_ControlCage& edited, iAllocator& allocator)
+	{
+		HE_RebuildReport report;
+
+		ModifiableShape shape;
+		for (const float3& point : edited.points)
+			shape.AddVertex(point);
+
+		std::vector<uint32_t> slots;								// Edited slot of each rebuilt face
+		std::vector<uint32_t> ordinal(edited.faces.size(), HE_InvalidFace);	// Rebuilt face of each edited slot
+		std::vector<uint32_t> vertices;
+
+		for (uint32_t faceIdx = 0; faceIdx < edited.faces.size(); faceIdx++)
+		{
+			const HE_Face& face = edited.faces[faceIdx];
+			if (face.IsFree())
+				continue;
+
+			vertices.clear();
+			for (uint32_t i = 0; i < face.edgeCount; i++)
+				vertices.push_back(edited.halfEdges[face.begin + i].vert);
+
+			ordinal[faceIdx] = (uint32_t)slots.size();
+			slots.push_back(faceIdx);
+			shape.AddPolygon(vertices.data(), vertices.data() + vertices.size());
+		}
+
+		const HE_ControlCage rebuilt = BuildControlCage(shape, allocator);
+
+		HE_Level editedLevel	{ allocator };
+		HE_Level rebuiltLevel	{ allocator };
+		HE_SubdivideFaces(HE_ControlCageView{ edited }, editedLevel);
+		HE_SubdivideFaces(HE_ControlCageView{ rebuilt }, rebuiltLevel);
+
+		report.faceCount = (uint32_t)slots.size();
+
+		for (uint32_t faceIdx = 0; faceIdx < slots.size(); faceIdx++)
+		{
+			const HE_Face& lhs = edited.faces[slots[faceIdx]];
+			const HE_Face& rhs = rebuilt.faces[faceIdx];
+
+			bool equal = lhs.edgeCount == rhs.edgeCount;
+
+			for (uint32_t i = 0; equal && i < lhs.edgeCount; i++)
+			{
+				const HEEdge& a = edited.halfEdges[lhs.begin + i];
+				const HEEdge& b = rebuilt.halfEdges[rhs.begin + i];
+
+				const uint32_t expectedTwin = a.Border() ?
+					HE_BorderValue :
+					rebuilt.faces[ordinal[edited.faceLookup[a.twin]]].begin + a.twin - edited.faces[edited.faceLookup[a.twin]].begin;
+
+				equal = a.vert == b.vert && a.flags == b.flags && b.twin == expectedTwin &&
+					editedLevel.flags[lhs.begin + i] == rebuiltLevel.flags[rhs.begin + i];
+			}
+
+			equal = equal && !memcmp(
+				editedLevel.points.data() + lhs.vertexRange,
+				rebuiltLevel.points.data() + rhs.vertexRange,
+				lhs.GetVertexCount() * sizeof(float3));
+
+			if (!equal)
+			{
+				if (!report.mismatches)
+					report.firstMismatch = slots[faceIdx];
+
+				report.mismatches++;
+			}
+		}
+
+		return report;
+	}
+
+
+}	/************************************************************************************************/
+
+/**********************************************************************
+
+Copyright (c) 2024 Robert May
+
+Permission is hereby granted, free of charge, to any person obtaining a
+copy of this software and associated documentation files (the "Software"),
+to deal in the Software without restriction, including without limitation
+the rights to use, copy, modify, merge, publish, distribute, sublicense,
+and/or sell copies of the Software, and to permit persons to whom the
+Software is furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included
+in all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+**********************************************************************/
@@ -0,0 +1,297 @@
+#include "HalfEdgeFaceCache.hpp"
+
+#include <algorithm>
+#include <chrono>
+
+
+namespace FlexKit
+{	/************************************************************************************************/
+
+
+	HE_FaceEvaluator::HE_FaceEvaluator(const HE_ControlCage& IN_cage, iAllocator& IN_allocator, const HE_FaceCacheOptions& options) :
+		cage		{ &IN_cage },
+		allocator	{ &IN_allocator },
+		shardBudget	{ options.budgetBytes / Max(options.shardCount, 1u) },
+		maxLevel	{ Max(HE_MaxLevelCount(IN_cage.halfEdges.size()), 1u) - 1 },
+		shards		{ std::make_unique<Shard[]>(Max(options.shardCount, 1u)) },
+		shardCount	{ Max(options.shardCount, 1u) } {}
+
+
+	/************************************************************************************************/
+
+
+	std::shared_ptr<const HE_Level> HE_FaceEvaluator::EvaluateFace(const uint32_t face, const uint32_t level)
+	{
+		if (face >= cage->faces.size())
+			return nullptr;
+
+		const uint32_t clamped	= Min(level, maxLevel);
+		const uint64_t key		= (uint64_t(version.load()) << 36) | (uint64_t(clamped) << 32) | face;	// Versions wrap after 2^28 edits
+		Shard&			shard	= shards[face % shardCount];
+
+		{
+			std::scoped_lock lock{ shard.lock };
+
+			if (auto itr = shard.lookup.find(key); itr != shard.lookup.end())
+			{
+				shard.lru.splice(shard.lru.begin(), shard.lru, itr->second);
+				hits++;
+
+				return itr->second->level;
+			}
+		}
+
+		misses++;
+
+		// Evaluated outside the lock, a face missed by two threads at once is evaluated twice and the
+		// first result inserted is kept
+		const auto						begin		= std::chrono::high_resolution_clock::now();
+		std::shared_ptr<const HE_Level>	result		= Evaluate(face, clamped);
+		const double					duration	= std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - begin).count();
+		const uint64_t					bytes		= sizeof(HE_Level) + result->cage.ByteSize() + result->flags.ByteSize() + result->points.ByteSize();
+
+		std::scoped_lock lock{ shard.lock };
+
+		shard.evaluateTime += duration;
+
+		if (auto itr = shard.lookup.find(key); itr != shard.lookup.end())
+			return itr->second->level;
+
+		shard.lru.push_front(Entry{ key, result, bytes });
+		shard.lookup[key]	= shard.lru.begin();
+		shard.bytes			+= bytes;
+
+		while (shard.bytes > shardBudget && shard.lru.size() > 1)
+		{
+			shard.bytes -= shard.lru.back().bytes;
+			shard.lookup.erase(shard.lru.back().key);
+			shard.lru.pop_back();
+			shard.evictions++;
+		}
+
+		return result;
+	}
+
+
+	/************************************************************************************************/
+
+
+	std::shared_ptr<const HE_Level> HE_FaceEvaluator::Evaluate(const uint32_t faceIdx, const uint32_t level) const
+	{
+		const HE_ControlCageView	view{ *cage };
+		const uint32_t				halfEdgeCount = view.HalfEdgeCount();
+
+		// Faces sharing a vertex with the face, rotating both ways so borders are walked from each side.
+		// The face itself goes first, its patches then lead every level of the local cage. Grows with the
+		// valence, a one-ring left out would change the face's stencils.
+		Vector<uint32_t> ringFaces{ *allocator };
+		ringFaces.reserve(HE_MaxValence * HE_MaxValence);
+
+		auto AddFace = [&](const uint32_t f)
+		{
+			if (std::find(ringFaces.begin(), ringFaces.end(), f) == ringFaces.end())
+				ringFaces.push_back(f);
+		};
+
+		AddFace(faceIdx);
+
+		const HE_Face face = view.GetFace(faceIdx);
+
+		for (uint32_t i = 0; i < face.edgeCount; i++)
+		{
+			const uint32_t edgeID = face.begin + i;
+
+			uint32_t itr = RotateSelectionCCW(view, edgeID);
+			for (uint32_t n = 0; itr != HE_BorderValue && itr != edgeID && n < halfEdgeCount; n++)
+			{
+				AddFace(view.Face(itr));
+				itr = RotateSelectionCCW(view, itr);
+			}
+
+			itr = RotateSelectionCW(view, edgeID);
+			for (uint32_t n = 0; itr != HE_BorderValue && itr != edgeID && n < halfEdgeCount; n++)
+			{
+				AddFace(view.Face(itr));
+				itr = RotateSelectionCW(view, itr);
+			}
+		}
+
+		// Copies the one-ring into a cage of its own, twins to faces outside it become borders
+		HE_ControlCage local{ *allocator };
+
+		const uint32_t		ringSize	= (uint32_t)ringFaces.size();
+		Vector<uint32_t>	localBegin{ *allocator };
+		uint32_t			localEdges	= 0;
+
+		localBegin.resize(ringSize);
+
+		for (uint32_t ringIdx = 0; ringIdx < ringSize; ringIdx++)
+		{
+			localBegin[ringIdx]	= localEdges;
+			localEdges			+= view.GetFace(ringFaces[ringIdx]).edgeCount;
+		}
+
+		auto LocalEdge = [&](const uint32_t e) -> uint32_t
+		{
+			if (e == HE_BorderValue)
+				return HE_BorderValue;
+
+			const uint32_t f		= view.Face(e);
+			const uint32_t ringIdx	= uint32_t(std::find(ringFaces.begin(), ringFaces.end(), f) - ringFaces.begin());
+
+			return ringIdx < ringSize ? localBegin[ringIdx] + e - view.GetFace(f).begin : HE_BorderValue;
+		};
+
+		Vector<uint32_t> vertices{ *allocator };
+
+		local.halfEdges.reserve(localEdges);
+		local.faceLookup.reserve(localEdges);
+		local.faces.reserve(ringSize);
+
+		for (uint32_t ringIdx = 0; ringIdx < ringSize; ringIdx++)
+		{
+			const HE_Face ringFace = view.GetFace(ringFaces[ringIdx]);
+
+			local.faces.push_back(HE_Face{ localBegin[ringIdx], local.vertexCount, ringFace.edgeCount, 0 });
+			local.vertexCount += ringFace.GetVertexCount();
+
+			for (uint32_t i = 0; i < ringFace.edgeCount; i++)
+			{
+				const HEEdge& edge = cage->halfEdges[ringFace.begin + i];
+
+				HEEdge localEdge	= edge;
+				localEdge.twin		= LocalEdge(edge.Twin());
+				localEdge.next		= localBegin[ringIdx] + edge.next - ringFace.begin;
+				localEdge.prev		= localBegin[ringIdx] + edge.prev - ringFace.begin;
+
+				local.halfEdges.push_back(localEdge);
+				local.faceLookup.push_back(ringIdx);
+				vertices.push_back(edge.vert);
+			}
+		}
+
+		std::sort(vertices.begin(), vertices.end());
+		vertices.erase(std::unique(vertices.begin(), vertices.end()), vertices.end());
+
+		local.points.reserve(vertices.size());
+		for (const uint32_t vertex : vertices)
+			local.points.push_back(cage->points[vertex]);
+
+		for (HEEdge& edge : local.halfEdges)
+			edge.vert = uint32_t(std::lower_bound(vertices.begin(), vertices.end(), edge.vert) - vertices.begin());
+
+		// Every level above the last is subdivided whole, the last only for the face's own patches,
+		// the leading face.edgeCount * 4^(level - 1) of the level below
+		HE_Level	scratch[2]	= { HE_Level{ *allocator }, HE_Level{ *allocator } };
+		auto		out			= std::make_shared<HE_Level>(*allocator);
+
+		auto SubdivideLast = [&](const auto& input, const uint32_t faceCount)
+		{
+			const uint32_t edgeCount = 4 * face.edgeCount << (2 * level);
+
+			out->cage.resize(edgeCount);
+			out->flags.resize(edgeCount / 4);
+			out->points.resize(level ? 9 * faceCount : face.GetVertexCount());
+
+			for (uint32_t inputFace = 0; inputFace < faceCount; inputFace++)
+			{
+				HE_SubdivideFace(input, inputFace,
+					[&](const uint32_t idx) -> HE_TwinEdge&	{ return out->cage[idx]; },
+					[&](const uint32_t idx) -> uint8_t&		{ return out->flags[idx]; },
+					[&](const uint32_t idx) -> float3&		{ return out->points[idx]; });
+			}
+
+			for (HE_TwinEdge& edge : out->cage)
+			{
+				if (edge.twin != HE_BorderValue && edge.twin >= edgeCount)
+					edge.twin = HE_BorderValue;
+			}
+		};
+
+		const HE_ControlCageView localView{ local };
+
+		if (level == 0)
+			SubdivideLast(localView, 1);
+		else
+		{
+			HE_SubdivideFaces(localView, scratch[0], 1);
+
+			for (uint32_t levelIdx = 1; levelIdx < level; levelIdx++)
+			{
+				scratch[levelIdx & 1].level = levelIdx;
+				HE_SubdivideFaces(HE_LevelView{ scratch[(levelIdx - 1) & 1] }, scratch[levelIdx & 1], 1);
+			}
+
+			SubdivideLast(HE_LevelView{ scratch[(level - 1) & 1] }, face.edgeCount << (2 * (level - 1)));
+		}
+
+		out->level		= level;
+		out->indexMode	= HE_IndexMode::PerFace;
+
+		return out;
+	}
+
+
+	/************************************************************************************************/
+
+
+	void HE_FaceEvaluator::Clear()
+	{
+		for (uint32_t shardIdx = 0; shardIdx < shardCount; shardIdx++)
+		{
+			Shard& shard = shards[shardIdx];
+
+			std::scoped_lock lock{ shard.lock };
+			shard.lookup.clear();
+			shard.lru.clear();
+			shard.bytes = 0;
+		}
+	}
+
+
+	HE_FaceCacheStats HE_FaceEvaluator::GetStats() const
+	{
+		HE_FaceCacheStats stats;
+		stats.hits		= hits;
+		stats.misses	= misses;
+
+		for (uint32_t shardIdx = 0; shardIdx < shardCount; shardIdx++)
+		{
+			Shard& shard = shards[shardIdx];
+
+			std::scoped_lock lock{ shard.lock };
+			stats.bytes			+= shard.bytes;
+			stats.entries		+= (uint32_t)shard.lru.size();
+			stats.evictions		+= shard.evictions;
+			stats.evaluateTime	+= shard.evaluateTime;
+		}
+
+		return stats;
+	}
+
+
+}	/************************************************************************************************/
+
+/**********************************************************************
+
+Copyright (c) 2024 Robert May
+
+Permission is hereby granted, free of charge, to any person obtaining a
+copy of this software and associated documentation files (the "Software"),
+to deal in the Software without restriction, including without limitation
+the rights to use, copy, modify, merge, publish, distribute, sublicense,
+and/or sell copies of the Software, and to permit persons to whom the
+Software is furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included
+in all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+**********************************************************************/
@@ -0,0 +1,292 @@
+#include "HalfEdgeInstancing.hpp"
+
+#include <cmath>
+
+
+namespace FlexKit
+{	/************************************************************************************************/
+
+
+	namespace
+	{
+		// Forwards to a view with the points replaced, topology is read from the shared level
+		template<typename TY_View>
+		struct HE_OverridePointView
+		{
+			const TY_View&				view;
+			std::span<const float3>		points;
+
+			uint32_t	Next(uint32_t e)		const noexcept { return view.Next(e); }
+			uint32_t	Prev(uint32_t e)		const noexcept { return view.Prev(e); }
+			uint32_t	Twin(uint32_t e)		const noexcept { return view.Twin(e); }
+			uint32_t	Vert(uint32_t e)		const noexcept { return view.Vert(e); }
+			uint32_t	Face(uint32_t e)		const noexcept { return view.Face(e); }
+			bool		IsCorner(uint32_t e)	const noexcept { return view.IsCorner(e); }
+			bool		IsT(uint32_t e)			const noexcept { return view.IsT(e); }
+			float3		Point(uint32_t e)		const noexcept { return points[view.Vert(e)]; }
+
+			uint32_t	FaceCount()				const noexcept { return view.FaceCount(); }
+			uint32_t	HalfEdgeCount()			const noexcept { return view.HalfEdgeCount(); }
+			uint32_t	PointCount()			const noexcept { return view.PointCount(); }
+			HE_Face		GetFace(uint32_t f)		const noexcept { return view.GetFace(f); }
+		};
+	}
+
+
+	/************************************************************************************************/
+
+
+	HE_SharedTopology::HE_SharedTopology(HE_ControlCage&& cage, iAllocator& allocator, const HE_IndexMode indexMode) :
+		mesh	{ std::move(cage), allocator, indexMode },
+		cones	{ BuildNormalCones(mesh.cage, allocator, { .clusterSize = 32 }) },
+		bounds	{ HE_CageBounds(mesh.cage) } {}
+
+
+	const HE_Level& HE_SharedTopology::Level(const uint32_t level, const uint32_t threadCount)
+	{
+		const uint32_t clamped = Min(level, MaxLevel());
+
+		while (mesh.LevelCount() <= clamped)
+			mesh.BuildNextLevel(threadCount);
+
+		return mesh.GetLevel(clamped);
+	}
+
+
+	uint64_t HE_SharedTopology::ByteSize() const noexcept
+	{
+		uint64_t bytes =
+			mesh.cage.halfEdges.ByteSize() + mesh.cage.faces.ByteSize() +
+			mesh.cage.faceLookup.ByteSize() + mesh.cage.points.ByteSize() +
+			cones.cones.ByteSize() + cones.bounds.ByteSize();
+
+		for (const HE_Level& level : mesh.levels)
+			bytes += level.cage.ByteSize() + level.flags.ByteSize() + level.points.ByteSize();
+
+		return bytes;
+	}
+
+
+	/************************************************************************************************/
+
+
+	HE_InstanceSet::HE_InstanceSet(HE_SharedTopology& IN_topology, iAllocator& IN_allocator) :
+		topology		{ &IN_topology },
+		allocator		{ &IN_allocator },
+		transforms		{ IN_allocator },
+		overrideRanges	{ IN_allocator },
+		lods			{ IN_allocator },
+		bounds			{ IN_allocator },
+		states			{ IN_allocator },
+		overridePool	{ IN_allocator },
+		scratchPoints	{ IN_allocator },
+		scratchLevels	{ Vector<float3>{ IN_allocator }, Vector<float3>{ IN_allocator } } {}
+
+
+	uint32_t HE_InstanceSet::AddInstance(const HE_InstanceTransform& transform, const HE_SurfaceLOD& lod)
+	{
+		const uint32_t instance = (uint32_t)transforms.size();
+
+		transforms.push_back(transform);
+		overrideRanges.push_back({});
+		lods.push_back(lod);
+		bounds.push_back({});
+		states.push_back({ .flags = HE_SurfacePointsDirty });
+
+		lods[instance].maxLevel = (uint8_t)Min<uint32_t>(lod.maxLevel, topology->MaxLevel());
+
+		UpdateBounds(instance);
+
+		return instance;
+	}
+
+
+	void HE_InstanceSet::SetTransform(const uint32_t instance, const HE_InstanceTransform& transform)
+	{
+		transforms[instance] = transform;
+		UpdateBounds(instance);
+	}
+
+
+	void HE_InstanceSet::UpdateBounds(const uint32_t instance) noexcept
+	{
+		// Overrides are not part of the shared bounds, grow them by the moved points in object space
+		HE_SurfaceBounds local = topology->Bounds();
+
+		const HE_OverrideRange range = overrideRanges[instance];
+		for (uint32_t idx = range.begin; idx < range.begin + range.count; idx++)
+		{
+			const float3 p = overridePool[idx].position;
+			local.min = float3{ Min(local.min.x, p.x), Min(local.min.y, p.y), Min(local.min.z, p.z) };
+			local.max = float3{ Max(local.max.x, p.x), Max(local.max.y, p.y), Max(local.max.z, p.z) };
+		}
+
+		// Center and extent of the box through the transform, the extent by the absolute matrix
+		const HE_InstanceTransform&	transform	= transforms[instance];
+		const float3				center		= transform.Apply((local.min + local.max) * 0.5f);
+		const float3				extent		= (local.max - local.min) * 0.5f;
+
+		float worldExtent[3];
+		for (uint32_t axis = 0; axis < 3; axis++)
+		{
+			const float4& row = transform.rows[axis];
+			worldExtent[axis] = std::abs(row.x) * extent.x + std::abs(row.y) * extent.y + std::abs(row.z) * extent.z;
+		}
+
+		const float3 e{ worldExtent[0], worldExtent[1], worldExtent[2] };
+
+		bounds[instance] = { center - e, center + e };
+	}
+
+
+	/************************************************************************************************/
+
+
+	void HE_InstanceSet::SetOverrides(const uint32_t instance, std::span<const HE_PointOverride> overrides)
+	{
+		HE_OverrideRange& range = overrideRanges[instance];
+
+		if (overrides.size() > range.count)
+		{
+			range.begin = (uint32_t)overridePool.size();
+			overridePool.resize(overridePool.size() + overrides.size());
+		}
+
+		range.count = (uint32_t)overrides.size();
+		std::copy(overrides.begin(), overrides.end(), overridePool.begin() + range.begin);
+
+		if (range.count == 0)
+			range.begin = 0;
+
+		states[instance].flags |= HE_SurfacePointsDirty;
+		UpdateBounds(instance);
+	}
+
+
+	void HE_InstanceSet::CompactOverrides()
+	{
+		Vector<HE_PointOverride> compacted{ *allocator };
+
+		for (HE_OverrideRange& range : overrideRanges)
+		{
+			const uint32_t begin = (uint32_t)compacted.size();
+
+			for (uint32_t idx = range.begin; idx < range.begin + range.count; idx++)
+				compacted.push_back(overridePool[idx]);
+
+			range.begin = range.count ? begin : 0;
+		}
+
+		overridePool = std::move(compacted);
+	}
+
+
+	/************************************************************************************************/
+
+
+	HE_SurfaceUpdateStats HE_InstanceSet::Update(std::span<const HE_ViewState> views, Vector<uint32_t>& outDirty, const HE_SurfaceUpdateOptions& options)
+	{
+		const HE_SurfaceFields fields{
+			{ lods.data(), lods.size() },
+			{ bounds.data(), bounds.size() },
+			{ states.data(), states.size() } };
+
+		return UpdateSubdivisionSurfaces(fields, views, outDirty, options);
+	}
+
+
+	/************************************************************************************************/
+
+
+	std::span<const float3> HE_InstanceSet::EvaluateInstance(const uint32_t instance, const uint32_t level, const uint32_t threadCount)
+	{
+		const HE_OverrideRange	range	= overrideRanges[instance];
+		const uint32_t			target	= Min(level, topology->MaxLevel());
+
+		if (range.count == 0)
+		{
+			const HE_Level& shared = topology->Level(target, threadCount);
+			return { shared.points.data(), shared.points.size() };
+		}
+
+		const HE_ControlCage& cage = topology->Cage();
+
+		topology->Level(target, threadCount);	// Builds every shared level first, later calls return references that stay valid
+
+		scratchPoints.resize(cage.points.size());
+		std::copy(cage.points.begin(), cage.points.end(), scratchPoints.begin());
+
+		for (uint32_t idx = range.begin; idx < range.begin + range.count; idx++)
+		{
+			if (overridePool[idx].vertex < scratchPoints.size())
+				scratchPoints[overridePool[idx].vertex] = overridePool[idx].position;
+		}
+
+		// Topology comes from the shared levels, only the points of this instance are evaluated
+		for (uint32_t levelIdx = 0; levelIdx <= target; levelIdx++)
+		{
+			const HE_Level&	shared	= topology->Level(levelIdx, threadCount);
+			Vector<float3>&	out		= scratchLevels[levelIdx & 1];
+
+			if (levelIdx == 0)
+			{
+				const HE_ControlCageView cageView{ cage };
+				HE_SubdividePoints(HE_OverridePointView<HE_ControlCageView>{ cageView, { scratchPoints.data(), scratchPoints.size() } }, (uint32_t)scratchPoints.size(), shared, out, *allocator, threadCount);
+			}
+			else
+			{
+				const HE_LevelView		inputView{ topology->Level(levelIdx - 1, threadCount) };
+				const Vector<float3>&	input = scratchLevels[(levelIdx - 1) & 1];
+
+				HE_SubdividePoints(HE_OverridePointView<HE_LevelView>{ inputView, { input.data(), input.size() } }, (uint32_t)input.size(), shared, out, *allocator, threadCount);
+			}
+		}
+
+		return { scratchLevels[target & 1].data(), scratchLevels[target & 1].size() };
+	}
+
+
+	/************************************************************************************************/
+
+
+	HE_InstanceStats HE_InstanceSet::GetStats() const noexcept
+	{
+		HE_InstanceStats stats;
+		stats.instanceCount	= InstanceCount();
+		stats.sharedBytes	= topology->ByteSize();
+		stats.instanceBytes	=
+			transforms.ByteSize() + overrideRanges.ByteSize() + lods.ByteSize() +
+			bounds.ByteSize() + states.ByteSize() + overridePool.ByteSize();
+
+		for (const HE_OverrideRange& range : overrideRanges)
+			stats.overridden += range.count ? 1 : 0;
+
+		return stats;
+	}
+
+
+}	/************************************************************************************************/
+
+/**********************************************************************
+
+Copyright (c) 2024 Robert May
+
+Permission is hereby granted, free of charge, to any person obtaining a
+copy of this software and associated documentation files (the "Software"),
+to deal in the Software without restriction, including without limitation
+the rights to use, copy, modify, merge, publish, distribute, sublicense,
+and/or sell copies of the Software, and to permit persons to whom the
+Software is furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included
+in all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+**********************************************************************/
@@ -1,75 +1,153 @@
 #include "HalfEdgeMesh.hpp"
+#include "HalfEdgeCulling.hpp"
+#include "HalfEdgeValidation.hpp"
+#include "HalfEdgeShaderCache.hpp"
 #include <LibraryBuilder.hpp>
 #include <Containers.hpp>
 
+#include <array>
+
 
 namespace FlexKit
 {	/************************************************************************************************/
 
 
-	HalfEdgeMesh::HalfEdgeMesh(
-			const	ModifiableShape&	shape,
-					RenderSystem&		IN_renderSystem, 
-					iAllocator&			IN_allocator, 
-					iAllocator&			IN_temp) : 
-			cbt		{ IN_renderSystem, IN_allocator } 
+	namespace
 	{
-		Vector<HEEdge>		halfEdges{ IN_allocator };
-		Vector<uint>		faceLookupBuffer{ IN_allocator };
+		// Shaders compiled through the content-hash cache, indexed by HE_ShaderSlot
+		enum HE_ShaderSlot : uint32_t
+		{
+			HE_AdaptiveCCLib,
+			HE_BisectorsCS,
+			HE_FacePointsCS,
+			HE_LevelCS,
+			HE_FacesMS,
+			HE_FacesPS,
+			HE_WireMS,
+			HE_WirePS,
+			HE_ShaderSlotCount,
+		};
+
+		std::vector<HE_CompiledShader> compiledShaders;
 
-		halfEdges.reserve(shape.wEdges.size());
-		for (const auto&& [idx, edge] : std::views::enumerate(shape.wEdges))
+
+		template<D3D12_PIPELINE_STATE_SUBOBJECT_TYPE TYPE, typename TY>
+		struct alignas(void*) PSOSubobject
 		{
-			const bool isOnEdge	= shape.IsEdgeVertex(edge.vertices[0]);
+			D3D12_PIPELINE_STATE_SUBOBJECT_TYPE	type = TYPE;
+			TY									desc;
+		};
 
-			auto CalculateTwinValue = [&]() -> uint32_t
-			{
-				return	(edge.twin & (0xffffffff >> 2)) |
-						(shape.GetVertexValence(edge.vertices[0]) == 2 ? (1 << 31) : 0) |
-						(isOnEdge ? (1 << 30) : 0);
-			};
 
-			HEEdge hEdge
+		// Pipeline states from cached DXIL, the root signatures are embedded in the shaders
+		ID3D12PipelineState* CreateComputePSO(RenderSystem& renderSystem, const HE_CompiledShader& cs)
+		{
+			D3D12_COMPUTE_PIPELINE_STATE_DESC desc{};
+			desc.CS = { cs.dxil.data(), cs.dxil.size() };
+
+			ID3D12PipelineState* pso = nullptr;
+			if (FAILED(renderSystem.pDevice14->CreateComputePipelineState(&desc, IID_PPV_ARGS(&pso))))
+				return nullptr;
+
+			return pso;
+		}
+
+
+		// Solid fill without culling, one R16G16B16A16 target and a D32 depth tested with LESS, as the
+		// PipelineBuilder fallbacks describe it
+		ID3D12PipelineState* CreateMeshPSO(RenderSystem& renderSystem, const HE_CompiledShader& ms, const HE_CompiledShader& ps)
+		{
+			struct
 			{
-				.twin = CalculateTwinValue(),
-				.next = edge.next,
-				.prev = edge.prev,
-				.vert = edge.vertices[0],
-			};
+				PSOSubobject<D3D12_PIPELINE_STATE_SUBOBJECT_TYPE_MS,					D3D12_SHADER_BYTECODE>		ms;
+				PSOSubobject<D3D12_PIPELINE_STATE_SUBOBJECT_TYPE_PS,					D3D12_SHADER_BYTECODE>		ps;
+				PSOSubobject<D3D12_PIPELINE_STATE_SUBOBJECT_TYPE_RASTERIZER,			D3D12_RASTERIZER_DESC>		rasterizer;
+				PSOSubobject<D3D12_PIPELINE_STATE_SUBOBJECT_TYPE_DEPTH_STENCIL,			D3D12_DEPTH_STENCIL_DESC>	depthStencil;
+				PSOSubobject<D3D12_PIPELINE_STATE_SUBOBJECT_TYPE_DEPTH_STENCIL_FORMAT,	DXGI_FORMAT>				depthFormat;
+				PSOSubobject<D3D12_PIPELINE_STATE_SUBOBJECT_TYPE_RENDER_TARGET_FORMATS,	D3D12_RT_FORMAT_ARRAY>		targetFormats;
+			} stream{};
+
+			stream.ms.desc = { ms.dxil.data(), ms.dxil.size() };
+			stream.ps.desc = { ps.dxil.data(), ps.dxil.size() };
+
+			stream.rasterizer.desc.FillMode			= D3D12_FILL_MODE_SOLID;
+			stream.rasterizer.desc.CullMode			= D3D12_CULL_MODE_NONE;
+			stream.rasterizer.desc.DepthClipEnable	= TRUE;
+
+			stream.depthStencil.desc.DepthEnable	= TRUE;
+			stream.depthStencil.desc.DepthWriteMask	= D3D12_DEPTH_WRITE_MASK_ALL;
+			stream.depthStencil.desc.DepthFunc		= D3D12_COMPARISON_FUNC_LESS;
+
+			stream.depthFormat.desc						= DXGI_FORMAT_D32_FLOAT;
+			stream.targetFormats.desc.NumRenderTargets	= 1;
+			stream.targetFormats.desc.RTFormats[0]		= DXGI_FORMAT_R16G16B16A16_FLOAT;
+
+			const D3D12_PIPELINE_STATE_STREAM_DESC desc{ sizeof(stream), &stream };
+
+			ID3D12PipelineState* pso = nullptr;
+			if (FAILED(renderSystem.pDevice14->CreatePipelineState(&desc, IID_PPV_ARGS(&pso))))
+				return nullptr;
 
-			halfEdges.push_back(hEdge);
+			return pso;
 		}
+	}
+
 
-		uint32_t edgeCount = 0;
-		uint32_t vertexCount = 0;
-		Vector<HE_Face> faces{ IN_allocator };
-		faces.reserve(shape.wFaces.size());
+	/************************************************************************************************/
 
-		for (const auto&& [idx, face] : enumerate(shape.wFaces))
-		{ 
-			auto faceEdgeCount = (uint16_t)face.GetEdgeCount(shape);
-			faces.emplace_back(face.edgeStart, vertexCount, faceEdgeCount, (uint16_t)0);
-			edgeCount += faceEdgeCount;
-			vertexCount += 1 + 2 * faceEdgeCount;
 
-			for (int i = 0; i < faceEdgeCount; i++)
-				faceLookupBuffer.emplace_back((uint32_t)idx);
+	HalfEdgeMesh::HalfEdgeMesh(
+			const	ModifiableShape&	shape,
+					RenderSystem&		IN_renderSystem, 
+					iAllocator&			IN_allocator, 
+					iAllocator&			IN_temp,
+			const	LevelOptions&		levelOptions) : 
+			cpuCage		{ BuildControlCage(shape, IN_allocator) },
+			cpuCones	{ BuildNormalCones(cpuCage, IN_allocator, { .clusterSize = 32 }) },
+			visibility			{ IN_allocator },
+			patches				{ IN_allocator, (uint32_t)cpuCage.faces.size(), levelOptions.levelCount },
+			patchTargets		{ IN_allocator },
+			patchUploader		{ IN_allocator, patches.cbt.WordCount(), sizeof(uint64_t), 1 * MEGABYTE },
+			controlPointData	{ IN_allocator },
+			pointUploader		{ IN_allocator, (uint32_t)cpuCage.points.size(), sizeof(HalfEdgeVertex), 1 * MEGABYTE },
+			coneUploader		{ IN_allocator, (uint32_t)cpuCones.cones.size(), sizeof(HE_NormalCone), 1 * MEGABYTE },
+			boundsUploader		{ IN_allocator, (uint32_t)cpuCones.bounds.size(), sizeof(HE_PatchBounds), 1 * MEGABYTE },
+			vertexEdges			{ IN_allocator },
+			movedVertices		{ IN_allocator },
+			dirtyCones			{ IN_allocator },
+			allocator			{ &IN_allocator }
+	{
+		auto& cage = cpuCage;
+
+		BuildVertexEdges(cage, vertexEdges);
+
+		if (const auto report = ValidateControlCage(cage, IN_temp, { .levelCount = levelOptions.levelCount }); !report.IsValid())
+		{
+			std::cout << "Control cage failed validation (" << report.errors.size() << (report.truncated ? "+" : "") << " errors, " << report.duration << "ms)\n";
+
+			for (size_t i = 0; i < report.errors.size() && i < 16; i++)
+				std::cout << "\t" << HE_ValidationErrorString(report.errors[i].code) << ": " << report.errors[i].element << ", " << report.errors[i].other << "\n";
 		}
-		
+
+		auto&			halfEdges			= cage.halfEdges;
+		auto&			faces				= cage.faces;
+		auto&			faceLookupBuffer	= cage.faceLookup;
+		const uint32_t	edgeCount			= (uint32_t)halfEdges.size();
+		const uint32_t	vertexCount			= cage.vertexCount;
+
 		std::cout << "Half edge count: " << edgeCount << "\n";
-		std::cout << "L0 Half edge count: " << edgeCount * 4 << "\n";
-		std::cout << "L1 Half edge count: " << edgeCount * 16 << "\n";
-		std::cout << "L2 Half edge count: " << edgeCount * 64 << "\n";
 		std::cout << "Vertex count: " << vertexCount << "\n";
 
-		Vector<HalfEdgeVertex> meshPoints{ IN_allocator };
-		meshPoints.resize(shape.wVertices.size());
-		for (const auto&& [idx, point] : std::views::enumerate(shape.wVertices))
+		auto& meshPoints = controlPointData;
+		meshPoints.resize(cage.points.size());
+		for (size_t idx = 0; idx < cage.points.size(); idx++)
 		{
 			HalfEdgeVertex v;
-			v.rgba = 0xff00ff00;
-			v.UV   = float2(0.0f, 0.0f);
-			memcpy(&v.xyz, &point, sizeof(HalfEdgeVertex));
+			v.xyz[0]	= cage.points[idx].x;
+			v.xyz[1]	= cage.points[idx].y;
+			v.xyz[2]	= cage.points[idx].z;
+			v.rgba		= 0xff00ff00;
+			v.UV		= float2(0.0f, 0.0f);
 			meshPoints[idx] = v;
 		}
 
@@ -77,31 +155,38 @@ namespace FlexKit
 		controlCage			= IN_renderSystem.CreateGPUResource(GPUResourceDesc::StructuredResource(halfEdges.ByteSize()));
 		controlPoints		= IN_renderSystem.CreateGPUResource(GPUResourceDesc::StructuredResource(meshPoints.ByteSize()));
 		faceLookup			= IN_renderSystem.CreateGPUResource(GPUResourceDesc::StructuredResource(faceLookupBuffer.ByteSize()));
+		normalCones			= IN_renderSystem.CreateGPUResource(GPUResourceDesc::StructuredResource(cpuCones.cones.ByteSize()));
+		faceBounds			= IN_renderSystem.CreateGPUResource(GPUResourceDesc::StructuredResource(cpuCones.bounds.ByteSize()));
+		facePoints			= IN_renderSystem.CreateGPUResource(GPUResourceDesc::UAVResource(faces.size() * sizeof(float4)));
+		patchBits			= IN_renderSystem.CreateGPUResource(GPUResourceDesc::StructuredResource(patches.cbt.Words().size_bytes()));
 
 		controlCageSize		= halfEdges.size();
 		controlCageFaces	= faces.size();
-		const uint32_t level0PointCount = (shape.wFaces.size() + shape.wEdges.size() * 2);
-		const uint32_t level1PointCount = level0PointCount * 9;
-		const uint32_t level2PointCount = level1PointCount * 9;
+		deterministic		= levelOptions.deterministic;
 
-		levels[0] = IN_renderSystem.CreateGPUResource(GPUResourceDesc::UAVResource(halfEdges.ByteSize() * 4));
-		levels[1] = IN_renderSystem.CreateGPUResource(GPUResourceDesc::UAVResource(halfEdges.ByteSize() * 16));
-		levels[2] = IN_renderSystem.CreateGPUResource(GPUResourceDesc::UAVResource(halfEdges.ByteSize() * 64));
-		points[0] = IN_renderSystem.CreateGPUResource(GPUResourceDesc::UAVResource(level0PointCount * sizeof(HalfEdgeVertex)));
-		points[1] = IN_renderSystem.CreateGPUResource(GPUResourceDesc::UAVResource(level1PointCount * sizeof(HalfEdgeVertex)));
-		points[2] = IN_renderSystem.CreateGPUResource(GPUResourceDesc::UAVResource(level2PointCount * sizeof(HalfEdgeVertex)));
+		static const char* levelNames[HE_MaxLevels] = { "level_0", "level_1", "level_2", "level_3", "level_4", "level_5", "level_6", "level_7" };
+		static const char* pointNames[HE_MaxLevels] = { "points_0", "points_1", "points_2", "points_3", "points_4", "points_5", "points_6", "points_7" };
 
-		patchCount[0] = edgeCount;
-		patchCount[1] = patchCount[0] * 4;
-		patchCount[2] = patchCount[1] * 4;
+		// Levels stop at the 32-bit twin range or the budget
+		const HE_LevelBufferPlan plan = HE_PlanLevelBuffers(edgeCount, vertexCount, levelOptions.levelCount, levelOptions.budgetBytes, TwinEdgeStride, sizeof(HalfEdgeVertex));
 
-		IN_renderSystem.SetDebugName(levels[0], "level_0");
-		IN_renderSystem.SetDebugName(levels[1], "level_1");
-		IN_renderSystem.SetDebugName(levels[2], "level_2");
+		for (levelCount = 0; levelCount < plan.levelCount; levelCount++)
+		{
+			levels[levelCount]		= IN_renderSystem.CreateGPUResource(GPUResourceDesc::UAVResource(plan.halfEdgeBytes[levelCount]));
+			points[levelCount]		= IN_renderSystem.CreateGPUResource(GPUResourceDesc::UAVResource(plan.pointBytes[levelCount]));
+			patchCount[levelCount]	= edgeCount << (2 * levelCount);
 
-		IN_renderSystem.SetDebugName(points[0], "points_0");
-		IN_renderSystem.SetDebugName(points[1], "points_1");
-		IN_renderSystem.SetDebugName(points[2], "points_2");
+			IN_renderSystem.SetDebugName(levels[levelCount], levelNames[levelCount]);
+			IN_renderSystem.SetDebugName(points[levelCount], pointNames[levelCount]);
+		}
+
+		for (uint32_t levelIdx = levelCount; levelIdx < HE_MaxLevels; levelIdx++)
+		{
+			levels[levelIdx] = InvalidHandle;
+			points[levelIdx] = InvalidHandle;
+		}
+
+		std::cout << "Subdivision levels: " << levelCount << " (" << plan.totalBytes / MEGABYTE << "MB)\n";
 
 
 		auto uploadQueue = IN_renderSystem.GetImmediateCopyQueue();
@@ -129,7 +214,20 @@ namespace FlexKit
 				faceLookupBuffer.data(),
 				faceLookupBuffer.ByteSize(), 1, FlexKit::DASNonPixelShaderResource);
 
-		cbt.Initialize({ .maxDepth = 14 });
+		IN_renderSystem.UpdateResourceByUploadQueue(
+				IN_renderSystem.GetDeviceResource(normalCones),
+				uploadQueue,
+				cpuCones.cones.data(),
+				cpuCones.cones.ByteSize(), 1, FlexKit::DASNonPixelShaderResource);
+
+		IN_renderSystem.UpdateResourceByUploadQueue(
+				IN_renderSystem.GetDeviceResource(faceBounds),
+				uploadQueue,
+				cpuCones.bounds.data(),
+				cpuCones.bounds.ByteSize(), 1, FlexKit::DASNonPixelShaderResource);
+
+		patchTargets.resize(faces.size());
+		patchUploader.MarkAllDirty();
 
 		static bool registerStates = 
 			[&]
@@ -140,7 +238,7 @@ namespace FlexKit
 				heap1.SetParameterAsShaderUAV(0, 0, -1, 2);
 
 				RootSignatureBuilder builder{ IN_allocator };
-				builder.SetParameterAsUINT(0, 18, 0, 0);
+				builder.SetParameterAsUINT(0, 19, 0, 0);
 				builder.SetParameterAsSRV(1, 0, 0);
 				builder.SetParameterAsSRV(2, 1, 0);
 				builder.SetParameterAsSRV(3, 2, 0);
@@ -149,10 +247,41 @@ namespace FlexKit
 				builder.SetParameterAsCBV(6, 1);
 				builder.SetParameterAsSRV(7, 3);
 				builder.SetParameterAsUAV(8, 0);
+				builder.SetParameterAsSRV(9, 4);
+				builder.SetParameterAsSRV(10, 5);
+				builder.SetParameterAsSRV(11, 6);
+				builder.SetParameterAsSRV(12, 7);
 				globalRoot = builder.Build(IN_renderSystem, IN_temp);
 
-				updateState = LibraryBuilder{ IN_temp }.
-					LoadShaderLibrary("assets\\shaders\\HalfEdge\\HE_AdaptiveCC.hlsl").
+				// One job per shader, compiled in parallel through the content-hash cache. Shaders that fail to
+				// compile, when dxc is unavailable, fall back to the engine compiler.
+				const HE_ShaderJob jobs[HE_ShaderSlotCount] = {
+					HE_ShaderJob::Library(		"assets\\shaders\\HalfEdge\\HE_AdaptiveCC.hlsl"),
+					HE_ShaderJob::EntryPoint(	"assets\\shaders\\HalfEdge\\HE_Initialize.hlsl",			"BuildBisectors",	"cs_6_6", true),
+					HE_ShaderJob::EntryPoint(	"assets\\shaders\\HalfEdge\\HE_FacePoints.hlsl",			"BuildFacePoints",	"cs_6_6", true),
+					HE_ShaderJob::EntryPoint(	"assets\\shaders\\HalfEdge\\HE_ComputeLevel.hlsl",		"BuildLevel",		"cs_6_6", true),
+					HE_ShaderJob::EntryPoint(	"assets\\shaders\\HalfEdge\\HE_BasicForwardRender.hlsl",	"MeshMain",			"ms_6_6", true),
+					HE_ShaderJob::EntryPoint(	"assets\\shaders\\HalfEdge\\HE_BasicForwardRender.hlsl",	"PMain",			"ps_6_6", true),
+					HE_ShaderJob::EntryPoint(	"assets\\shaders\\HalfEdge\\HE_BasicForwardRender.hlsl",	"WireMain",			"ms_6_6", true),
+					HE_ShaderJob::EntryPoint(	"assets\\shaders\\HalfEdge\\HE_BasicForwardRender.hlsl",	"WhiteWireframe",	"ps_6_6", true),
+				};
+
+				HE_ShaderCache		shaderCache{ "shadercache" };
+				HE_DXCCompiler		compiler;
+				HE_ShaderBuildStats	buildStats;
+
+				compiledShaders = CompileShaders(jobs, shaderCache, compiler, &buildStats);
+
+				std::cout << "HalfEdge shaders: " << buildStats.jobs << " jobs, " << buildStats.cacheHits << " cache hits, " << buildStats.failures << " failed, " << buildStats.wallTime << "ms\n";
+
+				LibraryBuilder libraryBuilder{ IN_temp };
+
+				if (compiledShaders[HE_AdaptiveCCLib].Succeeded())
+					libraryBuilder.LoadShaderLibrary(std::span<const std::byte>{ compiledShaders[HE_AdaptiveCCLib].dxil });
+				else
+					libraryBuilder.LoadShaderLibrary("assets\\shaders\\HalfEdge\\HE_AdaptiveCC.hlsl");
+
+				updateState = libraryBuilder.
 					//LoadShaderLibrary("assets\\shaders\\HalfEdge\\HE_CatmullClark.hlsl").
 					AddGlobalRootSignature(*globalRoot).
 					AddWorkGroup("HE_Builder", {}).
@@ -164,19 +293,37 @@ namespace FlexKit
 
 				IN_renderSystem.RegisterPSOLoader(
 					BuildBisectors,
-					[](FlexKit::RenderSystem* renderSystem, FlexKit::iAllocator& allocator) 
+					[](FlexKit::RenderSystem* renderSystem, FlexKit::iAllocator& allocator) -> ID3D12PipelineState*
 					{
+						if (compiledShaders[HE_BisectorsCS].Succeeded())
+							return CreateComputePSO(*renderSystem, compiledShaders[HE_BisectorsCS]);
+
 						return FlexKit::PipelineBuilder{ allocator }.
-							AddComputeShader("BuildBisectors", "assets\\shaders\\HalfEdge\\HE_Initialize.hlsl", { .hlsl2021 = true }).
+							AddComputeShader("BuildBisectors", "assets\\shaders\\HalfEdge\\HE_Initialize.hlsl", { .enable16BitTypes = true, .hlsl2021 = true }).
+							Build(*renderSystem);
+					});
+
+				IN_renderSystem.RegisterPSOLoader(
+					FacePass,
+					[](FlexKit::RenderSystem* renderSystem, FlexKit::iAllocator& allocator) -> ID3D12PipelineState*
+					{
+						if (compiledShaders[HE_FacePointsCS].Succeeded())
+							return CreateComputePSO(*renderSystem, compiledShaders[HE_FacePointsCS]);
+
+						return FlexKit::PipelineBuilder{ allocator }.
+							AddComputeShader("BuildFacePoints", "assets\\shaders\\HalfEdge\\HE_FacePoints.hlsl", { .enable16BitTypes = true, .hlsl2021 = true }).
 							Build(*renderSystem);
 					});
 
 				IN_renderSystem.RegisterPSOLoader(
 					BuildLevel,
-					[](FlexKit::RenderSystem* renderSystem, FlexKit::iAllocator& allocator)
+					[](FlexKit::RenderSystem* renderSystem, FlexKit::iAllocator& allocator) -> ID3D12PipelineState*
 					{
+						if (compiledShaders[HE_LevelCS].Succeeded())
+							return CreateComputePSO(*renderSystem, compiledShaders[HE_LevelCS]);
+
 						return FlexKit::PipelineBuilder{ allocator }.
-							AddComputeShader("BuildLevel", "assets\\shaders\\HalfEdge\\HE_ComputeLevel.hlsl", { .hlsl2021 = true }).
+							AddComputeShader("BuildLevel", "assets\\shaders\\HalfEdge\\HE_ComputeLevel.hlsl", { .enable16BitTypes = true, .hlsl2021 = true }).
 							Build(*renderSystem);
 					});
 
@@ -191,8 +338,11 @@ namespace FlexKit
 				
 				IN_renderSystem.RegisterPSOLoader(
 					RenderFaces,
-					[](FlexKit::RenderSystem* renderSystem, FlexKit::iAllocator& allocator)
+					[](FlexKit::RenderSystem* renderSystem, FlexKit::iAllocator& allocator) -> ID3D12PipelineState*
 					{
+						if (compiledShaders[HE_FacesMS].Succeeded() && compiledShaders[HE_FacesPS].Succeeded())
+							return CreateMeshPSO(*renderSystem, compiledShaders[HE_FacesMS], compiledShaders[HE_FacesPS]);
+
 						return FlexKit::PipelineBuilder{ allocator }.
 							AddMeshShader("MeshMain",	"assets\\shaders\\HalfEdge\\HE_BasicForwardRender.hlsl", { .enable16BitTypes = true, .hlsl2021 = true }).
 							AddPixelShader("PMain",		"assets\\shaders\\HalfEdge\\HE_BasicForwardRender.hlsl", { .enable16BitTypes = true, .hlsl2021 = true }).
@@ -207,8 +357,11 @@ namespace FlexKit
 
 				IN_renderSystem.RegisterPSOLoader(
 					RenderWireframe,
-					[](FlexKit::RenderSystem* renderSystem, FlexKit::iAllocator& allocator)
+					[](FlexKit::RenderSystem* renderSystem, FlexKit::iAllocator& allocator) -> ID3D12PipelineState*
 					{
+						if (compiledShaders[HE_WireMS].Succeeded() && compiledShaders[HE_WirePS].Succeeded())
+							return CreateMeshPSO(*renderSystem, compiledShaders[HE_WireMS], compiledShaders[HE_WirePS]);
+
 						return FlexKit::PipelineBuilder{ allocator }.
 							AddMeshShader("WireMain",			"assets\\shaders\\HalfEdge\\HE_BasicForwardRender.hlsl", { .enable16BitTypes = true, .hlsl2021 = true }).
 							AddPixelShader("WhiteWireframe",	"assets\\shaders\\HalfEdge\\HE_BasicForwardRender.hlsl", { .enable16BitTypes = true, .hlsl2021 = true }).
@@ -223,6 +376,7 @@ namespace FlexKit
 
 				IN_renderSystem.QueuePSOLoad(BuildBisectors);
 				IN_renderSystem.QueuePSOLoad(BuildLevel);
+				IN_renderSystem.QueuePSOLoad(FacePass);
 				IN_renderSystem.QueuePSOLoad(RenderWireframe);
 				IN_renderSystem.QueuePSOLoad(RenderFaces);
 
@@ -238,10 +392,16 @@ namespace FlexKit
 	{
 		RenderSystem::globalInstance->ReleaseResource(controlFaces);
 		RenderSystem::globalInstance->ReleaseResource(controlCage);
-		RenderSystem::globalInstance->ReleaseResource(levels[0]);
-		RenderSystem::globalInstance->ReleaseResource(levels[1]);
-		RenderSystem::globalInstance->ReleaseResource(points[0]);
-		RenderSystem::globalInstance->ReleaseResource(points[1]);
+		RenderSystem::globalInstance->ReleaseResource(controlPoints);
+		RenderSystem::globalInstance->ReleaseResource(normalCones);
+		RenderSystem::globalInstance->ReleaseResource(faceBounds);
+		RenderSystem::globalInstance->ReleaseResource(facePoints);
+
+		for (uint32_t levelIdx = 0; levelIdx < levelCount; levelIdx++)
+		{
+			RenderSystem::globalInstance->ReleaseResource(levels[levelIdx]);
+			RenderSystem::globalInstance->ReleaseResource(points[levelIdx]);
+		}
 	}
 
 
@@ -250,7 +410,7 @@ namespace FlexKit
 
 	void HalfEdgeMesh::BuildSubDivLevel(FlexKit::FrameGraph& frameGraph)
 	{
-		if (levelsBuilt >= 2)
+		if (levelsBuilt >= levelCount)
 			return;
 
 		struct buildLevel
@@ -304,8 +464,9 @@ namespace FlexKit
 					ctx.SetComputeShaderResourceView(3, resources.NonPixelShaderResource(subDivData.inputCage, ctx));
 					ctx.SetComputeShaderResourceView(4, resources.NonPixelShaderResource(subDivData.inputVerts, ctx));
 					ctx.SetComputeShaderResourceView(5, resources.NonPixelShaderResource(subDivData.inputFaces, ctx));
-					ctx.SetComputeConstantValue(6, 1, &subDivData.faceCount);
-					ctx.Dispatch({ Max(subDivData.faceCount / 64, 1), 1, 1 });
+					const uint32_t constants[] = { subDivData.faceCount, deterministic ? 1u : 0u };
+					ctx.SetComputeConstantValue(6, 2, constants);
+					ctx.Dispatch({ subDivData.faceCount / 64 + (subDivData.faceCount % 64 == 0 ? 0 : 1), 1, 1 });
 
 					ctx.EndEvent_DEBUG();
 				});
@@ -323,7 +484,7 @@ namespace FlexKit
 					subDivData.inputCage		= builder.NonPixelShaderResource(levels[levelsBuilt - 1]);
 					subDivData.inputVerts		= builder.NonPixelShaderResource(points[levelsBuilt - 1]);
 					subDivData.inputEdgeCount	= controlCageSize;
-					subDivData.faceCount		= controlCageFaces << (levelsBuilt * 2);
+					subDivData.faceCount		= controlCageSize << (2 * (levelsBuilt - 1));	// Patches of the level below, one per cage half-edge at level 0
 					edgeCount[levelsBuilt]		= edgeCount[levelsBuilt - 1] * 4;
 
 					subDivData.outputCage		= builder.UnorderedAccess(levels[levelsBuilt]);
@@ -345,8 +506,9 @@ namespace FlexKit
 					ctx.SetComputeUnorderedAccessView(2, resources.UAV(subDivData.counters, ctx));
 					ctx.SetComputeShaderResourceView(3, resources.NonPixelShaderResource(subDivData.inputCage, ctx));
 					ctx.SetComputeShaderResourceView(4, resources.NonPixelShaderResource(subDivData.inputVerts, ctx));
-					ctx.SetComputeConstantValue(5, 1, &subDivData.faceCount);
-					ctx.Dispatch({ Max(1, 1), 1, 1 });
+					const uint32_t constants[] = { subDivData.faceCount, deterministic ? 1u : 0u };
+					ctx.SetComputeConstantValue(5, 2, constants);
+					ctx.Dispatch({ subDivData.faceCount / 64 + (subDivData.faceCount % 64 == 0 ? 0 : 1), 1, 1 });
 
 					ctx.EndEvent_DEBUG();
 				});
@@ -370,9 +532,11 @@ namespace FlexKit
 			FrameResourceHandle inputPoints	= InvalidHandle;
 			FrameResourceHandle inputFaces	= InvalidHandle;
 			FrameResourceHandle faceLookup	= InvalidHandle;
+			FrameResourceHandle normalCones	= InvalidHandle;
 
-			FrameResourceHandle outputCages[3];
-			FrameResourceHandle outputVerts[3];
+			FrameResourceHandle outputCages[HE_MaxLevels];
+			FrameResourceHandle outputVerts[HE_MaxLevels];
+			uint32_t			levelCount = 0;
 
 			uint patchCount = 0;
 		};
@@ -388,7 +552,9 @@ namespace FlexKit
 				subDivData.inputFaces	= builder.NonPixelShaderResource(controlFaces);
 				subDivData.patchCount	= controlCageFaces;
 
-				for(uint32_t i = 0; i < 3; i++)
+				subDivData.levelCount = levelCount;
+
+				for(uint32_t i = 0; i < levelCount; i++)
 				{
 					frameGraph.AddOutput(levels[i]);
 					frameGraph.AddOutput(points[i]);
@@ -401,6 +567,7 @@ namespace FlexKit
 					subDivData.backingSpace = builder.AcquireVirtualResource(GPUResourceDesc::UAVResource(spaceRequired), DASUAV);
 
 				subDivData.faceLookup			= builder.NonPixelShaderResource(faceLookup);
+				subDivData.normalCones			= builder.NonPixelShaderResource(normalCones);
 				subDivData.localRootSigSpace	= builder.AcquireVirtualResource(GPUResourceDesc::UAVResource(1024), DASCopyDest);
 				subDivData.constantSpace		= builder.AcquireVirtualResource(GPUResourceDesc::StructuredResource(1024), DASCopyDest);
 			},
@@ -429,17 +596,18 @@ namespace FlexKit
 				ctx.SetComputeShaderResourceView(3, resources.GetResource(subDivData.inputFaces));
 				ctx.SetComputeConstantBufferView(6, resources.NonPixelShaderResource(subDivData.constantSpace, ctx, Sync_Copy, Sync_Compute));
 				ctx.SetComputeShaderResourceView(7, resources.GetResource(subDivData.faceLookup));
+				ctx.SetComputeShaderResourceView(9, resources.GetResource(subDivData.normalCones));
 
 				DescriptorHeap cages;
 				DescriptorHeap points;
-				cages.Init2(ctx, globalRoot->GetDescHeap(0), 3, threadLocalAllocator);
-				points.Init2(ctx, globalRoot->GetDescHeap(1), 3, threadLocalAllocator);
+				cages.Init2(ctx, globalRoot->GetDescHeap(0), subDivData.levelCount, threadLocalAllocator);
+				points.Init2(ctx, globalRoot->GetDescHeap(1), subDivData.levelCount, threadLocalAllocator);
 
-				for(auto&& [idx, cage] : enumerate(subDivData.outputCages))
-					cages.SetUAVStructured(ctx, idx, resources.GetResource(cage), 16);
-	
-				for (auto&& [idx, p] : enumerate(subDivData.outputVerts))
-					points.SetUAVStructured(ctx, idx, resources.GetResource(p), sizeof(HalfEdgeVertex));
+				for (uint32_t idx = 0; idx < subDivData.levelCount; idx++)
+				{
+					cages.SetUAVStructured(ctx, idx, resources.GetResource(subDivData.outputCages[idx]), TwinEdgeStride);
+					points.SetUAVStructured(ctx, idx, resources.GetResource(subDivData.outputVerts[idx]), sizeof(HalfEdgeVertex));
+				}
 
 				ctx.SetComputeDescriptorTable(4, cages);	// cages
 				ctx.SetComputeDescriptorTable(5, points);	// points
@@ -463,11 +631,11 @@ namespace FlexKit
 				dispatch.NodeCPUInput.RecordStrideInBytes	= sizeof(arguments);
 				ctx.DeviceContext->DispatchGraph(&dispatch);
 				
-				for (auto&& [idx, cage] : enumerate(subDivData.outputCages))
-					ctx.AddUAVBarrier(resources.GetResource(cage));
-
-				for (auto&& [idx, verts] : enumerate(subDivData.outputVerts))
-					ctx.AddUAVBarrier(resources.GetResource(verts));
+				for (uint32_t idx = 0; idx < subDivData.levelCount; idx++)
+				{
+					ctx.AddUAVBarrier(resources.GetResource(subDivData.outputCages[idx]));
+					ctx.AddUAVBarrier(resources.GetResource(subDivData.outputVerts[idx]));
+				}
 
 				ctx.EndEvent_DEBUG();
 			}
@@ -478,8 +646,159 @@ namespace FlexKit
 	/************************************************************************************************/
 
 
-	void HalfEdgeMesh::AdaptiveSubdivUpdate(FlexKit::FrameGraph& frameGraph, FlexKit::CameraHandle camera)
+	HE_RefineAction HalfEdgeMesh::PrepareRefinement(std::span<const RefineView> views)
+	{
+		// Culled as a whole, the tracker keeps its faces and picks up where it left off once back in view
+		if (!inView)
+			return refineAction = HE_RefineAction::Skip;
+
+		const uint32_t viewCount = (uint32_t)Min(views.size(), size_t(HE_MaxViews));
+
+		HE_ViewState viewStates[HE_MaxViews];
+		for (uint32_t viewIdx = 0; viewIdx < viewCount; viewIdx++)
+		{
+			viewStates[viewIdx].position	= GetCameraConstants(views[viewIdx].camera).WPOS.xyz();
+			viewStates[viewIdx].frustum		= GetFrustum(views[viewIdx].camera);
+			viewStates[viewIdx].lodScale	= views[viewIdx].lodScale;
+		}
+
+		// Faces that were already refined keep their output, only newly visible faces are refined.
+		// Levels stop at the deepest level buffer.
+		const HE_LODOptions lodOptions = { .maxLevel = levelCount ? levelCount - 1u : 0u };
+
+		refineAction = viewCount ? visibility.Update(cpuCage, cpuCones, { viewStates, viewCount }, cageVersion, lodOptions) : HE_RefineAction::Skip;
+
+		// Patches follow every change of the visible set, faces that only left refine nothing but merge
+		if (refineAction != HE_RefineAction::Skip)
+		{
+			for (uint32_t faceIdx = 0; faceIdx < controlCageFaces; faceIdx++)
+				patchTargets[faceIdx] = (visibility.visible[faceIdx / 64] >> (faceIdx % 64)) & 1 ? visibility.levels[faceIdx] : 0;
+
+			for (uint32_t step = 0; step <= 2 * patches.maxLevel; step++)
+			{
+				const auto stats = patches.Update(patchTargets, 1);
+
+				for (const uint32_t word : patches.ChangedWords())
+					patchUploader.MarkDirty(word);
+
+				if (!stats.splits && !stats.merges)
+					break;
+			}
+		}
+
+		if (visibility.refineList.size() == 0)
+			refineAction = HE_RefineAction::Skip;
+
+		return refineAction;
+	}
+
+
+	/************************************************************************************************/
+
+
+	UpdateTask& HalfEdgeMesh::QueueSubdivisionPrep(UpdateDispatcher& dispatcher, UpdateTask& cameraUpdate, std::span<const RefineView> views)
+	{
+		struct SubdivisionPrep
+		{
+			HalfEdgeMesh*							mesh;
+			std::array<RefineView, HE_MaxViews>		views;
+			uint32_t								viewCount;
+		};
+
+		auto& task = dispatcher.Add<SubdivisionPrep>(
+			[&](auto& builder, SubdivisionPrep& data)
+			{
+				builder.SetDebugString("Subdivision Prep");
+
+				data.mesh		= this;
+				data.viewCount	= (uint32_t)Min(views.size(), size_t(HE_MaxViews));
+				std::copy_n(views.begin(), data.viewCount, data.views.begin());
+			},
+			[](SubdivisionPrep& data, iAllocator& threadAllocator)
+			{
+				data.mesh->PrepareRefinement({ data.views.data(), data.viewCount });
+			});
+
+		task.AddInput(cameraUpdate);
+
+		return task;
+	}
+
+
+	/************************************************************************************************/
+
+
+	namespace
+	{
+		// Stages a flush straight into the context's upload space and replays its regions on the command list
+		class HE_ContextCopyQueue final : public HE_CopyQueue
+		{
+		public:
+			HE_ContextCopyQueue(Context& IN_ctx, ID3D12Resource* IN_destination) :
+				ctx			{ IN_ctx },
+				destination	{ IN_destination } {}
+
+			std::byte* Stage(HE_StagingRing&, const size_t size) override
+			{
+				upload = ctx.ReserveDirectUploadSpace(size);
+				return reinterpret_cast<std::byte*>(upload.buffer);
+			}
+
+			void Copy(const HE_StagingRing& ring, std::span<const HE_CopyRegion> regions) override
+			{
+				const size_t segmentBegin = ring.CurrentSegment() * ring.SegmentSize();
+
+				for (const auto& region : regions)
+					ctx.DeviceContext->CopyBufferRegion(
+						destination, region.destOffset,
+						upload.resource, upload.offset + region.stagingOffset - segmentBegin,
+						region.size);
+			}
+
+			Context&			ctx;
+			ID3D12Resource*		destination;
+			UploadReservation	upload = {};
+		};
+	}
+
+
+	/************************************************************************************************/
+
+
+	void HalfEdgeMesh::AdaptiveSubdivUpdate(FlexKit::FrameGraph& frameGraph, std::span<const RefineView> views, UpdateTask* prep)
 	{
+		struct CullView
+		{
+			float4x4	view;
+			Frustum		frustum;
+		};
+
+		// Matches CullViews in HE_AdaptiveCC.hlsl
+		struct CullViews
+		{
+			CullView	views[HE_MaxViews];
+			uint32_t	viewCount;
+		};
+
+		const uint32_t viewCount = (uint32_t)Min(views.size(), size_t(HE_MaxViews));
+		if (viewCount == 0)
+			return;
+
+		// Copied so the node can outlive the caller's span
+		std::array<CameraHandle, HE_MaxViews> viewCameras;
+		for (uint32_t viewIdx = 0; viewIdx < viewCount; viewIdx++)
+			viewCameras[viewIdx] = views[viewIdx].camera;
+
+		// Without a prep task the refine list is built now and sized exactly. With one it is not ready
+		// until the node runs, so the face list is sized for every control face and the node skips
+		// the dispatch when the task found nothing to refine.
+		if (!prep && PrepareRefinement(views) == HE_RefineAction::Skip)
+			return;
+
+		UpdateFacePoints(frameGraph);
+
+		const uint32_t faceListCapacity = prep ? controlCageFaces : (uint32_t)visibility.refineList.size();
+
 		struct BuildLevels
 		{
 			FrameResourceHandle meshDrawInfo		= InvalidHandle;
@@ -494,20 +813,31 @@ namespace FlexKit
 			FrameResourceHandle inputPoints	= InvalidHandle;
 			FrameResourceHandle InputFaces	= InvalidHandle;
 			FrameResourceHandle faceLookup	= InvalidHandle;
-
-			FrameResourceHandle outputCages[3];
-			FrameResourceHandle outputVerts[3];
+			FrameResourceHandle normalCones	= InvalidHandle;
+			FrameResourceHandle faceBounds	= InvalidHandle;
+			FrameResourceHandle faceList	= InvalidHandle;
+			FrameResourceHandle facePoints	= InvalidHandle;
+			FrameResourceHandle patchBits	= InvalidHandle;
+
+			FrameResourceHandle outputCages[HE_MaxLevels];
+			FrameResourceHandle outputVerts[HE_MaxLevels];
+			uint32_t			levelCount = 0;
 		};
 
 		frameGraph.AddNode<BuildLevels>(
 			{},
 			[&](FrameGraphNodeBuilder& builder, BuildLevels& subDivData)
 			{
+				if (prep)
+					builder.AddDataDependency(*prep);
+
 				subDivData.inputCage	= builder.NonPixelShaderResource(controlCage);
 				subDivData.inputPoints	= builder.NonPixelShaderResource(controlPoints);
 				subDivData.InputFaces	= builder.NonPixelShaderResource(controlFaces);
 
-				for(uint32_t i = 0; i < 3; i++)
+				subDivData.levelCount = levelCount;
+
+				for(uint32_t i = 0; i < levelCount; i++)
 				{
 					frameGraph.AddOutput(levels[i]);
 					frameGraph.AddOutput(points[i]);
@@ -520,14 +850,24 @@ namespace FlexKit
 					subDivData.backingSpace = builder.AcquireVirtualResource(GPUResourceDesc::UAVResource(spaceRequired), DASUAV);
 
 				subDivData.faceLookup			= builder.NonPixelShaderResource(faceLookup);
+				subDivData.normalCones			= builder.NonPixelShaderResource(normalCones);
+				subDivData.faceBounds			= builder.NonPixelShaderResource(faceBounds);
+				subDivData.facePoints			= builder.NonPixelShaderResource(facePoints);
+				subDivData.patchBits			= builder.CopyDest(patchBits);
+				subDivData.faceList				= builder.AcquireVirtualResource(GPUResourceDesc::StructuredResource(Max(faceListCapacity * 2 * sizeof(uint32_t), 256)), DASCopyDest);
 				subDivData.localRootSigSpace	= builder.AcquireVirtualResource(GPUResourceDesc::UAVResource(1024), DASCopyDest);
-				subDivData.constantSpace		= builder.AcquireVirtualResource(GPUResourceDesc::StructuredResource(1024), DASCopyDest);
+				subDivData.constantSpace		= builder.AcquireVirtualResource(GPUResourceDesc::StructuredResource(sizeof(CullViews)), DASCopyDest);
 
 				subDivData.meshDrawInfo		= builder.AcquireVirtualResource(GPUResourceDesc::UAVResource(1024), DASCopyDest);
-				subDivData.meshDrawFaces	= builder.AcquireVirtualResource(GPUResourceDesc::UAVResource(1 * MEGABYTE), DASUAV);
+				subDivData.meshDrawFaces	= builder.AcquireVirtualResource(GPUResourceDesc::UAVResource(Max(faceListCapacity * sizeof(HE_Face), 256)), DASUAV);
 			},
-			[this, camera](BuildLevels& subDivData, ResourceHandler& resources, Context& ctx, iAllocator& threadLocalAllocator)
+			[this, viewCameras, viewCount](BuildLevels& subDivData, ResourceHandler& resources, Context& ctx, iAllocator& threadLocalAllocator)
 			{
+				if (refineAction == HE_RefineAction::Skip)
+					return;
+
+				const uint32_t faceListCount = (uint32_t)visibility.refineList.size();
+
 				ctx.BeginEvent_DEBUG("Update Subdivision Levels");
 
 				resources.SetDebugName(subDivData.localRootSigSpace, "localRootSigSpace");
@@ -543,46 +883,74 @@ namespace FlexKit
 				setProgram.WorkGraph.Flags							= D3D12_SET_WORK_GRAPH_FLAG_INITIALIZE;
 				setProgram.Type										= D3D12_PROGRAM_TYPE_WORK_GRAPH;
 				
-				const auto constants = GetCameraConstants(camera);
-				
-				const auto f = GetFrustumVS(camera);
+				const auto constants = GetCameraConstants(viewCameras[0]);
+
+				CullViews cullViews{ .viewCount = viewCount };
+				for (uint32_t viewIdx = 0; viewIdx < viewCount; viewIdx++)
+				{
+					cullViews.views[viewIdx].view		= GetCameraConstants(viewCameras[viewIdx]).View;
+					cullViews.views[viewIdx].frustum	= GetFrustumVS(viewCameras[viewIdx]);
+				}
 
-				UploadReservation upload = ctx.ReserveDirectUploadSpace(sizeof(f));
-				memcpy(upload.buffer, &f, sizeof(f));
+				UploadReservation upload = ctx.ReserveDirectUploadSpace(sizeof(cullViews));
+				memcpy(upload.buffer, &cullViews, sizeof(cullViews));
 
 				ctx.ReserveDirectUploadSpace(upload);
 				ctx.CopyBuffer(upload, resources.GetResource(subDivData.constantSpace));
 
+				// Each face goes with its level, the highest any view asked for
+				UploadReservation	faceListUpload	= ctx.ReserveDirectUploadSpace(faceListCount * 2 * sizeof(uint32_t));
+				uint32_t*			faceListEntries	= reinterpret_cast<uint32_t*>(faceListUpload.buffer);
+
+				for (uint32_t entryIdx = 0; entryIdx < faceListCount; entryIdx++)
+				{
+					const uint32_t faceIdx = visibility.refineList[entryIdx];
+
+					faceListEntries[2 * entryIdx + 0] = faceIdx;
+					faceListEntries[2 * entryIdx + 1] = visibility.levels[faceIdx];
+				}
+
+				ctx.CopyBuffer(faceListUpload, resources.GetResource(subDivData.faceList));
+
+				// Only the words the prep task split or merged in, slots that kept their patch are not resent
+				HE_ContextCopyQueue patchQueue{ ctx, RenderSystem::globalInstance->GetDeviceResource(patchBits) };
+				patchUploader.Flush(patches.cbt.Words().data(), patchQueue);
+
 				ctx.FlushBarriers();
 
 				ctx.SetComputeRootSignature(globalRoot);
 				ctx.SetComputeConstantValue(0, 16, &constants.View);
 				ctx.SetComputeConstantValue(0, 1, &patchCount[0], 16);
 				ctx.SetComputeConstantValue(0, 1, &controlCageFaces, 17);
+				ctx.SetComputeConstantValue(0, 1, &faceListCount, 18);
 				ctx.SetComputeShaderResourceView(1, resources.GetResource(subDivData.inputCage));
 				ctx.SetComputeShaderResourceView(2, resources.GetResource(subDivData.inputPoints));
 				ctx.SetComputeShaderResourceView(3, resources.GetResource(subDivData.InputFaces));
 				ctx.SetComputeConstantBufferView(6, resources.NonPixelShaderResource(subDivData.constantSpace, ctx, Sync_Copy, Sync_Compute));
 				ctx.SetComputeShaderResourceView(7, resources.GetResource(subDivData.faceLookup));
+				ctx.SetComputeShaderResourceView(9, resources.GetResource(subDivData.normalCones));
+				ctx.SetComputeShaderResourceView(10, resources.NonPixelShaderResource(subDivData.faceList, ctx, Sync_Copy, Sync_Compute));
+				ctx.SetComputeShaderResourceView(11, resources.GetResource(subDivData.facePoints));
+				ctx.SetComputeShaderResourceView(12, resources.GetResource(subDivData.faceBounds));
 				ctx.SetComputeUnorderedAccessView(8, resources.GetResource(subDivData.meshDrawFaces));
 
 				DescriptorHeap cages;
 				DescriptorHeap points;
-				cages.Init2(ctx, globalRoot->GetDescHeap(0), 3, threadLocalAllocator);
-				points.Init2(ctx, globalRoot->GetDescHeap(1), 3, threadLocalAllocator);
+				cages.Init2(ctx, globalRoot->GetDescHeap(0), subDivData.levelCount, threadLocalAllocator);
+				points.Init2(ctx, globalRoot->GetDescHeap(1), subDivData.levelCount, threadLocalAllocator);
 
-				for(auto&& [idx, cage] : enumerate(subDivData.outputCages))
-					cages.SetUAVStructured(ctx, idx, resources.GetResource(cage), 16);
-	
-				for (auto&& [idx, p] : enumerate(subDivData.outputVerts))
-					points.SetUAVStructured(ctx, idx, resources.GetResource(p), sizeof(HalfEdgeVertex));
+				for (uint32_t idx = 0; idx < subDivData.levelCount; idx++)
+				{
+					cages.SetUAVStructured(ctx, idx, resources.GetResource(subDivData.outputCages[idx]), TwinEdgeStride);
+					points.SetUAVStructured(ctx, idx, resources.GetResource(subDivData.outputVerts[idx]), sizeof(HalfEdgeVertex));
+				}
 
 				ctx.SetComputeDescriptorTable(4, cages); // cages
 				ctx.SetComputeDescriptorTable(5, points); // points
 
 				ctx.DeviceContext->SetProgram(&setProgram);
 
-				const uint dispatchX = controlCageFaces / 32 + (controlCageFaces % 32 == 0 ? 0 : 1);
+				const uint dispatchX = faceListCount / 32 + (faceListCount % 32 == 0 ? 0 : 1);
 				struct
 				{
 					uint	dispatchesRemaining;
@@ -606,11 +974,156 @@ namespace FlexKit
 				dispatch.NodeCPUInput.RecordStrideInBytes	= sizeof(arguments);
 				ctx.DeviceContext->DispatchGraph(&dispatch);
 				
-				for (auto&& [idx, cage] : enumerate(subDivData.outputCages))
-					ctx.AddUAVBarrier(resources.GetResource(cage));
+				for (uint32_t idx = 0; idx < subDivData.levelCount; idx++)
+				{
+					ctx.AddUAVBarrier(resources.GetResource(subDivData.outputCages[idx]));
+					ctx.AddUAVBarrier(resources.GetResource(subDivData.outputVerts[idx]));
+				}
+
+				ctx.EndEvent_DEBUG();
+			}
+		);
+	}
 
-				for (auto&& [idx, verts] : enumerate(subDivData.outputVerts))
-					ctx.AddUAVBarrier(resources.GetResource(verts));
+
+	/************************************************************************************************/
+
+
+	void HalfEdgeMesh::UpdateFacePoints(FlexKit::FrameGraph& frameGraph)
+	{
+		if (facePointVersion == cageVersion)
+			return;
+
+		facePointVersion = cageVersion;
+
+		struct BuildFacePoints
+		{
+			FrameResourceHandle inputCage	= InvalidHandle;
+			FrameResourceHandle inputPoints	= InvalidHandle;
+			FrameResourceHandle inputFaces	= InvalidHandle;
+			FrameResourceHandle facePoints	= InvalidHandle;
+			uint32_t			faceCount	= 0;
+		};
+
+		frameGraph.AddOutput(facePoints);
+
+		frameGraph.AddNode<BuildFacePoints>(
+			{},
+			[&](FrameGraphNodeBuilder& builder, BuildFacePoints& faceData)
+			{
+				builder.Requires(FacePass);
+				faceData.inputCage		= builder.NonPixelShaderResource(controlCage);
+				faceData.inputPoints	= builder.NonPixelShaderResource(controlPoints);
+				faceData.inputFaces		= builder.NonPixelShaderResource(controlFaces);
+				faceData.facePoints		= builder.UnorderedAccess(facePoints);
+				faceData.faceCount		= controlCageFaces;
+			},
+			[](BuildFacePoints& faceData, ResourceHandler& resources, Context& ctx, iAllocator& threadLocalAllocator)
+			{
+				ctx.BeginEvent_DEBUG("Subdivision : Face Points");
+
+				ctx.SetComputePipelineState(FacePass, threadLocalAllocator);
+				ctx.SetComputeShaderResourceView(0, resources.NonPixelShaderResource(faceData.inputCage, ctx));
+				ctx.SetComputeShaderResourceView(1, resources.NonPixelShaderResource(faceData.inputPoints, ctx));
+				ctx.SetComputeShaderResourceView(2, resources.NonPixelShaderResource(faceData.inputFaces, ctx));
+				ctx.SetComputeUnorderedAccessView(3, resources.UAV(faceData.facePoints, ctx));
+				ctx.SetComputeConstantValue(4, 1, &faceData.faceCount);
+				ctx.Dispatch({ faceData.faceCount / 64 + (faceData.faceCount % 64 == 0 ? 0 : 1), 1, 1 });
+
+				ctx.AddUAVBarrier(resources.GetResource(faceData.facePoints));
+
+				ctx.EndEvent_DEBUG();
+			});
+	}
+
+
+	/************************************************************************************************/
+
+
+	void HalfEdgeMesh::SetControlPoints(std::span<const uint32_t> vertices, std::span<const float3> positions)
+	{
+		const size_t count = Min(vertices.size(), positions.size());
+
+		for (size_t I = 0; I < count; I++)
+		{
+			const uint32_t vertex = vertices[I];
+			if (vertex >= cpuCage.points.size())
+				continue;
+
+			cpuCage.points[vertex]				= positions[I];
+			controlPointData[vertex].xyz[0]		= positions[I].x;
+			controlPointData[vertex].xyz[1]		= positions[I].y;
+			controlPointData[vertex].xyz[2]		= positions[I].z;
+
+			pointUploader.MarkDirty(vertex);
+			movedVertices.push_back(vertex);
+		}
+
+		if (count)
+			cageVersion++; // Visibility and cones depend on the points
+	}
+
+
+	/************************************************************************************************/
+
+
+	void HalfEdgeMesh::UploadControlPoints(FlexKit::FrameGraph& frameGraph)
+	{
+		if (!pointUploader.IsDirty() && !coneUploader.IsDirty() && !boundsUploader.IsDirty())
+			return;
+
+		// Cones bound the limit surface of the moved points, refit around them. Past a quarter of the
+		// cage the parallel rebuild is cheaper.
+		if (movedVertices.size() * 4 > cpuCage.points.size())
+		{
+			cpuCones = BuildNormalCones(cpuCage, *allocator, { .clusterSize = 32 });
+			coneUploader.MarkAllDirty();
+			boundsUploader.MarkAllDirty();
+		}
+		else if (movedVertices.size())
+		{
+			dirtyCones.clear();
+			RefitNormalCones(cpuCage, vertexEdges, movedVertices, cpuCones, dirtyCones, { .clusterSize = 32 });
+
+			for (const uint32_t cone : dirtyCones)
+			{
+				coneUploader.MarkDirty(cone);
+
+				if (cone < cpuCones.faceCount)
+					boundsUploader.MarkDirty(cone);
+			}
+		}
+
+		movedVertices.clear();
+
+		struct UploadPoints
+		{
+			FrameResourceHandle points	= InvalidHandle;
+			FrameResourceHandle cones	= InvalidHandle;
+			FrameResourceHandle bounds	= InvalidHandle;
+		};
+
+		frameGraph.AddNode<UploadPoints>(
+			{},
+			[&](FrameGraphNodeBuilder& builder, UploadPoints& uploadData)
+			{
+				uploadData.points	= builder.CopyDest(controlPoints);
+				uploadData.cones	= builder.CopyDest(normalCones);
+				uploadData.bounds	= builder.CopyDest(faceBounds);
+			},
+			[this](UploadPoints& uploadData, ResourceHandler& resources, Context& ctx, iAllocator& threadLocalAllocator)
+			{
+				ctx.BeginEvent_DEBUG("Upload Control Points");
+
+				ctx.FlushBarriers();
+
+				HE_ContextCopyQueue pointQueue{ ctx, RenderSystem::globalInstance->GetDeviceResource(controlPoints) };
+				HE_ContextCopyQueue coneQueue{ ctx, RenderSystem::globalInstance->GetDeviceResource(normalCones) };
+				HE_ContextCopyQueue boundsQueue{ ctx, RenderSystem::globalInstance->GetDeviceResource(faceBounds) };
+
+				pointUploader.Flush(controlPointData.data(), pointQueue);
+				coneUploader.Flush(cpuCones.cones.data(), coneQueue);
+				boundsUploader.Flush(cpuCones.bounds.data(), boundsQueue);
 
 				ctx.EndEvent_DEBUG();
 			}
@@ -623,7 +1136,7 @@ namespace FlexKit
 
 	void HalfEdgeMesh::DrawSubDivLevel_DEBUG(FrameGraph& frameGraph, CameraHandle camera, UpdateTask* update, ResourceHandle renderTarget, ResourceHandle depthTarget, uint32_t targetLevel)
 	{
-		if (levelsBuilt == 0)
+		if (levelsBuilt == 0 || targetLevel >= levelCount)
 			return;
 
 		struct DrawLevel
@@ -652,6 +1165,9 @@ namespace FlexKit
 			},
 			[this, camera, targetLevel](DrawLevel& visData, ResourceHandler& resources, Context& ctx, iAllocator& threadLocalAllocator)
 			{
+				if (!inView)
+					return;
+
 				ctx.BeginEvent_DEBUG("Draw HE Mesh");
 				ctx.FlushBarriers();
 
@@ -0,0 +1,282 @@
+#include "HalfEdgeMeshlets.hpp"
+
+#include <algorithm>
+#include <cmath>
+
+
+namespace FlexKit
+{	/************************************************************************************************/
+
+
+	uint32_t WeldLevelVertices(const HE_Level& level, Vector<uint32_t>& remap)
+	{
+		const uint32_t pointCount = (uint32_t)level.points.size();
+
+		remap.resize(pointCount);
+		for (uint32_t i = 0; i < pointCount; i++)
+			remap[i] = i;
+
+		auto Find = [&](uint32_t v) -> uint32_t
+		{
+			while (remap[v] != v)
+			{
+				remap[v]	= remap[remap[v]];
+				v			= remap[v];
+			}
+
+			return v;
+		};
+
+		auto Union = [&](uint32_t a, uint32_t b)
+		{
+			a = Find(a);
+			b = Find(b);
+
+			if (a != b)
+				remap[Max(a, b)] = Min(a, b);
+		};
+
+		const HE_LevelView view{ level };
+
+		// A half-edge and its twin run in opposite directions, so each end point of one
+		// is the same surface vertex as the opposite end point of the other
+		for (uint32_t e = 0; e < view.HalfEdgeCount(); e++)
+		{
+			const uint32_t twin = view.Twin(e);
+			if (twin == HE_BorderValue || twin < e)
+				continue;
+
+			Union(view.Vert(e), view.Vert(view.Next(twin)));
+			Union(view.Vert(view.Next(e)), view.Vert(twin));
+		}
+
+		uint32_t uniqueCount = 0;
+		for (uint32_t i = 0; i < pointCount; i++)
+		{
+			remap[i] = Find(i);
+			uniqueCount += remap[i] == i ? 1 : 0;
+		}
+
+		return uniqueCount;
+	}
+
+
+	/************************************************************************************************/
+
+
+	HE_MeshletList BuildMeshlets(const HE_Level& level, iAllocator& allocator, const HE_MeshletOptions& options)
+	{
+		HE_MeshletList out{ allocator };
+
+		const uint32_t maxVertices		= Min(Max(options.maxVertices, 4u), 256u);
+		const uint32_t maxPrimitives	= Max(options.maxPrimitives, 2u);
+		const uint32_t patchCount		= level.PatchCount();
+		const uint32_t pointCount		= (uint32_t)level.points.size();
+		const uint32_t unassigned		= 0xffffffff;
+
+		const HE_LevelView view{ level };
+
+		Vector<uint32_t> remap{ allocator };
+		WeldLevelVertices(level, remap);
+
+		Vector<uint32_t> localIdx		{ allocator };
+		Vector<uint32_t> localOwner		{ allocator };
+		Vector<uint32_t> patchOwner		{ allocator };
+		Vector<uint32_t> frontierOwner	{ allocator };
+		Vector<uint32_t> frontier		{ allocator };
+
+		localIdx.resize(pointCount);
+		localOwner.resize(pointCount);
+		patchOwner.resize(patchCount);
+		frontierOwner.resize(patchCount);
+
+		std::fill(localOwner.begin(), localOwner.end(), unassigned);
+		std::fill(patchOwner.begin(), patchOwner.end(), unassigned);
+		std::fill(frontierOwner.begin(), frontierOwner.end(), unassigned);
+
+		auto GetCorners = [&](const uint32_t patch, uint32_t (&corners)[4])
+		{
+			for (uint32_t i = 0; i < 4; i++)
+				corners[i] = remap[view.Vert(4 * patch + i)];
+		};
+
+		auto NewVertexCount = [&](const uint32_t patch, const uint32_t meshletIdx) -> uint32_t
+		{
+			uint32_t corners[4];
+			GetCorners(patch, corners);
+
+			uint32_t count = 0;
+			for (uint32_t i = 0; i < 4; i++)
+			{
+				const bool repeated = std::find(corners, corners + i, corners[i]) != corners + i;
+				count += (localOwner[corners[i]] != meshletIdx && !repeated) ? 1 : 0;
+			}
+
+			return count;
+		};
+
+		for (uint32_t seed = 0; seed < patchCount; seed++)
+		{
+			if (patchOwner[seed] != unassigned)
+				continue;
+
+			const uint32_t meshletIdx = (uint32_t)out.meshlets.size();
+
+			HE_Meshlet meshlet{
+				.vertexOffset		= (uint32_t)out.vertexIndices.size(),
+				.vertexCount		= 0,
+				.primitiveOffset	= (uint32_t)out.primitives.size(),
+				.primitiveCount		= 0,
+			};
+
+			frontier.clear();
+			frontier.push_back(seed);
+			frontierOwner[seed] = meshletIdx;
+
+			while (frontier.size() && meshlet.primitiveCount + 2 <= maxPrimitives)
+			{
+				uint32_t bestSlot	= unassigned;
+				uint32_t bestCost	= unassigned;
+
+				for (uint32_t slot = 0; slot < frontier.size(); slot++)
+				{
+					const uint32_t cost = NewVertexCount(frontier[slot], meshletIdx);
+
+					if (cost < bestCost || (cost == bestCost && frontier[slot] < frontier[bestSlot]))
+					{
+						bestCost = cost;
+						bestSlot = slot;
+					}
+				}
+
+				if (meshlet.vertexCount + bestCost > maxVertices)
+					break;
+
+				const uint32_t patch = frontier[bestSlot];
+				frontier[bestSlot] = frontier.back();
+				frontier.pop_back();
+
+				patchOwner[patch] = meshletIdx;
+
+				uint32_t corners[4];
+				uint32_t local[4];
+				GetCorners(patch, corners);
+
+				for (uint32_t i = 0; i < 4; i++)
+				{
+					if (localOwner[corners[i]] != meshletIdx)
+					{
+						localOwner[corners[i]]	= meshletIdx;
+						localIdx[corners[i]]	= meshlet.vertexCount++;
+						out.vertexIndices.push_back(corners[i]);
+					}
+
+					local[i] = localIdx[corners[i]];
+				}
+
+				out.primitives.push_back(HE_PackTriangle(local[0], local[1], local[2]));
+				out.primitives.push_back(HE_PackTriangle(local[0], local[2], local[3]));
+				meshlet.primitiveCount += 2;
+
+				for (uint32_t i = 0; i < 4; i++)
+				{
+					const uint32_t twin = view.Twin(4 * patch + i);
+					if (twin == HE_BorderValue)
+						continue;
+
+					const uint32_t neighbour = twin / 4;
+					if (patchOwner[neighbour] == unassigned && frontierOwner[neighbour] != meshletIdx)
+					{
+						frontierOwner[neighbour] = meshletIdx;
+						frontier.push_back(neighbour);
+					}
+				}
+			}
+
+			// Patches left in the frontier become seeds again for later meshlets
+			HE_MeshletBounds bounds{
+				.center = float3{ 0, 0, 0 },
+				.radius = 0.0f,
+				.min	= level.points[out.vertexIndices[meshlet.vertexOffset]],
+				.max	= level.points[out.vertexIndices[meshlet.vertexOffset]],
+			};
+
+			for (uint32_t i = 0; i < meshlet.vertexCount; i++)
+			{
+				const float3 p = level.points[out.vertexIndices[meshlet.vertexOffset + i]];
+				bounds.min = float3{ Min(bounds.min.x, p.x), Min(bounds.min.y, p.y), Min(bounds.min.z, p.z) };
+				bounds.max = float3{ Max(bounds.max.x, p.x), Max(bounds.max.y, p.y), Max(bounds.max.z, p.z) };
+			}
+
+			bounds.center = (bounds.min + bounds.max) / 2.0f;
+
+			for (uint32_t i = 0; i < meshlet.vertexCount; i++)
+			{
+				const float3 d = level.points[out.vertexIndices[meshlet.vertexOffset + i]] - bounds.center;
+				bounds.radius = Max(bounds.radius, std::sqrt(d.x * d.x + d.y * d.y + d.z * d.z));
+			}
+
+			out.meshlets.push_back(meshlet);
+			out.bounds.push_back(bounds);
+		}
+
+		return out;
+	}
+
+
+	/************************************************************************************************/
+
+
+	HE_MeshletStats GetMeshletStats(const HE_MeshletList& meshlets, const HE_Level& level, const HE_MeshletOptions& options)
+	{
+		HE_MeshletStats stats;
+		stats.meshletCount	= (uint32_t)meshlets.meshlets.size();
+		stats.patchCount	= level.PatchCount();
+
+		for (const auto& meshlet : meshlets.meshlets)
+		{
+			stats.triangleCount			+= meshlet.primitiveCount;
+			stats.emittedVertexCount	+= meshlet.vertexCount;
+		}
+
+		Vector<uint32_t> remap{ SystemAllocator };
+		stats.uniqueVertexCount = WeldLevelVertices(level, remap);
+
+		if (stats.triangleCount)
+			stats.verticesPerTriangle = float(stats.emittedVertexCount) / float(stats.triangleCount);
+
+		if (stats.meshletCount)
+		{
+			stats.primitiveFillRate	= float(stats.triangleCount)		/ float(stats.meshletCount * options.maxPrimitives);
+			stats.vertexFillRate	= float(stats.emittedVertexCount)	/ float(stats.meshletCount * options.maxVertices);
+		}
+
+		return stats;
+	}
+
+
+}	/************************************************************************************************/
+
+/**********************************************************************
+
+Copyright (c) 2024 Robert May
+
+Permission is hereby granted, free of charge, to any person obtaining a
+copy of this software and associated documentation files (the "Software"),
+to deal in the Software without restriction, including without limitation
+the rights to use, copy, modify, merge, publish, distribute, sublicense,
+and/or sell copies of the Software, and to permit persons to whom the
+Software is furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included
+in all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+**********************************************************************/
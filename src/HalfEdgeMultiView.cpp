@@ -0,0 +1,145 @@
+#include "HalfEdgeMultiView.hpp"
+
+#include <bit>
+
+
+namespace FlexKit
+{	/************************************************************************************************/
+
+
+	HE_MultiViewStats RefineMultiView(
+		const HE_ControlCage&			cage,
+		const HE_NormalCones&			cones,
+		std::span<const HE_ViewState>	views,
+		Vector<uint32_t>&				outFaces,
+		Vector<uint8_t>&				outLevels,
+		const HE_LODOptions&			options)
+	{
+		const HE_ControlCageView view{ cage };
+
+		HE_MultiViewStats stats;
+		stats.viewCount = (uint32_t)views.size();
+		stats.faceCount = view.FaceCount();
+
+		outFaces.clear();
+		outLevels.clear();
+
+		if (views.empty() || views.size() > HE_MaxViews)
+			return stats;
+
+		for (uint32_t clusterBegin = 0; clusterBegin < stats.faceCount; clusterBegin += cones.clusterSize)
+		{
+			const uint32_t clusterEnd	= Min(clusterBegin + cones.clusterSize, stats.faceCount);
+			const auto&	clusterCone		= cones.Cluster(clusterBegin);
+
+			const float3 clusterMin = clusterCone.center - float3{ clusterCone.radius, clusterCone.radius, clusterCone.radius };
+			const float3 clusterMax = clusterCone.center + float3{ clusterCone.radius, clusterCone.radius, clusterCone.radius };
+
+			// Views that can see anything in this cluster, the rest are skipped for every face in it
+			uint32_t clusterMask = 0;
+			for (uint32_t viewIdx = 0; viewIdx < views.size(); viewIdx++)
+			{
+				stats.viewTests++;
+
+				if (HE_Intersects(views[viewIdx].frustum, clusterMin, clusterMax) &&
+					!IsBackFacing(clusterCone, views[viewIdx].position))
+					clusterMask |= 1u << viewIdx;
+			}
+
+			if (!clusterMask)
+			{
+				stats.clustersRejected++;
+				continue;
+			}
+
+			for (uint32_t faceIdx = clusterBegin; faceIdx < clusterEnd; faceIdx++)
+			{
+				const HE_Face			face		= view.GetFace(faceIdx);
+				const HE_PatchBounds&	bounds		= cones.Bounds(faceIdx);	// One-ring hull, holds the limit patch
+				const auto&				faceCone	= cones.Face(faceIdx);
+
+				bool		visible	= false;
+				uint32_t	level	= 0;
+
+				for (uint32_t mask = clusterMask; mask; mask &= mask - 1)
+				{
+					const auto& viewState = views[std::countr_zero(mask)];
+
+					stats.viewTests++;
+
+					if (!HE_Intersects(viewState.frustum, bounds.min, bounds.max) || IsBackFacing(faceCone, viewState.position))
+						continue;
+
+					const uint32_t viewLevel = HE_FaceLOD(viewState, faceCone, options);
+
+					stats.visiblePerView++;
+					stats.independentWork += uint64_t(face.edgeCount) << (2 * viewLevel);
+
+					visible	= true;
+					level	= Max(level, viewLevel);
+				}
+
+				if (!visible)
+					continue;
+
+				stats.visible++;
+				stats.sharedWork += uint64_t(face.edgeCount) << (2 * level);
+
+				outFaces.push_back(faceIdx);
+				outLevels.push_back((uint8_t)level);
+			}
+		}
+
+		return stats;
+	}
+
+
+	/************************************************************************************************/
+
+
+	Vector<HE_MultiViewStats> MeasureMultiViewScaling(
+		const HE_ControlCage&			cage,
+		const HE_NormalCones&			cones,
+		std::span<const HE_ViewState>	views,
+		iAllocator&						allocator,
+		const HE_LODOptions&			options)
+	{
+		Vector<HE_MultiViewStats>	results{ allocator };
+		Vector<uint32_t>			faces{ allocator };
+		Vector<uint8_t>				levels{ allocator };
+
+		const size_t viewCount = Min(views.size(), size_t(HE_MaxViews));
+		results.reserve(viewCount);
+
+		for (size_t count = 1; count <= viewCount; count++)
+			results.push_back(RefineMultiView(cage, cones, views.first(count), faces, levels, options));
+
+		return results;
+	}
+
+
+}	/************************************************************************************************/
+
+/**********************************************************************
+
+Copyright (c) 2024 Robert May
+
+Permission is hereby granted, free of charge, to any person obtaining a
+copy of this software and associated documentation files (the "Software"),
+to deal in the Software without restriction, including without limitation
+the rights to use, copy, modify, merge, publish, distribute, sublicense,
+and/or sell copies of the Software, and to permit persons to whom the
+Software is furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included
+in all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+**********************************************************************/
@@ -0,0 +1,537 @@
+#include "HalfEdgePaging.hpp"
+
+#include <algorithm>
+#include <cstring>
+#include <queue>
+
+
+namespace FlexKit
+{	/************************************************************************************************/
+
+
+	HE_PageAllocator::HE_PageAllocator(iAllocator& allocator, const uint32_t IN_maxPages) :
+		maxPages	{ IN_maxPages },
+		owners		{ allocator },
+		freeList	{ allocator } {}
+
+
+	uint32_t HE_PageAllocator::Allocate(const uint32_t owner) noexcept
+	{
+		if (residentCount >= maxPages)
+			return HE_InvalidPage;
+
+		uint32_t page;
+
+		if (freeList.size())
+		{
+			page = freeList.back();
+			freeList.pop_back();
+		}
+		else
+		{
+			page = (uint32_t)owners.size();
+			owners.push_back(HE_InvalidPage);
+		}
+
+		owners[page] = owner;
+		residentCount++;
+
+		return page;
+	}
+
+
+	void HE_PageAllocator::Free(const uint32_t page) noexcept
+	{
+		owners[page] = HE_InvalidPage;
+		freeList.push_back(page);
+		residentCount--;
+	}
+
+
+	void HE_PageAllocator::Compact(Vector<HE_PageMove>& outMoves)
+	{
+		outMoves.clear();
+
+		uint32_t hole = 0;
+
+		for (uint32_t page = residentCount; page < owners.size(); page++)
+		{
+			if (owners[page] == HE_InvalidPage)
+				continue;
+
+			while (owners[hole] != HE_InvalidPage)
+				hole++;
+
+			outMoves.push_back({ page, hole, owners[page] });
+
+			owners[hole] = owners[page];
+			owners[page] = HE_InvalidPage;
+		}
+
+		owners.resize(residentCount);
+		freeList.clear();
+	}
+
+
+	HE_PageStats HE_PageAllocator::GetStats() const noexcept
+	{
+		HE_PageStats stats;
+		stats.pageCount		= (uint32_t)owners.size();
+		stats.residentPages	= residentCount;
+		stats.highWater		= (uint32_t)owners.size();
+
+		while (stats.highWater && owners[stats.highWater - 1] == HE_InvalidPage)
+			stats.highWater--;
+
+		return stats;
+	}
+
+
+	/************************************************************************************************/
+
+
+	HE_PagedLevels::HE_PagedLevels(iAllocator& allocator, const HE_ControlCage& IN_cage, const HE_PagedLevelOptions& options) :
+		cage				{ &IN_cage },
+		levelCount			{ Min(options.levelCount, Max(HE_MaxLevelCount(IN_cage.halfEdges.size()), 1u) - 1) },
+		parentsPerPage		{ Max(options.parentsPerPage, 1u) },
+		pages				{ allocator, options.maxPages },
+		pageTable			{ allocator },
+		needed				{ allocator },
+		required			{ allocator },
+		neighbourOffsets	{ allocator },
+		neighbours			{ allocator },
+		moves				{ allocator },
+		edges				{ allocator },
+		flags				{ allocator },
+		points				{ allocator }
+	{
+		const uint32_t halfEdgeCount = (uint32_t)IN_cage.halfEdges.size();
+
+		tableOffset[0] = 0;
+
+		for (uint32_t levelIdx = 0; levelIdx < levelCount; levelIdx++)
+		{
+			parentCount[levelIdx]		= halfEdgeCount << (2 * levelIdx);
+			tableOffset[levelIdx + 1]	= tableOffset[levelIdx] + (parentCount[levelIdx] + parentsPerPage - 1) / parentsPerPage;
+		}
+
+		pageTable.resize(tableOffset[levelCount]);
+		needed.resize(tableOffset[levelCount]);
+		required.resize(IN_cage.faces.size());
+
+		std::fill(pageTable.begin(), pageTable.end(), HE_InvalidPage);
+		std::fill(required.begin(), required.end(), uint8_t(0));
+
+		// Faces sharing a vertex with each face, the inputs a face reads when it is subdivided
+		const HE_ControlCageView view{ IN_cage };
+
+		std::vector<uint32_t> faceNeighbours;
+
+		neighbourOffsets.reserve(IN_cage.faces.size() + 1);
+		neighbourOffsets.push_back(0);
+
+		for (uint32_t faceIdx = 0; faceIdx < view.FaceCount(); faceIdx++)
+		{
+			const HE_Face face = view.GetFace(faceIdx);
+
+			faceNeighbours.clear();
+
+			for (uint32_t i = 0; i < face.edgeCount; i++)
+			{
+				const uint32_t edgeID = face.begin + i;
+
+				uint32_t itr = RotateSelectionCCW(view, edgeID);
+				for (uint32_t n = 0; itr != HE_BorderValue && itr != edgeID && n < HE_MaxValence; n++)
+				{
+					faceNeighbours.push_back(IN_cage.faceLookup[itr]);
+					itr = RotateSelectionCCW(view, itr);
+				}
+
+				itr = RotateSelectionCW(view, edgeID);
+				for (uint32_t n = 0; itr != HE_BorderValue && itr != edgeID && n < HE_MaxValence; n++)
+				{
+					faceNeighbours.push_back(IN_cage.faceLookup[itr]);
+					itr = RotateSelectionCW(view, itr);
+				}
+			}
+
+			std::sort(faceNeighbours.begin(), faceNeighbours.end());
+			faceNeighbours.erase(std::unique(faceNeighbours.begin(), faceNeighbours.end()), faceNeighbours.end());
+
+			for (const uint32_t neighbour : faceNeighbours)
+			{
+				if (neighbour != faceIdx)
+					neighbours.push_back(neighbour);
+			}
+
+			neighbourOffsets.push_back((uint32_t)neighbours.size());
+		}
+	}
+
+
+	/************************************************************************************************/
+
+
+	HE_ResidencyStats HE_PagedLevels::UpdateResidency(std::span<const uint8_t> faceLevels)
+	{
+		const uint32_t faceCount	= (uint32_t)required.size();
+		const uint32_t topLevel		= levelCount + 1;
+
+		for (uint32_t faceIdx = 0; faceIdx < faceCount; faceIdx++)
+			required[faceIdx] = (uint8_t)Min(faceIdx < faceLevels.size() ? uint32_t(faceLevels[faceIdx]) : 0u, topLevel);
+
+		// Each pass carries levels one more face outwards, and a level fades out after topLevel faces
+		for (uint32_t pass = 1; pass < topLevel; pass++)
+		{
+			bool changed = false;
+
+			for (uint32_t faceIdx = 0; faceIdx < faceCount; faceIdx++)
+			{
+				for (uint32_t itr = neighbourOffsets[faceIdx]; itr < neighbourOffsets[faceIdx + 1]; itr++)
+				{
+					const uint8_t neighbourLevel = required[neighbours[itr]];
+
+					if (neighbourLevel > required[faceIdx] + 1)
+					{
+						required[faceIdx]	= neighbourLevel - 1;
+						changed				= true;
+					}
+				}
+			}
+
+			if (!changed)
+				break;
+		}
+
+		// Level L of face f needs the parents of f at L, faces at level n hold levels [0, n)
+		std::fill(needed.begin(), needed.end(), uint8_t(0));
+
+		uint32_t neededPages	= 0;
+		uint32_t levelLimit		= 1;
+
+		for (uint32_t level = 1; level <= levelCount; level++)
+		{
+			uint32_t levelPages = 0;
+
+			for (uint32_t faceIdx = 0; faceIdx < faceCount; faceIdx++)
+			{
+				if (required[faceIdx] <= level)
+					continue;
+
+				const HE_Face	face		= cage->faces[faceIdx];
+				const uint32_t	shift		= 2 * (level - 1);
+				const uint32_t	firstEntry	= tableOffset[level - 1] + (face.begin << shift) / parentsPerPage;
+				const uint32_t	lastEntry	= tableOffset[level - 1] + (((face.begin + face.edgeCount) << shift) - 1) / parentsPerPage;
+
+				for (uint32_t entry = firstEntry; entry <= lastEntry; entry++)
+				{
+					levelPages		+= needed[entry] ? 0 : 1;
+					needed[entry]	 = 1;
+				}
+			}
+
+			if (neededPages + levelPages > pages.maxPages)
+			{
+				std::fill(needed.begin() + tableOffset[level - 1], needed.end(), uint8_t(0));
+				break;
+			}
+
+			neededPages += levelPages;
+			levelLimit	 = level + 1;
+		}
+
+		// Clamping keeps the neighbour widening intact, both sides drop to the same limit
+		for (auto& level : required)
+			level = (uint8_t)Min(uint32_t(level), levelLimit);
+
+		HE_ResidencyStats stats;
+		stats.levelLimit = levelLimit;
+
+		// Frees first so the allocations below always fit in maxPages
+		for (uint32_t entry = 0; entry < pageTable.size(); entry++)
+		{
+			if (!needed[entry] && pageTable[entry] != HE_InvalidPage)
+			{
+				pages.Free(pageTable[entry]);
+				pageTable[entry] = HE_InvalidPage;
+				stats.unmapped++;
+			}
+		}
+
+		for (uint32_t entry = 0; entry < pageTable.size(); entry++)
+		{
+			if (needed[entry] && pageTable[entry] == HE_InvalidPage)
+			{
+				pageTable[entry] = pages.Allocate(entry);
+				stats.mapped++;
+			}
+		}
+
+		if (edges.size() < pages.PageCount() * parentsPerPage * EdgesPerParent)
+		{
+			edges.resize(pages.PageCount() * parentsPerPage * EdgesPerParent);
+			flags.resize(pages.PageCount() * parentsPerPage * PatchesPerParent);
+			points.resize(pages.PageCount() * parentsPerPage * PointsPerParent);
+		}
+
+		stats.residentPages = pages.ResidentCount();
+
+		return stats;
+	}
+
+
+	/************************************************************************************************/
+
+
+	void HE_PagedLevels::Build(const HE_Level& level0, const uint32_t threadCount)
+	{
+		for (uint32_t level = 1; level <= levelCount; level++)
+		{
+			auto SubdivideLevel = [&](const auto& view)
+			{
+				const uint32_t entryBegin = tableOffset[level - 1];
+
+				HE_ParallelFor(tableOffset[level] - entryBegin,
+					[&](const uint32_t begin, const uint32_t end)
+					{
+						for (uint32_t entry = entryBegin + begin; entry < entryBegin + end; entry++)
+						{
+							const uint32_t page = pageTable[entry];
+							if (page == HE_InvalidPage)
+								continue;
+
+							const uint32_t firstParent	= (entry - entryBegin) * parentsPerPage;
+							const uint32_t lastParent	= Min(firstParent + parentsPerPage, parentCount[level - 1]);
+
+							// Pages can straddle faces, only the parents of faces at this level have their inputs resident
+							for (uint32_t parent = firstParent; parent < lastParent; parent++)
+							{
+								if (required[FaceOfParent(level, parent)] <= level)
+									continue;
+
+								HE_SubdivideFace(view, parent,
+									[&](const uint32_t idx) -> HE_TwinEdge&	{ return edges[(page * parentsPerPage + idx / EdgesPerParent - firstParent) * EdgesPerParent + idx % EdgesPerParent]; },
+									[&](const uint32_t idx) -> uint8_t&		{ return flags[(page * parentsPerPage + idx / PatchesPerParent - firstParent) * PatchesPerParent + idx % PatchesPerParent]; },
+									[&](const uint32_t idx) -> float3&		{ return points[(page * parentsPerPage + idx / PointsPerParent - firstParent) * PointsPerParent + idx % PointsPerParent]; });
+							}
+						}
+					}, threadCount, 64);
+			};
+
+			if (level == 1)
+				SubdivideLevel(HE_LevelView{ level0 });
+			else
+				SubdivideLevel(HE_PagedLevelView{ *this, level - 1 });
+		}
+	}
+
+
+	/************************************************************************************************/
+
+
+	void HE_PagedLevels::Compact()
+	{
+		pages.Compact(moves);
+
+		const uint32_t edgesPerPage		= parentsPerPage * EdgesPerParent;
+		const uint32_t patchesPerPage	= parentsPerPage * PatchesPerParent;
+		const uint32_t pointsPerPage	= parentsPerPage * PointsPerParent;
+
+		for (const auto& move : moves)
+		{
+			memcpy(edges.data() + move.to * edgesPerPage, edges.data() + move.from * edgesPerPage, edgesPerPage * sizeof(HE_TwinEdge));
+			memcpy(flags.data() + move.to * patchesPerPage, flags.data() + move.from * patchesPerPage, patchesPerPage);
+			memcpy(points.data() + move.to * pointsPerPage, points.data() + move.from * pointsPerPage, pointsPerPage * sizeof(float3));
+
+			pageTable[move.owner] = move.to;
+		}
+
+		edges.resize(pages.PageCount() * edgesPerPage);
+		flags.resize(pages.PageCount() * patchesPerPage);
+		points.resize(pages.PageCount() * pointsPerPage);
+	}
+
+
+	/************************************************************************************************/
+
+
+	uint32_t HE_PagedLevels::Translate(const uint32_t level, const uint32_t parent) const noexcept
+	{
+		if (level == 0 || level > levelCount || parent >= parentCount[level - 1])
+			return HE_InvalidPage;
+
+		const uint32_t page = pageTable[tableOffset[level - 1] + parent / parentsPerPage];
+
+		return page == HE_InvalidPage ? HE_InvalidPage : page * parentsPerPage + parent % parentsPerPage;
+	}
+
+
+	HE_TwinEdge HE_PagedLevels::Edge(const uint32_t level, const uint32_t halfEdge) const noexcept
+	{
+		const uint32_t slot = Translate(level, halfEdge / EdgesPerParent);
+
+		return slot == HE_InvalidPage ? HE_TwinEdge{ HE_BorderValue, 0 } : edges[slot * EdgesPerParent + halfEdge % EdgesPerParent];
+	}
+
+
+	uint8_t HE_PagedLevels::EdgeFlags(const uint32_t level, const uint32_t halfEdge) const noexcept
+	{
+		const uint32_t slot = Translate(level, halfEdge / EdgesPerParent);
+
+		return slot == HE_InvalidPage ? 0 : HE_PatchEdgeFlags(flags[slot * PatchesPerParent + (halfEdge / 4) % PatchesPerParent], halfEdge);
+	}
+
+
+	float3 HE_PagedLevels::Point(const uint32_t level, const uint32_t vertex) const noexcept
+	{
+		const uint32_t slot = Translate(level, vertex / PointsPerParent);
+
+		return slot == HE_InvalidPage ? float3{ 0.0f, 0.0f, 0.0f } : points[slot * PointsPerParent + vertex % PointsPerParent];
+	}
+
+
+	uint64_t HE_PagedLevels::DenseBytes() const noexcept
+	{
+		uint64_t bytes = 0;
+
+		for (uint32_t levelIdx = 0; levelIdx < levelCount; levelIdx++)
+			bytes += uint64_t(parentCount[levelIdx]) * BytesPerParent;
+
+		return bytes;
+	}
+
+
+	uint32_t HE_PagedLevels::FaceOfParent(const uint32_t level, const uint32_t parent) const noexcept
+	{
+		return cage->faceLookup[parent >> (2 * (level - 1))];
+	}
+
+
+	/************************************************************************************************/
+
+
+	uint64_t HE_FaceLevelBytes(const uint32_t edgeCount, const uint32_t level) noexcept
+	{
+		if (level == 0)
+			return uint64_t(edgeCount) * (4 * sizeof(HE_TwinEdge) + 1) + uint64_t(1 + 2 * edgeCount) * sizeof(float3);
+
+		const uint64_t parents = uint64_t(edgeCount) << (2 * (level - 1));
+
+		return parents * HE_PagedLevels::BytesPerParent;
+	}
+
+
+	HE_LevelPlanStats PlanLevels(
+		const HE_ControlCage&		cage,
+		std::span<const uint8_t>	wantedLevels,
+		std::span<uint8_t>			outLevels,
+		const HE_LevelPlanOptions&	options)
+	{
+		const uint32_t faceCount	= (uint32_t)Min(cage.faces.size(), Min(wantedLevels.size(), outLevels.size()));
+		const uint32_t regionSize	= Max(options.regionSize, 1u);
+		const uint32_t regionCount	= (faceCount + regionSize - 1) / regionSize;
+		const uint32_t maxLevel		= Min(options.maxLevel, HE_MaxLevelCount(cage.halfEdges.size()));
+
+		HE_LevelPlanStats stats;
+		stats.regionCount = regionCount;
+
+		struct Region
+		{
+			uint32_t level;
+			uint32_t wanted;
+		};
+
+		std::vector<Region> regions(regionCount, Region{ 0, 0 });
+
+		for (uint32_t faceIdx = 0; faceIdx < faceCount; faceIdx++)
+		{
+			const uint32_t wanted = Min(uint32_t(wantedLevels[faceIdx]), maxLevel);
+
+			for (uint32_t level = 0; level < wanted; level++)
+				stats.wantedBytes += HE_FaceLevelBytes(cage.faces[faceIdx].edgeCount, level);
+
+			auto& region		= regions[faceIdx / regionSize];
+			region.wanted		= Max(region.wanted, wanted);
+			outLevels[faceIdx]	= 0;
+		}
+
+		// Level L costs the faces of the region that want deeper than L
+		auto RaiseCost = [&](const uint32_t regionIdx, const uint32_t level)
+		{
+			uint64_t bytes = 0;
+
+			const uint32_t end = Min((regionIdx + 1) * regionSize, faceCount);
+			for (uint32_t faceIdx = regionIdx * regionSize; faceIdx < end; faceIdx++)
+			{
+				if (Min(uint32_t(wantedLevels[faceIdx]), maxLevel) > level)
+					bytes += HE_FaceLevelBytes(cage.faces[faceIdx].edgeCount, level);
+			}
+
+			return bytes;
+		};
+
+		// Largest deficit first, then the shallower region
+		using Entry = std::pair<uint32_t, uint32_t>; // deficit << 8 | (255 - level), region
+		std::priority_queue<Entry> queue;
+
+		for (uint32_t regionIdx = 0; regionIdx < regionCount; regionIdx++)
+		{
+			if (regions[regionIdx].wanted)
+				queue.push({ regions[regionIdx].wanted << 8 | 255, regionIdx });
+		}
+
+		while (queue.size())
+		{
+			const uint32_t	regionIdx	= queue.top().second;
+			auto&			region		= regions[regionIdx];
+
+			queue.pop();
+
+			const uint64_t cost = RaiseCost(regionIdx, region.level);
+
+			if (stats.plannedBytes + cost > options.budgetBytes)
+			{
+				stats.clampedRegions++;
+				continue;
+			}
+
+			stats.plannedBytes += cost;
+			stats.deepestLevel	= Max(stats.deepestLevel, ++region.level);
+
+			if (region.level < region.wanted)
+				queue.push({ (region.wanted - region.level) << 8 | (255 - region.level), regionIdx });
+		}
+
+		for (uint32_t faceIdx = 0; faceIdx < faceCount; faceIdx++)
+			outLevels[faceIdx] = (uint8_t)Min(Min(uint32_t(wantedLevels[faceIdx]), maxLevel), regions[faceIdx / regionSize].level);
+
+		return stats;
+	}
+
+
+
+}	/************************************************************************************************/
+
+/**********************************************************************
+
+Copyright (c) 2024 Robert May
+
+Permission is hereby granted, free of charge, to any person obtaining a
+copy of this software and associated documentation files (the "Software"),
+to deal in the Software without restriction, including without limitation
+the rights to use, copy, modify, merge, publish, distribute, sublicense,
+and/or sell copies of the Software, and to permit persons to whom the
+Software is furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included
+in all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+**********************************************************************/
@@ -0,0 +1,527 @@
+#include "HalfEdgeProgressive.hpp"
+#include "HalfEdgeTopologyCodec.hpp"
+
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <cstring>
+#include <limits>
+#include <span>
+#include <vector>
+
+#include <zlib-ng.h>
+
+
+namespace FlexKit
+{	/************************************************************************************************/
+
+
+	namespace
+	{
+		uint32_t ZigZag(const int32_t value) noexcept		{ return (uint32_t(value) << 1) ^ uint32_t(value >> 31); }
+		int32_t UnZigZag(const uint32_t value) noexcept		{ return int32_t(value >> 1) ^ -int32_t(value & 1); }
+
+
+		// Zero residuals, the common case, take one byte before compression
+		void WriteVarint(std::vector<uint8_t>& out, uint32_t value)
+		{
+			while (value >= 0x80)
+			{
+				out.push_back(uint8_t(value | 0x80));
+				value >>= 7;
+			}
+
+			out.push_back(uint8_t(value));
+		}
+
+
+		bool ReadVarint(const uint8_t*& itr, const uint8_t* end, uint32_t& out) noexcept
+		{
+			out = 0;
+
+			for (uint32_t shift = 0; shift < 35 && itr < end; shift += 7)
+			{
+				const uint8_t byte = *itr++;
+				out |= uint32_t(byte & 0x7f) << shift;
+
+				if ((byte & 0x80) == 0)
+					return true;
+			}
+
+			return false;
+		}
+
+
+		std::vector<uint8_t> Compress(std::span<const uint8_t> source, const int level)
+		{
+			size_t					size = zng_compressBound(source.size());
+			std::vector<uint8_t>	out(size);
+
+			if (zng_compress2(out.data(), &size, source.data(), source.size(), level) != Z_OK)
+				return {};
+
+			out.resize(size);
+			return out;
+		}
+
+
+		bool Decompress(std::span<const uint8_t> source, std::span<uint8_t> out) noexcept
+		{
+			size_t size = out.size();
+			return zng_uncompress(out.data(), &size, source.data(), source.size()) == Z_OK && size == out.size();
+		}
+
+
+		template<typename TY>
+		void AppendBytes(std::vector<uint8_t>& out, const TY* data, const size_t count)
+		{
+			const uint8_t* bytes = reinterpret_cast<const uint8_t*>(data);
+			out.insert(out.end(), bytes, bytes + count * sizeof(TY));
+		}
+
+
+		template<typename TY>
+		bool ReadBytes(std::span<const uint8_t>& source, TY* data, const size_t count) noexcept
+		{
+			const size_t size = count * sizeof(TY);
+			if (source.size() < size)
+				return false;
+
+			memcpy(data, source.data(), size);
+			source = source.subspan(size);
+
+			return true;
+		}
+
+
+		template<typename TY>
+		void WriteValue(std::ostream& stream, const TY& value)
+		{
+			stream.write(reinterpret_cast<const char*>(&value), sizeof(TY));
+		}
+
+
+		template<typename TY>
+		bool ReadValue(std::istream& stream, TY& value)
+		{
+			return (bool)stream.read(reinterpret_cast<char*>(&value), sizeof(TY));
+		}
+
+
+		float BoundsStep(const HE_ControlCage& cage, const uint32_t precisionBits)
+		{
+			if (cage.points.size() == 0)
+				return 1.0f;
+
+			float3 min = cage.points[0];
+			float3 max = cage.points[0];
+
+			for (const float3& point : cage.points)
+			{
+				for (uint32_t axis = 0; axis < 3; axis++)
+				{
+					min[axis] = Min(min[axis], point[axis]);
+					max[axis] = Max(max[axis], point[axis]);
+				}
+			}
+
+			const float3	extent		= max - min;
+			const float		diagonal	= std::sqrt(extent.x * extent.x + extent.y * extent.y + extent.z * extent.z);
+
+			return diagonal > 0.0f ? std::ldexp(diagonal, -int(Min(precisionBits, 30u))) : 1.0f;
+		}
+
+
+		double Milliseconds(const std::chrono::high_resolution_clock::time_point begin)
+		{
+			return std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - begin).count();
+		}
+	}
+
+
+	/************************************************************************************************/
+
+
+	HE_ProgressiveEncodeStats WriteProgressive(std::ostream& stream, const HalfEdgeCPUMesh& baked, iAllocator& allocator, const HE_ProgressiveOptions& options)
+	{
+		HE_ProgressiveEncodeStats	stats;
+		const auto					encodeBegin	= std::chrono::high_resolution_clock::now();
+		const HE_ControlCage&		cage		= baked.cage;
+		const uint32_t				threads		= options.threadCount ? options.threadCount : Max(std::thread::hardware_concurrency(), 1u);
+
+		HE_ProgressiveHeader header;
+		header.levelCount		= baked.LevelCount();
+		header.indexMode		= baked.indexMode;
+		header.step				= options.step > 0.0f ? options.step : BoundsStep(cage, options.precisionBits);
+		header.halfEdgeCount	= (uint32_t)cage.halfEdges.size();
+		header.faceCount		= (uint32_t)cage.faces.size();
+		header.pointCount		= (uint32_t)cage.points.size();
+		header.vertexCount		= cage.vertexCount;
+
+		// Points are written as three floats, float3 may be padded
+		std::vector<uint8_t> cageRaw;
+
+		const auto topology = EncodeTopology(cage, cageRaw, allocator, { .threadCount = threads });
+		if (!topology.Succeeded())
+		{
+			stats.error = "failed to encode the control cage: " + topology.error;
+			return stats;
+		}
+
+		for (const float3& point : cage.points)
+		{
+			const float xyz[] = { point.x, point.y, point.z };
+			AppendBytes(cageRaw, xyz, 3);
+		}
+
+		const auto cageData = Compress(cageRaw, options.compressionLevel);
+		if (cageData.empty())
+		{
+			stats.error = "failed to compress the control cage";
+			return stats;
+		}
+
+		header.cageRawBytes	= (uint32_t)cageRaw.size();
+		header.cageBytes	= (uint32_t)cageData.size();
+
+		WriteValue(stream, header);
+		stream.write(reinterpret_cast<const char*>(cageData.data()), cageData.size());
+
+		stats.step		= header.step;
+		stats.rawBytes	= topology.rawBytes + cageRaw.size() - topology.encodedBytes;
+		stats.fileBytes	= sizeof(header) + cageData.size();
+
+		// Predicts each level from the decoded one below, as the reader does, so errors do not accumulate
+		HE_ControlCage predictorCage{ allocator };
+		predictorCage.halfEdges.resize(cage.halfEdges.size());
+		predictorCage.faces.resize(cage.faces.size());
+		predictorCage.faceLookup.resize(cage.faceLookup.size());
+		predictorCage.points.resize(cage.points.size());
+		predictorCage.vertexCount = cage.vertexCount;
+
+		std::copy(cage.halfEdges.begin(), cage.halfEdges.end(), predictorCage.halfEdges.begin());
+		std::copy(cage.faces.begin(), cage.faces.end(), predictorCage.faces.begin());
+		std::copy(cage.faceLookup.begin(), cage.faceLookup.end(), predictorCage.faceLookup.begin());
+		std::copy(cage.points.begin(), cage.points.end(), predictorCage.points.begin());
+
+		HalfEdgeCPUMesh predictor{ std::move(predictorCage), allocator, baked.indexMode };
+
+		const float				step		= header.step;
+		const float				invStep		= 1.0f / step;
+		const uint32_t			blockPoints	= Max(options.blockPoints, 1u);
+		std::vector<int32_t>	residuals;
+		std::vector<float>		chunkError(threads);
+
+		for (uint32_t levelIdx = 0; levelIdx < header.levelCount; levelIdx++)
+		{
+			predictor.BuildNextLevel(options.threadCount);
+
+			HE_Level&		predicted	= predictor.levels[levelIdx];
+			const HE_Level&	target		= baked.GetLevel(levelIdx);
+			const uint32_t	pointCount	= (uint32_t)target.points.size();
+
+			if (predicted.points.size() != pointCount)
+			{
+				stats.error = "level " + std::to_string(levelIdx) + " does not match the subdivision of the cage";
+				return stats;
+			}
+
+			residuals.resize(3 * size_t(pointCount));
+			std::fill(chunkError.begin(), chunkError.end(), 0.0f);
+
+			HE_ParallelFor(pointCount,
+				[&](const uint32_t begin, const uint32_t end, const uint32_t chunk)
+				{
+					float maxError = 0.0f;
+
+					for (uint32_t pointIdx = begin; pointIdx < end; pointIdx++)
+					{
+						float3&			point	= predicted.points[pointIdx];
+						const float3	goal	= target.points[pointIdx];
+
+						for (uint32_t axis = 0; axis < 3; axis++)
+						{
+							const float		delta	= std::round((goal[axis] - point[axis]) * invStep);
+							const int32_t	q		= (int32_t)std::clamp(delta, -2147483520.0f, 2147483520.0f);
+
+							point[axis] += float(q) * step;
+							residuals[3 * size_t(pointIdx) + axis] = q;
+
+							maxError = Max(maxError, std::abs(goal[axis] - point[axis]));
+						}
+					}
+
+					chunkError[chunk] = Max(chunkError[chunk], maxError);
+				}, threads, 4096);
+
+			HE_ProgressiveLevelHeader levelHeader;
+			levelHeader.level		= levelIdx;
+			levelHeader.pointCount	= pointCount;
+			levelHeader.blockPoints	= blockPoints;
+			levelHeader.blockCount	= pointCount / blockPoints + (pointCount % blockPoints == 0 ? 0 : 1);
+
+			std::vector<std::vector<uint8_t>>	blockData(levelHeader.blockCount);
+			std::vector<HE_ProgressiveBlock>	blocks(levelHeader.blockCount);
+			std::atomic_bool					failed = false;
+
+			HE_ParallelFor(levelHeader.blockCount,
+				[&](const uint32_t begin, const uint32_t end)
+				{
+					std::vector<uint8_t> raw;
+
+					for (uint32_t blockIdx = begin; blockIdx < end; blockIdx++)
+					{
+						const size_t first	= size_t(blockIdx) * blockPoints * 3;
+						const size_t last	= Min(first + size_t(blockPoints) * 3, residuals.size());
+
+						raw.clear();
+						for (size_t i = first; i < last; i++)
+							WriteVarint(raw, ZigZag(residuals[i]));
+
+						blockData[blockIdx]					= Compress(raw, options.compressionLevel);
+						blocks[blockIdx].rawBytes			= (uint32_t)raw.size();
+						blocks[blockIdx].compressedBytes	= (uint32_t)blockData[blockIdx].size();
+
+						if (blockData[blockIdx].empty())
+							failed = true;
+					}
+				}, threads, 1);
+
+			if (failed)
+			{
+				stats.error = "failed to compress level " + std::to_string(levelIdx);
+				return stats;
+			}
+
+			WriteValue(stream, levelHeader);
+			stream.write(reinterpret_cast<const char*>(blocks.data()), blocks.size() * sizeof(HE_ProgressiveBlock));
+
+			for (const auto& data : blockData)
+				stream.write(reinterpret_cast<const char*>(data.data()), data.size());
+
+			stats.fileBytes	+= sizeof(levelHeader) + blocks.size() * sizeof(HE_ProgressiveBlock);
+			stats.rawBytes	+= uint64_t(pointCount) * 3 * sizeof(float);
+
+			for (const auto& block : blocks)
+				stats.fileBytes += block.compressedBytes;
+
+			for (const float error : chunkError)
+				stats.maxError = Max(stats.maxError, error);
+
+			stats.levelCount++;
+		}
+
+		if (!stream)
+			stats.error = "failed to write the stream";
+
+		stats.duration = Milliseconds(encodeBegin);
+
+		return stats;
+	}
+
+
+	/************************************************************************************************/
+
+
+	HE_ProgressiveReader::HE_ProgressiveReader(std::istream& IN_stream, iAllocator& IN_allocator) :
+		stream		{ IN_stream },
+		allocator	{ &IN_allocator }
+	{
+		if (!ReadValue(stream, header) || memcmp(header.magic, "HEPR", 4) != 0 || header.version != 2)
+		{
+			error = "not a progressive subdivision file";
+			return;
+		}
+
+		// Deflate expands at most 1032 to 1, a larger raw size can only come from a corrupt header
+		if (header.levelCount > HE_MaxLevelCount(header.halfEdgeCount) || !(header.step > 0.0f) ||
+			uint64_t(header.cageRawBytes) > uint64_t(header.cageBytes) * 1032 + 64)
+		{
+			error = "corrupt header";
+			return;
+		}
+
+		std::vector<uint8_t> cageData(header.cageBytes);
+		std::vector<uint8_t> cageRaw(header.cageRawBytes);
+
+		if (!stream.read(reinterpret_cast<char*>(cageData.data()), cageData.size()) || !Decompress(cageData, cageRaw))
+		{
+			error = "failed to read the control cage";
+			return;
+		}
+
+		stats.bytesRead = sizeof(header) + cageData.size();
+
+		HE_ControlCage cage{ IN_allocator };
+		cage.points.resize(header.pointCount);
+
+		size_t topologyBytes = 0;
+		if (const auto topology = DecodeTopology(cageRaw, cage, IN_allocator, 0, &topologyBytes); !topology.Succeeded())
+		{
+			error = "failed to decode the control cage: " + topology.error;
+			return;
+		}
+
+		std::span<const uint8_t> source = std::span<const uint8_t>{ cageRaw }.subspan(topologyBytes);
+
+		bool read =
+			cage.halfEdges.size()	== header.halfEdgeCount &&
+			cage.faces.size()		== header.faceCount &&
+			cage.vertexCount		== header.vertexCount;
+
+		for (uint32_t pointIdx = 0; read && pointIdx < header.pointCount; pointIdx++)
+		{
+			float xyz[3] = {};
+			read = ReadBytes(source, xyz, 3);
+			cage.points[pointIdx] = float3{ xyz[0], xyz[1], xyz[2] };
+		}
+
+		if (!read)
+		{
+			error = "truncated control cage";
+			return;
+		}
+
+		mesh = std::make_unique<HalfEdgeCPUMesh>(std::move(cage), IN_allocator, header.indexMode);
+	}
+
+
+	/************************************************************************************************/
+
+
+	const HE_Level* HE_ProgressiveReader::DecodeNextLevel(const uint32_t threadCount)
+	{
+		if (!IsValid() || LevelsDecoded() >= header.levelCount)
+			return nullptr;
+
+		HE_ProgressiveLevelHeader levelHeader;
+		if (!ReadValue(stream, levelHeader) || levelHeader.level != LevelsDecoded() || levelHeader.blockPoints == 0 ||
+			levelHeader.blockCount != levelHeader.pointCount / levelHeader.blockPoints + (levelHeader.pointCount % levelHeader.blockPoints == 0 ? 0 : 1))
+		{
+			error = "corrupt level header";
+			return nullptr;
+		}
+
+		// The prediction fixes the level's size, every buffer below is bounded by it before anything is allocated
+		const auto predictBegin = std::chrono::high_resolution_clock::now();
+
+		mesh->BuildNextLevel(threadCount);
+
+		stats.duration += Milliseconds(predictBegin);
+
+		HE_Level&		level		= mesh->levels[levelHeader.level];
+		const float		step		= header.step;
+		const uint32_t	pointCount	= levelHeader.pointCount;
+
+		// A level that fails is dropped again, LevelsDecoded only counts complete ones
+		auto Fail = [&](std::string message) -> const HE_Level*
+		{
+			mesh->levels.pop_back();
+			error = std::move(message);
+
+			return nullptr;
+		};
+
+		if (level.points.size() != pointCount)
+			return Fail("level point count does not match the cage");
+
+		std::vector<HE_ProgressiveBlock> blocks(levelHeader.blockCount);
+		if (!stream.read(reinterpret_cast<char*>(blocks.data()), blocks.size() * sizeof(HE_ProgressiveBlock)))
+			return Fail("truncated level");
+
+		std::vector<size_t> offsets(blocks.size() + 1, 0);
+		for (size_t blockIdx = 0; blockIdx < blocks.size(); blockIdx++)
+		{
+			// Five varint bytes at most per residual
+			const uint64_t blockPoints = Min(uint64_t(levelHeader.blockPoints), uint64_t(pointCount) - uint64_t(blockIdx) * levelHeader.blockPoints);
+
+			if (blocks[blockIdx].rawBytes > blockPoints * 3 * 5 || blocks[blockIdx].compressedBytes > zng_compressBound(blocks[blockIdx].rawBytes))
+				return Fail("corrupt block table in level " + std::to_string(levelHeader.level));
+
+			offsets[blockIdx + 1] = offsets[blockIdx] + blocks[blockIdx].compressedBytes;
+		}
+
+		std::vector<uint8_t> data(offsets.back());
+		if (!stream.read(reinterpret_cast<char*>(data.data()), data.size()))
+			return Fail("truncated level");
+
+		const auto decodeBegin = std::chrono::high_resolution_clock::now();
+
+		std::atomic_bool failed = false;
+
+		HE_ParallelFor(levelHeader.blockCount,
+			[&](const uint32_t begin, const uint32_t end)
+			{
+				std::vector<uint8_t> raw;
+
+				for (uint32_t blockIdx = begin; blockIdx < end && !failed; blockIdx++)
+				{
+					raw.resize(blocks[blockIdx].rawBytes);
+
+					const std::span<const uint8_t> compressed{ data.data() + offsets[blockIdx], blocks[blockIdx].compressedBytes };
+					if (!Decompress(compressed, raw))
+					{
+						failed = true;
+						return;
+					}
+
+					const uint8_t*	itr		= raw.data();
+					const uint8_t*	rawEnd	= raw.data() + raw.size();
+					const uint32_t	first	= blockIdx * levelHeader.blockPoints;
+					const uint32_t	last	= Min(first + levelHeader.blockPoints, pointCount);
+
+					for (uint32_t pointIdx = first; pointIdx < last; pointIdx++)
+					{
+						float3& point = level.points[pointIdx];
+
+						for (uint32_t axis = 0; axis < 3; axis++)
+						{
+							uint32_t value;
+							if (!ReadVarint(itr, rawEnd, value))
+							{
+								failed = true;
+								return;
+							}
+
+							point[axis] += float(UnZigZag(value)) * step;
+						}
+					}
+				}
+			}, threadCount, 1);
+
+		if (failed)
+			return Fail("corrupt residuals in level " + std::to_string(levelHeader.level));
+
+		stats.duration		+= Milliseconds(decodeBegin);
+		stats.bytesRead		+= sizeof(levelHeader) + blocks.size() * sizeof(HE_ProgressiveBlock) + data.size();
+		stats.pointsDecoded	+= pointCount;
+
+		return &level;
+	}
+
+
+}	/************************************************************************************************/
+
+/**********************************************************************
+
+Copyright (c) 2024 Robert May
+
+Permission is hereby granted, free of charge, to any person obtaining a
+copy of this software and associated documentation files (the "Software"),
+to deal in the Software without restriction, including without limitation
+the rights to use, copy, modify, merge, publish, distribute, sublicense,
+and/or sell copies of the Software, and to permit persons to whom the
+Software is furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included
+in all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+**********************************************************************/
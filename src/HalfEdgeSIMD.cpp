@@ -0,0 +1,86 @@
+#include "HalfEdgeSIMD.hpp"
+
+#if defined(_MSC_VER) && (defined(_M_X64) || defined(_M_IX86))
+#include <intrin.h>
+#endif
+
+
+namespace FlexKit
+{	/************************************************************************************************/
+
+
+	namespace
+	{
+		HE_SIMDLevel HE_DetectSIMD() noexcept
+		{
+			bool avx2	= false;
+			bool avx512	= false;
+
+#if defined(_MSC_VER) && (defined(_M_X64) || defined(_M_IX86))
+			int info[4];
+			__cpuid(info, 0);
+
+			if (info[0] >= 7)
+			{
+				__cpuid(info, 1);
+				const bool osxsave = (info[2] & (1 << 27)) != 0;
+
+				// The OS has to save the ymm and zmm registers too, not only the CPU support them
+				const unsigned long long xcr0 = osxsave ? _xgetbv(0) : 0;
+
+				__cpuidex(info, 7, 0);
+				avx2	= (info[1] & (1 << 5)) != 0 && (xcr0 & 0x06) == 0x06;
+				avx512	= (info[1] & (1 << 16)) != 0 && (xcr0 & 0xe6) == 0xe6;
+			}
+#elif (defined(__GNUC__) || defined(__clang__)) && (defined(__x86_64__) || defined(__i386__))
+			// Checks the OS register state as well
+			__builtin_cpu_init();
+			avx2	= __builtin_cpu_supports("avx2");
+			avx512	= __builtin_cpu_supports("avx512f");
+#endif
+
+			if (avx512 && HE_AVX512Built())
+				return HE_SIMDLevel::AVX512;
+			else if (avx2 && HE_AVX2Built())
+				return HE_SIMDLevel::AVX2;
+			else
+				return HE_SIMDLevel::Scalar;
+		}
+	}
+
+
+	/************************************************************************************************/
+
+
+	HE_SIMDLevel HE_SIMDSupport() noexcept
+	{
+		static const HE_SIMDLevel level = HE_DetectSIMD();
+		return level;
+	}
+
+
+}	/************************************************************************************************/
+
+/**********************************************************************
+
+Copyright (c) 2024 Robert May
+
+Permission is hereby granted, free of charge, to any person obtaining a
+copy of this software and associated documentation files (the "Software"),
+to deal in the Software without restriction, including without limitation
+the rights to use, copy, modify, merge, publish, distribute, sublicense,
+and/or sell copies of the Software, and to permit persons to whom the
+Software is furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included
+in all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+**********************************************************************/
@@ -0,0 +1,386 @@
+#include "HalfEdgeShaderCache.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <sstream>
+#include <thread>
+
+#if defined(_WIN32)
+#include <process.h>
+#else
+#include <unistd.h>
+#endif
+
+
+namespace FlexKit
+{	/************************************************************************************************/
+
+
+	namespace
+	{
+		constexpr uint64_t FNVOffset	= 0xcbf29ce484222325ull;
+		constexpr uint64_t FNVPrime		= 0x100000001b3ull;
+
+
+		uint64_t HashBytes(uint64_t hash, const void* data, const size_t size) noexcept
+		{
+			const auto* bytes = static_cast<const uint8_t*>(data);
+
+			for (size_t I = 0; I < size; I++)
+				hash = (hash ^ bytes[I]) * FNVPrime;
+
+			return hash;
+		}
+
+
+		// Length first, so concatenated fields can't collide by shifting bytes between them
+		uint64_t HashString(const uint64_t hash, std::string_view str) noexcept
+		{
+			const uint64_t length = str.size();
+			return HashBytes(HashBytes(hash, &length, sizeof(length)), str.data(), str.size());
+		}
+
+
+		bool ReadFile(const std::filesystem::path& path, std::string& out)
+		{
+			std::ifstream file{ path, std::ios::binary };
+			if (!file)
+				return false;
+
+			std::ostringstream contents;
+			contents << file.rdbuf();
+			out = std::move(contents).str();
+
+			return true;
+		}
+
+
+		// Returns the include target and whether it was quoted, for lines of the form #include "x" or <x>
+		bool ParseInclude(std::string_view line, std::string_view& outTarget, bool& outQuoted)
+		{
+			const size_t first = line.find_first_not_of(" \t");
+			if (first == std::string_view::npos || line[first] != '#')
+				return false;
+
+			line.remove_prefix(first + 1);
+			line.remove_prefix(std::min(line.find_first_not_of(" \t"), line.size()));
+
+			if (!line.starts_with("include"))
+				return false;
+
+			line.remove_prefix(7);
+			line.remove_prefix(std::min(line.find_first_not_of(" \t"), line.size()));
+
+			if (line.empty() || (line[0] != '"' && line[0] != '<'))
+				return false;
+
+			const char		close	= line[0] == '"' ? '"' : '>';
+			const size_t	end		= line.find(close, 1);
+
+			if (end == std::string_view::npos)
+				return false;
+
+			outTarget	= line.substr(1, end - 1);
+			outQuoted	= close == '"';
+
+			return true;
+		}
+
+
+		uint32_t ProcessID() noexcept
+		{
+#if defined(_WIN32)
+			return (uint32_t)_getpid();
+#else
+			return (uint32_t)getpid();
+#endif
+		}
+
+
+		std::filesystem::path NormalizePath(std::string_view path)
+		{
+			std::string generic{ path };
+			std::replace(generic.begin(), generic.end(), '\\', '/');
+
+			return std::filesystem::path{ generic }.lexically_normal();
+		}
+
+
+		void HashFile(
+			const std::filesystem::path&				path,
+			const HE_ShaderJob&							job,
+			uint64_t&									hash,
+			std::vector<std::filesystem::path>&			visited)
+		{
+			if (std::find(visited.begin(), visited.end(), path) != visited.end())
+				return;
+
+			visited.push_back(path);
+
+			std::string source;
+			if (!ReadFile(path, source))
+			{
+				hash = HashString(HashString(hash, "<missing>"), path.generic_string());
+				return;
+			}
+
+			hash = HashString(HashString(hash, path.generic_string()), source);
+
+			std::string_view remaining{ source };
+
+			while (!remaining.empty())
+			{
+				const size_t			lineEnd	= std::min(remaining.find('\n'), remaining.size());
+				const std::string_view	line	= remaining.substr(0, lineEnd);
+
+				remaining.remove_prefix(std::min(lineEnd + 1, remaining.size()));
+
+				std::string_view	target;
+				bool				quoted;
+
+				if (!ParseInclude(line, target, quoted))
+					continue;
+
+				const std::filesystem::path relative = NormalizePath(target);
+
+				std::filesystem::path resolved;
+
+				if (quoted && std::filesystem::exists(path.parent_path() / relative))
+					resolved = (path.parent_path() / relative).lexically_normal();
+
+				for (size_t I = 0; resolved.empty() && I < job.includeDirs.size(); I++)
+				{
+					if (std::filesystem::exists(job.includeDirs[I] / relative))
+						resolved = (job.includeDirs[I] / relative).lexically_normal();
+				}
+
+				HashFile(resolved.empty() ? (path.parent_path() / relative).lexically_normal() : resolved, job, hash, visited);
+			}
+		}
+	}
+
+
+	/************************************************************************************************/
+
+
+	uint64_t HE_ShaderCacheKey(
+		const HE_ShaderJob&						job,
+		std::string_view						compilerVersion,
+		std::vector<std::filesystem::path>*		outDependencies)
+	{
+		uint64_t hash = FNVOffset;
+
+		hash = HashString(hash, compilerVersion);
+		hash = HashString(hash, job.target);
+		hash = HashString(hash, job.entryPoint);
+
+		for (const auto& argument : job.arguments)
+			hash = HashString(hash, argument);
+
+		for (const auto& dir : job.includeDirs)
+			hash = HashString(hash, dir.generic_string());
+
+		std::vector<std::filesystem::path> visited;
+		HashFile(NormalizePath(job.path), job, hash, visited);
+
+		if (outDependencies)
+			*outDependencies = std::move(visited);
+
+		return hash;
+	}
+
+
+	/************************************************************************************************/
+
+
+	HE_ShaderCache::HE_ShaderCache(std::filesystem::path IN_directory) :
+		directory{ std::move(IN_directory) }
+	{
+		std::error_code ec;
+		std::filesystem::create_directories(directory, ec);
+	}
+
+
+	bool HE_ShaderCache::Load(const uint64_t key, std::vector<std::byte>& out) const
+	{
+		char name[32];
+		snprintf(name, sizeof(name), "%016llx.dxil", (unsigned long long)key);
+
+		std::ifstream file{ directory / name, std::ios::binary | std::ios::ate };
+		if (!file)
+			return false;
+
+		const std::streamsize size = file.tellg();
+		if (size <= 0)
+			return false;
+
+		out.resize(size_t(size));
+		file.seekg(0);
+
+		return bool(file.read(reinterpret_cast<char*>(out.data()), size));
+	}
+
+
+	bool HE_ShaderCache::Store(const uint64_t key, std::span<const std::byte> dxil) const
+	{
+		char name[32];
+		snprintf(name, sizeof(name), "%016llx.dxil", (unsigned long long)key);
+
+		// Process and thread id, so writers in other processes sharing the directory never pick the same name
+		std::stringstream temporaryName;
+		temporaryName << name << "." << ProcessID() << "." << std::this_thread::get_id() << ".tmp";
+
+		const auto temporary = directory / temporaryName.str();
+
+		{
+			std::ofstream file{ temporary, std::ios::binary | std::ios::trunc };
+			if (!file || !file.write(reinterpret_cast<const char*>(dxil.data()), dxil.size()))
+				return false;
+		}
+
+		std::error_code ec;
+		std::filesystem::rename(temporary, directory / name, ec);
+
+		if (ec)
+			std::filesystem::remove(temporary, ec);
+
+		return !ec;
+	}
+
+
+	/************************************************************************************************/
+
+
+	HE_DXCCompiler::HE_DXCCompiler(std::string IN_executable, std::string IN_version) :
+		executable	{ std::move(IN_executable) },
+		version		{ std::move(IN_version) } {}
+
+
+	bool HE_DXCCompiler::Compile(const HE_ShaderJob& job, std::vector<std::byte>& outDXIL, std::string& outErrors)
+	{
+		static std::atomic_uint32_t counter = 0;
+
+		const auto tempDir	= std::filesystem::temp_directory_path();
+		const auto stem		= "he_shader_" + std::to_string(counter++);
+		const auto output	= tempDir / (stem + ".dxil");
+		const auto log		= tempDir / (stem + ".log");
+
+		std::string command = "\"" + executable + "\" -nologo -T " + job.target;
+
+		if (!job.entryPoint.empty())
+			command += " -E " + job.entryPoint;
+
+		for (const auto& argument : job.arguments)
+			command += " " + argument;
+
+		for (const auto& dir : job.includeDirs)
+			command += " -I \"" + dir.string() + "\"";
+
+		command += " -Fo \"" + output.string() + "\" \"" + NormalizePath(job.path).string() + "\" > \"" + log.string() + "\" 2>&1";
+
+#if defined(_WIN32)
+		command = "\"" + command + "\""; // cmd.exe strips the outer quotes
+#endif
+
+		const int result = std::system(command.c_str());
+
+		ReadFile(log, outErrors);
+
+		std::string dxil;
+		const bool succeeded = result == 0 && ReadFile(output, dxil) && !dxil.empty();
+
+		if (succeeded)
+		{
+			outDXIL.resize(dxil.size());
+			memcpy(outDXIL.data(), dxil.data(), dxil.size());
+		}
+
+		std::error_code ec;
+		std::filesystem::remove(output, ec);
+		std::filesystem::remove(log, ec);
+
+		return succeeded;
+	}
+
+
+	/************************************************************************************************/
+
+
+	std::vector<HE_CompiledShader> CompileShaders(
+		std::span<const HE_ShaderJob>	jobs,
+		HE_ShaderCache&					cache,
+		HE_ShaderCompiler&				compiler,
+		HE_ShaderBuildStats*			outStats,
+		const uint32_t					threadCount)
+	{
+		const auto begin = std::chrono::high_resolution_clock::now();
+
+		std::vector<HE_CompiledShader> results(jobs.size());
+
+		HE_ParallelFor((uint32_t)jobs.size(),
+			[&](const uint32_t jobBegin, const uint32_t jobEnd)
+			{
+				for (uint32_t jobIdx = jobBegin; jobIdx < jobEnd; jobIdx++)
+				{
+					const auto	jobStart	= std::chrono::high_resolution_clock::now();
+					auto&		result		= results[jobIdx];
+
+					result.key		= HE_ShaderCacheKey(jobs[jobIdx], compiler.Version());
+					result.cacheHit	= cache.Load(result.key, result.dxil);
+
+					if (!result.cacheHit && compiler.Compile(jobs[jobIdx], result.dxil, result.errors))
+						cache.Store(result.key, result.dxil);
+
+					result.duration = std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - jobStart).count();
+				}
+			}, threadCount, 1);
+
+		if (outStats)
+		{
+			*outStats = {};
+			outStats->jobs = (uint32_t)jobs.size();
+
+			for (const auto& result : results)
+			{
+				outStats->cacheHits		+= result.cacheHit ? 1 : 0;
+				outStats->failures		+= result.Succeeded() ? 0 : 1;
+				outStats->compileTime	+= result.duration;
+			}
+
+			outStats->wallTime = std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - begin).count();
+		}
+
+		return results;
+	}
+
+
+}	/************************************************************************************************/
+
+/**********************************************************************
+
+Copyright (c) 2024 Robert May
+
+Permission is hereby granted, free of charge, to any person obtaining a
+copy of this software and associated documentation files (the "Software"),
+to deal in the Software without restriction, including without limitation
+the rights to use, copy, modify, merge, publish, distribute, sublicense,
+and/or sell copies of the Software, and to permit persons to whom the
+Software is furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included
+in all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+**********************************************************************/
@@ -0,0 +1,342 @@
+#include "HalfEdgeSoA.hpp"
+#include "HalfEdgeSIMD.hpp"
+
+#include <chrono>
+#include <cmath>
+
+
+namespace FlexKit
+{	/************************************************************************************************/
+
+
+	static_assert(HE_SIMDMaxValence == HE_MaxValence);
+	static_assert(uint32_t(HE_SoAKernel::AVX2) == uint32_t(HE_SIMDLevel::AVX2) && uint32_t(HE_SoAKernel::AVX512) == uint32_t(HE_SIMDLevel::AVX512));
+
+
+	HE_SoAKernel HE_BestSoAKernel() noexcept
+	{
+		return HE_SoAKernel(HE_SIMDSupport());
+	}
+
+
+	const char* HE_SoAKernelString(const HE_SoAKernel kernel) noexcept
+	{
+		switch (kernel)
+		{
+		case HE_SoAKernel::Scalar:	return "scalar";
+		case HE_SoAKernel::AVX2:	return "AVX2";
+		case HE_SoAKernel::AVX512:	return "AVX-512";
+		default:					return "unknown";
+		}
+	}
+
+
+	/************************************************************************************************/
+
+
+	namespace
+	{
+		template<typename TY_View>
+		void HE_BuildSoAMesh(const TY_View& view, const Vector<float3>& points, HE_SoAMesh& out)
+		{
+			const uint32_t halfEdgeCount	= view.HalfEdgeCount();
+			const uint32_t faceCount		= view.FaceCount();
+
+			out.twin.resize(halfEdgeCount);
+			out.next.resize(halfEdgeCount);
+			out.vert.resize(halfEdgeCount);
+			out.face.resize(halfEdgeCount);
+
+			for (uint32_t e = 0; e < halfEdgeCount; e++)
+			{
+				out.twin[e] = view.Twin(e);
+				out.next[e] = view.Next(e);
+				out.vert[e] = view.Vert(e);
+				out.face[e] = view.Face(e);
+			}
+
+			out.faceBegin.resize(faceCount);
+			out.edgeCount.resize(faceCount);
+
+			for (uint32_t faceIdx = 0; faceIdx < faceCount; faceIdx++)
+			{
+				const HE_Face face = view.GetFace(faceIdx);
+
+				out.faceBegin[faceIdx] = face.begin;
+				out.edgeCount[faceIdx] = face.edgeCount;
+			}
+
+			out.x.resize(points.size());
+			out.y.resize(points.size());
+			out.z.resize(points.size());
+
+			for (uint32_t p = 0; p < points.size(); p++)
+			{
+				out.x[p] = points[p].x;
+				out.y[p] = points[p].y;
+				out.z[p] = points[p].z;
+			}
+		}
+
+
+		float3 HE_SoAPoint(const HE_SoAMesh& mesh, const uint32_t vertex) noexcept
+		{
+			return float3{ mesh.x[vertex], mesh.y[vertex], mesh.z[vertex] };
+		}
+
+
+		/************************************************************************************************/
+
+
+		// Same pairwise tree as HE_FacePoint
+		void HE_FacePointsScalar(const HE_SoAMesh& mesh, HE_SoAPoints& out, const uint32_t begin, const uint32_t end)
+		{
+			for (uint32_t faceIdx = begin; faceIdx < end; faceIdx++)
+			{
+				const uint32_t	first	= mesh.faceBegin[faceIdx];
+				const uint32_t	n		= Min(mesh.edgeCount[faceIdx], HE_MaxValence);
+				float3			terms[HE_MaxValence];
+
+				for (uint32_t i = 0; i < n; i++)
+					terms[i] = HE_SoAPoint(mesh, mesh.vert[first + i]);
+
+				for (uint32_t stride = 1; stride < n; stride *= 2)
+				{
+					for (uint32_t i = 0; i + stride < n; i += 2 * stride)
+						terms[i] += terms[i + stride];
+				}
+
+				const float3 point = terms[0] / float(n);
+				out.x[faceIdx] = point.x;
+				out.y[faceIdx] = point.y;
+				out.z[faceIdx] = point.z;
+			}
+		}
+
+
+		void HE_EdgePointsScalar(const HE_SoAMesh& mesh, const HE_SoAPoints& facePoints, HE_SoAPoints& out, const uint32_t begin, const uint32_t end)
+		{
+			for (uint32_t e = begin; e < end; e++)
+			{
+				const float3 midPoint	= (HE_SoAPoint(mesh, mesh.vert[e]) + HE_SoAPoint(mesh, mesh.vert[mesh.next[e]])) / 2.0f;
+				const uint32_t twin		= mesh.twin[e];
+
+				const float3 point = twin == HE_BorderValue ?
+					midPoint :
+					(facePoints[mesh.face[e]] + facePoints[mesh.face[twin]]) / 4.0f + midPoint / 2.0f;
+
+				out.x[e] = point.x;
+				out.y[e] = point.y;
+				out.z[e] = point.z;
+			}
+		}
+
+
+		/************************************************************************************************/
+
+
+		// Raw arrays for the kernels in HalfEdgeAVX2.cpp and HalfEdgeAVX512.cpp
+		HE_SoAArrays HE_Arrays(const HE_SoAMesh& mesh) noexcept
+		{
+			return {
+				.twin		= mesh.twin.data(),
+				.next		= mesh.next.data(),
+				.vert		= mesh.vert.data(),
+				.face		= mesh.face.data(),
+				.faceBegin	= mesh.faceBegin.data(),
+				.edgeCount	= mesh.edgeCount.data(),
+				.x			= mesh.x.data(),
+				.y			= mesh.y.data(),
+				.z			= mesh.z.data(),
+			};
+		}
+	}
+
+
+	/************************************************************************************************/
+
+
+	void HE_BuildSoAMesh(const HE_ControlCage& cage, HE_SoAMesh& out)
+	{
+		HE_BuildSoAMesh(HE_ControlCageView{ cage }, cage.points, out);
+	}
+
+
+	void HE_BuildSoAMesh(const HE_Level& level, HE_SoAMesh& out)
+	{
+		HE_BuildSoAMesh(HE_LevelView{ level }, level.points, out);
+	}
+
+
+	/************************************************************************************************/
+
+
+	void HE_SoAFacePoints(const HE_SoAMesh& mesh, HE_SoAPoints& out, const HE_SoAKernel kernel, const uint32_t threadCount)
+	{
+		const HE_SoAKernel selected = Min(kernel, HE_BestSoAKernel());
+
+		out.Resize(mesh.FaceCount());
+
+		const HE_SoAArrays	meshArrays	= HE_Arrays(mesh);
+		const HE_SoAOutput	outArrays	= { out.x.data(), out.y.data(), out.z.data() };
+
+		HE_ParallelFor(mesh.FaceCount(),
+			[&](const uint32_t begin, const uint32_t end)
+			{
+				uint32_t itr = begin;
+
+				if (selected == HE_SoAKernel::AVX512)
+					HE_FacePointsAVX512(meshArrays, outArrays, itr, end);
+				else if (selected == HE_SoAKernel::AVX2)
+					HE_FacePointsAVX2(meshArrays, outArrays, itr, end);
+
+				HE_FacePointsScalar(mesh, out, itr, end);
+			}, threadCount, 4096);
+	}
+
+
+	void HE_SoAEdgePoints(const HE_SoAMesh& mesh, const HE_SoAPoints& facePoints, HE_SoAPoints& out, const HE_SoAKernel kernel, const uint32_t threadCount)
+	{
+		const HE_SoAKernel selected = Min(kernel, HE_BestSoAKernel());
+
+		out.Resize(mesh.HalfEdgeCount());
+
+		const HE_SoAArrays		meshArrays	= HE_Arrays(mesh);
+		const HE_SoAPointArrays	faceArrays	= { facePoints.x.data(), facePoints.y.data(), facePoints.z.data() };
+		const HE_SoAOutput		outArrays	= { out.x.data(), out.y.data(), out.z.data() };
+
+		HE_ParallelFor(mesh.HalfEdgeCount(),
+			[&](const uint32_t begin, const uint32_t end)
+			{
+				uint32_t itr = begin;
+
+				if (selected == HE_SoAKernel::AVX512)
+					HE_EdgePointsAVX512(meshArrays, faceArrays, outArrays, itr, end);
+				else if (selected == HE_SoAKernel::AVX2)
+					HE_EdgePointsAVX2(meshArrays, faceArrays, outArrays, itr, end);
+
+				HE_EdgePointsScalar(mesh, facePoints, out, itr, end);
+			}, threadCount, 4096);
+	}
+
+
+	/************************************************************************************************/
+
+
+	HE_SoABenchmark BenchmarkSoAKernels(const HE_ControlCage& cage, iAllocator& allocator, const uint32_t levelCount)
+	{
+		HE_SoABenchmark results;
+		results.kernel		= HE_BestSoAKernel();
+		results.levelCount	= Min(levelCount, HE_MaxLevelCount(cage.halfEdges.size()));
+
+		HE_Level		levels[]	= { HE_Level{ allocator }, HE_Level{ allocator } };
+		HE_SoAMesh		mesh		{ allocator };
+		HE_SoAPoints	facePoints	{ allocator };
+		HE_SoAPoints	edgePoints	{ allocator };
+		Vector<float3>	aosFaces	{ allocator };
+		Vector<float3>	aosEdges	{ allocator };
+
+		using Clock = std::chrono::high_resolution_clock;
+
+		auto Elapsed = [](const Clock::time_point begin) { return std::chrono::duration<double, std::milli>(Clock::now() - begin).count(); };
+
+		auto Measure = [&](const auto& view, const auto& source)
+		{
+			results.halfEdgeCount += view.HalfEdgeCount();
+
+			// Outputs are sized up front so no timing includes first touch page faults
+			aosFaces.resize(view.FaceCount());
+			aosEdges.resize(view.HalfEdgeCount());
+			facePoints.Resize(view.FaceCount());
+			edgePoints.Resize(view.HalfEdgeCount());
+
+			auto begin = Clock::now();
+
+			for (uint32_t faceIdx = 0; faceIdx < view.FaceCount(); faceIdx++)
+				aosFaces[faceIdx] = HE_FacePoint(view, view.GetFace(faceIdx).begin);
+
+			for (uint32_t e = 0; e < view.HalfEdgeCount(); e++)
+				aosEdges[e] = HE_EdgePoint(view, e, [&](const uint32_t edge) { return aosFaces[view.Face(edge)]; });
+
+			results.aosDuration += Elapsed(begin);
+			begin = Clock::now();
+
+			HE_BuildSoAMesh(source, mesh);
+
+			results.mirrorDuration += Elapsed(begin);
+			begin = Clock::now();
+
+			HE_SoAFacePoints(mesh, facePoints, HE_SoAKernel::Scalar);
+			HE_SoAEdgePoints(mesh, facePoints, edgePoints, HE_SoAKernel::Scalar);
+
+			results.scalarDuration += Elapsed(begin);
+			begin = Clock::now();
+
+			HE_SoAFacePoints(mesh, facePoints, results.kernel);
+			HE_SoAEdgePoints(mesh, facePoints, edgePoints, results.kernel);
+
+			results.simdDuration += Elapsed(begin);
+
+			auto Error = [&](const float3 lhs, const float3 rhs)
+			{
+				results.maxError = Max(results.maxError, Max(std::abs(lhs.x - rhs.x), Max(std::abs(lhs.y - rhs.y), std::abs(lhs.z - rhs.z))));
+			};
+
+			for (uint32_t faceIdx = 0; faceIdx < view.FaceCount(); faceIdx++)
+				Error(aosFaces[faceIdx], facePoints[faceIdx]);
+
+			for (uint32_t e = 0; e < view.HalfEdgeCount(); e++)
+				Error(aosEdges[e], edgePoints[e]);
+		};
+
+		// The cage, then each level as the input of the next
+		for (uint32_t levelIdx = 0; levelIdx < results.levelCount; levelIdx++)
+		{
+			const HE_Level& input = levels[(levelIdx + 1) & 1];
+
+			if (levelIdx == 0)
+				Measure(HE_ControlCageView{ cage }, cage);
+			else
+				Measure(HE_LevelView{ input }, input);
+
+			if (levelIdx + 1 == results.levelCount)
+				break;
+
+			HE_Level& out	= levels[levelIdx & 1];
+			out.level		= levelIdx;
+
+			if (levelIdx == 0)
+				HE_SubdivideFaces(HE_ControlCageView{ cage }, out, 1);
+			else
+				HE_SubdivideFaces(HE_LevelView{ input }, out, 1);
+		}
+
+		return results;
+	}
+
+
+}	/************************************************************************************************/
+
+/**********************************************************************
+
+Copyright (c) 2024 Robert May
+
+Permission is hereby granted, free of charge, to any person obtaining a
+copy of this software and associated documentation files (the "Software"),
+to deal in the Software without restriction, including without limitation
+the rights to use, copy, modify, merge, publish, distribute, sublicense,
+and/or sell copies of the Software, and to permit persons to whom the
+Software is furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included
+in all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+**********************************************************************/
@@ -0,0 +1,219 @@
+#include "HalfEdgeTemporal.hpp"
+
+#include <algorithm>
+#include <bit>
+#include <cmath>
+
+
+namespace FlexKit
+{	/************************************************************************************************/
+
+
+	float HE_ViewDelta(const HE_ViewState& lhs, const HE_ViewState& rhs) noexcept
+	{
+		float delta = Max(
+			std::abs(lhs.position.x - rhs.position.x),
+			Max(std::abs(lhs.position.y - rhs.position.y), std::abs(lhs.position.z - rhs.position.z)));
+
+		for (int I = 0; I < 6; ++I)
+		{
+			const auto& a = lhs.frustum.Planes[I].n;
+			const auto& b = rhs.frustum.Planes[I].n;
+
+			delta = Max(delta, Max(std::abs(a.x - b.x), Max(std::abs(a.y - b.y), std::abs(a.z - b.z))));
+		}
+
+		return delta;
+	}
+
+
+	/************************************************************************************************/
+
+
+	HE_RefineAction HE_ChangeDetector::Update(std::span<const HE_ViewState> views, const uint64_t cageVersion) noexcept
+	{
+		const uint32_t viewCount = (uint32_t)Min(views.size(), size_t(HE_MaxViews));
+
+		if (!valid || cageVersion != lastCageVersion || viewCount != lastViewCount)
+		{
+			std::copy_n(views.begin(), viewCount, lastBuild);
+			lastViewCount	= viewCount;
+			lastCageVersion	= cageVersion;
+			valid			= true;
+
+			return HE_RefineAction::Full;
+		}
+
+		// Compared against the last rebuild rather than the last frame, so slow drift still triggers one
+		float delta = 0.0f;
+		for (uint32_t viewIdx = 0; viewIdx < viewCount; viewIdx++)
+			delta = Max(delta, HE_ViewDelta(lastBuild[viewIdx], views[viewIdx]));
+
+		if (delta <= options.skipThreshold)
+			return HE_RefineAction::Skip;
+
+		std::copy_n(views.begin(), viewCount, lastBuild);
+
+		return delta <= options.incrementalThreshold ? HE_RefineAction::Incremental : HE_RefineAction::Full;
+	}
+
+
+	/************************************************************************************************/
+
+
+	HE_RefineAction HE_VisibilityTracker::Update(
+		const HE_ControlCage&			cage,
+		const HE_NormalCones&			cones,
+		std::span<const HE_ViewState>	views,
+		const uint64_t					cageVersion,
+		const HE_LODOptions&			lodOptions)
+	{
+		auto action = detector.Update(views, cageVersion);
+
+		entered.clear();
+		left.clear();
+		refineList.clear();
+
+		if (action == HE_RefineAction::Skip)
+			return action;
+
+		lastRefine = RefineMultiView(cage, cones, views, current, currentLevels, lodOptions);
+
+		const uint32_t faceCount = (uint32_t)cage.faces.size();
+		const uint32_t wordCount = faceCount / 64 + (faceCount % 64 == 0 ? 0 : 1);
+
+		if (visible.size() != wordCount || levels.size() != faceCount)
+		{
+			visible.resize(wordCount);
+			levels.resize(faceCount);
+			std::fill(visible.begin(), visible.end(), 0ull);
+			std::fill(levels.begin(), levels.end(), uint8_t(0));
+			action = HE_RefineAction::Full;
+		}
+
+		nextVisible.resize(wordCount);
+		std::fill(nextVisible.begin(), nextVisible.end(), 0ull);
+
+		for (size_t I = 0; I < current.size(); I++)
+		{
+			const uint32_t	faceIdx	= current[I];
+			const bool		wasSeen	= (visible[faceIdx / 64] >> (faceIdx % 64)) & 1;
+
+			if (!wasSeen || levels[faceIdx] != currentLevels[I])
+				refineList.push_back(faceIdx);
+
+			nextVisible[faceIdx / 64] |= 1ull << (faceIdx % 64);
+			levels[faceIdx] = currentLevels[I];
+		}
+
+		for (uint32_t word = 0; word < wordCount; word++)
+		{
+			uint64_t enteredBits	= nextVisible[word] & ~visible[word];
+			uint64_t leftBits		= visible[word] & ~nextVisible[word];
+
+			while (enteredBits)
+			{
+				entered.push_back(word * 64 + std::countr_zero(enteredBits));
+				enteredBits &= enteredBits - 1;
+			}
+
+			while (leftBits)
+			{
+				left.push_back(word * 64 + std::countr_zero(leftBits));
+				leftBits &= leftBits - 1;
+			}
+		}
+
+		std::swap(visible, nextVisible);
+
+		if (action == HE_RefineAction::Incremental &&
+			float(refineList.size()) > detector.options.maxIncrementalRatio * float(current.size()))
+			action = HE_RefineAction::Full;
+
+		if (action == HE_RefineAction::Full)
+		{
+			refineList.clear();
+			refineList.reserve(current.size());
+
+			for (const uint32_t faceIdx : current)
+				refineList.push_back(faceIdx);
+		}
+
+		return action;
+	}
+
+
+	/************************************************************************************************/
+
+
+	HE_ReplayStats ReplayVisibility(
+		const HE_ControlCage&				cage,
+		const HE_NormalCones&				cones,
+		std::span<const HE_ReplayFrame>		frames,
+		iAllocator&							allocator,
+		const HE_TemporalOptions&			options)
+	{
+		HE_ReplayStats			stats;
+		HE_VisibilityTracker	tracker{ allocator };
+		Vector<uint32_t>		reference{ allocator };
+
+		tracker.detector.options = options;
+
+		for (const auto& frame : frames)
+		{
+			const auto action = tracker.Update(cage, cones, frame.view, frame.cageVersion);
+
+			reference.clear();
+			CullControlFaces(cage, cones, frame.view.frustum, frame.view.position, reference);
+
+			stats.frames++;
+			stats.facesRefinedAlways	+= reference.size();
+			stats.facesRefined			+= tracker.refineList.size();
+
+			switch (action)
+			{
+			case HE_RefineAction::Skip:			stats.skipped++;		continue;
+			case HE_RefineAction::Incremental:	stats.incremental++;	break;
+			case HE_RefineAction::Full:			stats.full++;			break;
+			}
+
+			bool matches = true;
+			for (uint32_t faceIdx = 0; faceIdx < cage.faces.size() && matches; faceIdx++)
+			{
+				const bool tracked	= (tracker.visible[faceIdx / 64] >> (faceIdx % 64)) & 1;
+				const bool expected	= std::binary_search(reference.begin(), reference.end(), faceIdx);
+				matches = tracked == expected;
+			}
+
+			stats.mismatches += matches ? 0 : 1;
+		}
+
+		return stats;
+	}
+
+
+}	/************************************************************************************************/
+
+/**********************************************************************
+
+Copyright (c) 2024 Robert May
+
+Permission is hereby granted, free of charge, to any person obtaining a
+copy of this software and associated documentation files (the "Software"),
+to deal in the Software without restriction, including without limitation
+the rights to use, copy, modify, merge, publish, distribute, sublicense,
+and/or sell copies of the Software, and to permit persons to whom the
+Software is furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included
+in all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+**********************************************************************/
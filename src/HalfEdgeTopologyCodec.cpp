@@ -0,0 +1,575 @@
+#include "HalfEdgeTopologyCodec.hpp"
+
+#include <atomic>
+#include <chrono>
+#include <cstring>
+
+
+namespace FlexKit
+{	/************************************************************************************************/
+
+
+	namespace
+	{
+		uint32_t ZigZag(const int32_t value) noexcept		{ return (uint32_t(value) << 1) ^ uint32_t(value >> 31); }
+		int32_t UnZigZag(const uint32_t value) noexcept		{ return int32_t(value >> 1) ^ -int32_t(value & 1); }
+
+
+		void WriteVarint(std::vector<uint8_t>& out, uint32_t value)
+		{
+			while (value >= 0x80)
+			{
+				out.push_back(uint8_t(value | 0x80));
+				value >>= 7;
+			}
+
+			out.push_back(uint8_t(value));
+		}
+
+
+		bool ReadVarint(const uint8_t*& itr, const uint8_t* end, uint32_t& out) noexcept
+		{
+			// One byte covers edge counts and most vertex deltas
+			if (itr < end && *itr < 0x80)
+			{
+				out = *itr++;
+				return true;
+			}
+
+			out = 0;
+
+			for (uint32_t shift = 0; shift < 35 && itr < end; shift += 7)
+			{
+				const uint8_t byte = *itr++;
+				out |= uint32_t(byte & 0x7f) << shift;
+
+				if ((byte & 0x80) == 0)
+					return true;
+			}
+
+			return false;
+		}
+
+
+		template<typename TY>
+		void AppendValue(std::vector<uint8_t>& out, const TY& value)
+		{
+			const uint8_t* bytes = reinterpret_cast<const uint8_t*>(&value);
+			out.insert(out.end(), bytes, bytes + sizeof(TY));
+		}
+
+
+		uint64_t RawBytes(const HE_ControlCage& cage) noexcept
+		{
+			return cage.halfEdges.ByteSize() + cage.faces.ByteSize() + cage.faceLookup.ByteSize();
+		}
+
+
+		double Milliseconds(const std::chrono::high_resolution_clock::time_point begin)
+		{
+			return std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - begin).count();
+		}
+	}
+
+
+	/************************************************************************************************/
+
+
+	void HE_RebuildTwins(Vector<HEEdge>& halfEdges, const uint32_t vertexCount, iAllocator& allocator, const uint32_t threadCount)
+	{
+		struct OutgoingEdge
+		{
+			uint32_t halfEdge;
+			uint32_t dest;
+		};
+
+		const uint32_t halfEdgeCount = (uint32_t)halfEdges.size();
+
+		Vector<uint32_t>		offsets		{ allocator };
+		Vector<uint32_t>		cursors		{ allocator };
+		Vector<OutgoingEdge>	outgoing	{ allocator };
+		Vector<uint8_t>			border		{ allocator };
+
+		offsets.resize(vertexCount + 1);
+		cursors.resize(vertexCount);
+		outgoing.resize(halfEdgeCount);
+		border.resize(vertexCount);
+		std::fill(cursors.begin(), cursors.end(), 0u);
+		std::fill(border.begin(), border.end(), uint8_t(0));
+
+		// Outgoing half-edges per vertex, CSR. The destination is stored alongside so the twin search
+		// stays within one vertex's range.
+		HE_ParallelFor(halfEdgeCount,
+			[&](const uint32_t begin, const uint32_t end)
+			{
+				for (uint32_t e = begin; e < end; e++)
+					std::atomic_ref{ cursors[halfEdges[e].vert] }.fetch_add(1, std::memory_order_relaxed);
+			}, threadCount, 1u << 16);
+
+		offsets[0] = 0;
+		for (uint32_t v = 0; v < vertexCount; v++)
+		{
+			offsets[v + 1]	= offsets[v] + cursors[v];
+			cursors[v]		= offsets[v];
+		}
+
+		HE_ParallelFor(halfEdgeCount,
+			[&](const uint32_t begin, const uint32_t end)
+			{
+				for (uint32_t e = begin; e < end; e++)
+				{
+					const uint32_t slot = std::atomic_ref{ cursors[halfEdges[e].vert] }.fetch_add(1, std::memory_order_relaxed);
+					outgoing[slot] = { e, halfEdges[halfEdges[e].next].vert };
+				}
+			}, threadCount, 1u << 16);
+
+		// a -> b pairs with b -> a, the lowest index wins so the fill order above does not matter.
+		// Both ends of a border edge are border vertices, the same test ValidateControlCage makes
+		// through the outgoing edge and the edge before it.
+		HE_ParallelFor(halfEdgeCount,
+			[&](const uint32_t begin, const uint32_t end)
+			{
+				for (uint32_t e = begin; e < end; e++)
+				{
+					const uint32_t a	= halfEdges[e].vert;
+					const uint32_t b	= halfEdges[halfEdges[e].next].vert;
+
+					uint32_t twin = HE_BorderValue;
+
+					for (uint32_t itr = offsets[b]; itr < offsets[b + 1]; itr++)
+					{
+						if (outgoing[itr].dest == a)
+							twin = Min(twin, outgoing[itr].halfEdge);
+					}
+
+					halfEdges[e].twin = twin;
+
+					if (twin == HE_BorderValue)
+					{
+						std::atomic_ref{ border[a] }.store(1, std::memory_order_relaxed);
+						std::atomic_ref{ border[b] }.store(1, std::memory_order_relaxed);
+					}
+				}
+			}, threadCount, 1u << 14);
+
+		HE_ParallelFor(halfEdgeCount,
+			[&](const uint32_t begin, const uint32_t end)
+			{
+				for (uint32_t e = begin; e < end; e++)
+				{
+					const uint32_t	v				= halfEdges[e].vert;
+					const bool		onBorder		= border[v] != 0;
+					const uint32_t	incidentEdges	= offsets[v + 1] - offsets[v] + (onBorder ? 1 : 0);
+
+					halfEdges[e].flags =
+						(onBorder				? HE_TFlag : 0) |
+						(incidentEdges == 2		? HE_CornerFlag : 0);
+				}
+			}, threadCount, 1u << 16);
+	}
+
+
+	/************************************************************************************************/
+
+
+	HE_TopologyStats EncodeTopology(const HE_ControlCage& cage, std::vector<uint8_t>& out, iAllocator& allocator, const HE_TopologyOptions& options)
+	{
+		HE_TopologyStats	stats;
+		const auto			encodeBegin	= std::chrono::high_resolution_clock::now();
+		const uint32_t		faceCount	= (uint32_t)cage.faces.size();
+		const uint32_t		edgeCount	= (uint32_t)cage.halfEdges.size();
+		const uint32_t		blockFaces	= Max(options.blockFaces, 1u);
+
+		stats.rawBytes = RawBytes(cage);
+
+		// Next and prev are only implied for faces that own consecutive ranges in face order
+		uint32_t halfEdgeItr = 0;
+		for (uint32_t faceIdx = 0; faceIdx < faceCount; faceIdx++)
+		{
+			const HE_Face& face = cage.faces[faceIdx];
+
+			if (face.begin != halfEdgeItr || face.edgeCount == 0 || face.begin + face.edgeCount > edgeCount)
+			{
+				stats.error = "face " + std::to_string(faceIdx) + " does not own the next half-edge range";
+				return stats;
+			}
+
+			for (uint32_t i = 0; i < face.edgeCount; i++)
+			{
+				const HEEdge& he = cage.halfEdges[face.begin + i];
+
+				if (he.next != face.begin + (i + 1) % face.edgeCount ||
+					he.prev != face.begin + (i + face.edgeCount - 1) % face.edgeCount ||
+					he.vert >= cage.points.size())
+				{
+					stats.error = "half-edge " + std::to_string(face.begin + i) + " is not a loop of its face";
+					return stats;
+				}
+			}
+
+			halfEdgeItr += face.edgeCount;
+		}
+
+		if (halfEdgeItr != edgeCount)
+		{
+			stats.error = "half-edges not owned by any face";
+			return stats;
+		}
+
+		HE_TopologyHeader header;
+		header.faceCount		= faceCount;
+		header.halfEdgeCount	= edgeCount;
+		header.vertexCount		= (uint32_t)cage.points.size();
+		header.blockCount		= faceCount / blockFaces + (faceCount % blockFaces == 0 ? 0 : 1);
+
+		std::vector<std::vector<uint8_t>>	blockData(header.blockCount);
+		std::vector<HE_TopologyBlock>		blocks(header.blockCount);
+
+		HE_ParallelFor(header.blockCount,
+			[&](const uint32_t begin, const uint32_t end)
+			{
+				for (uint32_t blockIdx = begin; blockIdx < end; blockIdx++)
+				{
+					const uint32_t	firstFace	= blockIdx * blockFaces;
+					const uint32_t	lastFace	= Min(firstFace + blockFaces, faceCount);
+					auto&			data		= blockData[blockIdx];
+					uint32_t		prevFirst	= 0;
+
+					data.reserve(size_t(lastFace - firstFace) * 6);
+
+					for (uint32_t faceIdx = firstFace; faceIdx < lastFace; faceIdx++)
+					{
+						const HE_Face& face = cage.faces[faceIdx];
+						WriteVarint(data, face.edgeCount);
+
+						uint32_t prev = prevFirst;
+						for (uint32_t i = 0; i < face.edgeCount; i++)
+						{
+							const uint32_t vert = cage.halfEdges[face.begin + i].vert;
+							WriteVarint(data, ZigZag(int32_t(vert - prev)));
+
+							prev = vert;
+							if (i == 0)
+								prevFirst = vert;
+						}
+					}
+
+					blocks[blockIdx].firstFace		= firstFace;
+					blocks[blockIdx].firstHalfEdge	= cage.faces[firstFace].begin;
+					blocks[blockIdx].byteCount		= (uint32_t)data.size();
+				}
+			}, options.threadCount, 1);
+
+		// Anything the rebuild does not reproduce, twins of non-manifold edges or hand-set flags, is
+		// stored as is
+		Vector<HEEdge> rebuilt{ allocator };
+		rebuilt.resize(edgeCount);
+		std::copy(cage.halfEdges.begin(), cage.halfEdges.end(), rebuilt.begin());
+
+		HE_RebuildTwins(rebuilt, header.vertexCount, allocator, options.threadCount);
+
+		std::vector<uint8_t>	exceptions;
+		uint32_t				prevException = 0;
+
+		for (uint32_t e = 0; e < edgeCount; e++)
+		{
+			if (rebuilt[e].twin == cage.halfEdges[e].twin && rebuilt[e].flags == cage.halfEdges[e].flags)
+				continue;
+
+			WriteVarint(exceptions, e - prevException);
+			WriteVarint(exceptions, cage.halfEdges[e].twin);
+			WriteVarint(exceptions, cage.halfEdges[e].flags);
+
+			prevException = e;
+			header.exceptionCount++;
+		}
+
+		header.exceptionBytes = (uint32_t)exceptions.size();
+
+		uint32_t byteOffset = 0;
+		for (auto& block : blocks)
+		{
+			block.byteOffset	= byteOffset;
+			byteOffset			+= block.byteCount;
+		}
+
+		const size_t outBegin = out.size();
+
+		AppendValue(out, header);
+
+		for (const auto& block : blocks)
+			AppendValue(out, block);
+
+		for (const auto& data : blockData)
+			out.insert(out.end(), data.begin(), data.end());
+
+		out.insert(out.end(), exceptions.begin(), exceptions.end());
+
+		stats.encodedBytes		= out.size() - outBegin;
+		stats.exceptionCount	= header.exceptionCount;
+		stats.duration			= Milliseconds(encodeBegin);
+
+		return stats;
+	}
+
+
+	/************************************************************************************************/
+
+
+	HE_TopologyStats DecodeTopology(std::span<const uint8_t> data, HE_ControlCage& out, iAllocator& allocator, const uint32_t threadCount, size_t* outBytesRead)
+	{
+		HE_TopologyStats	stats;
+		const auto			decodeBegin = std::chrono::high_resolution_clock::now();
+
+		HE_TopologyHeader header;
+		if (data.size() < sizeof(header))
+		{
+			stats.error = "truncated topology header";
+			return stats;
+		}
+
+		memcpy(&header, data.data(), sizeof(header));
+
+		const size_t tableBytes = size_t(header.blockCount) * sizeof(HE_TopologyBlock);
+
+		if (memcmp(header.magic, "HETC", 4) != 0 || header.version != 2 || data.size() < sizeof(header) + tableBytes)
+		{
+			stats.error = "not an encoded topology";
+			return stats;
+		}
+
+		std::vector<HE_TopologyBlock> blocks(header.blockCount);
+		memcpy(blocks.data(), data.data() + sizeof(header), tableBytes);
+
+		const uint8_t*	blockBytes		= data.data() + sizeof(header) + tableBytes;
+		const size_t	available		= data.size() - sizeof(header) - tableBytes;
+		size_t			blockByteCount	= 0;
+
+		for (const auto& block : blocks)
+			blockByteCount = Max(blockByteCount, size_t(block.byteOffset) + block.byteCount);
+
+		if (blockByteCount + header.exceptionBytes > available)
+		{
+			stats.error = "truncated topology";
+			return stats;
+		}
+
+		// Blocks must tile the faces and half-edges from zero, and every face and half-edge costs at
+		// least one encoded byte, which bounds the arrays before anything is allocated
+		const bool emptyTable	= header.blockCount == 0 && (header.faceCount != 0 || header.halfEdgeCount != 0);
+		const bool firstBlock	= header.blockCount != 0 && (blocks[0].firstFace != 0 || blocks[0].firstHalfEdge != 0);
+
+		if (emptyTable || firstBlock || header.faceCount > blockByteCount || header.halfEdgeCount > blockByteCount)
+		{
+			stats.error = "corrupt topology block table";
+			return stats;
+		}
+
+		out.halfEdges.resize(header.halfEdgeCount);
+		out.faces.resize(header.faceCount);
+		out.faceLookup.resize(header.halfEdgeCount);
+
+		std::atomic_bool failed = false;
+
+		HE_ParallelFor(header.blockCount,
+			[&](const uint32_t begin, const uint32_t end)
+			{
+				for (uint32_t blockIdx = begin; blockIdx < end && !failed; blockIdx++)
+				{
+					const HE_TopologyBlock&	block		= blocks[blockIdx];
+					const uint32_t			lastFace	= blockIdx + 1 < header.blockCount ? blocks[blockIdx + 1].firstFace : header.faceCount;
+					const uint32_t			lastEdge	= blockIdx + 1 < header.blockCount ? blocks[blockIdx + 1].firstHalfEdge : header.halfEdgeCount;
+					const uint8_t*			itr			= blockBytes + block.byteOffset;
+					const uint8_t*			blockEnd	= itr + block.byteCount;
+					uint32_t				edgeItr		= block.firstHalfEdge;
+					uint32_t				prevFirst	= 0;
+
+					if (lastFace > header.faceCount || block.firstFace > lastFace || lastEdge > header.halfEdgeCount || block.firstHalfEdge > lastEdge)
+					{
+						failed = true;
+						return;
+					}
+
+					for (uint32_t faceIdx = block.firstFace; faceIdx < lastFace; faceIdx++)
+					{
+						uint32_t faceEdgeCount;
+						if (!ReadVarint(itr, blockEnd, faceEdgeCount) || faceEdgeCount == 0 || faceEdgeCount > 0xffff || faceEdgeCount > lastEdge - edgeItr)
+						{
+							failed = true;
+							return;
+						}
+
+						out.faces[faceIdx] = HE_Face{ edgeItr, faceIdx + 2 * edgeItr, (uint16_t)faceEdgeCount, (uint16_t)0 };
+
+						uint32_t prev = prevFirst;
+						for (uint32_t i = 0; i < faceEdgeCount; i++)
+						{
+							uint32_t delta;
+							if (!ReadVarint(itr, blockEnd, delta))
+							{
+								failed = true;
+								return;
+							}
+
+							const uint32_t vert = prev + uint32_t(UnZigZag(delta));
+							if (vert >= header.vertexCount)
+							{
+								failed = true;
+								return;
+							}
+
+							out.halfEdges[edgeItr + i] =
+								HEEdge{
+									.twin	= HE_BorderValue,
+									.next	= edgeItr + (i + 1) % faceEdgeCount,
+									.prev	= edgeItr + (i + faceEdgeCount - 1) % faceEdgeCount,
+									.vert	= vert,
+									.flags	= 0,
+								};
+
+							out.faceLookup[edgeItr + i] = faceIdx;
+
+							prev = vert;
+							if (i == 0)
+								prevFirst = vert;
+						}
+
+						edgeItr += faceEdgeCount;
+					}
+
+					if (edgeItr != lastEdge)
+						failed = true;
+				}
+			}, threadCount, 1);
+
+		if (failed)
+		{
+			stats.error = "corrupt topology block";
+			return stats;
+		}
+
+		HE_RebuildTwins(out.halfEdges, header.vertexCount, allocator, threadCount);
+
+		const uint8_t*	itr				= blockBytes + blockByteCount;
+		const uint8_t*	exceptionsEnd	= itr + header.exceptionBytes;
+		uint32_t		halfEdge		= 0;
+
+		for (uint32_t exceptionIdx = 0; exceptionIdx < header.exceptionCount; exceptionIdx++)
+		{
+			uint32_t delta;
+			uint32_t twin;
+			uint32_t flags;
+
+			if (!ReadVarint(itr, exceptionsEnd, delta) || !ReadVarint(itr, exceptionsEnd, twin) || !ReadVarint(itr, exceptionsEnd, flags) ||
+				uint64_t(halfEdge) + delta >= header.halfEdgeCount || (twin >= header.halfEdgeCount && twin != HE_BorderValue))
+			{
+				stats.error = "corrupt topology exceptions";
+				return stats;
+			}
+
+			halfEdge += delta;
+			out.halfEdges[halfEdge].twin	= twin;
+			out.halfEdges[halfEdge].flags	= flags;
+		}
+
+		// Exceptions may only pair half-edges the rebuild could not, both sides have to agree
+		HE_ParallelFor(header.halfEdgeCount,
+			[&](const uint32_t begin, const uint32_t end)
+			{
+				for (uint32_t edgeIdx = begin; edgeIdx < end && !failed; edgeIdx++)
+				{
+					const uint32_t twin = out.halfEdges[edgeIdx].twin;
+					if (twin != HE_BorderValue && (twin == edgeIdx || out.halfEdges[twin].twin != edgeIdx))
+						failed = true;
+				}
+			}, threadCount);
+
+		if (failed)
+		{
+			stats.error = "corrupt topology twins";
+			return stats;
+		}
+
+		out.vertexCount = header.faceCount + 2 * header.halfEdgeCount;
+
+		if (outBytesRead)
+			*outBytesRead = sizeof(header) + tableBytes + blockByteCount + header.exceptionBytes;
+
+		stats.rawBytes			= RawBytes(out);
+		stats.encodedBytes		= sizeof(header) + tableBytes + blockByteCount + header.exceptionBytes;
+		stats.exceptionCount	= header.exceptionCount;
+		stats.duration			= Milliseconds(decodeBegin);
+
+		return stats;
+	}
+
+
+	/************************************************************************************************/
+
+
+	HE_TopologyBenchmark BenchmarkTopology(const HE_ControlCage& cage, iAllocator& allocator, const uint32_t threadCount)
+	{
+		HE_TopologyBenchmark results;
+
+		std::vector<uint8_t> encoded;
+		results.encode = EncodeTopology(cage, encoded, allocator, { .threadCount = threadCount });
+
+		if (!results.encode.Succeeded())
+			return results;
+
+		HE_ControlCage decoded{ allocator };
+		results.decode = DecodeTopology(encoded, decoded, allocator, threadCount);
+
+		results.matches =
+			results.decode.Succeeded() &&
+			decoded.halfEdges.ByteSize()	== cage.halfEdges.ByteSize() &&
+			decoded.faces.ByteSize()		== cage.faces.ByteSize() &&
+			decoded.faceLookup.ByteSize()	== cage.faceLookup.ByteSize() &&
+			decoded.vertexCount				== cage.vertexCount &&
+			memcmp(decoded.halfEdges.data(), cage.halfEdges.data(), cage.halfEdges.ByteSize()) == 0 &&
+			memcmp(decoded.faces.data(), cage.faces.data(), cage.faces.ByteSize()) == 0 &&
+			memcmp(decoded.faceLookup.data(), cage.faceLookup.data(), cage.faceLookup.ByteSize()) == 0;
+
+		// Reference: the raw arrays are only copied
+		HE_ControlCage copy{ allocator };
+		const auto copyBegin = std::chrono::high_resolution_clock::now();
+
+		copy.halfEdges.resize(cage.halfEdges.size());
+		copy.faces.resize(cage.faces.size());
+		copy.faceLookup.resize(cage.faceLookup.size());
+
+		memcpy(copy.halfEdges.data(), cage.halfEdges.data(), cage.halfEdges.ByteSize());
+		memcpy(copy.faces.data(), cage.faces.data(), cage.faces.ByteSize());
+		memcpy(copy.faceLookup.data(), cage.faceLookup.data(), cage.faceLookup.ByteSize());
+
+		results.rawCopyDuration = Milliseconds(copyBegin);
+
+		return results;
+	}
+
+
+}	/************************************************************************************************/
+
+/**********************************************************************
+
+Copyright (c) 2024 Robert May
+
+Permission is hereby granted, free of charge, to any person obtaining a
+copy of this software and associated documentation files (the "Software"),
+to deal in the Software without restriction, including without limitation
+the rights to use, copy, modify, merge, publish, distribute, sublicense,
+and/or sell copies of the Software, and to permit persons to whom the
+Software is furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included
+in all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+**********************************************************************/
@@ -0,0 +1,290 @@
+#include "HalfEdgeUpload.hpp"
+
+#include <algorithm>
+#include <cstring>
+
+
+namespace FlexKit
+{	/************************************************************************************************/
+
+
+	void HE_DirtyRanges::Mark(const uint32_t begin, const uint32_t count)
+	{
+		if (!count)
+			return;
+
+		// Sequential marks are the common case, extend the last range instead of growing the list
+		if (ranges.size())
+		{
+			auto& last = ranges.back();
+			if (begin >= last.begin && begin <= last.end)
+			{
+				last.end = Max(last.end, begin + count);
+				return;
+			}
+		}
+
+		ranges.push_back({ begin, begin + count });
+	}
+
+
+	/************************************************************************************************/
+
+
+	void HE_DirtyRanges::Coalesce(Vector<HE_DirtyRange>& out, const uint32_t maxGap, const uint32_t maxRegions) const
+	{
+		out.clear();
+
+		if (Empty())
+			return;
+
+		Vector<HE_DirtyRange> sorted{ ranges };
+		std::sort(sorted.begin(), sorted.end(), [](const auto& lhs, const auto& rhs) { return lhs.begin < rhs.begin; });
+
+		out.push_back(sorted[0]);
+
+		for (size_t I = 1; I < sorted.size(); I++)
+		{
+			auto& last = out.back();
+
+			if (sorted[I].begin <= last.end || sorted[I].begin - last.end <= maxGap)
+				last.end = Max(last.end, sorted[I].end);
+			else
+				out.push_back(sorted[I]);
+		}
+
+		if (out.size() <= Max(maxRegions, 1u))
+			return;
+
+		// Close the smallest gaps first until the region budget is met
+		std::vector<uint32_t> gaps;
+		gaps.reserve(out.size() - 1);
+
+		for (size_t I = 1; I < out.size(); I++)
+			gaps.push_back(out[I].begin - out[I - 1].end);
+
+		const size_t mergeCount = out.size() - Max(maxRegions, 1u);
+		std::nth_element(gaps.begin(), gaps.begin() + (mergeCount - 1), gaps.end());
+
+		const uint32_t	threshold	= gaps[mergeCount - 1];
+		size_t			written		= 0;
+
+		for (size_t I = 1; I < out.size(); I++)
+		{
+			if (out[I].begin - out[written].end <= threshold)
+				out[written].end = out[I].end;
+			else
+				out[++written] = out[I];
+		}
+
+		out.resize(written + 1);
+	}
+
+
+	/************************************************************************************************/
+
+
+	HE_StagingRing::HE_StagingRing(iAllocator& allocator, const size_t IN_segmentSize, const uint32_t IN_segmentCount) :
+		memory			{ allocator },
+		segmentSize		{ IN_segmentSize },
+		segmentCount	{ Max(IN_segmentCount, 1u) }
+	{
+		memory.resize(segmentSize * segmentCount);
+	}
+
+
+	void HE_StagingRing::BeginFrame() noexcept
+	{
+		segment	= (segment + 1) % segmentCount;
+		used	= 0;
+	}
+
+
+	size_t HE_StagingRing::Available() const noexcept
+	{
+		const size_t offset = (used + 15) & ~size_t(15);
+		return offset < segmentSize ? segmentSize - offset : 0;
+	}
+
+
+	std::byte* HE_StagingRing::Allocate(const size_t size, uint64_t& outOffset) noexcept
+	{
+		const size_t offset = (used + 15) & ~size_t(15);
+
+		if (offset + size > segmentSize)
+			return nullptr;
+
+		used		= offset + size;
+		outOffset	= segment * segmentSize + offset;
+
+		return memory.data() + outOffset;
+	}
+
+
+	/************************************************************************************************/
+
+
+	HE_MockCopyQueue::HE_MockCopyQueue(iAllocator& allocator, const size_t destinationSize) :
+		destination	{ allocator },
+		history		{ allocator }
+	{
+		destination.resize(destinationSize);
+	}
+
+
+	void HE_MockCopyQueue::Copy(const HE_StagingRing& ring, std::span<const HE_CopyRegion> regions)
+	{
+		for (const auto& region : regions)
+		{
+			memcpy(destination.data() + region.destOffset, ring.Data() + region.stagingOffset, region.size);
+			history.push_back(region);
+		}
+
+		submissions++;
+	}
+
+
+	/************************************************************************************************/
+
+
+	HE_BufferUploader::HE_BufferUploader(
+			iAllocator&				allocator,
+			const uint32_t			IN_elementCount,
+			const uint32_t			IN_elementSize,
+			const size_t			stagingSize,
+			const HE_UploadOptions&	IN_options) :
+		options			{ IN_options },
+		elementCount	{ IN_elementCount },
+		elementSize		{ IN_elementSize },
+		dirty			{ allocator },
+		ring			{ allocator, stagingSize },
+		coalesced		{ allocator },
+		regions			{ allocator } {}
+
+
+	/************************************************************************************************/
+
+
+	HE_UploadStats HE_BufferUploader::Flush(const void* source, HE_CopyQueue& queue)
+	{
+		HE_UploadStats frame;
+		frame.frames	= 1;
+		frame.fullBytes	= uint64_t(elementCount) * elementSize;
+
+		if (!dirty.Empty())
+		{
+			// Exact dirty size first, then the regions actually sent
+			dirty.Coalesce(coalesced, 0, elementCount);
+
+			uint64_t dirtyElements = 0;
+			for (const auto& range : coalesced)
+				dirtyElements += range.end - range.begin;
+
+			frame.dirtyBytes = dirtyElements * elementSize;
+
+			if (float(dirtyElements) > options.fullUploadRatio * float(elementCount))
+			{
+				// One region over the whole dirty span, which may be the tail of a deferred full upload
+				const HE_DirtyRange span = { coalesced.front().begin, coalesced.back().end };
+
+				coalesced.clear();
+				coalesced.push_back(span);
+				frame.fullUploads = 1;
+			}
+			else
+				dirty.Coalesce(coalesced, options.maxGap, options.maxRegions);
+
+			dirty.Clear();
+			regions.clear();
+			ring.BeginFrame();
+
+			// Regions are placed in the segment first, then written once to wherever the queue stages them
+			for (const auto& range : coalesced)
+			{
+				uint32_t begin = range.begin;
+
+				while (begin < range.end)
+				{
+					// Large ranges are split to fit what is left of the segment, the rest waits for the next frame
+					const uint32_t count = (uint32_t)Min(size_t(range.end - begin), ring.Available() / elementSize);
+
+					uint64_t stagingOffset = 0;
+
+					if (!count || !ring.Allocate(size_t(count) * elementSize, stagingOffset))
+					{
+						dirty.Mark(begin, range.end - begin);
+						frame.overflows = 1;
+						break;
+					}
+
+					regions.push_back({ stagingOffset, uint64_t(begin) * elementSize, uint64_t(count) * elementSize });
+
+					frame.uploadedBytes += uint64_t(count) * elementSize;
+					begin += count;
+				}
+			}
+
+			frame.regions = (uint32_t)regions.size();
+
+			if (regions.size())
+			{
+				const std::byte*	bytes			= static_cast<const std::byte*>(source);
+				const uint64_t		segmentBegin	= uint64_t(ring.CurrentSegment()) * ring.SegmentSize();
+				std::byte*			staging			= queue.Stage(ring, ring.Used());
+
+				if (staging)
+				{
+					for (const auto& region : regions)
+						memcpy(staging + (region.stagingOffset - segmentBegin), bytes + region.destOffset, region.size);
+
+					queue.Copy(ring, regions);
+				}
+				else
+				{
+					for (const auto& region : regions)
+						dirty.Mark(uint32_t(region.destOffset / elementSize), uint32_t(region.size / elementSize));
+
+					frame.overflows		= 1;
+					frame.regions		= 0;
+					frame.uploadedBytes	= 0;
+				}
+			}
+		}
+
+		totals.frames			+= frame.frames;
+		totals.regions			+= frame.regions;
+		totals.fullUploads		+= frame.fullUploads;
+		totals.overflows		+= frame.overflows;
+		totals.dirtyBytes		+= frame.dirtyBytes;
+		totals.uploadedBytes	+= frame.uploadedBytes;
+		totals.fullBytes		+= frame.fullBytes;
+
+		return frame;
+	}
+
+
+}	/************************************************************************************************/
+
+/**********************************************************************
+
+Copyright (c) 2024 Robert May
+
+Permission is hereby granted, free of charge, to any person obtaining a
+copy of this software and associated documentation files (the "Software"),
+to deal in the Software without restriction, including without limitation
+the rights to use, copy, modify, merge, publish, distribute, sublicense,
+and/or sell copies of the Software, and to permit persons to whom the
+Software is furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included
+in all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+**********************************************************************/
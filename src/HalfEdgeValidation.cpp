@@ -0,0 +1,362 @@
+#include "HalfEdgeValidation.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <mutex>
+
+
+namespace FlexKit
+{	/************************************************************************************************/
+
+
+	const char* HE_ValidationErrorString(const HE_ValidationErrorCode code)
+	{
+		switch (code)
+		{
+		case HE_ValidationErrorCode::VertexOutOfRange:		return "vertex index out of range";
+		case HE_ValidationErrorCode::NextOutOfRange:		return "next/prev index out of range";
+		case HE_ValidationErrorCode::TwinOutOfRange:		return "twin index out of range";
+		case HE_ValidationErrorCode::TwinSelf:				return "half-edge is its own twin";
+		case HE_ValidationErrorCode::TwinAsymmetric:		return "twin of twin is not the half-edge";
+		case HE_ValidationErrorCode::InconsistentWinding:	return "twin runs in the same direction";
+		case HE_ValidationErrorCode::NextPrevMismatch:		return "next and prev are not inverses";
+		case HE_ValidationErrorCode::FaceOutOfRange:		return "face half-edge range out of bounds";
+		case HE_ValidationErrorCode::FaceEdgeCount:			return "face edge count outside supported range";
+		case HE_ValidationErrorCode::FaceOpenLoop:			return "face next loop does not close over its half-edge range";
+		case HE_ValidationErrorCode::FaceLookupMismatch:	return "faceLookup does not point at the owning face";
+		case HE_ValidationErrorCode::VertexRangeMismatch:	return "face vertexRange is not the prefix sum of vertex counts";
+		case HE_ValidationErrorCode::ValenceExceeded:		return "vertex valence exceeds limit";
+		case HE_ValidationErrorCode::NonManifoldVertex:		return "vertex has more than one fan";
+		case HE_ValidationErrorCode::CornerFlagMismatch:	return "corner flag does not match vertex valence";
+		case HE_ValidationErrorCode::TFlagMismatch:			return "T flag does not match border";
+		case HE_ValidationErrorCode::LevelIndexOverflow:	return "subdivision level half-edge count exceeds the 32-bit twin index range";
+		default:											return "unknown";
+		}
+	}
+
+
+	/************************************************************************************************/
+
+
+	HE_ValidationReport ValidateControlCage(const HE_ControlCage& cage, iAllocator& allocator, const HE_ValidationOptions& options)
+	{
+		const auto begin = std::chrono::high_resolution_clock::now();
+
+		HE_ValidationReport report{ allocator };
+		report.halfEdgeCount	= (uint32_t)cage.halfEdges.size();
+		report.faceCount		= (uint32_t)cage.faces.size();
+		report.vertexCount		= (uint32_t)cage.points.size();
+
+		const uint32_t halfEdgeCount	= report.halfEdgeCount;
+		const uint32_t faceCount		= report.faceCount;
+		const uint32_t vertexCount		= report.vertexCount;
+		const auto&	   halfEdges		= cage.halfEdges;
+
+		std::mutex errorLock;
+
+		struct ErrorSink
+		{
+			ErrorSink(HE_ValidationReport& IN_report, std::mutex& IN_lock, const uint32_t IN_maxErrors) :
+				report		{ IN_report },
+				lock		{ IN_lock },
+				maxErrors	{ IN_maxErrors } {}
+
+			HE_ValidationReport&	report;
+			std::mutex&				lock;
+			const uint32_t			maxErrors;
+
+			HE_ValidationError		buffer[64];
+			uint32_t				count = 0;
+
+			void Push(HE_ValidationErrorCode code, uint32_t element, uint32_t other = 0)
+			{
+				buffer[count++] = { code, element, other };
+
+				if (count == 64)
+					Flush();
+			}
+
+			void Flush()
+			{
+				std::scoped_lock l{ lock };
+
+				for (uint32_t i = 0; i < count; i++)
+				{
+					if (report.errors.size() < maxErrors)
+						report.errors.push_back(buffer[i]);
+					else
+						report.truncated = true;
+				}
+
+				count = 0;
+			}
+		};
+
+		auto InRange = [&](const uint32_t e) { return e < halfEdgeCount; };
+
+		// Half-edges of slots left by HE_CageEditor deletes are not part of any fan
+		auto InFreeFace = [&](const uint32_t e) { return e < cage.faceLookup.size() && cage.faceLookup[e] < faceCount && cage.faces[cage.faceLookup[e]].IsFree(); };
+
+		Vector<uint32_t>	outgoing		{ allocator };
+		Vector<uint32_t>	firstOutgoing	{ allocator };
+		Vector<uint8_t>		vertexFlags		{ allocator };
+
+		outgoing.resize(vertexCount);
+		firstOutgoing.resize(vertexCount);
+		vertexFlags.resize(vertexCount);
+
+		std::fill(outgoing.begin(), outgoing.end(), 0u);
+		std::fill(firstOutgoing.begin(), firstOutgoing.end(), 0xffffffffu);
+
+		// Per half-edge: index ranges, twin symmetry and winding, next/prev inverses
+		HE_ParallelFor(halfEdgeCount,
+			[&](const uint32_t itr, const uint32_t end)
+			{
+				ErrorSink errors{ report, errorLock, options.maxErrors };
+
+				for (uint32_t e = itr; e < end; e++)
+				{
+					const HEEdge& he = halfEdges[e];
+
+					const bool vertexValid	= he.vert < vertexCount;
+					const bool linksValid	= InRange(he.next) && InRange(he.prev);
+
+					if (!vertexValid)
+						errors.Push(HE_ValidationErrorCode::VertexOutOfRange, e, he.vert);
+					else if (!InFreeFace(e))
+					{
+						std::atomic_ref<uint32_t>{ outgoing[he.vert] }.fetch_add(1, std::memory_order_relaxed);
+
+						std::atomic_ref<uint32_t> first{ firstOutgoing[he.vert] };
+						uint32_t expected = first.load(std::memory_order_relaxed);
+						while (e < expected && !first.compare_exchange_weak(expected, e, std::memory_order_relaxed));
+					}
+
+					if (!linksValid)
+						errors.Push(HE_ValidationErrorCode::NextOutOfRange, e);
+					else if (halfEdges[he.next].prev != e || halfEdges[he.prev].next != e)
+						errors.Push(HE_ValidationErrorCode::NextPrevMismatch, e);
+
+					if (e >= cage.faceLookup.size() || cage.faceLookup[e] >= faceCount)
+						errors.Push(HE_ValidationErrorCode::FaceLookupMismatch, e, e < cage.faceLookup.size() ? cage.faceLookup[e] : 0xffffffff);
+
+					const uint32_t twin = he.Twin();
+					if (twin == HE_BorderValue)
+						continue;
+
+					if (!InRange(twin))
+						errors.Push(HE_ValidationErrorCode::TwinOutOfRange, e, twin);
+					else if (twin == e)
+						errors.Push(HE_ValidationErrorCode::TwinSelf, e);
+					else if (halfEdges[twin].Twin() != e)
+						errors.Push(HE_ValidationErrorCode::TwinAsymmetric, e, twin);
+					else if (e < twin && linksValid && InRange(halfEdges[twin].next))
+					{
+						if (halfEdges[twin].vert != halfEdges[he.next].vert ||
+							halfEdges[halfEdges[twin].next].vert != he.vert)
+							errors.Push(HE_ValidationErrorCode::InconsistentWinding, e, twin);
+					}
+				}
+
+				errors.Flush();
+			}, options.threadCount);
+
+		// Per face: contiguous closed loops, faceLookup ownership, vertex ranges
+		HE_ParallelFor(faceCount,
+			[&](const uint32_t itr, const uint32_t end)
+			{
+				ErrorSink errors{ report, errorLock, options.maxErrors };
+
+				for (uint32_t f = itr; f < end; f++)
+				{
+					const HE_Face& face = cage.faces[f];
+
+					if (face.edgeCount < 3 || face.edgeCount > options.maxValence)
+						errors.Push(HE_ValidationErrorCode::FaceEdgeCount, f, face.edgeCount);
+
+					const uint32_t expectedRange = f == 0 ? 0 : cage.faces[f - 1].vertexRange + cage.faces[f - 1].GetVertexCount();
+					if (face.vertexRange != expectedRange)
+						errors.Push(HE_ValidationErrorCode::VertexRangeMismatch, f, expectedRange);
+
+					if (face.edgeCount == 0 || uint64_t(face.begin) + face.edgeCount > halfEdgeCount)
+					{
+						errors.Push(HE_ValidationErrorCode::FaceOutOfRange, f);
+						continue;
+					}
+
+					for (uint32_t i = 0; i < face.edgeCount; i++)
+					{
+						const uint32_t e = face.begin + i;
+
+						if (halfEdges[e].next != face.begin + (i + 1) % face.edgeCount)
+						{
+							errors.Push(HE_ValidationErrorCode::FaceOpenLoop, f, e);
+							break;
+						}
+					}
+
+					for (uint32_t i = 0; i < face.edgeCount; i++)
+					{
+						const uint32_t e = face.begin + i;
+
+						if (e < cage.faceLookup.size() && cage.faceLookup[e] < faceCount && cage.faceLookup[e] != f)
+							errors.Push(HE_ValidationErrorCode::FaceLookupMismatch, e, cage.faceLookup[e]);
+					}
+				}
+
+				errors.Flush();
+			}, options.threadCount);
+
+		enum VertexFlags : uint8_t
+		{
+			OnBorder	= 0x01,
+			Corner		= 0x02,
+			Checked		= 0x04,
+		};
+
+		// Per vertex: walk the fan once, compare with the outgoing count
+		HE_ParallelFor(vertexCount,
+			[&](const uint32_t itr, const uint32_t end)
+			{
+				ErrorSink errors{ report, errorLock, options.maxErrors };
+
+				auto Step = [&](const uint32_t e, const uint32_t v, const bool CCW) -> uint32_t
+				{
+					if (CCW)
+					{
+						const uint32_t twin = halfEdges[e].Twin();
+						if (!InRange(twin) || !InRange(halfEdges[twin].next))
+							return HE_BorderValue;
+
+						const uint32_t n = halfEdges[twin].next;
+						return halfEdges[n].vert == v ? n : HE_BorderValue;
+					}
+					else
+					{
+						const uint32_t prev = halfEdges[e].prev;
+						if (!InRange(prev))
+							return HE_BorderValue;
+
+						const uint32_t twin = halfEdges[prev].Twin();
+						return InRange(twin) && halfEdges[twin].vert == v ? twin : HE_BorderValue;
+					}
+				};
+
+				for (uint32_t v = itr; v < end; v++)
+				{
+					const uint32_t count = outgoing[v];
+					const uint32_t first = firstOutgoing[v];
+
+					if (count == 0)
+						continue;
+
+					if (count > options.maxValence)
+						errors.Push(HE_ValidationErrorCode::ValenceExceeded, v, count);
+
+					uint32_t	fan			= 1;
+					bool		border		= false;
+					uint32_t	selection	= Step(first, v, true);
+
+					while (selection != first && fan <= count)
+					{
+						if (selection == HE_BorderValue)
+						{
+							border = true;
+							break;
+						}
+
+						fan++;
+						selection = Step(selection, v, true);
+					}
+
+					if (border)
+					{
+						selection = Step(first, v, false);
+						while (selection != HE_BorderValue && selection != first && fan <= count)
+						{
+							fan++;
+							selection = Step(selection, v, false);
+						}
+					}
+
+					if (fan != count)
+						errors.Push(HE_ValidationErrorCode::NonManifoldVertex, v, fan > count ? fan - count : count - fan);
+
+					const uint32_t incidentEdges = count + (border ? 1 : 0);
+
+					vertexFlags[v] =	Checked |
+										(border ? OnBorder : 0) |
+										(incidentEdges == 2 ? Corner : 0);
+				}
+
+				errors.Flush();
+			}, options.threadCount);
+
+		// Per half-edge: flag bits match the vertex classification
+		HE_ParallelFor(halfEdgeCount,
+			[&](const uint32_t itr, const uint32_t end)
+			{
+				ErrorSink errors{ report, errorLock, options.maxErrors };
+
+				for (uint32_t e = itr; e < end; e++)
+				{
+					const HEEdge& he = halfEdges[e];
+					if (he.vert >= vertexCount || !(vertexFlags[he.vert] & Checked) || InFreeFace(e))
+						continue;
+
+					if (he.IsT() != ((vertexFlags[he.vert] & OnBorder) != 0))
+						errors.Push(HE_ValidationErrorCode::TFlagMismatch, e, he.vert);
+
+					if (he.IsCorner() != ((vertexFlags[he.vert] & Corner) != 0))
+						errors.Push(HE_ValidationErrorCode::CornerFlagMismatch, e, he.vert);
+				}
+
+				errors.Flush();
+			}, options.threadCount);
+
+		// Twins are stored in 32 bits, every level multiplies the half-edge count by four
+		if (const uint32_t maxLevels = HE_MaxLevelCount(halfEdgeCount); options.levelCount > maxLevels)
+		{
+			ErrorSink errors{ report, errorLock, options.maxErrors };
+			errors.Push(HE_ValidationErrorCode::LevelIndexOverflow, maxLevels, options.levelCount);
+			errors.Flush();
+		}
+
+		std::sort(report.errors.begin(), report.errors.end(),
+			[](const HE_ValidationError& lhs, const HE_ValidationError& rhs)
+			{
+				return lhs.code != rhs.code ? lhs.code < rhs.code : lhs.element < rhs.element;
+			});
+
+		report.duration = std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - begin).count();
+
+		return report;
+	}
+
+
+}	/************************************************************************************************/
+
+/**********************************************************************
+
+Copyright (c) 2024 Robert May
+
+Permission is hereby granted, free of charge, to any person obtaining a
+copy of this software and associated documentation files (the "Software"),
+to deal in the Software without restriction, including without limitation
+the rights to use, copy, modify, merge, publish, distribute, sublicense,
+and/or sell copies of the Software, and to permit persons to whom the
+Software is furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included
+in all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+**********************************************************************/
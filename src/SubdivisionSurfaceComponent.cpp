@@ -0,0 +1,130 @@
+#include "SubdivisionSurfaceComponent.hpp"
+
+#include <chrono>
+
+
+namespace FlexKit
+{	/************************************************************************************************/
+
+
+	HE_SurfaceUpdateStats UpdateSubdivisionSurfaces(
+		const HE_SurfaceFields&			fields,
+		std::span<const HE_ViewState>	views,
+		Vector<uint32_t>&				outDirty,
+		const HE_SurfaceUpdateOptions&	options)
+	{
+		HE_SurfaceUpdateStats	stats;
+		const auto				begin		= std::chrono::high_resolution_clock::now();
+		const uint32_t			count		= fields.Count();
+		const uint32_t			viewCount	= (uint32_t)Min(views.size(), size_t(HE_MaxViews));
+
+		stats.instanceCount = count;
+
+		HE_ParallelFor(count,
+			[&](const uint32_t chunkBegin, const uint32_t chunkEnd)
+			{
+				for (uint32_t idx = chunkBegin; idx < chunkEnd; idx++)
+				{
+					const HE_SurfaceBounds&	bounds	= fields.bounds[idx];
+					HE_SurfaceLOD&			lod		= fields.lods[idx];
+					uint32_t				flags	= fields.states[idx].flags & ~(HE_SurfaceVisible | HE_SurfaceLevelChanged);
+
+					// Bounding sphere of the box, HE_FaceLOD only reads the center and radius of a cone
+					HE_NormalCone sphere;
+					sphere.center = (bounds.min + bounds.max) * 0.5f;
+
+					const float3 extent = (bounds.max - bounds.min) * 0.5f;
+					sphere.radius = std::sqrt(extent.x * extent.x + extent.y * extent.y + extent.z * extent.z);
+
+					uint32_t level = lod.minLevel;
+
+					for (uint32_t viewIdx = 0; viewIdx < viewCount; viewIdx++)
+					{
+						if (!HE_Intersects(views[viewIdx].frustum, bounds.min, bounds.max))
+							continue;
+
+						flags |= HE_SurfaceVisible;
+						level = Max(level, HE_FaceLOD(views[viewIdx], sphere, { .targetPixels = lod.targetPixels, .maxLevel = lod.maxLevel }));
+					}
+
+					// Culled instances keep their level, they are refined again only once a view finds them
+					if ((flags & HE_SurfaceVisible) && level != lod.level)
+					{
+						lod.level	= (uint8_t)level;
+						flags		|= HE_SurfaceLevelChanged;
+					}
+
+					fields.states[idx].flags = flags;
+				}
+			}, options.threadCount, Max(options.chunkSize, 1u));
+
+		// Serial gather over the flags array alone, keeps the dirty list in index order for any thread count
+		for (uint32_t idx = 0; idx < count; idx++)
+		{
+			uint32_t& flags = fields.states[idx].flags;
+
+			if (flags & HE_SurfaceVisible)
+				stats.visible++;
+
+			if (flags & HE_SurfaceLevelChanged)
+				stats.levelChanged++;
+
+			if ((flags & HE_SurfaceVisible) && (flags & (HE_SurfaceLevelChanged | HE_SurfacePointsDirty)))
+			{
+				outDirty.push_back(idx);
+				flags &= ~HE_SurfacePointsDirty;
+				stats.dirty++;
+			}
+		}
+
+		stats.duration = std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - begin).count();
+
+		return stats;
+	}
+
+
+	/************************************************************************************************/
+
+
+	HE_SurfaceBounds HE_CageBounds(const HE_ControlCage& cage) noexcept
+	{
+		if (cage.points.size() == 0)
+			return { float3{ 0.0f, 0.0f, 0.0f }, float3{ 0.0f, 0.0f, 0.0f } };
+
+		HE_SurfaceBounds bounds{ cage.points[0], cage.points[0] };
+
+		for (const float3& point : cage.points)
+		{
+			bounds.min = float3{ Min(bounds.min.x, point.x), Min(bounds.min.y, point.y), Min(bounds.min.z, point.z) };
+			bounds.max = float3{ Max(bounds.max.x, point.x), Max(bounds.max.y, point.y), Max(bounds.max.z, point.z) };
+		}
+
+		return bounds;
+	}
+
+
+}	/************************************************************************************************/
+
+/**********************************************************************
+
+Copyright (c) 2024 Robert May
+
+Permission is hereby granted, free of charge, to any person obtaining a
+copy of this software and associated documentation files (the "Software"),
+to deal in the Software without restriction, including without limitation
+the rights to use, copy, modify, merge, publish, distribute, sublicense,
+and/or sell copies of the Software, and to permit persons to whom the
+Software is furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included
+in all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+**********************************************************************/
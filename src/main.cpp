@@ -1,5 +1,6 @@
 #include "TestComponent.hpp"
 #include "HalfEdgeMesh.hpp"
+#include "SubdivisionSurfaceComponent.hpp"
 
 #include <Application.hpp>
 #include <atomic>
@@ -156,6 +157,8 @@ struct CBTTerrainState : FlexKit::FrameworkState
 		FlexKit::FrameworkState	{ in_framework },
 		testComponent			{ in_framework.core.GetBlockMemory() },
 		complexComponent		{ in_framework.core.GetBlockMemory() },
+		surfaces				{ in_framework.core.GetBlockMemory() },
+		dirtySurfaces			{ in_framework.core.GetBlockMemory() },
 		runOnce					{ in_framework.core.GetBlockMemory() },
 		poolAllocator			{ in_framework.GetRenderSystem(), 64 * MEGABYTE, 
 									FlexKit::DefaultBlockSize, FlexKit::DeviceHeapFlags::UAVBuffer, 
@@ -244,16 +247,22 @@ struct CBTTerrainState : FlexKit::FrameworkState
 		shape.AddPolygon(face4, face4 + 4);
 
 #endif
-		HEMesh = std::make_unique<HalfEdgeMesh>(
+		const HalfEdgeMeshHandle meshHandle{ (uint32_t)meshes.size() };
+
+		auto& mesh = *meshes.emplace_back(
+						std::make_unique<HalfEdgeMesh>(
 							shape,
 							framework.GetRenderSystem(), 
 							framework.core.GetBlockMemory(), 
-							framework.core.GetTempMemory());
+							framework.core.GetTempMemory()));
+
+		CreateSubdivisionSurface(surfaces, meshHandle, HE_CageBounds(mesh.cpuCage), { .maxLevel = (uint8_t)(Max(mesh.levelCount, 1u) - 1) });
+
 		if (1)
 		runOnce.push_back(
-			[&](FlexKit::FrameGraph& frameGraph) 
+			[&mesh](FlexKit::FrameGraph& frameGraph) 
 			{
-				HEMesh->InitializeMesh(frameGraph);
+				mesh.InitializeMesh(frameGraph);
 			});
 
 		auto& cameraNode	= camera.AddView<SceneNodeView>();
@@ -263,7 +272,7 @@ struct CBTTerrainState : FlexKit::FrameworkState
 
 		orbitCamera.acceleration = 10.0f;
 		orbitCamera.TranslateWorld({  0.0f, shape.GetAABB().MidPoint().y, 7.5f });
-		orbitCamera.SetCameraFOV(0.523599);
+		orbitCamera.SetCameraFOV(cameraFOV);
 		orbitCamera.SetCameraAspectRatio(1920.0f / 1080.0f);
 
 		activeCamera = orbitCamera;
@@ -285,6 +294,59 @@ struct CBTTerrainState : FlexKit::FrameworkState
 	/************************************************************************************************/
 
 
+	// One sweep over every surface culls and levels them, run once the cameras moved for this frame
+	FlexKit::UpdateTask& QueueSurfaceUpdate(FlexKit::UpdateDispatcher& dispatcher, FlexKit::UpdateTask& cameraUpdate)
+	{
+		struct SurfaceUpdate
+		{
+			CBTTerrainState* state;
+		};
+
+		auto& task = dispatcher.Add<SurfaceUpdate>(
+			[&](auto& builder, SurfaceUpdate& data)
+			{
+				builder.SetDebugString("Subdivision Surface Update");
+
+				data.state = this;
+			},
+			[](SurfaceUpdate& data, FlexKit::iAllocator& threadAllocator)
+			{
+				data.state->UpdateSurfaces();
+			});
+
+		task.AddInput(cameraUpdate);
+
+		return task;
+	}
+
+
+	void UpdateSurfaces()
+	{
+		using namespace FlexKit;
+
+		HE_ViewState view;
+		view.position	= GetCameraConstants(activeCamera).WPOS.xyz();
+		view.frustum	= GetFrustum(activeCamera);
+		view.lodScale	= HE_LODScale(1080.0f, cameraFOV);
+
+		dirtySurfaces.clear();
+		UpdateSubdivisionSurfaces(surfaces, { &view, 1 }, dirtySurfaces);
+
+		// A mesh shared by several surfaces stays in view while any of them is
+		const auto meshColumn	= surfaces.GetFieldArray<HE_SurfaceMesh>();
+		const auto stateColumn	= surfaces.GetFieldArray<HE_SurfaceState>();
+
+		for (const HE_SurfaceMesh& surface : meshColumn)
+			GetMesh(surface.mesh).inView = false;
+
+		for (size_t row = 0; row < meshColumn.size(); row++)
+			GetMesh(meshColumn[row].mesh).inView |= (stateColumn[row].flags & HE_SurfaceVisible) != 0;
+	}
+
+
+	/************************************************************************************************/
+
+
 	void DrawHelloWorldTriangle(FlexKit::UpdateTask* update, FlexKit::EngineCore& core, FlexKit::UpdateDispatcher& dispatcher, double dT, FlexKit::FrameGraph& frameGraph)
 	{
 		auto color			= FlexKit::float4{ (rand() % 1024) / 1024.0f, (rand() % 1024) / 1024.0f, (rand() % 1024) / 1024.0f, 1 };
@@ -376,12 +438,31 @@ struct CBTTerrainState : FlexKit::FrameworkState
 			transformUpdate.AddInput(QueueOrbitCameraUpdateTask(dispatcher, *orbitCamera, renderWindow->mouseState, dT));
 
 
-		if (HEMesh && activeCamera != FlexKit::InvalidHandle)
+		// Moved control points are sent whether or not the surface is in view, each mesh tracks its own dirty ranges
+		for (const HE_SurfaceMesh& surface : surfaces.GetFieldArray<HE_SurfaceMesh>())
+			GetMesh(surface.mesh).UploadControlPoints(frameGraph);
+
+		if (activeCamera != FlexKit::InvalidHandle)
 		{
-			if(updateAdaptiveLOD)
-				HEMesh->AdaptiveSubdivUpdate(frameGraph, activeCamera);
-			
-			HEMesh->DrawSubDivLevel_DEBUG(frameGraph, activeCamera, &cameraUpdate, renderWindow->GetBackBuffer(), depthBuffer.Get(), adaptiveLODlevel);
+			// Refinement and drawing wait on the sweep, meshes it culled skip both when their nodes run
+			auto& surfaceUpdate = QueueSurfaceUpdate(dispatcher, cameraUpdate);
+
+			const HalfEdgeMesh::RefineView refineView{ activeCamera, HE_LODScale(1080.0f, cameraFOV) };
+
+			for (const HE_SurfaceMesh& surface : surfaces.GetFieldArray<HE_SurfaceMesh>())
+			{
+				auto& mesh = GetMesh(surface.mesh);
+
+				UpdateTask* subdivisionUpdate = &surfaceUpdate;
+
+				if (updateAdaptiveLOD)
+				{
+					subdivisionUpdate = &mesh.QueueSubdivisionPrep(dispatcher, surfaceUpdate, { &refineView, 1 });
+					mesh.AdaptiveSubdivUpdate(frameGraph, { &refineView, 1 }, subdivisionUpdate);
+				}
+
+				mesh.DrawSubDivLevel_DEBUG(frameGraph, activeCamera, subdivisionUpdate, renderWindow->GetBackBuffer(), depthBuffer.Get(), adaptiveLODlevel);
+			}
 		}
 
 		PresentBackBuffer(frameGraph, renderWindow->GetBackBuffer());
@@ -480,12 +561,18 @@ struct CBTTerrainState : FlexKit::FrameworkState
 	TestComponent					testComponent;
 	TestMultiFieldComponent			complexComponent;
 
-	std::unique_ptr<FlexKit::HalfEdgeMesh>	HEMesh;
+	FlexKit::HalfEdgeMesh& GetMesh(const FlexKit::HalfEdgeMeshHandle mesh) { return *meshes[mesh.to_uint()]; }
+
+	FlexKit::SubdivisionSurfaceComponent				surfaces;
+	FlexKit::Vector<uint32_t>							dirtySurfaces;	// Rows of the last sweep, visible with a new level or moved points
+	std::vector<std::unique_ptr<FlexKit::HalfEdgeMesh>>	meshes;		// Indexed by HalfEdgeMeshHandle
 
 	FlexKit::CameraHandle		activeCamera = FlexKit::InvalidHandle;
 	FlexKit::GameObject			gameObjects[512];
 	FlexKit::GameObject			camera;
 
+	static constexpr float cameraFOV = 0.523599f;
+
 	uint32_t	adaptiveLODlevel	= 0;
 	bool		updateAdaptiveLOD	= true;
 };
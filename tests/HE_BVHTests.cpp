@@ -0,0 +1,305 @@
+#include "HE_Tests.hpp"
+#include "HalfEdgeBVH.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <vector>
+
+
+using namespace FlexKit;
+
+
+/************************************************************************************************/
+
+
+static float Waves(uint32_t x, uint32_t y) { return float((x * 5 + y * 11) % 7) * 0.2f; }
+
+
+static void CopyLevel(const HE_Level& source, HE_Level& out)
+{
+	out.cage.resize(source.cage.size());
+	out.flags.resize(source.flags.size());
+	out.points.resize(source.points.size());
+
+	std::copy(source.cage.begin(), source.cage.end(), out.cage.begin());
+	std::copy(source.flags.begin(), source.flags.end(), out.flags.begin());
+	std::copy(source.points.begin(), source.points.end(), out.points.begin());
+
+	out.level		= source.level;
+	out.indexMode	= source.indexMode;
+}
+
+
+// Rays down onto the grid, up from below it and across it from the side, some missing it entirely
+static std::vector<HE_Ray> RandomRays(const uint32_t count, uint32_t seed)
+{
+	auto Random = [&]() { seed = seed * 1664525u + 1013904223u; return float(seed >> 8) / float(1u << 24); };
+
+	std::vector<HE_Ray> rays(count);
+
+	for (uint32_t rayIdx = 0; rayIdx < count; rayIdx++)
+	{
+		HE_Ray& ray = rays[rayIdx];
+
+		switch (rayIdx % 3)
+		{
+		case 0:
+			ray.origin		= float3{ Random() * 20.0f - 2.0f, Random() * 20.0f - 2.0f, 5.0f };
+			ray.direction	= float3{ Random() * 0.6f - 0.3f, Random() * 0.6f - 0.3f, -1.0f };
+			break;
+		case 1:
+			ray.origin		= float3{ Random() * 20.0f - 2.0f, Random() * 20.0f - 2.0f, -5.0f };
+			ray.direction	= float3{ Random() * 0.6f - 0.3f, Random() * 0.6f - 0.3f, 1.0f };
+			break;
+		default:
+			ray.origin		= float3{ -3.0f, Random() * 16.0f, Random() * 1.2f };
+			ray.direction	= float3{ 1.0f, Random() * 0.2f - 0.1f, Random() * 0.1f - 0.05f };
+			break;
+		}
+	}
+
+	return rays;
+}
+
+
+static float3 Cross(const float3 a, const float3 b) { return { a.y * b.z - a.z * b.y, a.z * b.x - a.x * b.z, a.x * b.y - a.y * b.x }; }
+static float Dot(const float3 a, const float3 b) { return a.x * b.x + a.y * b.y + a.z * b.z; }
+
+
+// Every patch of the level as the two triangles (0, 1, 2) and (0, 2, 3), the uv convention of HE_RayHit
+static HE_RayHit BruteForceHit(const HE_Level& level, const HE_Ray& ray)
+{
+	HE_RayHit hit;
+	hit.distance = ray.tMax;
+
+	auto Triangle = [&](const float3 p0, const float3 p1, const float3 p2, float& t, float& b1, float& b2)
+	{
+		const float3	e1	= p1 - p0;
+		const float3	e2	= p2 - p0;
+		const float3	p	= Cross(ray.direction, e2);
+		const float		det	= Dot(e1, p);
+
+		if (std::abs(det) < 1.0e-12f)
+			return false;
+
+		const float		invDet	= 1.0f / det;
+		const float3	s		= ray.origin - p0;
+		const float3	q		= Cross(s, e1);
+
+		b1	= Dot(s, p) * invDet;
+		b2	= Dot(ray.direction, q) * invDet;
+		t	= Dot(e2, q) * invDet;
+
+		return b1 >= 0.0f && b2 >= 0.0f && b1 + b2 <= 1.0f && t >= ray.tMin && t < hit.distance;
+	};
+
+	for (uint32_t patchIdx = 0; patchIdx < level.PatchCount(); patchIdx++)
+	{
+		float3 corners[4];
+		for (uint32_t i = 0; i < 4; i++)
+			corners[i] = level.points[level.cage[4 * patchIdx + i].vert];
+
+		float t, b1, b2;
+
+		if (Triangle(corners[0], corners[1], corners[2], t, b1, b2))
+			hit = { .patchIdx = patchIdx, .u = b1 + b2, .v = b2, .distance = t };
+
+		if (Triangle(corners[0], corners[2], corners[3], t, b1, b2))
+			hit = { .patchIdx = patchIdx, .u = b1, .v = b1 + b2, .distance = t };
+	}
+
+	return hit;
+}
+
+
+// A ray through an edge two patches share can land on either one, both at the same distance
+static bool SameHit(const HE_RayHit& lhs, const HE_RayHit& rhs)
+{
+	if (lhs.Hit() != rhs.Hit())
+		return false;
+
+	if (!lhs.Hit())
+		return true;
+
+	const float tolerance = 1.0e-4f * Max(1.0f, rhs.distance);
+
+	if (lhs.patchIdx != rhs.patchIdx)
+		return std::abs(lhs.distance - rhs.distance) <= tolerance;
+
+	return
+		std::abs(lhs.distance - rhs.distance) <= tolerance &&
+		std::abs(lhs.u - rhs.u) <= 1.0e-4f &&
+		std::abs(lhs.v - rhs.v) <= 1.0e-4f;
+}
+
+
+// Every node has to hold exactly its patches: leaves the corners of theirs, interior nodes the union
+// of their children
+static bool BoundsAreTight(const HE_BVH& bvh, const HE_Level& level)
+{
+	for (size_t nodeIdx = bvh.nodes.size(); nodeIdx-- > 0;)
+	{
+		const HE_BVHNode&	node	= bvh.nodes[nodeIdx];
+		float3				min		= float3{  1.0e30f };
+		float3				max		= float3{ -1.0e30f };
+
+		auto Add = [&](const float3 lo, const float3 hi)
+		{
+			min = float3{ Min(min.x, lo.x), Min(min.y, lo.y), Min(min.z, lo.z) };
+			max = float3{ Max(max.x, hi.x), Max(max.y, hi.y), Max(max.z, hi.z) };
+		};
+
+		if (node.IsLeaf())
+		{
+			for (uint32_t itr = node.leftOrFirst; itr < node.leftOrFirst + node.count; itr++)
+				for (uint32_t i = 0; i < 4; i++)
+				{
+					const float3 p = level.points[level.cage[4 * bvh.patchIndices[itr] + i].vert];
+					Add(p, p);
+				}
+		}
+		else
+		{
+			Add(bvh.nodes[node.leftOrFirst].min, bvh.nodes[node.leftOrFirst].max);
+			Add(bvh.nodes[node.leftOrFirst + 1].min, bvh.nodes[node.leftOrFirst + 1].max);
+		}
+
+		if (min.x != node.min.x || min.y != node.min.y || min.z != node.min.z ||
+			max.x != node.max.x || max.y != node.max.y || max.z != node.max.z)
+			return false;
+	}
+
+	return true;
+}
+
+
+/************************************************************************************************/
+
+
+// Closest hits through the tree have to be the closest hits over every patch, with the same patch,
+// uv and distance, one ray at a time and batched over threads
+HE_TEST(BVH_RaysMatchBruteForce)
+{
+	HalfEdgeCPUMesh mesh{ HE_TestGrid(16, *SystemAllocator, Waves), *SystemAllocator };
+	mesh.BuildNextLevel();
+
+	const HE_Level& level = mesh.BuildNextLevel();
+
+	HE_BVH bvh{ *SystemAllocator };
+	bvh.Build(level, { .threadCount = 4 });
+
+	HE_CHECK(bvh.stats.leafCount > 1);
+	HE_CHECK(BoundsAreTight(bvh, level));
+
+	// Every patch sits in exactly one leaf
+	std::vector<uint32_t> patches{ bvh.patchIndices.begin(), bvh.patchIndices.end() };
+	std::ranges::sort(patches);
+
+	HE_CHECK(patches.size() == level.PatchCount());
+	for (uint32_t patchIdx = 0; patchIdx < patches.size(); patchIdx++)
+		HE_CHECK(patches[patchIdx] == patchIdx);
+
+	const std::vector<HE_Ray>	rays = RandomRays(3000, 777);
+	std::vector<HE_RayHit>		hits(rays.size());
+
+	bvh.Intersect(level, rays, hits, 4);
+
+	uint32_t hitCount = 0;
+
+	for (size_t rayIdx = 0; rayIdx < rays.size(); rayIdx++)
+	{
+		const HE_RayHit expected = BruteForceHit(level, rays[rayIdx]);
+
+		HE_CHECK(SameHit(bvh.Intersect(level, rays[rayIdx]), expected));
+		HE_CHECK(SameHit(hits[rayIdx], expected));
+
+		hitCount += expected.Hit() ? 1 : 0;
+	}
+
+	HE_CHECK(hitCount > rays.size() / 2 && hitCount < rays.size());
+}
+
+
+/************************************************************************************************/
+
+
+// After the points move a refit has to leave every node as tight as a fresh build leaves its own,
+// and answer rays the same as the rebuilt tree and brute force
+HE_TEST(BVH_RefitMatchesRebuild)
+{
+	HalfEdgeCPUMesh mesh{ HE_TestGrid(16, *SystemAllocator, Waves), *SystemAllocator };
+	mesh.BuildNextLevel();
+
+	HE_Level level{ *SystemAllocator };
+	CopyLevel(mesh.BuildNextLevel(), level);
+
+	HE_BVH refit{ *SystemAllocator };
+	refit.Build(level);
+
+	const std::vector<uint32_t> order{ refit.patchIndices.begin(), refit.patchIndices.end() };
+
+	uint32_t seed = 4242;
+	auto Random = [&]() { seed = seed * 1664525u + 1013904223u; return float(seed >> 8) / float(1u << 24); };
+
+	for (float3& p : level.points)
+	{
+		p.z += 2.0f * std::sin(p.x * 0.7f) + Random() * 0.5f;
+		p.x += Random() * 0.2f - 0.1f;
+	}
+
+	refit.Refit(level, 4);
+
+	HE_CHECK(std::ranges::equal(refit.patchIndices, order));	// The tree is kept, only the bounds move
+	HE_CHECK(BoundsAreTight(refit, level));
+
+	HE_BVH rebuilt{ *SystemAllocator };
+	rebuilt.Build(level);
+
+	HE_CHECK(BoundsAreTight(rebuilt, level));
+	HE_CHECK(refit.nodes[0].min.x == rebuilt.nodes[0].min.x && refit.nodes[0].max.z == rebuilt.nodes[0].max.z);
+
+	const std::vector<HE_Ray> rays = RandomRays(2000, 31337);
+
+	for (const HE_Ray& ray : rays)
+	{
+		const HE_RayHit expected = BruteForceHit(level, ray);
+
+		HE_CHECK(SameHit(refit.Intersect(level, ray), expected));
+		HE_CHECK(SameHit(rebuilt.Intersect(level, ray), expected));
+	}
+
+	// Nothing to refit without patches
+	HE_Level	empty{ *SystemAllocator };
+	HE_BVH		emptyBVH{ *SystemAllocator };
+
+	emptyBVH.Build(empty);
+	emptyBVH.Refit(empty);
+
+	HE_CHECK(emptyBVH.nodes.empty());
+	HE_CHECK(!emptyBVH.Intersect(empty, rays[0]).Hit());
+}
+
+
+/**********************************************************************
+
+Copyright (c) 2024 Robert May
+
+Permission is hereby granted, free of charge, to any person obtaining a
+copy of this software and associated documentation files (the "Software"),
+to deal in the Software without restriction, including without limitation
+the rights to use, copy, modify, merge, publish, distribute, sublicense,
+and/or sell copies of the Software, and to permit persons to whom the
+Software is furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included
+in all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+**********************************************************************/
@@ -0,0 +1,140 @@
+#include "HE_Tests.hpp"
+#include "HalfEdgeCBT.hpp"
+
+#include <algorithm>
+#include <random>
+
+
+using namespace FlexKit;
+
+
+/************************************************************************************************/
+
+
+// SumReduction runs the AVX2 pairwise sums when the CPU has them, Validate recomputes every sum with
+// scalar code, so each round compares the two
+HE_TEST(CBT_RandomSplitMerge)
+{
+	std::mt19937 rng{ 31 };
+
+	for (const uint32_t maxDepth : { 6u, 11u, 16u })
+	{
+		HE_CBT cbt{ *SystemAllocator, maxDepth, 3 };
+		HE_CHECK(cbt.Validate());
+		HE_CHECK(cbt.NodeCount() == 8);
+
+		std::vector<HE_CBTNode> leaves;
+
+		for (uint32_t round = 0; round < 64; round++)
+		{
+			leaves.clear();
+			cbt.ForEachLeaf([&](const HE_CBTNode node) { leaves.push_back(node); });
+
+			for (const HE_CBTNode node : leaves)
+			{
+				const uint32_t roll = rng() % 8;
+
+				if (roll < 3)
+					cbt.SplitNode(node);
+				else if (roll < 5 && (node.id & 1) && cbt.IsLeaf(node.Sibling()))
+					cbt.MergeNode(node);
+			}
+
+			cbt.SumReduction(round % 3);
+
+			uint32_t leafCount = 0;
+			cbt.ForEachLeaf([&](const HE_CBTNode) { leafCount++; });
+
+			HE_CHECK(cbt.Validate());
+			HE_CHECK(cbt.NodeCount() == leafCount);
+		}
+	}
+}
+
+
+/************************************************************************************************/
+
+
+HE_TEST(CBT_PatchAllocatorConverges)
+{
+	std::mt19937			rng{ 7 };
+	std::vector<uint8_t>	targets(37);
+
+	HE_PatchAllocator patches{ *SystemAllocator, uint32_t(targets.size()), 3 };
+	HE_CHECK(patches.cbt.Validate());
+
+	// Faces are padded to a power of two, the range past the last face stays in a few level 0 nodes
+	auto FacePatches = [&]
+	{
+		uint32_t count = 0;
+		for (uint32_t patchIdx = 0; patchIdx < patches.PatchCount(); patchIdx++)
+			count += patches.GetPatch(patchIdx).faceIdx < targets.size() ? 1 : 0;
+
+		return count;
+	};
+
+	HE_CHECK(FacePatches() == targets.size());
+
+	// Stands in for the device copy of the bitfield, refreshed from the changed words alone
+	std::vector<uint64_t> mirror(patches.cbt.Words().begin(), patches.cbt.Words().end());
+
+	for (uint32_t pass = 0; pass < 3; pass++)
+	{
+		for (auto& target : targets)
+			target = uint8_t(rng() % 4);
+
+		uint32_t steps = 0;
+		for (; steps < 16; steps++)
+		{
+			const auto stats = patches.Update(targets, steps % 2);
+			HE_CHECK(patches.cbt.Validate());
+
+			for (const uint32_t word : patches.ChangedWords())
+				mirror[word] = patches.cbt.Words()[word];
+
+			HE_CHECK(std::equal(mirror.begin(), mirror.end(), patches.cbt.Words().begin()));
+
+			if (!stats.splits && !stats.merges)
+				break;
+		}
+
+		HE_CHECK(steps < 16);
+
+		uint32_t expected = 0;
+		for (const uint8_t target : targets)
+			expected += 1u << (2 * target);
+
+		HE_CHECK(FacePatches() == expected);
+
+		for (uint32_t patchIdx = 0; patchIdx < patches.PatchCount(); patchIdx++)
+		{
+			const HE_Patch patch = patches.GetPatch(patchIdx);
+			HE_CHECK(patch.faceIdx >= targets.size() ? patch.level == 0 : patch.level == targets[patch.faceIdx]);
+		}
+	}
+}
+
+
+/**********************************************************************
+
+Copyright (c) 2024 Robert May
+
+Permission is hereby granted, free of charge, to any person obtaining a
+copy of this software and associated documentation files (the "Software"),
+to deal in the Software without restriction, including without limitation
+the rights to use, copy, modify, merge, publish, distribute, sublicense,
+and/or sell copies of the Software, and to permit persons to whom the
+Software is furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included
+in all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+**********************************************************************/
@@ -0,0 +1,99 @@
+#include "HE_Tests.hpp"
+#include "HalfEdgeCulling.hpp"
+
+#include <cmath>
+#include <cstring>
+
+
+using namespace FlexKit;
+
+
+/************************************************************************************************/
+
+
+// The center of the fan has valence 64, four times HE_MaxValence, so every face's one-ring is the whole
+// fan. Bounds and cone spheres have to hold all of it or visible patches get culled.
+HE_TEST(Culling_HighValenceOneRing)
+{
+	const HE_ControlCage		cage	= HE_TestFan(64, true, *SystemAllocator);
+	const HE_ControlCageView	view{ cage };
+	const HE_NormalCones		cones	= BuildNormalCones(cage, *SystemAllocator);
+
+	HE_CHECK(cones.faceCount == 64);
+
+	for (uint32_t faceIdx = 0; faceIdx < cones.faceCount; faceIdx++)
+	{
+		const HE_PatchBounds&	bounds		= cones.Bounds(faceIdx);
+		const HE_PatchBounds	reference	= HE_OneRingBounds(view, faceIdx);
+		const HE_NormalCone&	cone		= cones.Face(faceIdx);
+
+		for (const float3& p : cage.points)
+		{
+			HE_CHECK(p.x >= bounds.min.x && p.y >= bounds.min.y && p.z >= bounds.min.z);
+			HE_CHECK(p.x <= bounds.max.x && p.y <= bounds.max.y && p.z <= bounds.max.z);
+			HE_CHECK(p.x >= reference.min.x && p.y >= reference.min.y && p.z >= reference.min.z);
+			HE_CHECK(p.x <= reference.max.x && p.y <= reference.max.y && p.z <= reference.max.z);
+
+			const float3 d = p - cone.center;
+			HE_CHECK(std::sqrt(d.x * d.x + d.y * d.y + d.z * d.z) <= cone.radius + 1e-5f);
+		}
+	}
+}
+
+
+/************************************************************************************************/
+
+
+static float Waves(uint32_t x, uint32_t y) { return float((x * 5 + y * 11) % 7) * 0.2f; }
+
+
+// Moving a few points and refitting has to give the cones and bounds a full rebuild gives, bit for
+// bit, while touching only the faces and clusters near the points
+HE_TEST(Culling_RefitMatchesRebuild)
+{
+	const HE_ConeOptions	options		= { .clusterSize = 4 };
+	HE_ControlCage			cage		= HE_TestGrid(8, *SystemAllocator, Waves);
+	HE_NormalCones			cones		= BuildNormalCones(cage, *SystemAllocator, options);
+	Vector<uint32_t>		vertexEdges{ *SystemAllocator };
+	Vector<uint32_t>		dirtyCones{ *SystemAllocator };
+
+	BuildVertexEdges(cage, vertexEdges);
+
+	const uint32_t moved[] = { 0, 40, 80 };	// A corner, the middle and the far corner of the grid
+
+	for (const uint32_t vertex : moved)
+		cage.points[vertex] = cage.points[vertex] + float3{ 0.25f, -0.5f, 0.75f };
+
+	RefitNormalCones(cage, vertexEdges, moved, cones, dirtyCones, options);
+
+	const HE_NormalCones rebuilt = BuildNormalCones(cage, *SystemAllocator, options);
+
+	HE_CHECK(std::memcmp(cones.cones.data(), rebuilt.cones.data(), rebuilt.cones.ByteSize()) == 0);
+	HE_CHECK(std::memcmp(cones.bounds.data(), rebuilt.bounds.data(), rebuilt.bounds.ByteSize()) == 0);
+	HE_CHECK(dirtyCones.size() > 0 && dirtyCones.size() < cones.cones.size() / 2);
+}
+
+
+/**********************************************************************
+
+Copyright (c) 2024 Robert May
+
+Permission is hereby granted, free of charge, to any person obtaining a
+copy of this software and associated documentation files (the "Software"),
+to deal in the Software without restriction, including without limitation
+the rights to use, copy, modify, merge, publish, distribute, sublicense,
+and/or sell copies of the Software, and to permit persons to whom the
+Software is furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included
+in all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+**********************************************************************/
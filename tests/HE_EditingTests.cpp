@@ -0,0 +1,327 @@
+#include "HE_Tests.hpp"
+#include "HalfEdgeEditing.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <numbers>
+#include <random>
+
+
+using namespace FlexKit;
+
+
+/************************************************************************************************/
+
+
+using Loops = std::vector<std::vector<uint32_t>>;
+
+
+// Vertex loops of the live faces, each rotated to start at its smallest vertex, sorted. Rolled back
+// edits may put faces back in other slots, so this is what has to survive them.
+static Loops LiveLoops(const HE_ControlCage& cage)
+{
+	Loops loops;
+
+	for (const HE_Face& face : cage.faces)
+	{
+		if (face.IsFree())
+			continue;
+
+		std::vector<uint32_t> loop;
+		for (uint32_t i = 0; i < face.edgeCount; i++)
+			loop.push_back(cage.halfEdges[face.begin + i].vert);
+
+		std::rotate(loop.begin(), std::min_element(loop.begin(), loop.end()), loop.end());
+		loops.push_back(std::move(loop));
+	}
+
+	std::sort(loops.begin(), loops.end());
+
+	return loops;
+}
+
+
+static uint32_t FindHalfEdge(const HE_ControlCage& cage, const uint32_t from, const uint32_t to)
+{
+	for (uint32_t e = 0; e < cage.halfEdges.size(); e++)
+	{
+		const HEEdge& edge = cage.halfEdges[e];
+		if (edge.vert == from && cage.halfEdges[edge.next].vert == to && !cage.faces[cage.faceLookup[e]].IsFree())
+			return e;
+	}
+
+	return HE_BorderValue;
+}
+
+
+static bool MatchesRebuild(const HE_ControlCage& cage)
+{
+	return HE_IsValid(cage, *SystemAllocator) && CompareWithRebuild(cage, *SystemAllocator).IsEqual();
+}
+
+
+// Two interior vertices A and B of valence 11 joined by an edge, inside a ring of 18 triangles.
+// Collapsing the edge would leave 18 edges on one vertex.
+static HE_ControlCage TwinHubs(iAllocator& allocator)
+{
+	ModifiableShape shape{};
+
+	const uint32_t ringSize	= 18;
+	const uint32_t top		= 9;
+	const uint32_t a		= shape.AddVertex({ -1.0f, 0.0f, 0.0f });
+	const uint32_t b		= shape.AddVertex({  1.0f, 0.0f, 0.0f });
+
+	for (uint32_t idx = 0; idx < ringSize; idx++)
+	{
+		const float angle = -std::numbers::pi_v<float> / 2.0f + 2.0f * std::numbers::pi_v<float> * float(idx) / float(ringSize);
+		shape.AddVertex({ 3.0f * std::cos(angle), 2.0f * std::sin(angle), 0.0f });
+	}
+
+	auto Ring		= [&](const uint32_t idx) { return 2 + idx % ringSize; };
+	auto Triangle	= [&](const uint32_t v0, const uint32_t v1, const uint32_t v2)
+	{
+		const uint32_t triangle[] = { v0, v1, v2 };
+		shape.AddPolygon(triangle, triangle + 3);
+	};
+
+	for (uint32_t idx = 0; idx < top; idx++)
+		Triangle(b, Ring(idx), Ring(idx + 1));
+
+	for (uint32_t idx = top; idx < ringSize; idx++)
+		Triangle(a, Ring(idx), Ring(idx + 1));
+
+	Triangle(a, Ring(0), b);
+	Triangle(b, Ring(top), a);
+
+	return BuildControlCage(shape, allocator);
+}
+
+
+/************************************************************************************************/
+
+
+HE_TEST(Editing_EachEditMatchesRebuild)
+{
+	HE_ControlCage	cage	= HE_TestGrid(4, *SystemAllocator);
+	HE_CageEditor	editor	{ cage, *SystemAllocator };
+
+	HE_CHECK(MatchesRebuild(cage));
+
+	// Vertex moves
+	editor.MoveVertex(6, { 1.0f, 1.0f, 0.75f });
+	HE_CHECK(MatchesRebuild(cage));
+
+	// A triangle on the bottom border through a new vertex
+	const uint32_t vertex	= editor.AddVertex({ 0.5f, -1.0f, 0.0f });
+	const uint32_t added	= editor.AddFace(std::vector<uint32_t>{ 1, 0, vertex });
+	HE_CHECK(added != HE_InvalidFace);
+	HE_CHECK(MatchesRebuild(cage));
+
+	// Interior face deleted, then added back into its free slot
+	const Loops		before			= LiveLoops(cage);
+	const uint32_t	interiorFace	= 5;
+
+	std::vector<uint32_t> interior;
+	for (uint32_t i = 0; i < cage.faces[interiorFace].edgeCount; i++)
+		interior.push_back(cage.halfEdges[cage.faces[interiorFace].begin + i].vert);
+
+	HE_CHECK(editor.DeleteFace(interiorFace));
+	HE_CHECK(cage.faces[interiorFace].IsFree());
+	HE_CHECK(MatchesRebuild(cage));
+	HE_CHECK(!editor.DeleteFace(interiorFace));
+
+	HE_CHECK(editor.AddFace(interior) == interiorFace);
+	HE_CHECK(editor.stats.slotsReused == 1);
+	HE_CHECK(LiveLoops(cage) == before);
+	HE_CHECK(MatchesRebuild(cage));
+
+	// Interior and border edge splits
+	const uint32_t interiorEdge = FindHalfEdge(cage, 6, 7);
+	HE_CHECK(editor.SplitEdge(interiorEdge, { 1.5f, 1.0f, 0.0f }) != HE_InvalidVertex);
+	HE_CHECK(MatchesRebuild(cage));
+
+	const uint32_t borderEdge = FindHalfEdge(cage, 3, 4);
+	HE_CHECK(cage.halfEdges[borderEdge].Border());
+	HE_CHECK(editor.SplitEdge(borderEdge, { 3.5f, 0.0f, 0.0f }) != HE_InvalidVertex);
+	HE_CHECK(MatchesRebuild(cage));
+
+	// Interior and border edge collapses, the triangle collapses away with its edge
+	HE_CHECK(editor.CollapseEdge(FindHalfEdge(cage, 12, 13)) == 12);
+	HE_CHECK(MatchesRebuild(cage));
+
+	const uint32_t faces = editor.LiveFaceCount();
+	HE_CHECK(editor.CollapseEdge(FindHalfEdge(cage, 0, vertex)) == 0);
+	HE_CHECK(editor.LiveFaceCount() == faces - 1);
+	HE_CHECK(MatchesRebuild(cage));
+
+	HE_CHECK(editor.stats.rejected == 0);
+}
+
+
+/************************************************************************************************/
+
+
+HE_TEST(Editing_RefusedEditsRollBack)
+{
+	HE_ControlCage	cage	= HE_TestGrid(2, *SystemAllocator);
+	HE_CageEditor	editor	{ cage, *SystemAllocator };
+	uint32_t		refused	= 0;
+
+	auto Refused = [&](const bool result)
+	{
+		refused++;
+		return result && editor.stats.rejected == refused;
+	};
+
+	const Loops		before		= LiveLoops(cage);
+	const uint32_t	liveFaces	= editor.LiveFaceCount();
+
+	// Directed edge 0 -> 1 exists, a repeated vertex, and too few and too many edges
+	HE_CHECK(Refused(editor.AddFace(std::vector<uint32_t>{ 0, 1, 4 }) == HE_InvalidFace));
+	HE_CHECK(Refused(editor.AddFace(std::vector<uint32_t>{ 1, 0, 0 }) == HE_InvalidFace));
+	HE_CHECK(Refused(editor.AddFace(std::vector<uint32_t>{ 1, 0 }) == HE_InvalidFace));
+
+	std::vector<uint32_t> tooMany;
+	for (uint32_t idx = 0; idx <= HE_MaxValence; idx++)
+		tooMany.push_back(editor.AddVertex({ float(idx), -2.0f, 0.0f }));
+
+	HE_CHECK(Refused(editor.AddFace(tooMany) == HE_InvalidFace));
+
+	// A triangle touching the grid at corner 8 only, two fans on one vertex
+	const uint32_t v0 = editor.AddVertex({ 3.0f, 2.0f, 0.0f });
+	const uint32_t v1 = editor.AddVertex({ 3.0f, 3.0f, 0.0f });
+	HE_CHECK(Refused(editor.AddFace(std::vector<uint32_t>{ 8, v0, v1 }) == HE_InvalidFace));
+
+	HE_CHECK(LiveLoops(cage) == before);
+	HE_CHECK(editor.LiveFaceCount() == liveFaces);
+	HE_CHECK(MatchesRebuild(cage));
+
+	// Deleting two diagonal quads leaves the center with two fans, the second delete is undone
+	HE_CHECK(editor.DeleteFace(0));
+
+	const Loops afterDelete = LiveLoops(cage);
+	HE_CHECK(Refused(!editor.DeleteFace(3)));
+	HE_CHECK(LiveLoops(cage) == afterDelete);
+	HE_CHECK(MatchesRebuild(cage));
+
+	// Splitting an edge of a face that already has HE_MaxValence edges
+	std::vector<uint32_t> ring;
+	for (uint32_t idx = 0; idx < HE_MaxValence; idx++)
+	{
+		const float angle = 2.0f * std::numbers::pi_v<float> * float(idx) / float(HE_MaxValence);
+		ring.push_back(editor.AddVertex({ 10.0f + std::cos(angle), std::sin(angle), 0.0f }));
+	}
+
+	const uint32_t polygon = editor.AddFace(ring);
+	HE_CHECK(polygon != HE_InvalidFace);
+
+	const Loops withPolygon = LiveLoops(cage);
+	HE_CHECK(Refused(editor.SplitEdge(cage.faces[polygon].begin, { 11.0f, 0.1f, 0.0f }) == HE_InvalidVertex));
+	HE_CHECK(LiveLoops(cage) == withPolygon);
+	HE_CHECK(MatchesRebuild(cage));
+}
+
+
+/************************************************************************************************/
+
+
+HE_TEST(Editing_CollapseOverValenceRollsBack)
+{
+	HE_ControlCage	cage	= TwinHubs(*SystemAllocator);
+	HE_CHECK(MatchesRebuild(cage));
+
+	HE_CageEditor	editor	{ cage, *SystemAllocator };
+	const Loops		before	= LiveLoops(cage);
+
+	HE_CHECK(editor.CollapseEdge(FindHalfEdge(cage, 0, 1)) == HE_InvalidVertex);
+	HE_CHECK(editor.stats.rejected == 1);
+	HE_CHECK(LiveLoops(cage) == before);
+	HE_CHECK(MatchesRebuild(cage));
+
+	// Moving one ring vertex onto a hub is fine, the valence stays below the limit
+	HE_CHECK(editor.CollapseEdge(FindHalfEdge(cage, 1, 2)) == 1);
+	HE_CHECK(MatchesRebuild(cage));
+}
+
+
+/************************************************************************************************/
+
+
+HE_TEST(Editing_RandomEditsMatchRebuild)
+{
+	auto Height = [](uint32_t x, uint32_t y) { return float((x * 13 + y * 7) % 9) * 0.1f; };
+
+	HE_ControlCage	cage	= HE_TestGrid(8, *SystemAllocator, Height);
+	HE_CageEditor	editor	{ cage, *SystemAllocator };
+	std::mt19937	rng		{ 49 };
+	Loops			deleted;
+	uint32_t		applied[4] = {};
+
+	for (uint32_t editIdx = 0; editIdx < 300; editIdx++)
+	{
+		const uint32_t	op		= rng() % 4;
+		const uint32_t	e		= rng() % uint32_t(cage.halfEdges.size());
+		const bool		live	= !cage.faces[cage.faceLookup[e]].IsFree();
+		bool			result	= false;
+
+		if (op == 0 && live)
+		{
+			const uint32_t	faceIdx	= cage.faceLookup[e];
+			const HE_Face	face	= cage.faces[faceIdx];
+
+			std::vector<uint32_t> loop;
+			for (uint32_t i = 0; i < face.edgeCount; i++)
+				loop.push_back(cage.halfEdges[face.begin + i].vert);
+
+			result = editor.DeleteFace(faceIdx);
+			if (result)
+				deleted.push_back(loop);
+		}
+		else if (op == 1 && deleted.size())
+		{
+			result = editor.AddFace(deleted.back()) != HE_InvalidFace;
+			deleted.pop_back();
+		}
+		else if (op == 2 && live)
+		{
+			const float3 a = cage.points[cage.halfEdges[e].vert];
+			const float3 b = cage.points[cage.halfEdges[cage.halfEdges[e].next].vert];
+
+			result = editor.SplitEdge(e, (a + b) * 0.5f) != HE_InvalidVertex;
+		}
+		else if (op == 3 && live)
+			result = editor.CollapseEdge(e) != HE_InvalidVertex;
+
+		applied[op] += result ? 1 : 0;
+
+		HE_CHECK(MatchesRebuild(cage));
+	}
+
+	for (const uint32_t count : applied)
+		HE_CHECK(count > 0);
+}
+
+
+/**********************************************************************
+
+Copyright (c) 2024 Robert May
+
+Permission is hereby granted, free of charge, to any person obtaining a
+copy of this software and associated documentation files (the "Software"),
+to deal in the Software without restriction, including without limitation
+the rights to use, copy, modify, merge, publish, distribute, sublicense,
+and/or sell copies of the Software, and to permit persons to whom the
+Software is furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included
+in all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+**********************************************************************/
@@ -0,0 +1,85 @@
+#include "HE_Tests.hpp"
+#include "HalfEdgeFaceCache.hpp"
+
+#include <cstring>
+
+
+using namespace FlexKit;
+
+
+/************************************************************************************************/
+
+
+// Every face of the fan shares the center, valence 300, so each evaluation copies the whole fan as
+// its one-ring, past the HE_MaxValence^2 faces a fixed buffer held. Patches, flags and points have
+// to match the whole cage subdivided, bit for bit.
+HE_TEST(FaceCache_HighValenceMatchesMesh)
+{
+	const uint32_t			levelCount	= 3;
+	const HE_ControlCage	cage		= HE_TestFan(300, true, *SystemAllocator);
+	HE_FaceEvaluator		cached{ cage, *SystemAllocator };
+	HalfEdgeCPUMesh			mesh{ HE_TestFan(300, true, *SystemAllocator), *SystemAllocator };
+
+	for (uint32_t levelIdx = 0; levelIdx < levelCount; levelIdx++)
+		mesh.BuildNextLevel(1);
+
+	for (uint32_t levelIdx = 0; levelIdx < levelCount; levelIdx++)
+	{
+		const HE_Level& level = mesh.GetLevel(levelIdx);
+
+		for (uint32_t faceIdx = 0; faceIdx < cage.faces.size(); faceIdx++)
+		{
+			const auto result = cached.EvaluateFace(faceIdx, levelIdx);
+
+			HE_CHECK(result != nullptr);
+			if (!result)
+				continue;
+
+			const HE_Face	face		= cage.faces[faceIdx];
+			const uint32_t	begin		= (4 * face.begin) << (2 * levelIdx);
+			const uint32_t	edgeCount	= (4 * face.edgeCount) << (2 * levelIdx);
+
+			HE_CHECK(result->cage.size() == edgeCount);
+			if (result->cage.size() != edgeCount)
+				continue;
+
+			for (uint32_t e = 0; e < edgeCount; e++)
+			{
+				const HE_TwinEdge&	expected	= level.cage[begin + e];
+				const HE_TwinEdge&	edge		= result->cage[e];
+				const uint32_t		twin		= expected.twin - begin < edgeCount ? expected.twin - begin : HE_BorderValue;
+
+				HE_CHECK(edge.twin == twin);
+				HE_CHECK(std::memcmp(&result->points[edge.vert], &level.points[expected.vert], sizeof(float3)) == 0);
+			}
+
+			for (uint32_t patch = 0; patch < edgeCount / 4; patch++)
+				HE_CHECK(result->flags[patch] == level.flags[begin / 4 + patch]);
+		}
+	}
+}
+
+
+/**********************************************************************
+
+Copyright (c) 2024 Robert May
+
+Permission is hereby granted, free of charge, to any person obtaining a
+copy of this software and associated documentation files (the "Software"),
+to deal in the Software without restriction, including without limitation
+the rights to use, copy, modify, merge, publish, distribute, sublicense,
+and/or sell copies of the Software, and to permit persons to whom the
+Software is furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included
+in all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+**********************************************************************/
@@ -0,0 +1,87 @@
+#include "HE_Tests.hpp"
+#include "HalfEdgeInstancing.hpp"
+
+#include <cstring>
+
+
+using namespace FlexKit;
+
+
+/************************************************************************************************/
+
+
+static float Waves(uint32_t x, uint32_t y) { return float((x * 5 + y * 11) % 7) * 0.2f; }
+
+
+// An overridden instance evaluates its points over the shared levels, the result has to match
+// subdividing a copy of the cage with the points moved, bit for bit, in both indexing modes
+HE_TEST(Instancing_OverridesMatchRebuild)
+{
+	const HE_PointOverride overrides[] = {
+		{ 0,	float3{ -0.5f, -0.25f, 1.0f } },
+		{ 7,	float3{ 2.0f, 1.5f, -0.75f } },
+		{ 12,	float3{ 2.25f, 3.0f, 0.5f } },
+	};
+
+	for (const HE_IndexMode indexMode : { HE_IndexMode::PerFace, HE_IndexMode::Shared })
+	{
+		HE_SharedTopology	topology{ HE_TestGrid(4, *SystemAllocator, Waves), *SystemAllocator, indexMode };
+		HE_InstanceSet		instances{ topology, *SystemAllocator };
+
+		const uint32_t plain	= instances.AddInstance({});
+		const uint32_t moved	= instances.AddInstance({});
+
+		instances.SetOverrides(moved, overrides);
+
+		HE_ControlCage reference = HE_TestGrid(4, *SystemAllocator, Waves);
+		for (const HE_PointOverride& o : overrides)
+			reference.points[o.vertex] = o.position;
+
+		HalfEdgeCPUMesh rebuilt{ std::move(reference), *SystemAllocator, indexMode };
+
+		for (uint32_t levelIdx = 0; levelIdx < 3; levelIdx++)
+		{
+			const HE_Level&			expected	= rebuilt.BuildNextLevel();
+			std::span<const float3>	points		= instances.EvaluateInstance(moved, levelIdx);
+
+			HE_CHECK(points.size() == expected.points.size());
+			HE_CHECK(points.size() == expected.points.size() && !memcmp(points.data(), expected.points.data(), points.size_bytes()));
+
+			// Topology is shared, not rebuilt per instance
+			const HE_Level& shared = topology.Level(levelIdx);
+
+			HE_CHECK(shared.cage.size() == expected.cage.size() && !memcmp(shared.cage.data(), expected.cage.data(), shared.cage.ByteSize()));
+			HE_CHECK(shared.flags.size() == expected.flags.size() && !memcmp(shared.flags.data(), expected.flags.data(), shared.flags.ByteSize()));
+
+			std::span<const float3> plainPoints = instances.EvaluateInstance(plain, levelIdx);
+			HE_CHECK(plainPoints.data() == shared.points.data());
+		}
+
+		HE_CHECK(topology.mesh.LevelCount() == 3);
+	}
+}
+
+
+/**********************************************************************
+
+Copyright (c) 2024 Robert May
+
+Permission is hereby granted, free of charge, to any person obtaining a
+copy of this software and associated documentation files (the "Software"),
+to deal in the Software without restriction, including without limitation
+the rights to use, copy, modify, merge, publish, distribute, sublicense,
+and/or sell copies of the Software, and to permit persons to whom the
+Software is furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included
+in all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+**********************************************************************/
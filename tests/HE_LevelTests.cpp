@@ -0,0 +1,281 @@
+#include "HE_Tests.hpp"
+#include "HalfEdgePaging.hpp"
+#include "HalfEdgeValidation.hpp"
+
+#include <cstring>
+#include <vector>
+
+
+using namespace FlexKit;
+
+
+/************************************************************************************************/
+
+
+HE_TEST(Levels_SizesMatchCPU)
+{
+	// The device level buffers are sized from HE_LevelHalfEdgeCount and HE_LevelPointCount, the CPU
+	// reference writes exactly that many half-edges and points at every level
+	HE_ControlCage cages[] = {
+		HE_TestCube(*SystemAllocator),
+		HE_TestGrid(5, *SystemAllocator),
+		HE_TestFan(7, true, *SystemAllocator),
+		HE_TestFan(5, false, *SystemAllocator),
+	};
+
+	for (auto& cage : cages)
+	{
+		const uint64_t	cageHalfEdges	= cage.halfEdges.size();
+		const uint64_t	cagePoints		= cage.vertexCount;
+		HalfEdgeCPUMesh	mesh{ std::move(cage), *SystemAllocator };
+
+		for (uint32_t levelIdx = 0; levelIdx < 4; levelIdx++)
+		{
+			const HE_Level& level = mesh.BuildNextLevel();
+
+			HE_CHECK(level.cage.size() == HE_LevelHalfEdgeCount(cageHalfEdges, levelIdx));
+			HE_CHECK(level.points.size() == HE_LevelPointCount(cageHalfEdges, cagePoints, levelIdx));
+		}
+	}
+}
+
+
+/************************************************************************************************/
+
+
+HE_TEST(Levels_SizesPast2To30)
+{
+	// Sizes only, nothing is allocated at these counts. A cage one half-edge past 16M passes 2^30
+	// half-edges at level 2, its byte sizes pass 2^32 and the next level would overflow the twins.
+	constexpr uint64_t cageHalfEdges	= (1ull << 24) + 1;
+	constexpr uint64_t cagePoints		= 1ull << 23;
+	constexpr uint64_t twinStride		= 16;
+	constexpr uint64_t pointStride		= 32;
+
+	HE_CHECK(HE_LevelHalfEdgeCount(cageHalfEdges, 2) == (1ull << 30) + 64);
+	HE_CHECK(HE_LevelHalfEdgeCount(cageHalfEdges, 3) == (1ull << 32) + 256);
+	HE_CHECK(HE_LevelPointCount(cageHalfEdges, cagePoints, 2) == 9 * ((1ull << 26) + 4));
+	HE_CHECK(HE_LevelPointCount(cageHalfEdges, cagePoints, 3) == 9 * ((1ull << 28) + 16));
+	HE_CHECK(HE_MaxLevelCount(cageHalfEdges) == 3);
+	HE_CHECK(HE_MaxLevelCount(cageHalfEdges << 2) == 2);
+	HE_CHECK(HE_MaxLevelCount((1ull << 30) - 1) == 1);
+	HE_CHECK(HE_MaxLevelCount(1ull << 30) == 0);
+
+	const HE_LevelBufferPlan all = HE_PlanLevelBuffers(cageHalfEdges, cagePoints, HE_MaxLevels, ~0ull, twinStride, pointStride);
+
+	HE_CHECK(all.levelCount == 3);
+	HE_CHECK(all.halfEdgeBytes[2] == ((1ull << 30) + 64) * twinStride);
+	HE_CHECK(all.pointBytes[2] == 9 * ((1ull << 26) + 4) * pointStride);
+	HE_CHECK(all.halfEdgeBytes[3] == 0);
+
+	uint64_t total = 0;
+	for (uint32_t levelIdx = 0; levelIdx < all.levelCount; levelIdx++)
+		total += all.halfEdgeBytes[levelIdx] + all.pointBytes[levelIdx];
+
+	HE_CHECK(all.totalBytes == total);
+	HE_CHECK(all.totalBytes > 0xffffffffull);
+
+	// One byte short of level 2 keeps levels 0 and 1, level 0 is kept over any budget
+	const uint64_t				twoLevels	= all.totalBytes - all.halfEdgeBytes[2] - all.pointBytes[2];
+	const HE_LevelBufferPlan	clamped		= HE_PlanLevelBuffers(cageHalfEdges, cagePoints, HE_MaxLevels, all.totalBytes - 1, twinStride, pointStride);
+
+	HE_CHECK(clamped.levelCount == 2);
+	HE_CHECK(clamped.totalBytes == twoLevels);
+	HE_CHECK(HE_PlanLevelBuffers(cageHalfEdges, cagePoints, HE_MaxLevels, 0, twinStride, pointStride).levelCount == 1);
+
+	// Validation refuses the level that would overflow
+	HE_ControlCage cage = HE_TestGrid(2, *SystemAllocator);
+	HE_ValidationOptions options;
+	options.levelCount = HE_MaxLevelCount(cage.halfEdges.size()) + 1;
+
+	const auto report = ValidateControlCage(cage, *SystemAllocator, options);
+
+	HE_CHECK(!report.IsValid());
+	HE_CHECK(report.errors.size() && report.errors[0].code == HE_ValidationErrorCode::LevelIndexOverflow);
+}
+
+
+/************************************************************************************************/
+
+
+static float Waves(uint32_t x, uint32_t y) { return float((x * 5 + y * 11) % 7) * 0.2f; }
+
+
+HE_TEST(Levels_TwinsPast2To30)
+{
+	// Level 1 of a real grid seen from past patch 2^26, where the level 1 patches of a cage past 16M
+	// half-edges end, so the level 2 half-edges it writes land past 2^30. Only the grid's own
+	// half-edges are stored, the split must match the grid's shifted by the base.
+	struct OffsetLevelView
+	{
+		HE_LevelView	inner;
+		uint32_t		base;	// Half-edges, a multiple of 4
+
+		uint32_t	Next(uint32_t e)		const noexcept { return inner.Next(e - base) + base; }
+		uint32_t	Prev(uint32_t e)		const noexcept { return inner.Prev(e - base) + base; }
+		uint32_t	Twin(uint32_t e)		const noexcept { const uint32_t t = inner.Twin(e - base); return t == HE_BorderValue ? t : t + base; }
+		uint32_t	Vert(uint32_t e)		const noexcept { return inner.Vert(e - base) + 9 * (base / 4); }
+		uint32_t	Face(uint32_t e)		const noexcept { return e >> 2; }
+		bool		IsCorner(uint32_t e)	const noexcept { return inner.IsCorner(e - base); }
+		bool		IsT(uint32_t e)			const noexcept { return inner.IsT(e - base); }
+		float3		Point(uint32_t e)		const noexcept { return inner.Point(e - base); }
+		HE_Face		GetFace(uint32_t p)		const noexcept { return { 4 * p, 9 * p, 4, (uint16_t)inner.level.level }; }
+	};
+
+	HalfEdgeCPUMesh mesh{ HE_TestGrid(4, *SystemAllocator, Waves), *SystemAllocator };
+	for (uint32_t levelIdx = 0; levelIdx < 3; levelIdx++)
+		mesh.BuildNextLevel();
+
+	const HE_Level&			level1		= mesh.GetLevel(1);
+	const HE_Level&			level2		= mesh.GetLevel(2);
+	const HE_LevelView		view		= { level1 };
+	const uint32_t			basePatch	= 1u << 26;
+	const OffsetLevelView	offset		= { view, 4 * basePatch };
+	const uint64_t			outputBase	= 16ull * basePatch;
+	const uint64_t			pointBase	= 9ull * basePatch;
+
+	HE_CHECK(outputBase == 1ull << 30);
+	HE_CHECK(4 * (offset.base + uint64_t(level1.cage.size())) < HE_BorderValue);
+
+	std::vector<HE_TwinEdge>	edges(level2.cage.size());
+	std::vector<uint8_t>		flags(level2.flags.size());
+	std::vector<float3>			points(level2.points.size());
+	bool						inRange = true;
+
+	for (uint32_t patchIdx = 0; patchIdx < level1.PatchCount(); patchIdx++)
+	{
+		HE_SubdivideFace(offset, basePatch + patchIdx,
+			[&](const uint32_t idx) -> HE_TwinEdge&
+			{
+				inRange &= idx >= outputBase && idx - outputBase < edges.size();
+				return edges[(idx - outputBase) % edges.size()];
+			},
+			[&](const uint32_t idx) -> uint8_t&
+			{
+				inRange &= idx >= offset.base && idx - offset.base < flags.size();
+				return flags[(idx - offset.base) % flags.size()];
+			},
+			[&](const uint32_t idx) -> float3&
+			{
+				inRange &= idx >= pointBase && idx - pointBase < points.size();
+				return points[(idx - pointBase) % points.size()];
+			});
+	}
+
+	HE_CHECK(inRange);
+
+	uint32_t pastBase = 0;
+	for (size_t idx = 0; idx < edges.size(); idx++)
+	{
+		const HE_TwinEdge& expected = level2.cage[idx];
+
+		if (expected.Border())
+			HE_CHECK(edges[idx].Border());
+		else
+		{
+			HE_CHECK(edges[idx].twin == expected.twin + outputBase);
+			pastBase += edges[idx].twin >= 1u << 30;
+		}
+
+		HE_CHECK(edges[idx].vert == expected.vert + pointBase);
+	}
+
+	HE_CHECK(pastBase > 0);
+	HE_CHECK(std::memcmp(flags.data(), level2.flags.data(), flags.size()) == 0);
+	HE_CHECK(std::memcmp(points.data(), level2.points.data(), points.size() * sizeof(float3)) == 0);
+}
+
+
+/************************************************************************************************/
+
+
+HE_TEST(Levels_PlannedBytesPast2To32)
+{
+	// 1600 quads planned down to level 7 want over 4GB, the paged levels the same faces would hold
+	// densely as well. Byte totals and table offsets are summed in 64 bits.
+	HE_ControlCage cage = HE_TestGrid(40, *SystemAllocator);
+
+	const uint32_t faceCount = (uint32_t)cage.faces.size();
+
+	std::vector<uint8_t> wanted(faceCount, uint8_t(HE_MaxLevels));
+	std::vector<uint8_t> planned(faceCount);
+
+	uint64_t wantedBytes = 0;
+	for (const auto& face : cage.faces)
+	{
+		for (uint32_t level = 0; level < HE_MaxLevels; level++)
+			wantedBytes += HE_FaceLevelBytes(face.edgeCount, level);
+	}
+
+	HE_CHECK(HE_MaxLevelCount(cage.halfEdges.size()) == HE_MaxLevels);
+	HE_CHECK(wantedBytes > 0xffffffffull);
+
+	HE_LevelPlanOptions options;
+	options.maxLevel	= HE_MaxLevels;
+	options.budgetBytes	= ~0ull;
+
+	const auto full = PlanLevels(cage, wanted, planned, options);
+
+	HE_CHECK(full.wantedBytes == wantedBytes);
+	HE_CHECK(full.plannedBytes == wantedBytes);
+	HE_CHECK(full.clampedRegions == 0);
+	HE_CHECK(full.deepestLevel == HE_MaxLevels);
+
+	for (const uint8_t level : planned)
+		HE_CHECK(level == HE_MaxLevels);
+
+	options.budgetBytes = wantedBytes - 1;
+
+	const auto clamped = PlanLevels(cage, wanted, planned, options);
+
+	HE_CHECK(clamped.wantedBytes == wantedBytes);
+	HE_CHECK(clamped.plannedBytes <= options.budgetBytes);
+	HE_CHECK(clamped.plannedBytes > 0xffffffffull);
+	HE_CHECK(clamped.clampedRegions > 0);
+
+	// Paged levels 1..7, the dense size of the lot counts every parent
+	HE_PagedLevelOptions pagedOptions;
+	pagedOptions.levelCount		= HE_MaxLevels;
+	pagedOptions.parentsPerPage	= 1u << 12;
+
+	HE_PagedLevels	paged{ *SystemAllocator, cage, pagedOptions };
+	uint64_t		denseBytes = 0;
+
+	HE_CHECK(paged.LevelCount() == HE_MaxLevels - 1);
+
+	for (uint32_t level = 1; level <= paged.LevelCount(); level++)
+	{
+		HE_CHECK(paged.ParentCount(level) == HE_LevelHalfEdgeCount(cage.halfEdges.size(), level) / HE_PagedLevels::EdgesPerParent);
+
+		for (const auto& face : cage.faces)
+			denseBytes += HE_FaceLevelBytes(face.edgeCount, level);
+	}
+
+	HE_CHECK(paged.DenseBytes() == denseBytes);
+	HE_CHECK(paged.DenseBytes() > 0xffffffffull);
+}
+
+
+/**********************************************************************
+
+Copyright (c) 2024 Robert May
+
+Permission is hereby granted, free of charge, to any person obtaining a
+copy of this software and associated documentation files (the "Software"),
+to deal in the Software without restriction, including without limitation
+the rights to use, copy, modify, merge, publish, distribute, sublicense,
+and/or sell copies of the Software, and to permit persons to whom the
+Software is furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included
+in all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+**********************************************************************/
@@ -0,0 +1,229 @@
+#include "HE_Tests.hpp"
+#include "HalfEdgeMeshlets.hpp"
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <vector>
+
+
+using namespace FlexKit;
+
+
+/************************************************************************************************/
+
+
+static float Waves(uint32_t x, uint32_t y) { return float((x * 5 + y * 11) % 7) * 0.2f; }
+
+
+using Triangle = std::array<uint32_t, 3>;
+
+
+// Checks every meshlet against the limits and its own ranges, then that the triangles they emit,
+// through their local indices, are exactly the two triangles of every patch of the level
+static void CheckMeshlets(HE_TestContext& context, const HE_Level& level, const HE_MeshletList& list, const uint32_t maxVertices, const uint32_t maxPrimitives)
+{
+	HE_CHECK(list.meshlets.size() == list.bounds.size());
+
+	uint32_t vertexOffset		= 0;
+	uint32_t primitiveOffset	= 0;
+
+	std::vector<Triangle> emitted;
+
+	for (size_t meshletIdx = 0; meshletIdx < list.meshlets.size(); meshletIdx++)
+	{
+		const HE_Meshlet&		meshlet	= list.meshlets[meshletIdx];
+		const HE_MeshletBounds&	bounds	= list.bounds[meshletIdx];
+
+		HE_CHECK(meshlet.vertexCount > 0 && meshlet.vertexCount <= maxVertices);
+		HE_CHECK(meshlet.primitiveCount > 0 && meshlet.primitiveCount <= maxPrimitives);
+		HE_CHECK(meshlet.primitiveCount % 2 == 0);
+		HE_CHECK(meshlet.vertexOffset == vertexOffset);
+		HE_CHECK(meshlet.primitiveOffset == primitiveOffset);
+
+		vertexOffset	+= meshlet.vertexCount;
+		primitiveOffset	+= meshlet.primitiveCount;
+
+		// A vertex is listed once per meshlet
+		std::vector<uint32_t> vertices{ list.vertexIndices.begin() + meshlet.vertexOffset, list.vertexIndices.begin() + meshlet.vertexOffset + meshlet.vertexCount };
+		std::ranges::sort(vertices);
+
+		HE_CHECK(std::ranges::adjacent_find(vertices) == vertices.end());
+
+		for (const uint32_t vertex : vertices)
+		{
+			HE_CHECK(vertex < level.points.size());
+
+			const float3 p = level.points[vertex];
+			const float3 d = p - bounds.center;
+
+			HE_CHECK(p.x >= bounds.min.x && p.y >= bounds.min.y && p.z >= bounds.min.z);
+			HE_CHECK(p.x <= bounds.max.x && p.y <= bounds.max.y && p.z <= bounds.max.z);
+			HE_CHECK(std::sqrt(d.x * d.x + d.y * d.y + d.z * d.z) <= bounds.radius * (1.0f + 1.0e-5f));
+		}
+
+		for (uint32_t primitiveIdx = 0; primitiveIdx < meshlet.primitiveCount; primitiveIdx++)
+		{
+			const uint32_t packed = list.primitives[meshlet.primitiveOffset + primitiveIdx];
+
+			HE_CHECK((packed >> 24) == 0);
+
+			Triangle triangle;
+			for (uint32_t i = 0; i < 3; i++)
+			{
+				const uint32_t local = (packed >> (8 * i)) & 0xff;
+
+				HE_CHECK(local < meshlet.vertexCount);
+				triangle[i] = list.vertexIndices[meshlet.vertexOffset + Min(local, meshlet.vertexCount - 1)];
+			}
+
+			emitted.push_back(triangle);
+		}
+	}
+
+	HE_CHECK(vertexOffset == list.vertexIndices.size());
+	HE_CHECK(primitiveOffset == list.primitives.size());
+
+	Vector<uint32_t> remap{ SystemAllocator };
+	WeldLevelVertices(level, remap);
+
+	std::vector<Triangle> expected;
+
+	for (uint32_t patchIdx = 0; patchIdx < level.PatchCount(); patchIdx++)
+	{
+		uint32_t corners[4];
+		for (uint32_t i = 0; i < 4; i++)
+			corners[i] = remap[level.cage[4 * patchIdx + i].vert];
+
+		expected.push_back({ corners[0], corners[1], corners[2] });
+		expected.push_back({ corners[0], corners[2], corners[3] });
+	}
+
+	std::ranges::sort(emitted);
+	std::ranges::sort(expected);
+
+	HE_CHECK(emitted == expected);
+}
+
+
+/************************************************************************************************/
+
+
+// Every meshlet stays within 64 primitives and 128 vertices, or the smaller limits it is given, and
+// its local indices reach only its own vertices, on open and closed cages at several levels
+HE_TEST(Meshlets_LimitsAndLocalIndices)
+{
+	HE_ControlCage cages[] = {
+		HE_TestGrid(12, *SystemAllocator, Waves),
+		HE_TestCube(*SystemAllocator),
+		HE_TestFan(7, true, *SystemAllocator),
+		HE_TestFan(5, false, *SystemAllocator),
+	};
+
+	const HE_MeshletOptions options[] = {
+		{},
+		{ .maxVertices = 16, .maxPrimitives = 8 },
+		{ .maxVertices = 9, .maxPrimitives = 64 },
+	};
+
+	for (auto& cage : cages)
+	{
+		HalfEdgeCPUMesh mesh{ std::move(cage), *SystemAllocator };
+
+		for (uint32_t levelIdx = 0; levelIdx < 3; levelIdx++)
+		{
+			const HE_Level& level = mesh.BuildNextLevel();
+
+			for (const auto& option : options)
+			{
+				const HE_MeshletList list = BuildMeshlets(level, *SystemAllocator, option);
+
+				CheckMeshlets(context, level, list, option.maxVertices, option.maxPrimitives);
+			}
+		}
+	}
+}
+
+
+/************************************************************************************************/
+
+
+// Limits too small for a patch are raised to one patch a meshlet, and an empty level gives no meshlets
+HE_TEST(Meshlets_DegenerateLimits)
+{
+	HalfEdgeCPUMesh mesh{ HE_TestGrid(4, *SystemAllocator), *SystemAllocator };
+
+	const HE_Level&			level	= mesh.BuildNextLevel();
+	const HE_MeshletList	list	= BuildMeshlets(level, *SystemAllocator, { .maxVertices = 2, .maxPrimitives = 1 });
+
+	HE_CHECK(list.meshlets.size() == level.PatchCount());
+	CheckMeshlets(context, level, list, 4, 2);
+
+	const HE_Level			empty{ *SystemAllocator };
+	const HE_MeshletList	none = BuildMeshlets(empty, *SystemAllocator);
+
+	HE_CHECK(none.meshlets.empty() && none.vertexIndices.empty() && none.primitives.empty());
+}
+
+
+/************************************************************************************************/
+
+
+// Welding joins the copies every face keeps of its corners and edge points, a grid of N by N quads
+// has (2N + 1)^2 distinct points after one subdivision. Meshlets share them, so they emit fewer
+// vertices per triangle than a mesh shader group per patch.
+HE_TEST(Meshlets_WeldAndStats)
+{
+	constexpr uint32_t N = 12;
+
+	HalfEdgeCPUMesh mesh{ HE_TestGrid(N, *SystemAllocator, Waves), *SystemAllocator };
+
+	const HE_Level& level = mesh.BuildNextLevel();
+
+	Vector<uint32_t> remap{ SystemAllocator };
+	HE_CHECK(WeldLevelVertices(level, remap) == (2 * N + 1) * (2 * N + 1));
+
+	for (uint32_t pointIdx = 0; pointIdx < remap.size(); pointIdx++)
+	{
+		const float3 a = level.points[pointIdx];
+		const float3 b = level.points[remap[pointIdx]];
+
+		HE_CHECK(remap[pointIdx] <= pointIdx);
+		HE_CHECK(std::abs(a.x - b.x) + std::abs(a.y - b.y) + std::abs(a.z - b.z) < 1.0e-5f);
+	}
+
+	const HE_MeshletList	list	= BuildMeshlets(level, *SystemAllocator);
+	const HE_MeshletStats	stats	= GetMeshletStats(list, level);
+
+	HE_CHECK(stats.patchCount == level.PatchCount());
+	HE_CHECK(stats.triangleCount == 2 * level.PatchCount());
+	HE_CHECK(stats.uniqueVertexCount == (2 * N + 1) * (2 * N + 1));
+	HE_CHECK(stats.emittedVertexCount >= stats.uniqueVertexCount);
+	HE_CHECK(stats.verticesPerTriangle < stats.perPatchVertsPerTri);
+	HE_CHECK(stats.primitiveFillRate > 0.5f && stats.primitiveFillRate <= 1.0f);
+}
+
+
+/**********************************************************************
+
+Copyright (c) 2024 Robert May
+
+Permission is hereby granted, free of charge, to any person obtaining a
+copy of this software and associated documentation files (the "Software"),
+to deal in the Software without restriction, including without limitation
+the rights to use, copy, modify, merge, publish, distribute, sublicense,
+and/or sell copies of the Software, and to permit persons to whom the
+Software is furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included
+in all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+**********************************************************************/
@@ -0,0 +1,130 @@
+#include "HE_Tests.hpp"
+#include "HalfEdgePaging.hpp"
+
+#include <random>
+
+
+using namespace FlexKit;
+
+
+/************************************************************************************************/
+
+
+static float Waves(uint32_t x, uint32_t y) { return float((x * 5 + y * 11) % 7) * 0.2f; }
+
+
+// Every resident parent of every paged level has to hold exactly what the dense CPU levels hold
+static uint32_t CompareResident(HE_TestContext& context, const HE_PagedLevels& paged, const HalfEdgeCPUMesh& dense)
+{
+	uint32_t residentParents = 0;
+
+	for (uint32_t levelIdx = 1; levelIdx <= paged.LevelCount(); levelIdx++)
+	{
+		const HE_Level& level = dense.GetLevel(levelIdx);
+
+		HE_CHECK(paged.ParentCount(levelIdx) == dense.GetLevel(levelIdx - 1).PatchCount());
+
+		for (uint32_t parent = 0; parent < paged.ParentCount(levelIdx); parent++)
+		{
+			if (!paged.IsResident(levelIdx, parent))
+				continue;
+
+			residentParents++;
+
+			for (uint32_t e = HE_PagedLevels::EdgesPerParent * parent; e < HE_PagedLevels::EdgesPerParent * (parent + 1); e++)
+			{
+				const HE_TwinEdge edge = paged.Edge(levelIdx, e);
+
+				HE_CHECK(edge.twin == level.cage[e].twin);
+				HE_CHECK(edge.vert == level.cage[e].vert);
+				HE_CHECK(paged.EdgeFlags(levelIdx, e) == level.EdgeFlags(e));
+			}
+
+			for (uint32_t v = HE_PagedLevels::PointsPerParent * parent; v < HE_PagedLevels::PointsPerParent * (parent + 1); v++)
+			{
+				const float3 point = paged.Point(levelIdx, v);
+				HE_CHECK(point.x == level.points[v].x && point.y == level.points[v].y && point.z == level.points[v].z);
+			}
+		}
+	}
+
+	return residentParents;
+}
+
+
+/************************************************************************************************/
+
+
+HE_TEST(Paging_MatchesResident)
+{
+	HE_ControlCage	cage	= HE_TestGrid(9, *SystemAllocator, Waves);
+	HalfEdgeCPUMesh	dense	{ HE_TestGrid(9, *SystemAllocator, Waves), *SystemAllocator };
+
+	for (uint32_t levelIdx = 0; levelIdx < 3; levelIdx++)
+		dense.BuildNextLevel();
+
+	HE_PagedLevels paged{ *SystemAllocator, cage, { .levelCount = 2, .parentsPerPage = 4 } };
+	HE_CHECK(paged.LevelCount() == 2);
+
+	// Everything resident
+	std::vector<uint8_t> faceLevels(cage.faces.size(), 3);
+
+	paged.UpdateResidency(faceLevels);
+	paged.Build(dense.GetLevel(0));
+
+	const uint32_t allParents = CompareResident(context, paged, dense);
+	HE_CHECK(allParents == paged.ParentCount(1) + paged.ParentCount(2));
+
+	// Random subsets, then coarsen most of the mesh and compact the holes away
+	std::mt19937 rng{ 35 };
+
+	for (uint32_t pass = 0; pass < 4; pass++)
+	{
+		for (auto& level : faceLevels)
+			level = uint8_t(rng() % 4);
+
+		paged.UpdateResidency(faceLevels);
+		paged.Build(dense.GetLevel(0), pass % 2);
+
+		const uint32_t resident = CompareResident(context, paged, dense);
+		HE_CHECK(resident > 0 && resident < allParents);
+
+		for (uint32_t face = 0; face < cage.faces.size(); face++)
+			HE_CHECK(paged.RequiredLevel(face) >= faceLevels[face]);
+	}
+
+	std::fill(faceLevels.begin(), faceLevels.end(), uint8_t(1));
+	faceLevels[40] = 3;
+
+	paged.UpdateResidency(faceLevels);
+	paged.Compact();
+	paged.Build(dense.GetLevel(0));
+
+	HE_CHECK(paged.PageStats().Fragmentation() == 0.0f);
+	HE_CHECK(CompareResident(context, paged, dense) > 0);
+}
+
+
+/**********************************************************************
+
+Copyright (c) 2024 Robert May
+
+Permission is hereby granted, free of charge, to any person obtaining a
+copy of this software and associated documentation files (the "Software"),
+to deal in the Software without restriction, including without limitation
+the rights to use, copy, modify, merge, publish, distribute, sublicense,
+and/or sell copies of the Software, and to permit persons to whom the
+Software is furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included
+in all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+**********************************************************************/
@@ -0,0 +1,280 @@
+#include "HE_Tests.hpp"
+#include "HalfEdgeProgressive.hpp"
+
+#include <cmath>
+#include <cstring>
+#include <sstream>
+#include <string>
+#include <vector>
+
+
+using namespace FlexKit;
+
+
+/************************************************************************************************/
+
+
+static float Waves(uint32_t x, uint32_t y) { return float((x * 5 + y * 11) % 7) * 0.2f; }
+
+
+// Subdivided levels with detail the subdivision rules don't predict, as a sculpt would leave
+static HalfEdgeCPUMesh BakeSculpted(const uint32_t N, const uint32_t levelCount)
+{
+	HalfEdgeCPUMesh mesh{ HE_TestGrid(N, *SystemAllocator, Waves), *SystemAllocator };
+
+	for (uint32_t levelIdx = 0; levelIdx < levelCount; levelIdx++)
+	{
+		mesh.BuildNextLevel();
+
+		for (float3& p : mesh.levels[levelIdx].points)
+			p.z += 0.05f * std::sin(3.0f * p.x) * std::cos(2.0f * p.y);
+	}
+
+	return mesh;
+}
+
+
+static std::string Encode(const HalfEdgeCPUMesh& mesh, const HE_ProgressiveOptions& options = {})
+{
+	std::ostringstream stream;
+	WriteProgressive(stream, mesh, *SystemAllocator, options);
+
+	return stream.str();
+}
+
+
+struct DecodeResult
+{
+	bool		cage	= false;	// The cage was read
+	uint32_t	levels	= 0;		// Levels decoded before the reader stopped
+	bool		failed	= false;	// Stopped on an error rather than at the last level
+};
+
+
+static DecodeResult Decode(const std::string& bytes)
+{
+	std::istringstream		stream{ bytes };
+	HE_ProgressiveReader	reader{ stream, *SystemAllocator };
+
+	if (!reader.IsValid())
+		return { .failed = true };
+
+	while (reader.DecodeNextLevel(2));
+
+	return { .cage = true, .levels = reader.LevelsDecoded(), .failed = !reader.IsValid() };
+}
+
+
+/************************************************************************************************/
+
+
+// The cage is ready as soon as the header and cage chunk are read, and each level after it reads
+// only its own bytes, level 0 first. Decoded points match the baked ones to half a quantization step.
+HE_TEST(Progressive_RoundTrip)
+{
+	const HalfEdgeCPUMesh	baked	= BakeSculpted(12, 3);
+	std::string				bytes;
+
+	{
+		std::ostringstream	stream;
+		const auto			stats = WriteProgressive(stream, baked, *SystemAllocator, { .blockPoints = 500, .threadCount = 3 });
+
+		HE_CHECK(stats.Succeeded());
+		HE_CHECK(stats.levelCount == 3);
+		HE_CHECK(stats.maxError <= 0.5f * stats.step * 1.001f);
+		HE_CHECK(stats.CompressionRatio() > 1.0);
+
+		bytes = stream.str();
+		HE_CHECK(stats.fileBytes == bytes.size());
+	}
+
+	std::istringstream		stream{ bytes };
+	HE_ProgressiveReader	reader{ stream, *SystemAllocator };
+
+	HE_CHECK(reader.IsValid());
+	HE_CHECK(reader.LevelCount() == 3);
+	HE_CHECK(reader.LevelsDecoded() == 0);
+	HE_CHECK(uint64_t(stream.tellg()) == sizeof(HE_ProgressiveHeader) + reader.Header().cageBytes);
+	HE_CHECK(uint64_t(stream.tellg()) == reader.Stats().bytesRead);
+
+	const HE_ControlCage& cage = reader.Cage();
+
+	HE_CHECK(cage.halfEdges.size() == baked.cage.halfEdges.size());
+	HE_CHECK(cage.faces.size() == baked.cage.faces.size());
+	HE_CHECK(memcmp(cage.halfEdges.data(), baked.cage.halfEdges.data(), baked.cage.halfEdges.ByteSize()) == 0);
+
+	for (uint32_t pointIdx = 0; pointIdx < baked.cage.points.size(); pointIdx++)
+	{
+		HE_CHECK(cage.points[pointIdx].x == baked.cage.points[pointIdx].x);
+		HE_CHECK(cage.points[pointIdx].y == baked.cage.points[pointIdx].y);
+		HE_CHECK(cage.points[pointIdx].z == baked.cage.points[pointIdx].z);
+	}
+
+	const float bound = 0.5f * reader.Header().step * 1.001f;
+
+	for (uint32_t levelIdx = 0; levelIdx < 3; levelIdx++)
+	{
+		const HE_Level* level = reader.DecodeNextLevel(2);
+
+		HE_CHECK(level != nullptr);
+		if (!level)
+			return;
+
+		HE_CHECK(reader.LevelsDecoded() == levelIdx + 1);
+		HE_CHECK(uint64_t(stream.tellg()) == reader.Stats().bytesRead);
+
+		const HE_Level& expected = baked.GetLevel(levelIdx);
+
+		HE_CHECK(level->points.size() == expected.points.size());
+		HE_CHECK(memcmp(level->cage.data(), expected.cage.data(), expected.cage.ByteSize()) == 0);
+
+		float maxError = 0.0f;
+		for (uint32_t pointIdx = 0; pointIdx < expected.points.size(); pointIdx++)
+		{
+			for (uint32_t axis = 0; axis < 3; axis++)
+				maxError = Max(maxError, std::abs(level->points[pointIdx][axis] - expected.points[pointIdx][axis]));
+		}
+
+		HE_CHECK(maxError <= bound);
+	}
+
+	HE_CHECK(reader.DecodeNextLevel() == nullptr);
+	HE_CHECK(reader.IsValid());
+	HE_CHECK(reader.Stats().bytesRead == bytes.size());
+	HE_CHECK(reader.Stats().pointsDecoded > 0);
+
+	// Levels that only follow the subdivision rules are all zero residuals
+	HalfEdgeCPUMesh smooth{ HE_TestGrid(12, *SystemAllocator, Waves), *SystemAllocator };
+	for (uint32_t levelIdx = 0; levelIdx < 3; levelIdx++)
+		smooth.BuildNextLevel();
+
+	HE_CHECK(Encode(smooth).size() < bytes.size());
+}
+
+
+/************************************************************************************************/
+
+
+// A stream cut short anywhere gives up the cage and every level it holds in full, and refuses the
+// level it cuts through instead of reading past its end
+HE_TEST(Progressive_Truncated)
+{
+	const HalfEdgeCPUMesh	baked	= BakeSculpted(4, 2);
+	const std::string		bytes	= Encode(baked, { .blockPoints = 64 });
+
+	std::vector<uint64_t> ends;
+	{
+		std::istringstream		stream{ bytes };
+		HE_ProgressiveReader	reader{ stream, *SystemAllocator };
+
+		ends.push_back(reader.Stats().bytesRead);
+		while (reader.DecodeNextLevel())
+			ends.push_back(reader.Stats().bytesRead);
+
+		HE_CHECK(ends.size() == 3 && ends.back() == bytes.size());
+	}
+
+	for (size_t size = 0; size <= bytes.size(); size++)
+	{
+		uint32_t complete = 0;
+		for (size_t levelIdx = 1; levelIdx < ends.size(); levelIdx++)
+			complete += size >= ends[levelIdx] ? 1 : 0;
+
+		const DecodeResult result = Decode(bytes.substr(0, size));
+
+		HE_CHECK(result.cage == (size >= ends[0]));
+		HE_CHECK(result.levels == complete);
+		HE_CHECK(result.failed == (size < bytes.size()));
+	}
+}
+
+
+/************************************************************************************************/
+
+
+// Corrupt headers and block tables are refused before they size anything, corrupt data when it
+// fails to decompress to the size the table gives
+HE_TEST(Progressive_Corrupt)
+{
+	const HalfEdgeCPUMesh	baked	= BakeSculpted(4, 2);
+	const std::string		bytes	= Encode(baked, { .blockPoints = 64 });
+
+	HE_ProgressiveHeader header;
+	memcpy(&header, bytes.data(), sizeof(header));
+
+	const size_t levelOffset	= sizeof(HE_ProgressiveHeader) + header.cageBytes;
+	const size_t blockOffset	= levelOffset + sizeof(HE_ProgressiveLevelHeader);
+
+	HE_ProgressiveLevelHeader levelHeader;
+	memcpy(&levelHeader, bytes.data() + levelOffset, sizeof(levelHeader));
+
+	const size_t dataOffset = blockOffset + levelHeader.blockCount * sizeof(HE_ProgressiveBlock);
+
+	HE_CHECK(Decode(bytes).levels == 2 && !Decode(bytes).failed);
+	HE_CHECK(levelHeader.blockCount > 1);
+
+	auto Corrupt =
+		[&](auto&& edit)
+		{
+			std::string copy = bytes;
+
+			edit(
+				*reinterpret_cast<HE_ProgressiveHeader*>(copy.data()),
+				*reinterpret_cast<HE_ProgressiveLevelHeader*>(copy.data() + levelOffset),
+				reinterpret_cast<HE_ProgressiveBlock*>(copy.data() + blockOffset),
+				copy);
+
+			return Decode(copy).failed;
+		};
+
+	using Header		= HE_ProgressiveHeader;
+	using LevelHeader	= HE_ProgressiveLevelHeader;
+	using Block			= HE_ProgressiveBlock;
+
+	HE_CHECK(Corrupt([](Header& h, LevelHeader&, Block*, std::string&) { h.magic[0] = 'X'; }));
+	HE_CHECK(Corrupt([](Header& h, LevelHeader&, Block*, std::string&) { h.version = 1; }));
+	HE_CHECK(Corrupt([](Header& h, LevelHeader&, Block*, std::string&) { h.levelCount = HE_MaxLevels + 1; }));
+	HE_CHECK(Corrupt([](Header& h, LevelHeader&, Block*, std::string&) { h.step = 0.0f; }));
+	HE_CHECK(Corrupt([](Header& h, LevelHeader&, Block*, std::string&) { h.step = std::nanf(""); }));
+	HE_CHECK(Corrupt([](Header& h, LevelHeader&, Block*, std::string&) { h.cageRawBytes = 0xffffffff; }));
+	HE_CHECK(Corrupt([](Header& h, LevelHeader&, Block*, std::string&) { h.cageRawBytes += 1; }));
+	HE_CHECK(Corrupt([](Header& h, LevelHeader&, Block*, std::string&) { h.halfEdgeCount += 4; }));
+	HE_CHECK(Corrupt([](Header& h, LevelHeader&, Block*, std::string&) { h.pointCount += 1; }));
+
+	HE_CHECK(Corrupt([](Header&, LevelHeader& l, Block*, std::string&) { l.level = 1; }));
+	HE_CHECK(Corrupt([](Header&, LevelHeader& l, Block*, std::string&) { l.blockPoints = 0; }));
+	HE_CHECK(Corrupt([](Header&, LevelHeader& l, Block*, std::string&) { l.blockCount = 0xffffffff; }));
+	HE_CHECK(Corrupt([](Header&, LevelHeader& l, Block*, std::string&) { l.pointCount += 1; }));
+	HE_CHECK(Corrupt([](Header&, LevelHeader& l, Block*, std::string&) { l.pointCount = 0xffffffff; l.blockPoints = 0xffffffff; l.blockCount = 1; }));
+
+	HE_CHECK(Corrupt([](Header&, LevelHeader&, Block* b, std::string&) { b[0].rawBytes = 0xffffffff; }));
+	HE_CHECK(Corrupt([](Header&, LevelHeader&, Block* b, std::string&) { b[0].compressedBytes = 0xffffffff; }));
+	HE_CHECK(Corrupt([](Header&, LevelHeader&, Block* b, std::string&) { b[1].rawBytes += 1; }));
+	HE_CHECK(Corrupt([](Header&, LevelHeader&, Block* b, std::string&) { b[0].compressedBytes -= 1; }));
+	HE_CHECK(Corrupt([&](Header&, LevelHeader&, Block* b, std::string& c) { c[dataOffset + b[0].compressedBytes / 2] ^= 0x5a; }));
+}
+
+
+/**********************************************************************
+
+Copyright (c) 2024 Robert May
+
+Permission is hereby granted, free of charge, to any person obtaining a
+copy of this software and associated documentation files (the "Software"),
+to deal in the Software without restriction, including without limitation
+the rights to use, copy, modify, merge, publish, distribute, sublicense,
+and/or sell copies of the Software, and to permit persons to whom the
+Software is furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included
+in all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+**********************************************************************/
@@ -0,0 +1,134 @@
+#include "HE_Tests.hpp"
+#include "HalfEdgeSoA.hpp"
+
+#include <cmath>
+#include <cstring>
+#include <numbers>
+
+
+using namespace FlexKit;
+
+
+/************************************************************************************************/
+
+
+// Separate polygons of three to HE_MaxValence edges, twice over, so the face kernels see every edge
+// count mixed in one group of lanes and a tail the scalar loop finishes
+static HE_ControlCage MixedPolygons(iAllocator& allocator)
+{
+	ModifiableShape shape{};
+
+	for (uint32_t copy = 0; copy < 2; copy++)
+	{
+		for (uint32_t edgeCount = 3; edgeCount <= HE_MaxValence; edgeCount++)
+		{
+			std::vector<uint32_t> polygon;
+
+			for (uint32_t idx = 0; idx < edgeCount; idx++)
+			{
+				const float angle = 2.0f * std::numbers::pi_v<float> * float(idx) / float(edgeCount);
+				polygon.push_back(shape.AddVertex({ 3.0f * edgeCount + std::cos(angle), float(copy) * 3.0f + std::sin(angle), 0.1f * float(idx % 3) }));
+			}
+
+			shape.AddPolygon(polygon.data(), polygon.data() + polygon.size());
+		}
+	}
+
+	return BuildControlCage(shape, allocator);
+}
+
+
+static float Bumps(uint32_t x, uint32_t y) { return std::sin(float(x) * 0.7f) * std::cos(float(y) * 1.3f); }
+
+
+/************************************************************************************************/
+
+
+HE_TEST(SoA_KernelsMatchScalar)
+{
+	HE_ControlCage cages[] = {
+		MixedPolygons(*SystemAllocator),
+		HE_TestGrid(13, *SystemAllocator, Bumps),
+		HE_TestFan(11, true, *SystemAllocator),
+	};
+
+	printf("    widest kernel: %s\n", HE_SoAKernelString(HE_BestSoAKernel()));
+
+	HE_SoAPoints scalarFaces	{ *SystemAllocator };
+	HE_SoAPoints scalarEdges	{ *SystemAllocator };
+	HE_SoAPoints simdFaces		{ *SystemAllocator };
+	HE_SoAPoints simdEdges		{ *SystemAllocator };
+
+	auto Equal = [](const HE_SoAPoints& lhs, const HE_SoAPoints& rhs)
+	{
+		return	lhs.x.size() == rhs.x.size() &&
+				memcmp(lhs.x.data(), rhs.x.data(), lhs.x.ByteSize()) == 0 &&
+				memcmp(lhs.y.data(), rhs.y.data(), lhs.y.ByteSize()) == 0 &&
+				memcmp(lhs.z.data(), rhs.z.data(), lhs.z.ByteSize()) == 0;
+	};
+
+	for (auto& cage : cages)
+	{
+		HE_Level level{ *SystemAllocator };
+		HE_SubdivideFaces(HE_ControlCageView{ cage }, level);
+
+		HE_SoAMesh meshes[] = { HE_SoAMesh{ *SystemAllocator }, HE_SoAMesh{ *SystemAllocator } };
+		HE_BuildSoAMesh(cage, meshes[0]);
+		HE_BuildSoAMesh(level, meshes[1]);
+
+		for (const auto& mesh : meshes)
+		{
+			HE_SoAFacePoints(mesh, scalarFaces, HE_SoAKernel::Scalar);
+			HE_SoAEdgePoints(mesh, scalarFaces, scalarEdges, HE_SoAKernel::Scalar);
+
+			// The scalar loop is the AoS rule on the mirror
+			if (&mesh == &meshes[0])
+			{
+				const HE_ControlCageView view{ cage };
+
+				for (uint32_t faceIdx = 0; faceIdx < view.FaceCount(); faceIdx++)
+				{
+					const float3 point = HE_FacePoint(view, view.GetFace(faceIdx).begin);
+					HE_CHECK(point.x == scalarFaces.x[faceIdx] && point.y == scalarFaces.y[faceIdx] && point.z == scalarFaces.z[faceIdx]);
+				}
+			}
+
+			for (const HE_SoAKernel kernel : { HE_SoAKernel::AVX2, HE_SoAKernel::AVX512 })
+			{
+				if (kernel > HE_BestSoAKernel())
+					continue;
+
+				HE_SoAFacePoints(mesh, simdFaces, kernel, 3);
+				HE_SoAEdgePoints(mesh, scalarFaces, simdEdges, kernel, 3);
+
+				HE_CHECK(Equal(scalarFaces, simdFaces));
+				HE_CHECK(Equal(scalarEdges, simdEdges));
+			}
+		}
+	}
+}
+
+
+/**********************************************************************
+
+Copyright (c) 2024 Robert May
+
+Permission is hereby granted, free of charge, to any person obtaining a
+copy of this software and associated documentation files (the "Software"),
+to deal in the Software without restriction, including without limitation
+the rights to use, copy, modify, merge, publish, distribute, sublicense,
+and/or sell copies of the Software, and to permit persons to whom the
+Software is furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included
+in all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+**********************************************************************/
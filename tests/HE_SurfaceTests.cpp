@@ -0,0 +1,194 @@
+#include "HE_Tests.hpp"
+#include "SubdivisionSurfaceComponent.hpp"
+
+#include <cstring>
+#include <vector>
+
+
+using namespace FlexKit;
+
+
+/************************************************************************************************/
+
+
+// Axis-aligned box as a frustum, outward facing planes
+static Frustum BoxFrustum(const float3 min, const float3 max)
+{
+	const float normals[6][3]	= { { -1, 0, 0 }, { 1, 0, 0 }, { 0, -1, 0 }, { 0, 1, 0 }, { 0, 0, -1 }, { 0, 0, 1 } };
+	Frustum		frustum;
+
+	for (uint32_t planeIdx = 0; planeIdx < 6; planeIdx++)
+	{
+		const float3 origin = planeIdx % 2 ? max : min;
+
+		frustum.Planes[planeIdx].n.x = normals[planeIdx][0];
+		frustum.Planes[planeIdx].n.y = normals[planeIdx][1];
+		frustum.Planes[planeIdx].n.z = normals[planeIdx][2];
+		frustum.Planes[planeIdx].o.x = origin.x;
+		frustum.Planes[planeIdx].o.y = origin.y;
+		frustum.Planes[planeIdx].o.z = origin.z;
+	}
+
+	return frustum;
+}
+
+
+/************************************************************************************************/
+
+
+// Freed rows are filled from the back, the surviving handles have to keep reaching their own fields
+HE_TEST(Surfaces_CreateAndRemove)
+{
+	SubdivisionSurfaceComponent surfaces{ *SystemAllocator };
+
+	auto Bounds = [](const float x) -> HE_SurfaceBounds { return { float3{ x, 0.0f, 0.0f }, float3{ x + 1.0f, 1.0f, 1.0f } }; };
+
+	const SubdivisionSurfaceHandle a = CreateSubdivisionSurface(surfaces, HalfEdgeMeshHandle{ 0 }, Bounds(0.0f), { .maxLevel = 1 });
+	const SubdivisionSurfaceHandle b = CreateSubdivisionSurface(surfaces, HalfEdgeMeshHandle{ 1 }, Bounds(10.0f), { .maxLevel = 2 });
+	const SubdivisionSurfaceHandle c = CreateSubdivisionSurface(surfaces, HalfEdgeMeshHandle{ 2 }, Bounds(20.0f), { .maxLevel = 3 });
+
+	HE_CHECK(!(a == b) && !(b == c) && !(a == c));
+	HE_CHECK(surfaces.GetField<HE_SurfaceState>(b).flags == HE_SurfacePointsDirty);
+
+	surfaces.Remove(a);
+
+	HE_CHECK(HE_GetSurfaceFields(surfaces).Count() == 2);
+	HE_CHECK(surfaces.GetField<HE_SurfaceMesh>(b).mesh.to_uint() == 1);
+	HE_CHECK(surfaces.GetField<HE_SurfaceMesh>(c).mesh.to_uint() == 2);
+	HE_CHECK(surfaces.GetField<HE_SurfaceLOD>(c).maxLevel == 3);
+	HE_CHECK(surfaces.GetField<HE_SurfaceBounds>(c).min.x == 20.0f);
+
+	const SubdivisionSurfaceHandle d = CreateSubdivisionSurface(surfaces, HalfEdgeMeshHandle{ 3 }, Bounds(30.0f));
+
+	HE_CHECK(!(d == b) && !(d == c));
+	HE_CHECK(HE_GetSurfaceFields(surfaces).Count() == 3);
+	HE_CHECK(surfaces.GetField<HE_SurfaceMesh>(d).mesh.to_uint() == 3);
+	HE_CHECK(surfaces.GetField<HE_SurfaceBounds>(b).min.x == 10.0f);
+
+	// The sweep runs over the component's own columns, only the surfaces inside the view are gathered
+	HE_ViewState view;
+	view.position	= float3{ 10.5f, 0.5f, -5.0f };
+	view.frustum	= BoxFrustum(float3{ 5.0f, -5.0f, -10.0f }, float3{ 25.0f, 5.0f, 10.0f });
+	view.lodScale	= 100.0f;
+
+	Vector<uint32_t>	dirty{ SystemAllocator };
+	const auto			stats = UpdateSubdivisionSurfaces(surfaces, { &view, 1 }, dirty);
+
+	HE_CHECK(stats.instanceCount == 3);
+	HE_CHECK(stats.visible == 2);
+	HE_CHECK(stats.dirty == 2);
+	HE_CHECK(surfaces.GetField<HE_SurfaceState>(b).flags & HE_SurfaceVisible);
+	HE_CHECK(surfaces.GetField<HE_SurfaceState>(c).flags & HE_SurfaceVisible);
+	HE_CHECK(surfaces.GetField<HE_SurfaceState>(d).flags == HE_SurfacePointsDirty);
+
+	const auto meshes = surfaces.GetFieldArray<HE_SurfaceMesh>();
+	for (const uint32_t row : dirty)
+		HE_CHECK(meshes[row].mesh.to_uint() == 1 || meshes[row].mesh.to_uint() == 2);
+
+	surfaces.Remove(b);
+	surfaces.Remove(c);
+	surfaces.Remove(d);
+
+	HE_CHECK(HE_GetSurfaceFields(surfaces).Count() == 0);
+}
+
+
+/************************************************************************************************/
+
+
+// Chunked over several threads the sweep has to write the same levels and flags, and gather the
+// same dirty rows in the same order, as a single pass over every surface, frame after frame
+HE_TEST(Surfaces_ChunkedSweepMatchesSerial)
+{
+	constexpr uint32_t surfaceCount = 5000;
+
+	std::vector<HE_SurfaceLOD>		lods(surfaceCount);
+	std::vector<HE_SurfaceBounds>	bounds(surfaceCount);
+	std::vector<HE_SurfaceState>	states(surfaceCount);
+
+	uint32_t seed = 12345;
+	auto Random = [&]() { seed = seed * 1664525u + 1013904223u; return float(seed >> 8) / float(1u << 24); };
+
+	for (uint32_t idx = 0; idx < surfaceCount; idx++)
+	{
+		const float3 center	= float3{ Random() * 200.0f - 100.0f, Random() * 200.0f - 100.0f, Random() * 200.0f - 100.0f };
+		const float3 extent	= float3{ Random() * 4.0f, Random() * 4.0f, Random() * 4.0f };
+
+		bounds[idx]				= { center - extent, center + extent };
+		lods[idx].targetPixels	= 8.0f + Random() * 24.0f;
+		lods[idx].maxLevel		= uint8_t(idx % 5);
+		states[idx].flags		= idx % 7 == 0 ? uint32_t(HE_SurfacePointsDirty) : 0u;
+	}
+
+	std::vector<HE_SurfaceLOD>		serialLODs		= lods;
+	std::vector<HE_SurfaceState>	serialStates	= states;
+
+	const HE_SurfaceFields chunked	{ lods, bounds, states };
+	const HE_SurfaceFields serial	{ serialLODs, bounds, serialStates };
+
+	uint32_t visibleSeen = 0;
+	uint32_t changedSeen = 0;
+
+	for (uint32_t frame = 0; frame < 8; frame++)
+	{
+		HE_ViewState views[2];
+		views[0].position	= float3{ -60.0f + 15.0f * frame, 0.0f, -120.0f };
+		views[0].frustum	= BoxFrustum(float3{ -80.0f + 15.0f * frame, -60.0f, -100.0f }, float3{ 20.0f + 15.0f * frame, 60.0f, 40.0f });
+		views[0].lodScale	= 800.0f;
+		views[1].position	= float3{ 50.0f, 50.0f, 150.0f - 20.0f * frame };
+		views[1].frustum	= BoxFrustum(float3{ 0.0f, 0.0f, -20.0f * frame }, float3{ 100.0f, 100.0f, 100.0f });
+		views[1].lodScale	= 400.0f;
+
+		// Marked between frames, as an owner moving points would
+		for (uint32_t idx = frame; idx < surfaceCount; idx += 97)
+		{
+			states[idx].flags		|= HE_SurfacePointsDirty;
+			serialStates[idx].flags	|= HE_SurfacePointsDirty;
+		}
+
+		Vector<uint32_t> chunkedDirty{ SystemAllocator };
+		Vector<uint32_t> serialDirty{ SystemAllocator };
+
+		const auto chunkedStats	= UpdateSubdivisionSurfaces(chunked, views, chunkedDirty, { .threadCount = 4, .chunkSize = 64 });
+		const auto serialStats	= UpdateSubdivisionSurfaces(serial, views, serialDirty, { .threadCount = 1, .chunkSize = surfaceCount });
+
+		HE_CHECK(chunkedStats.visible == serialStats.visible);
+		HE_CHECK(chunkedStats.levelChanged == serialStats.levelChanged);
+		HE_CHECK(chunkedStats.dirty == serialStats.dirty);
+		HE_CHECK(chunkedDirty.size() == serialDirty.size() && !memcmp(chunkedDirty.data(), serialDirty.data(), chunkedDirty.size() * sizeof(uint32_t)));
+		HE_CHECK(!memcmp(lods.data(), serialLODs.data(), surfaceCount * sizeof(HE_SurfaceLOD)));
+		HE_CHECK(!memcmp(states.data(), serialStates.data(), surfaceCount * sizeof(HE_SurfaceState)));
+
+		visibleSeen += serialStats.visible;
+		changedSeen += serialStats.levelChanged;
+	}
+
+	// Every outcome was exercised, culled, visible and relevelled
+	HE_CHECK(visibleSeen > 0 && visibleSeen < 8 * surfaceCount);
+	HE_CHECK(changedSeen > 0);
+}
+
+
+/**********************************************************************
+
+Copyright (c) 2024 Robert May
+
+Permission is hereby granted, free of charge, to any person obtaining a
+copy of this software and associated documentation files (the "Software"),
+to deal in the Software without restriction, including without limitation
+the rights to use, copy, modify, merge, publish, distribute, sublicense,
+and/or sell copies of the Software, and to permit persons to whom the
+Software is furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included
+in all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+**********************************************************************/
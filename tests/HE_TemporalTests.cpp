@@ -0,0 +1,239 @@
+#include "HE_Tests.hpp"
+#include "HalfEdgeTemporal.hpp"
+
+#include <algorithm>
+#include <vector>
+
+
+using namespace FlexKit;
+
+
+/************************************************************************************************/
+
+
+// Shallow enough that the face cones stay narrow and the grid's back can be cone culled
+static float Swell(uint32_t x, uint32_t y) { return float((x * 5 + y * 11) % 7) * 0.02f; }
+
+
+// Axis-aligned box as a frustum, outward facing planes
+static Frustum BoxFrustum(const float3 min, const float3 max)
+{
+	const float normals[6][3]	= { { -1, 0, 0 }, { 1, 0, 0 }, { 0, -1, 0 }, { 0, 1, 0 }, { 0, 0, -1 }, { 0, 0, 1 } };
+	Frustum		frustum;
+
+	for (uint32_t planeIdx = 0; planeIdx < 6; planeIdx++)
+	{
+		const float3 origin = planeIdx % 2 ? max : min;
+
+		frustum.Planes[planeIdx].n.x = normals[planeIdx][0];
+		frustum.Planes[planeIdx].n.y = normals[planeIdx][1];
+		frustum.Planes[planeIdx].n.z = normals[planeIdx][2];
+		frustum.Planes[planeIdx].o.x = origin.x;
+		frustum.Planes[planeIdx].o.y = origin.y;
+		frustum.Planes[planeIdx].o.z = origin.z;
+	}
+
+	return frustum;
+}
+
+
+// A window sliding over the grid, the camera above it or, for a stretch of frames, below it
+static std::vector<HE_ReplayFrame> RecordCameraPath()
+{
+	std::vector<HE_ReplayFrame> frames;
+
+	for (uint32_t frameIdx = 0; frameIdx < 40; frameIdx++)
+	{
+		const float	x		= 0.4f * float(frameIdx);
+		const float	height	= frameIdx >= 20 && frameIdx < 26 ? -12.0f : 12.0f;
+
+		HE_ReplayFrame frame;
+		frame.view.position	= float3{ x + 5.0f, 12.0f, height };
+		frame.view.frustum	= BoxFrustum(float3{ x, 4.0f, -5.0f }, float3{ x + 10.0f, 20.0f, 5.0f });
+		frame.cageVersion	= frameIdx >= 30 ? 1 : 0;
+
+		frames.push_back(frame);
+
+		// Every fifth frame the camera shakes by less than the skip threshold
+		if (frameIdx % 5 == 4)
+		{
+			frame.view.position.x += 1.0e-5f;
+			frames.push_back(frame);
+		}
+	}
+
+	return frames;
+}
+
+
+static std::vector<bool> BruteForceVisible(const HE_ControlCage& cage, const HE_NormalCones& cones, const HE_ViewState& view)
+{
+	std::vector<bool> visible(cage.faces.size());
+
+	for (uint32_t faceIdx = 0; faceIdx < cage.faces.size(); faceIdx++)
+	{
+		const HE_PatchBounds& bounds = cones.Bounds(faceIdx);
+
+		visible[faceIdx] =
+			HE_Intersects(view.frustum, bounds.min, bounds.max) &&
+			!IsBackFacing(cones.Cluster(faceIdx), view.position) &&
+			!IsBackFacing(cones.Face(faceIdx), view.position);
+	}
+
+	return visible;
+}
+
+
+/************************************************************************************************/
+
+
+// Replays a recorded camera path frame by frame. Every rebuilt frame has to report exactly the faces
+// that entered and left against a brute-force cull of the frame before, frames moving less than the
+// skip threshold have to change nothing.
+HE_TEST(Temporal_ReplayMatchesBruteForce)
+{
+	const HE_ControlCage				cage	= HE_TestGrid(32, *SystemAllocator, Swell);
+	const HE_NormalCones				cones	= BuildNormalCones(cage, *SystemAllocator);
+	const std::vector<HE_ReplayFrame>	frames	= RecordCameraPath();
+
+	HE_VisibilityTracker	tracker{ *SystemAllocator };
+	std::vector<bool>		lastVisible(cage.faces.size(), false);
+	uint32_t				skipped		= 0;
+	uint32_t				incremental	= 0;
+	uint32_t				coneCulled	= 0;
+
+	for (size_t frameIdx = 0; frameIdx < frames.size(); frameIdx++)
+	{
+		const HE_ReplayFrame&	frame	= frames[frameIdx];
+		const HE_RefineAction	action	= tracker.Update(cage, cones, frame.view, frame.cageVersion);
+
+		if (action == HE_RefineAction::Skip)
+		{
+			HE_CHECK(frameIdx % 6 == 5);
+			HE_CHECK(tracker.entered.empty() && tracker.left.empty() && tracker.refineList.empty());
+
+			for (uint32_t faceIdx = 0; faceIdx < cage.faces.size(); faceIdx++)
+				HE_CHECK(bool((tracker.visible[faceIdx / 64] >> (faceIdx % 64)) & 1) == lastVisible[faceIdx]);
+
+			skipped++;
+			continue;
+		}
+
+		const std::vector<bool> expected = BruteForceVisible(cage, cones, frame.view);
+
+		std::vector<uint32_t> entered;
+		std::vector<uint32_t> left;
+		std::vector<uint32_t> visible;
+
+		for (uint32_t faceIdx = 0; faceIdx < cage.faces.size(); faceIdx++)
+		{
+			if (expected[faceIdx] && !lastVisible[faceIdx])
+				entered.push_back(faceIdx);
+			if (!expected[faceIdx] && lastVisible[faceIdx])
+				left.push_back(faceIdx);
+			if (expected[faceIdx])
+				visible.push_back(faceIdx);
+
+			HE_CHECK(bool((tracker.visible[faceIdx / 64] >> (faceIdx % 64)) & 1) == expected[faceIdx]);
+		}
+
+		HE_CHECK(std::ranges::equal(tracker.entered, entered));
+		HE_CHECK(std::ranges::equal(tracker.left, left));
+
+		// Without a lodScale every level stays zero, an incremental frame only refines what entered
+		std::vector<uint32_t> refined{ tracker.refineList.begin(), tracker.refineList.end() };
+		std::ranges::sort(refined);
+
+		if (action == HE_RefineAction::Incremental)
+		{
+			HE_CHECK(std::ranges::equal(refined, entered));
+			incremental++;
+		}
+		else
+			HE_CHECK(std::ranges::equal(refined, visible));
+
+		for (uint32_t faceIdx = 0; faceIdx < cage.faces.size(); faceIdx++)
+		{
+			const HE_PatchBounds& bounds = cones.Bounds(faceIdx);
+			coneCulled += !expected[faceIdx] && HE_Intersects(frame.view.frustum, bounds.min, bounds.max) ? 1 : 0;
+		}
+
+		lastVisible = expected;
+	}
+
+	HE_CHECK(skipped == 8);
+	HE_CHECK(incremental > 0);
+	HE_CHECK(coneCulled > 0);	// The frames below the grid see its back
+
+	const HE_ReplayStats stats = ReplayVisibility(cage, cones, frames, *SystemAllocator);
+
+	HE_CHECK(stats.frames == frames.size());
+	HE_CHECK(stats.skipped == skipped);
+	HE_CHECK(stats.incremental == incremental);
+	HE_CHECK(stats.mismatches == 0);
+	HE_CHECK(stats.facesRefined < stats.facesRefinedAlways);
+}
+
+
+/************************************************************************************************/
+
+
+// Moves under the threshold are skipped, but they are measured against the last rebuild, so a slow
+// drift still rebuilds once it adds up
+HE_TEST(Temporal_SkipUnderThreshold)
+{
+	const HE_ControlCage	cage	= HE_TestGrid(8, *SystemAllocator, Swell);
+	const HE_NormalCones	cones	= BuildNormalCones(cage, *SystemAllocator);
+
+	HE_VisibilityTracker tracker{ *SystemAllocator };
+
+	HE_ViewState view;
+	view.position	= float3{ 4.0f, 4.0f, 10.0f };
+	view.frustum	= BoxFrustum(float3{ 1.0f, 1.0f, -5.0f }, float3{ 6.0f, 6.0f, 5.0f });
+
+	HE_CHECK(tracker.Update(cage, cones, view, 0) == HE_RefineAction::Full);
+	HE_CHECK(tracker.refineList.size() > 0);
+
+	const float step = tracker.detector.options.skipThreshold * 0.6f;
+
+	view.position.x += step;
+	HE_CHECK(tracker.Update(cage, cones, view, 0) == HE_RefineAction::Skip);
+	HE_CHECK(tracker.refineList.empty());
+
+	view.position.x += step;
+	HE_CHECK(tracker.Update(cage, cones, view, 0) != HE_RefineAction::Skip);
+
+	// Nothing entered or left, the rebuild has nothing new to refine
+	HE_CHECK(tracker.entered.empty() && tracker.left.empty());
+
+	view.position.x += step;
+	HE_CHECK(tracker.Update(cage, cones, view, 0) == HE_RefineAction::Skip);
+
+	// A cage edit rebuilds whatever the view did
+	HE_CHECK(tracker.Update(cage, cones, view, 1) == HE_RefineAction::Full);
+}
+
+
+/**********************************************************************
+
+Copyright (c) 2024 Robert May
+
+Permission is hereby granted, free of charge, to any person obtaining a
+copy of this software and associated documentation files (the "Software"),
+to deal in the Software without restriction, including without limitation
+the rights to use, copy, modify, merge, publish, distribute, sublicense,
+and/or sell copies of the Software, and to permit persons to whom the
+Software is furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included
+in all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+**********************************************************************/
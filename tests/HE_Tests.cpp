@@ -0,0 +1,171 @@
+#include "HE_Tests.hpp"
+#include "HalfEdgeValidation.hpp"
+
+#include <cmath>
+#include <cstring>
+#include <numbers>
+
+
+namespace FlexKit
+{	/************************************************************************************************/
+
+
+	std::vector<HE_TestCase>& HE_TestCases()
+	{
+		static std::vector<HE_TestCase> cases;
+		return cases;
+	}
+
+
+	/************************************************************************************************/
+
+
+	HE_ControlCage HE_TestGrid(const uint32_t N, iAllocator& allocator, float (*height)(uint32_t x, uint32_t y))
+	{
+		ModifiableShape shape{};
+
+		for (uint32_t y = 0; y <= N; y++)
+			for (uint32_t x = 0; x <= N; x++)
+				shape.AddVertex({ float(x), float(y), height ? height(x, y) : 0.0f });
+
+		for (uint32_t y = 0; y < N; y++)
+		{
+			for (uint32_t x = 0; x < N; x++)
+			{
+				const uint32_t corner	= y * (N + 1) + x;
+				const uint32_t quad[]	= { corner, corner + 1, corner + N + 2, corner + N + 1 };
+
+				shape.AddPolygon(quad, quad + 4);
+			}
+		}
+
+		return BuildControlCage(shape, allocator);
+	}
+
+
+	/************************************************************************************************/
+
+
+	HE_ControlCage HE_TestCube(iAllocator& allocator)
+	{
+		ModifiableShape shape{};
+
+		for (uint32_t corner = 0; corner < 8; corner++)
+			shape.AddVertex({ corner & 1 ? 1.0f : -1.0f, corner & 2 ? 1.0f : -1.0f, corner & 4 ? 1.0f : -1.0f });
+
+		const uint32_t quads[6][4] = {
+			{ 0, 2, 3, 1 },
+			{ 4, 5, 7, 6 },
+			{ 0, 1, 5, 4 },
+			{ 2, 6, 7, 3 },
+			{ 0, 4, 6, 2 },
+			{ 1, 3, 7, 5 },
+		};
+
+		for (const auto& quad : quads)
+			shape.AddPolygon(quad, quad + 4);
+
+		return BuildControlCage(shape, allocator);
+	}
+
+
+	/************************************************************************************************/
+
+
+	HE_ControlCage HE_TestFan(const uint32_t valence, const bool closed, iAllocator& allocator)
+	{
+		ModifiableShape shape{};
+
+		const uint32_t	center	= shape.AddVertex({ 0.0f, 0.0f, 1.0f });
+		const uint32_t	ring	= closed ? valence : valence + 1;
+
+		for (uint32_t idx = 0; idx < ring; idx++)
+		{
+			const float angle = 2.0f * std::numbers::pi_v<float> * float(idx) / float(closed ? valence : valence + 1);
+			shape.AddVertex({ std::cos(angle), std::sin(angle), 0.0f });
+		}
+
+		for (uint32_t idx = 0; idx < valence; idx++)
+		{
+			const uint32_t triangle[] = { center, 1 + idx, 1 + (idx + 1) % ring };
+			shape.AddPolygon(triangle, triangle + 3);
+		}
+
+		return BuildControlCage(shape, allocator);
+	}
+
+
+	/************************************************************************************************/
+
+
+	bool HE_IsValid(const HE_ControlCage& cage, iAllocator& allocator)
+	{
+		auto report = ValidateControlCage(cage, allocator);
+
+		for (const auto& error : report.errors)
+			fprintf(stderr, "    validation: %s at %u\n", HE_ValidationErrorString(error.code), error.element);
+
+		return report.IsValid();
+	}
+
+
+}	/************************************************************************************************/
+
+
+// hetests [filter]
+//
+// Runs every registered test whose name contains the filter, returns the number of failed tests.
+
+
+int main(int argc, char* argv[])
+{
+	using namespace FlexKit;
+
+	const char*	filter = argc > 1 ? argv[1] : nullptr;
+	int			failed = 0;
+	uint32_t	run		= 0;
+
+	for (const auto& test : HE_TestCases())
+	{
+		if (filter && !strstr(test.name, filter))
+			continue;
+
+		HE_TestContext context;
+		test.fn(context);
+		run++;
+
+		printf("%-48s %s\n", test.name, context.failures ? "FAILED" : "ok");
+
+		if (context.failures)
+			failed++;
+	}
+
+	printf("%u tests, %d failed\n", run, failed);
+
+	return failed;
+}
+
+
+/**********************************************************************
+
+Copyright (c) 2024 Robert May
+
+Permission is hereby granted, free of charge, to any person obtaining a
+copy of this software and associated documentation files (the "Software"),
+to deal in the Software without restriction, including without limitation
+the rights to use, copy, modify, merge, publish, distribute, sublicense,
+and/or sell copies of the Software, and to permit persons to whom the
+Software is furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included
+in all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+**********************************************************************/
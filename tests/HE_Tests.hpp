@@ -0,0 +1,91 @@
+#pragma once
+#include "HalfEdgeCPU.hpp"
+
+#include <cstdio>
+#include <vector>
+
+
+// Registry for the hetests executable. Each HE_TEST runs once, HE_CHECK logs and counts a failure
+// without stopping the test, so one run reports every broken check.
+
+
+namespace FlexKit
+{	/************************************************************************************************/
+
+
+	struct HE_TestContext
+	{
+		uint32_t failures = 0;
+
+		void Fail(const char* file, const int line, const char* expression)
+		{
+			fprintf(stderr, "%s(%d): check failed: %s\n", file, line, expression);
+			failures++;
+		}
+	};
+
+
+	using HE_TestFn = void (*)(HE_TestContext&);
+
+	struct HE_TestCase
+	{
+		const char*	name;
+		HE_TestFn	fn;
+	};
+
+
+	std::vector<HE_TestCase>& HE_TestCases();
+
+	struct HE_TestRegistration
+	{
+		HE_TestRegistration(const char* name, HE_TestFn fn) { HE_TestCases().push_back({ name, fn }); }
+	};
+
+
+	/************************************************************************************************/
+
+
+	// Quads on an N by N grid of unit cells in the xy plane, with z from the height function
+	HE_ControlCage	HE_TestGrid(const uint32_t N, iAllocator& allocator, float (*height)(uint32_t x, uint32_t y) = nullptr);
+	HE_ControlCage	HE_TestCube(iAllocator& allocator);
+
+	// A fan of triangles around one vertex, closed when the fan goes all the way round
+	HE_ControlCage	HE_TestFan(const uint32_t valence, const bool closed, iAllocator& allocator);
+
+	bool			HE_IsValid(const HE_ControlCage& cage, iAllocator& allocator);
+
+
+}	/************************************************************************************************/
+
+
+#define HE_TEST(NAME)																	\
+	static void NAME(FlexKit::HE_TestContext& context);									\
+	static FlexKit::HE_TestRegistration NAME##_registration{ #NAME, NAME };				\
+	static void NAME(FlexKit::HE_TestContext& context)
+
+#define HE_CHECK(EXPRESSION) do { if (!(EXPRESSION)) context.Fail(__FILE__, __LINE__, #EXPRESSION); } while (false)
+
+
+/**********************************************************************
+
+Copyright (c) 2024 Robert May
+
+Permission is hereby granted, free of charge, to any person obtaining a
+copy of this software and associated documentation files (the "Software"),
+to deal in the Software without restriction, including without limitation
+the rights to use, copy, modify, merge, publish, distribute, sublicense,
+and/or sell copies of the Software, and to permit persons to whom the
+Software is furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included
+in all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+**********************************************************************/
@@ -0,0 +1,168 @@
+#include "HE_Tests.hpp"
+#include "HalfEdgeTopologyCodec.hpp"
+
+#include <cstring>
+
+
+using namespace FlexKit;
+
+
+/************************************************************************************************/
+
+
+static float Bumps(uint32_t x, uint32_t y) { return float((x * 7 + y * 3) % 5) * 0.25f; }
+
+
+/************************************************************************************************/
+
+
+HE_TEST(TopologyCodec_RoundTrip)
+{
+	for (const uint32_t blockFaces : { 1u, 7u, 1u << 14 })
+	{
+		HE_ControlCage			cage = HE_TestGrid(24, *SystemAllocator, Bumps);
+		std::vector<uint8_t>	encoded;
+
+		HE_CHECK(EncodeTopology(cage, encoded, *SystemAllocator, { .blockFaces = blockFaces }).Succeeded());
+
+		HE_ControlCage	decoded{ *SystemAllocator };
+		size_t			bytesRead	= 0;
+		const auto		stats		= DecodeTopology(encoded, decoded, *SystemAllocator, 0, &bytesRead);
+
+		HE_CHECK(stats.Succeeded());
+		HE_CHECK(bytesRead == encoded.size());
+		HE_CHECK(decoded.halfEdges.size() == cage.halfEdges.size());
+		HE_CHECK(decoded.faces.size() == cage.faces.size());
+		HE_CHECK(decoded.vertexCount == cage.vertexCount);
+		HE_CHECK(memcmp(decoded.halfEdges.data(), cage.halfEdges.data(), cage.halfEdges.ByteSize()) == 0);
+		HE_CHECK(memcmp(decoded.faces.data(), cage.faces.data(), cage.faces.ByteSize()) == 0);
+		HE_CHECK(memcmp(decoded.faceLookup.data(), cage.faceLookup.data(), cage.faceLookup.ByteSize()) == 0);
+	}
+}
+
+
+/************************************************************************************************/
+
+
+HE_TEST(TopologyCodec_Truncated)
+{
+	HE_ControlCage			cage = HE_TestGrid(12, *SystemAllocator);
+	std::vector<uint8_t>	encoded;
+
+	EncodeTopology(cage, encoded, *SystemAllocator, { .blockFaces = 16 });
+
+	// Every prefix shorter than the stream must be refused, never read past its end
+	for (size_t size = 0; size < encoded.size(); size++)
+	{
+		std::vector<uint8_t>	prefix{ encoded.begin(), encoded.begin() + size };
+		HE_ControlCage			decoded{ *SystemAllocator };
+
+		HE_CHECK(!DecodeTopology(prefix, decoded, *SystemAllocator).Succeeded());
+	}
+}
+
+
+/************************************************************************************************/
+
+
+HE_TEST(TopologyCodec_CorruptBlockTable)
+{
+	HE_ControlCage			cage = HE_TestGrid(12, *SystemAllocator);
+	std::vector<uint8_t>	encoded;
+
+	EncodeTopology(cage, encoded, *SystemAllocator, { .blockFaces = 16 });
+
+	HE_TopologyHeader header;
+	memcpy(&header, encoded.data(), sizeof(header));
+	HE_CHECK(header.blockCount > 2);
+
+	auto Corrupt =
+		[&](auto&& edit)
+		{
+			std::vector<uint8_t>	copy		= encoded;
+			HE_TopologyHeader*		copyHeader	= reinterpret_cast<HE_TopologyHeader*>(copy.data());
+			HE_TopologyBlock*		blocks		= reinterpret_cast<HE_TopologyBlock*>(copy.data() + sizeof(HE_TopologyHeader));
+			HE_ControlCage			decoded{ *SystemAllocator };
+
+			edit(*copyHeader, blocks);
+
+			return !DecodeTopology(copy, decoded, *SystemAllocator).Succeeded();
+		};
+
+	HE_CHECK(Corrupt([](HE_TopologyHeader&, HE_TopologyBlock* blocks) { blocks[1].firstHalfEdge = 0xfffffff0; }));
+	HE_CHECK(Corrupt([](HE_TopologyHeader&, HE_TopologyBlock* blocks) { blocks[2].firstHalfEdge = blocks[1].firstHalfEdge - 4; }));
+	HE_CHECK(Corrupt([](HE_TopologyHeader&, HE_TopologyBlock* blocks) { blocks[0].firstHalfEdge = 4; }));
+	HE_CHECK(Corrupt([](HE_TopologyHeader&, HE_TopologyBlock* blocks) { blocks[1].firstFace = 0xfffffff0; }));
+	HE_CHECK(Corrupt([](HE_TopologyHeader&, HE_TopologyBlock* blocks) { blocks[1].byteOffset = 0x7fffffff; }));
+	HE_CHECK(Corrupt([](HE_TopologyHeader& header, HE_TopologyBlock*) { header.halfEdgeCount = 0xffffffff; }));
+	HE_CHECK(Corrupt([](HE_TopologyHeader& header, HE_TopologyBlock*) { header.faceCount += 1; }));
+	HE_CHECK(Corrupt([](HE_TopologyHeader& header, HE_TopologyBlock*) { header.vertexCount = 4; }));
+	HE_CHECK(Corrupt([](HE_TopologyHeader& header, HE_TopologyBlock*) { header.blockCount = 0; }));
+}
+
+
+/************************************************************************************************/
+
+
+HE_TEST(TopologyCodec_CorruptExceptions)
+{
+	// The grid needs no exceptions, each test appends one that overrides half-edge 0, a border edge
+	HE_ControlCage			cage = HE_TestGrid(2, *SystemAllocator);
+	std::vector<uint8_t>	encoded;
+
+	EncodeTopology(cage, encoded, *SystemAllocator);
+
+	HE_TopologyHeader header;
+	memcpy(&header, encoded.data(), sizeof(header));
+
+	auto WithException =
+		[&](const uint8_t delta, const std::vector<uint8_t>& twin)
+		{
+			std::vector<uint8_t> copy = encoded;
+			copy.resize(copy.size() - header.exceptionBytes);
+
+			copy.push_back(delta);
+			copy.insert(copy.end(), twin.begin(), twin.end());
+			copy.push_back(0);
+
+			HE_TopologyHeader* copyHeader	= reinterpret_cast<HE_TopologyHeader*>(copy.data());
+			copyHeader->exceptionCount		= 1;
+			copyHeader->exceptionBytes		= uint32_t(2 + twin.size());
+
+			HE_ControlCage decoded{ *SystemAllocator };
+			return DecodeTopology(copy, decoded, *SystemAllocator);
+		};
+
+	HE_CHECK(header.exceptionCount == 0);
+	HE_CHECK(!WithException(0, { 0xff, 0xff, 0xff, 0x7f }).Succeeded());	// Twin far out of range
+	HE_CHECK(!WithException(0, { uint8_t(header.halfEdgeCount) }).Succeeded());	// Twin one past the end
+	HE_CHECK(!WithException(0, { 0 }).Succeeded());								// Twin to itself
+	HE_CHECK(!WithException(0, { 2 }).Succeeded());								// Twin that does not point back
+	HE_CHECK(!WithException(0x7f, { 0 }).Succeeded());							// Half-edge out of range
+	HE_CHECK(WithException(0, { 0xff, 0xff, 0xff, 0xff, 0x0f }).Succeeded());			// Border, as rebuilt
+}
+
+
+/**********************************************************************
+
+Copyright (c) 2024 Robert May
+
+Permission is hereby granted, free of charge, to any person obtaining a
+copy of this software and associated documentation files (the "Software"),
+to deal in the Software without restriction, including without limitation
+the rights to use, copy, modify, merge, publish, distribute, sublicense,
+and/or sell copies of the Software, and to permit persons to whom the
+Software is furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included
+in all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+**********************************************************************/
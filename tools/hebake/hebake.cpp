@@ -0,0 +1,194 @@
+#include "HalfEdgeBake.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <mutex>
+#include <string_view>
+#include <thread>
+#include <vector>
+
+
+/************************************************************************************************/
+
+
+// hebake <input dir> <output dir> [--level N] [--format obj|ply|raw|hep] [--jobs N] [--threads N] [--shared]
+//
+// Subdivides every OBJ in the input directory without a window or device. Files are baked by a
+// pool of --jobs workers, each level build uses --threads threads.
+
+
+void PrintUsage()
+{
+	printf(
+		"usage: hebake <input dir> <output dir> [options]\n"
+		"  --level N        level to write, 0 is the first subdivision (default 1)\n"
+		"  --format F       obj, ply, raw or hep, progressive residuals (default obj)\n"
+		"  --jobs N         files baked concurrently (default: hardware threads)\n"
+		"  --threads N      threads per file (default 1)\n"
+		"  --shared         store each vertex, edge and face point once\n");
+}
+
+
+int main(int argc, char* argv[])
+{
+	using namespace FlexKit;
+
+	if (argc < 3)
+	{
+		PrintUsage();
+		return 1;
+	}
+
+	const std::filesystem::path inputDir	= argv[1];
+	const std::filesystem::path outputDir	= argv[2];
+
+	HE_BakeOptions	options;
+	uint32_t		jobCount = Max(std::thread::hardware_concurrency(), 1u);
+
+	for (int argIdx = 3; argIdx < argc; argIdx++)
+	{
+		const std::string_view	arg		= argv[argIdx];
+		const char*				value	= argIdx + 1 < argc ? argv[argIdx + 1] : nullptr;
+
+		if (arg == "--shared")
+		{
+			options.indexMode = HE_IndexMode::Shared;
+			continue;
+		}
+
+		if (!value)
+		{
+			PrintUsage();
+			return 1;
+		}
+
+		if (arg == "--level")
+			options.level = (uint32_t)std::atoi(value);
+		else if (arg == "--jobs")
+			jobCount = Max((uint32_t)std::atoi(value), 1u);
+		else if (arg == "--threads")
+			options.threadCount = Max((uint32_t)std::atoi(value), 1u);
+		else if (arg == "--format")
+		{
+			const std::string_view format = value;
+
+			if (format == "obj")		options.format = HE_BakeFormat::OBJ;
+			else if (format == "ply")	options.format = HE_BakeFormat::PLY;
+			else if (format == "raw")	options.format = HE_BakeFormat::Raw;
+			else if (format == "hep")	options.format = HE_BakeFormat::Progressive;
+			else
+			{
+				PrintUsage();
+				return 1;
+			}
+		}
+		else
+		{
+			PrintUsage();
+			return 1;
+		}
+
+		argIdx++;
+	}
+
+	std::error_code ec;
+
+	std::vector<std::filesystem::path> inputs;
+	for (const auto& entry : std::filesystem::directory_iterator{ inputDir, ec })
+	{
+		auto extension = entry.path().extension().string();
+		std::transform(extension.begin(), extension.end(), extension.begin(), [](char c) { return (char)std::tolower(c); });
+
+		if (entry.is_regular_file() && extension == ".obj")
+			inputs.push_back(entry.path());
+	}
+
+	if (ec || inputs.empty())
+	{
+		printf("hebake: no .obj files in %s\n", inputDir.string().c_str());
+		return 1;
+	}
+
+	std::filesystem::create_directories(outputDir, ec);
+
+	// Largest first, so a big file does not start last and leave the other workers idle
+	std::sort(inputs.begin(), inputs.end(),
+		[](const auto& lhs, const auto& rhs)
+		{
+			return std::filesystem::file_size(lhs) > std::filesystem::file_size(rhs);
+		});
+
+	const auto begin = std::chrono::high_resolution_clock::now();
+
+	std::atomic_uint32_t	nextInput	= 0;
+	std::atomic_uint32_t	failures	= 0;
+	std::mutex				printLock;
+
+	auto Worker = [&]
+	{
+		for (uint32_t inputIdx = nextInput++; inputIdx < inputs.size(); inputIdx = nextInput++)
+		{
+			const HE_BakeResult result = BakeFile(inputs[inputIdx], outputDir, options, *SystemAllocator);
+
+			std::scoped_lock lock{ printLock };
+
+			if (result.Succeeded())
+			{
+				printf("%-32s faces %8u  L%u patches %10u  load %8.1fms  subdivide %8.1fms  write %8.1fms  %8.1fMB  peak RSS %6.0fMB\n",
+					result.input.filename().string().c_str(), result.faceCount, result.level, result.patchCount,
+					result.loadTime, result.subdivideTime, result.writeTime,
+					result.bytesWritten / double(MEGABYTE), HE_PeakRSS() / double(MEGABYTE));
+
+				if (result.compressionRatio > 0.0)
+					printf("%-32s compression %6.2fx  decode %8.2fM points/s\n", "", result.compressionRatio, result.decodeRate / 1000000.0);
+			}
+			else
+			{
+				printf("%-32s failed: %s\n", result.input.filename().string().c_str(), result.error.c_str());
+				failures++;
+			}
+		}
+	};
+
+	{
+		std::vector<std::jthread> workers;
+		for (uint32_t workerIdx = 1; workerIdx < Min(jobCount, (uint32_t)inputs.size()); workerIdx++)
+			workers.emplace_back(Worker);
+
+		Worker();
+	}
+
+	const double duration = std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - begin).count();
+
+	printf("hebake: %u files, %u failed, %.1fms, %u jobs, peak RSS %.0fMB\n",
+		(uint32_t)inputs.size(), failures.load(), duration, jobCount, HE_PeakRSS() / double(MEGABYTE));
+
+	return failures ? 1 : 0;
+}
+
+
+/**********************************************************************
+
+Copyright (c) 2024 Robert May
+
+Permission is hereby granted, free of charge, to any person obtaining a
+copy of this software and associated documentation files (the "Software"),
+to deal in the Software without restriction, including without limitation
+the rights to use, copy, modify, merge, publish, distribute, sublicense,
+and/or sell copies of the Software, and to permit persons to whom the
+Software is furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included
+in all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+**********************************************************************/